@@ -0,0 +1,252 @@
+//NEWCODE
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Library source file
+ * Module: GLOBAL
+ * Desc.:  Definition class AsyncLogWriter
+ * ------------------------------------------------------------------- */
+
+#include "lhotse/global.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cmath>
+#include <sys/time.h>
+
+// Static members
+
+const int AsyncLogWriter::flushBatch;
+const int AsyncLogWriter::flushPeriodic;
+const int AsyncLogWriter::flushClose;
+const int AsyncLogWriter::defCapacity;
+const int AsyncLogWriter::defSlotSize;
+const int AsyncLogWriter::defFlushMSec;
+
+static inline double alwNowMSec()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv,0);
+  return 1e3*((double) tv.tv_sec)+1e-3*((double) tv.tv_usec);
+}
+
+AsyncLogWriter::AsyncLogWriter(ostream& pos,int capacity,int ppolicy,
+			       int pflushMS,int pslotSize) :
+  os(pos),policy(ppolicy),flushMSec(pflushMS),slotSize(pslotSize),enqPos(0),
+  deqPos(0),nDropped(0),nWritten(0),nDropReported(0),stopReq(0),idle(0),
+  flushReq(0),flushDone(0)
+{
+  long i,cap;
+
+  if (capacity<1 || ppolicy<flushBatch || ppolicy>flushClose || pflushMS<0 ||
+      pslotSize<1)
+    throw InvalidParameterException("AsyncLogWriter: Invalid parameters");
+  for (cap=2; cap<capacity; cap*=2);
+  mask=cap-1;
+  slots.resize(cap); slotData.resize(cap*slotSize);
+  for (i=0; i<cap; i++) {
+    Slot& sl=slots[i];
+    sl.seq=i; sl.len=0; sl.ext=0; sl.data=&slotData[i*slotSize];
+  }
+  wBuff.reserve(65536);
+  pthread_mutex_init(&mutex,0);
+  pthread_cond_init(&cond,0);
+  pthread_cond_init(&flushCond,0);
+  if (pthread_create(&thrId,0,writerMain,(void*) this)!=0) {
+    pthread_cond_destroy(&flushCond);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+    throw WrongStatusException("AsyncLogWriter: Cannot start writer thread");
+  }
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+  pthread_mutex_lock(&mutex);
+  stopReq=1;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(thrId,0);
+  pthread_cond_destroy(&flushCond);
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+/*
+ * Bounded multi-producer queue (D. Vyukov): Slot i is free for position
+ * 'pos' (i == 'pos' & 'mask') iff 'seq'=='pos', and holds the message for
+ * 'pos' iff 'seq'=='pos'+1. A producer claims 'pos' by advancing 'enqPos'
+ * (CAS), writes the message and then publishes it by setting 'seq'. The
+ * writer frees the slot by setting 'seq' to 'pos'+capacity.
+ * After publishing, the producer wakes the writer if it is 'idle' (see
+ * 'runWriter'). Only one producer succeeds in resetting 'idle', so the
+ * others do not touch the mutex.
+ * Long messages are stored in a block obtained by 'malloc' (not 'new',
+ * which may throw and would then leave a claimed slot unpublished). If
+ * this fails, the message is truncated.
+ */
+bool AsyncLogWriter::push(const char* s0,const char* s1,const char* s2,
+			  const char* s3)
+{
+  const char* strs[4]={s0,s1,s2,s3};
+  int lens[4];
+  int i,len=1;
+  long pos,dif;
+  Slot* sl;
+  char* dst;
+
+  for (i=0; i<4; i++)
+    len+=(lens[i]=(strs[i]!=0)?strlen(strs[i]):0);
+  pos=enqPos;
+  for (;;) {
+    sl=&slots[pos&mask];
+    dif=sl->seq-pos;
+    if (dif==0) {
+      if (__sync_bool_compare_and_swap(&enqPos,pos,pos+1))
+	break;
+      pos=enqPos;
+    } else if (dif<0) {
+      __sync_add_and_fetch(&nDropped,1L); // Queue full
+      return false;
+    } else
+      pos=enqPos;
+  }
+  sl->ext=0;
+  if (len>slotSize && (sl->ext=(char*) malloc(len))==0)
+    len=slotSize;
+  dst=(sl->ext!=0)?sl->ext:sl->data;
+  sl->len=len--;
+  for (i=0; i<4 && len>0; i++) {
+    if (lens[i]>len) lens[i]=len;
+    memcpy(dst,strs[i],lens[i]);
+    dst+=lens[i]; len-=lens[i];
+  }
+  *dst='\n';
+  __sync_synchronize();
+  sl->seq=pos+1;
+  __sync_synchronize();
+  if (idle && __sync_bool_compare_and_swap(&idle,1,0)) {
+    pthread_mutex_lock(&mutex);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  return true;
+}
+
+void AsyncLogWriter::flush()
+{
+  long req;
+
+  pthread_mutex_lock(&mutex);
+  req=++flushReq;
+  pthread_cond_signal(&cond);
+  while (flushDone<req)
+    pthread_cond_wait(&flushCond,&mutex);
+  pthread_mutex_unlock(&mutex);
+}
+
+void* AsyncLogWriter::writerMain(void* arg)
+{
+  ((AsyncLogWriter*) arg)->runWriter();
+
+  return 0;
+}
+
+int AsyncLogWriter::writeBatch()
+{
+  int num=0;
+  long ndrop;
+  char tbuff[80];
+  Slot* sl;
+
+  wBuff.clear();
+  if ((ndrop=nDropped)>nDropReported) {
+    sprintf(tbuff,"** AsyncLogWriter: %ld messages dropped\n",
+	    ndrop-nDropReported);
+    wBuff.insert(wBuff.end(),tbuff,tbuff+strlen(tbuff));
+    nDropReported=ndrop;
+  }
+  for (; num<=mask; num++,deqPos++) {
+    sl=&slots[deqPos&mask];
+    if (sl->seq!=deqPos+1) break; // Not yet published
+    __sync_synchronize();
+    if (sl->ext!=0) {
+      wBuff.insert(wBuff.end(),sl->ext,sl->ext+sl->len);
+      free(sl->ext); sl->ext=0;
+    } else
+      wBuff.insert(wBuff.end(),sl->data,sl->data+sl->len);
+    __sync_synchronize();
+    sl->seq=deqPos+mask+1;
+  }
+  if (!wBuff.empty())
+    os.write(&wBuff[0],wBuff.size());
+  nWritten+=num;
+
+  return num;
+}
+
+/*
+ * Before waiting, the writer sets 'idle' and then checks the queue once
+ * more (both with the mutex held). A producer publishes its message and
+ * then reads 'idle', so at least one of them sees the other's write: the
+ * writer finds the message, or the producer signals 'cond', which it can
+ * only do once the writer waits (it needs the mutex).
+ */
+void AsyncLogWriter::runWriter()
+{
+  double lastFlush=alwNowMSec(),tnow,tsec;
+  bool dirty=false;
+  long req;
+  struct timespec wtime;
+
+  for (;;) {
+    if (writeBatch()>0) {
+      dirty=true;
+      if (policy==flushBatch || (policy==flushPeriodic &&
+				 alwNowMSec()-lastFlush>=flushMSec)) {
+	os.flush(); dirty=false; lastFlush=alwNowMSec();
+      }
+      continue;
+    }
+    // Queue empty
+    if (policy==flushPeriodic && dirty &&
+	(tnow=alwNowMSec())-lastFlush>=flushMSec) {
+      os.flush(); dirty=false; lastFlush=tnow;
+    }
+    pthread_mutex_lock(&mutex);
+    if (flushReq>flushDone || stopReq) {
+      // Messages pushed before the request may have been missed by the
+      // last 'writeBatch'
+      req=flushReq;
+      pthread_mutex_unlock(&mutex);
+      while (writeBatch()>0);
+      os.flush(); dirty=false; lastFlush=alwNowMSec();
+      pthread_mutex_lock(&mutex);
+      flushDone=req;
+      pthread_cond_broadcast(&flushCond);
+      pthread_mutex_unlock(&mutex);
+      if (stopReq)
+	break;
+      continue;
+    }
+    idle=1;
+    __sync_synchronize();
+    if (slots[deqPos&mask].seq!=deqPos+1) {
+      if (policy==flushPeriodic && dirty) {
+	// Wake up when the flush period is over (gettimeofday is the
+	// default clock of 'cond')
+	tsec=floor(1e-3*(lastFlush+flushMSec));
+	wtime.tv_sec=(time_t) tsec;
+	wtime.tv_nsec=(long) (1e6*(lastFlush+flushMSec-1e3*tsec));
+	if (wtime.tv_nsec>=1000000000) wtime.tv_nsec=999999999;
+	pthread_cond_timedwait(&cond,&mutex,&wtime);
+      } else
+	pthread_cond_wait(&cond,&mutex);
+    }
+    idle=0;
+    pthread_mutex_unlock(&mutex);
+  }
+}
@@ -0,0 +1,173 @@
+//NEWCODE
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Library source file
+ * Module: GLOBAL
+ * Desc.:  Header class AsyncLogWriter
+ * ------------------------------------------------------------------- */
+
+#ifndef ASYNCLOGWRITER_H
+#define ASYNCLOGWRITER_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+// NOTE: Does not include global.h, which includes this header ahead of
+// LogFile.h
+#include <ostream>
+#include <pthread.h>
+#include <vector>
+
+/**
+ * Asynchronous backend for 'LogFile'. Messages are passed to a background
+ * writer thread, which writes them to an output stream. Calling threads
+ * never do I/O, and never wait for the writer: they only take a lock
+ * (briefly) to wake it up if it is idle.
+ * <p>
+ * The queue is a bounded lock-free ring buffer of 'capacity' slots (rounded
+ * up to a power of 2), which can be fed by any number of threads ('push').
+ * Messages of up to 'slotSize' bytes are copied into the slot, longer ones
+ * into a block allocated by the calling thread. If the queue is full, the
+ * message is dropped and counted ('numDropped'). The writer notes the
+ * number of dropped messages in the output once the queue has space again.
+ * <p>
+ * The writer drains the queue in batches, each written by a single call
+ * to the stream. Flush policy:
+ * - flushBatch:    Flush stream after each batch
+ * - flushPeriodic: Flush stream at most every 'flushMSec' milliseconds
+ *                  (and once the queue becomes empty after that)
+ * - flushClose:    Flush only on 'flush' and when the writer is closed
+ * If the queue is empty, the writer blocks on a condition variable until
+ * a message is pushed, 'flush' is called or (for 'flushPeriodic', with
+ * unflushed data) the flush period is over. It does not poll.
+ * <p>
+ * The stream must not be accessed by other code while the writer exists.
+ * The destructor writes all remaining messages, flushes the stream and
+ * stops the writer thread.
+ *
+ * @author  Matthias Seeger
+ * @version %I% %G%
+ */
+class AsyncLogWriter
+{
+public:
+  // Constants
+
+  static const int flushBatch   =0;
+  static const int flushPeriodic=1;
+  static const int flushClose   =2;
+
+  static const int defCapacity =4096;
+  static const int defSlotSize =248;
+  static const int defFlushMSec=500;
+
+protected:
+  /*
+   * Slot of the ring buffer. 'seq' controls ownership between producers
+   * and the writer (see 'push'). If 'ext'!=0, the message is stored there
+   * (allocated by 'push'), otherwise in 'data'.
+   */
+  struct Slot
+  {
+    volatile long seq;
+    int len;
+    char* ext;
+    char* data;
+  };
+
+  // Members
+
+  std::ostream& os;
+  int policy,flushMSec,slotSize;
+  long mask;
+  std::vector<Slot> slots;
+  std::vector<char> slotData;
+  std::vector<char> wBuff;     // Write buffer (used by writer only)
+  volatile long enqPos;        // Next slot to be written by producer
+  long deqPos;                 // Next slot to be read by writer
+  volatile long nDropped,nWritten;
+  long nDropReported;
+  volatile int stopReq;
+  volatile int idle;           // Writer waits (or is about to) on 'cond'
+  volatile long flushReq,flushDone;
+  pthread_t thrId;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond,flushCond;
+
+public:
+  // Constructors
+
+  /**
+   * Starts the writer thread.
+   *
+   * @param pos       Output stream
+   * @param capacity  Number of slots. Def.: 'defCapacity'
+   * @param ppolicy   Flush policy. Def.: 'flushBatch'
+   * @param pflushMS  Flush period (milliseconds) for 'flushPeriodic'. Def.:
+   *                  'defFlushMSec'
+   * @param pslotSize Message size stored in slot. Def.: 'defSlotSize'
+   */
+  AsyncLogWriter(std::ostream& pos,int capacity=defCapacity,
+		 int ppolicy=flushBatch,int pflushMS=defFlushMSec,
+		 int pslotSize=defSlotSize);
+
+  ~AsyncLogWriter();
+
+  // Public methods
+
+  /**
+   * Enqueues message composed of the strings 's0', ..., 's3' (those !=0,
+   * concatenated), followed by newline. Never blocks.
+   *
+   * @return False if message has been dropped (queue full)
+   */
+  bool push(const char* s0,const char* s1=0,const char* s2=0,
+	    const char* s3=0);
+
+  /**
+   * Blocks until all messages enqueued so far are written and the stream
+   * has been flushed.
+   */
+  void flush();
+
+  /**
+   * @return Number of messages dropped so far
+   */
+  long numDropped() const {
+    return nDropped;
+  }
+
+  /**
+   * @return Number of messages written so far
+   */
+  long numWritten() const {
+    return nWritten;
+  }
+
+  int getPolicy() const {
+    return policy;
+  }
+
+protected:
+  // Internal methods
+
+  static void* writerMain(void* arg);
+
+  void runWriter();
+
+  /**
+   * Moves messages from the queue to 'wBuff' and writes them to the
+   * stream.
+   *
+   * @return Number of messages written
+   */
+  int writeBatch();
+
+private:
+  AsyncLogWriter(const AsyncLogWriter&);
+  AsyncLogWriter& operator=(const AsyncLogWriter&);
+};
+
+#endif
@@ -62,6 +62,9 @@
  * <p>
  * ATTENTION: Before accessing any of the default logs, call 'init' and supply
  * the base filename of the task!
+ * If 'init' is called with 'async'==true, the logs use the asynchronous
+ * backend (see 'LogFile::startAsync'), so that diagnostic logging can stay
+ * on without slowing down the calling code.
  *
  * @author  Matthias Seeger
  * @version %I% %G%
@@ -84,8 +87,9 @@ public:
    * This init. method has to be called before any of the logs is accessed!
    *
    * @param baseName Base filename of the task
+   * @param async    Use asynchronous backend? Def.: false
    */
-  static void init(const my_string& baseName) {
+  static void init(const my_string& baseName,bool async=false) {
     char buff[200];
 
     if (globalLog.isZero()) {
@@ -97,6 +101,12 @@ public:
       sprintf(buff,"%slhotse-debug.log",baseName.c_str());
       debugLog.changeRep(new LogFile(buff));
 #endif
+      if (async) {
+	globalLog->startAsync(); errorLog->startAsync();
+#ifdef HAVE_DEBUG
+	debugLog->startAsync();
+#endif
+      }
     }
   }
 
@@ -15,6 +15,7 @@
 #endif
 
 #include "lhotse/global.h" // global header
+#include "lhotse/AsyncLogWriter.h"
 
 // Macros (for convenience)
 
@@ -54,6 +55,14 @@
  * The feature of printing filename and line number can be suppressed. In this
  * case, only the strings itself are written into the file, every line term.
  * by newline. The default is to print name and number.
+ * <p>
+ * By default, 'print' writes to the file and flushes it. If 'startAsync'
+ * is called, messages are passed to an 'AsyncLogWriter' instead, whose
+ * background thread does the writing (see there for flush policies and
+ * dropping of messages if the queue is full). This makes 'print' cheap,
+ * but note that 'add', 'print' and 'tempBuff' (used by the macros) still
+ * share state, so a 'LogFile' must not be used by several threads at
+ * the same time in either mode.
  *
  * @author  Matthias Seeger
  * @version %I% %G%
@@ -66,6 +75,8 @@ protected:
   ofstream os;     // Output file stream
   my_string buff;  // String buffer
   bool nameNum;    // Print filename and line number?
+  AsyncLogWriter* async; // Asynchronous backend (or 0)
+  char hdrBuff[257];
 
 public:
 
@@ -76,13 +87,63 @@ public:
   /**
    * @param fname Filename for logfile
    */
-  LogFile(const char* fname) : os(fname),nameNum(true) {
+  LogFile(const char* fname) : os(fname),nameNum(true),async(0) {
     if (!os) throw FileUtilsException("Cannot create logfile");
     os.precision(20); os.setf(std::ios::scientific);
   }
 
+  ~LogFile() {
+    stopAsync();
+  }
+
   // Public methods
 
+  /**
+   * Switches to asynchronous mode (see header comment). If already in
+   * this mode, the writer is replaced (after writing all messages).
+   *
+   * @param capacity Queue size. Def.: 'AsyncLogWriter::defCapacity'
+   * @param policy   Flush policy. Def.: 'AsyncLogWriter::flushPeriodic'
+   * @param flushMS  Flush period (milliseconds). Def.:
+   *                 'AsyncLogWriter::defFlushMSec'
+   */
+  void startAsync(int capacity=AsyncLogWriter::defCapacity,
+		  int policy=AsyncLogWriter::flushPeriodic,
+		  int flushMS=AsyncLogWriter::defFlushMSec) {
+    stopAsync();
+    async=new AsyncLogWriter(os,capacity,policy,flushMS);
+  }
+
+  /**
+   * Writes all pending messages and switches back to synchronous mode.
+   */
+  void stopAsync() {
+    if (async!=0) {
+      delete async; async=0;
+    }
+  }
+
+  bool isAsync() const {
+    return (async!=0);
+  }
+
+  /**
+   * @return Number of messages dropped in asynchronous mode (queue full)
+   */
+  long numDropped() const {
+    return (async!=0)?async->numDropped():0;
+  }
+
+  /**
+   * Blocks until all messages printed so far are written and flushed.
+   */
+  void flush() {
+    if (async!=0)
+      async->flush();
+    else
+      os.flush();
+  }
+
   /**
    * @param flag Shall we print filename and line number together with
    *             every message?
@@ -100,15 +161,17 @@ public:
   }
 
   void print(const char* name,int no,const my_string& str) {
-    if (nameNum)
-      os << "**" << name << "(" << no << "):\n" << buff << str << endl;
-    else
-      os << buff << str << endl;
-    buff="";
+    print(name,no,str.c_str());
   }
 
   void print(const char* name,int no,const char* str) {
-    if (nameNum)
+    if (async!=0) {
+      if (nameNum) {
+	snprintf(hdrBuff,sizeof(hdrBuff),"**%s(%d):\n",name,no);
+	async->push(hdrBuff,buff.c_str(),str);
+      } else
+	async->push(buff.c_str(),str);
+    } else if (nameNum)
       os << "**" << name << "(" << no << "):\n" << buff << str << endl;
     else
       os << buff << str << endl;
@@ -118,6 +181,10 @@ public:
   my_string& getBuff() const {
     return (my_string&) buff;
   }
+
+private:
+  LogFile(const LogFile&);
+  LogFile& operator=(const LogFile&);
 };
 
 #endif
@@ -0,0 +1,199 @@
+//NEWCODE
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Library source file
+ * Module: GLOBAL
+ * Desc.:  Header class TrackingMemManager
+ * ------------------------------------------------------------------- */
+
+#ifndef TRACKINGMEMMANAGER_H
+#define TRACKINGMEMMANAGER_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+
+/**
+ * Memory manager tracking allocations by tag. Used by the global
+ * overload of new/delete (see global.cc) iff USE_OWN_MEMMAN is defined.
+ * Memory is still obtained from the standard (or Matlab) allocator, the
+ * manager only keeps statistics.
+ * <p>
+ * Each thread has a current tag (default 0: untagged), set by
+ * 'MemTagScope' objects. An allocation is charged to the current tag of
+ * the allocating thread, its deallocation to the same tag (from any
+ * thread). Tags are numbers 0,...,'maxTags'-1, their meaning is up to
+ * the code using them (see f.ex. 'EPMemoryTags' in eptools).
+ * Per tag, we count allocations and deallocations, and maintain the
+ * number of bytes currently allocated, its high-water mark, and the
+ * total number of bytes allocated. Counts (except current bytes) refer
+ * to the time since the last 'resetStats', so that allocation rates can
+ * be determined.
+ * <p>
+ * A header of 'headerSize' bytes is placed in front of each block (size,
+ * tag). Counters are updated atomically (GCC builtins), so the manager
+ * can be used with threads. Statistics are only collected while enabled
+ * (default), a block allocated while disabled is not counted when it is
+ * freed.
+ * <p>
+ * If USE_OWN_MEMMAN is not defined, all methods are no-ops ('isActive'
+ * returns false), and 'MemTagScope' objects cost nothing.
+ *
+ * @author  Matthias Seeger
+ * @version %I% %G%
+ */
+class TrackingMemManager
+{
+public:
+  // Constants
+
+  static const int maxTags=16;
+  static const std::size_t headerSize=16;
+
+  /**
+   * Statistics for one tag
+   */
+  struct TagStats
+  {
+    long numAlloc,numFree;  // Number of allocations, deallocations
+    long bytesCur,bytesPeak; // Bytes allocated, high-water mark
+    long bytesTotal;        // Total bytes allocated
+  };
+
+  // Public static methods
+
+  /**
+   * @return Is tracking compiled in (USE_OWN_MEMMAN)?
+   */
+  static bool isActive() {
+#ifdef USE_OWN_MEMMAN
+    return true;
+#else
+    return false;
+#endif
+  }
+
+#ifdef USE_OWN_MEMMAN
+  static void setEnabled(bool flag) {
+    enabled=flag;
+  }
+
+  static bool isEnabled() {
+    return enabled;
+  }
+
+  /**
+   * Sets current tag of calling thread.
+   *
+   * @param tag New tag
+   * @return    Previous tag
+   */
+  static int setTag(int tag) {
+    int prev=curTag;
+
+    curTag=(tag>=0 && tag<maxTags)?tag:0;
+    return prev;
+  }
+
+  static int getTag() {
+    return curTag;
+  }
+
+  /**
+   * @param tag   Tag
+   * @param stats Statistics ret. here
+   */
+  static void getStats(int tag,TagStats& stats);
+
+  /**
+   * Resets statistics of all tags (except current bytes, the high-water
+   * marks are set to them).
+   */
+  static void resetStats();
+
+  /**
+   * @return Seconds since last 'resetStats' (or program start)
+   */
+  static double elapsedTime();
+
+  /**
+   * Called by 'operator new': 'raw' has been allocated with
+   * 'n'+'headerSize' bytes. Writes the header, updates statistics.
+   *
+   * @param raw Block (incl. header)
+   * @param n   Size requested
+   * @return    Block for caller
+   */
+  static void* registerAlloc(void* raw,std::size_t n);
+
+  /**
+   * Called by 'operator delete'. Updates statistics.
+   *
+   * @param ptr Block as returned by 'registerAlloc' (not 0)
+   * @return    Block (incl. header) to be freed
+   */
+  static void* registerDealloc(void* ptr);
+
+protected:
+  static volatile bool enabled;
+#ifdef __GNUC__
+  static __thread int curTag;
+#else
+  static int curTag;
+#endif
+#else
+  static void setEnabled(bool) {}
+
+  static bool isEnabled() {
+    return false;
+  }
+
+  static int setTag(int) {
+    return 0;
+  }
+
+  static int getTag() {
+    return 0;
+  }
+
+  static void getStats(int,TagStats& stats) {
+    stats.numAlloc=stats.numFree=stats.bytesCur=stats.bytesPeak=
+      stats.bytesTotal=0;
+  }
+
+  static void resetStats() {}
+
+  static double elapsedTime() {
+    return 0.0;
+  }
+#endif
+};
+
+/**
+ * Sets current tag of the calling thread (see 'TrackingMemManager') for
+ * the lifetime of the object, then restores the previous one. Create as
+ * local variable at the beginning of the scope doing the allocations.
+ */
+class MemTagScope
+{
+protected:
+  int prevTag;
+
+public:
+  explicit MemTagScope(int tag) {
+    prevTag=TrackingMemManager::setTag(tag);
+  }
+
+  ~MemTagScope() {
+    TrackingMemManager::setTag(prevTag);
+  }
+
+private:
+  MemTagScope(const MemTagScope&);
+  MemTagScope& operator=(const MemTagScope&);
+};
+
+#endif
@@ -8,6 +8,9 @@
  * ------------------------------------------------------------------- */
 
 #include "lhotse/global.h"
+#ifdef USE_OWN_MEMMAN
+#include <sys/time.h>
+#endif
 #ifdef MATLAB_MEX
 #include "lhotse/matif/mex_for_cpp.h"
 #endif
@@ -33,12 +36,8 @@ void printMsgStdout(const char* msg)
 
 // Global overload of new/delete and their array variants.
 
-void* operator new(std::size_t n) throw(std::bad_alloc)
+static inline void* globalRawAlloc(std::size_t n)
 {
-#ifdef USE_OWN_MEMMAN
-  if (FixedMemManager::isMMInit())
-    return FixedMemManager::alloc(n);
-#endif
 #if !defined(MATLAB_MEX) || !defined(USE_MATLAB_MM)
   return malloc(n);
 #else
@@ -48,45 +47,154 @@ void* operator new(std::size_t n) throw(std::bad_alloc)
 #endif
 }
 
-void* operator new[](std::size_t n) throw(std::bad_alloc)
+static inline void globalRawFree(void* ptr)
 {
-#ifdef USE_OWN_MEMMAN
-  if (FixedMemManager::isMMInit())
-    return FixedMemManager::alloc(n);
-#endif
 #if !defined(MATLAB_MEX) || !defined(USE_MATLAB_MM)
-  return malloc(n);
+  free(ptr);
 #else
-  void* ptr=mxMalloc(n);
-  mexMakeMemoryPersistent(ptr);
-  return ptr;
+  mxFree(ptr);
 #endif
 }
 
-void operator delete(void* ptr) throw()
+void* operator new(std::size_t n) throw(std::bad_alloc)
 {
 #ifdef USE_OWN_MEMMAN
-  if (FixedMemManager::isMMInit())
-    FixedMemManager::dealloc(ptr);
+  return TrackingMemManager::registerAlloc(
+    globalRawAlloc(n+TrackingMemManager::headerSize),n);
+#else
+  return globalRawAlloc(n);
 #endif
-#if !defined(MATLAB_MEX) || !defined(USE_MATLAB_MM)
-  free(ptr);
+}
+
+void* operator new[](std::size_t n) throw(std::bad_alloc)
+{
+#ifdef USE_OWN_MEMMAN
+  return TrackingMemManager::registerAlloc(
+    globalRawAlloc(n+TrackingMemManager::headerSize),n);
 #else
-  mxFree(ptr);
+  return globalRawAlloc(n);
 #endif
 }
 
+void operator delete(void* ptr) throw()
+{
+  if (ptr==0) return;
+#ifdef USE_OWN_MEMMAN
+  ptr=TrackingMemManager::registerDealloc(ptr);
+#endif
+  globalRawFree(ptr);
+}
+
 void operator delete[](void* ptr) throw()
 {
+  if (ptr==0) return;
 #ifdef USE_OWN_MEMMAN
-  if (FixedMemManager::isMMInit())
-    FixedMemManager::dealloc(ptr);
+  ptr=TrackingMemManager::registerDealloc(ptr);
 #endif
-#if !defined(MATLAB_MEX) || !defined(USE_MATLAB_MM)
-  free(ptr);
+  globalRawFree(ptr);
+}
+
+#endif
+
+#ifdef USE_OWN_MEMMAN
+
+// Memory manager 'TrackingMemManager'
+
+const int TrackingMemManager::maxTags;
+const std::size_t TrackingMemManager::headerSize;
+volatile bool TrackingMemManager::enabled=true;
+#ifdef __GNUC__
+__thread int TrackingMemManager::curTag=0;
 #else
-  mxFree(ptr);
+int TrackingMemManager::curTag=0;
 #endif
+
+/*
+ * Block header. 'counted': Was the block counted in the statistics?
+ */
+struct TrackingMemHeader
+{
+  std::size_t size;
+  int tag,counted;
+};
+
+static TrackingMemManager::TagStats tmmStats[TrackingMemManager::maxTags];
+static double tmmResetTime=-1.0;
+
+static inline double tmmNow()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv,0);
+  return ((double) tv.tv_sec)+1e-6*((double) tv.tv_usec);
+}
+
+#ifdef __GNUC__
+#  define TMM_ADD(VAR,VAL) __sync_add_and_fetch(&(VAR),(VAL))
+#else
+#  define TMM_ADD(VAR,VAL) ((VAR)+=(VAL)) // Not thread-safe!
+#endif
+
+void* TrackingMemManager::registerAlloc(void* raw,std::size_t n)
+{
+  TrackingMemHeader* hdr=(TrackingMemHeader*) raw;
+  long cur,peak;
+
+  if (raw==0) return 0;
+  hdr->size=n; hdr->tag=curTag; hdr->counted=enabled?1:0;
+  if (hdr->counted) {
+    TagStats& st=tmmStats[hdr->tag];
+    TMM_ADD(st.numAlloc,1L);
+    TMM_ADD(st.bytesTotal,(long) n);
+    cur=TMM_ADD(st.bytesCur,(long) n);
+    while ((peak=st.bytesPeak)<cur) {
+#ifdef __GNUC__
+      if (__sync_bool_compare_and_swap(&st.bytesPeak,peak,cur)) break;
+#else
+      st.bytesPeak=cur;
+#endif
+    }
+  }
+
+  return ((char*) raw)+headerSize;
+}
+
+void* TrackingMemManager::registerDealloc(void* ptr)
+{
+  TrackingMemHeader* hdr=(TrackingMemHeader*) (((char*) ptr)-headerSize);
+
+  if (hdr->counted) {
+    TagStats& st=tmmStats[hdr->tag];
+    TMM_ADD(st.numFree,1L);
+    TMM_ADD(st.bytesCur,-((long) hdr->size));
+  }
+
+  return (void*) hdr;
+}
+
+void TrackingMemManager::getStats(int tag,TagStats& stats)
+{
+  if (tag<0 || tag>=maxTags)
+    throw InvalidParameterException(EXCEPT_MSG(""));
+  stats=tmmStats[tag];
+}
+
+void TrackingMemManager::resetStats()
+{
+  for (int i=0; i<maxTags; i++) {
+    TagStats& st=tmmStats[i];
+    st.numAlloc=st.numFree=st.bytesTotal=0;
+    st.bytesPeak=st.bytesCur;
+  }
+  tmmResetTime=tmmNow();
+}
+
+double TrackingMemManager::elapsedTime()
+{
+  if (tmmResetTime<0.0)
+    tmmResetTime=tmmNow(); // First call
+
+  return tmmNow()-tmmResetTime;
 }
 
 #endif
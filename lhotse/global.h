@@ -83,10 +83,9 @@
  *   Only considered if MATLAB_MEX is defined. Set this variable iff you are
  *   using Matlab 6.5 or later. Set by default.
  * - USE_OWN_MEMMAN:
- *   If this is defined, we replace the global memory manager by our own
- *   which is more efficient if a large number of allocations/deallocations
- *   come at a small number of fixed small sizes (see 'FixedMemManager').
- *   ATTENTION: Does not work properly right now!
+ *   If this is defined, the global new/delete keep allocation statistics
+ *   per tag (see 'TrackingMemManager'). Costs a header per block and a
+ *   few atomic operations per new/delete.
  * - MATLAB_DEBUG / MATLAB_DEBUG_OLD:
  *   MatlabDebug code supposed to be active should be enclosed in
  *   MATLAB_DEBUG. Old MatlabDebug code not to be used should be enclosed in
@@ -127,7 +126,7 @@
 //#define MATLAB_MEX
 //#define USE_MATLAB_MM
 #define MATLAB_VER65
-//#define USE_OWN_MEMMAN // DO NOT USE RIGHT NOW!
+//#define USE_OWN_MEMMAN
 #define MATLAB_DEBUG
 #define MATLABDEBUG_USEMEX
 //#define NAMESPACE
@@ -445,12 +444,12 @@ extern void debugMemPrintStats();
 #endif
 
 /*
- * Memory manager 'FixedMemManager' for fixed-sized objects:
- * The MM is maintained in the static members/methods of 'FixedMemManager'.
- * It initializes itself upon first usage. We globally overload new/delete
- * (see global.cc, global_mem.h) to use this MM once properly initialized.
- * NOTE: Done iff USE_OWN_MEMMAN is defined.
- * NOTE: Does not work properly in the moment. Do not use!
+ * Memory manager 'TrackingMemManager', keeping allocation statistics per
+ * tag: The MM is maintained in the static members/methods of
+ * 'TrackingMemManager'. We globally overload new/delete (see global.cc,
+ * global_mem.h) to use this MM.
+ * NOTE: Done iff USE_OWN_MEMMAN is defined. Otherwise, 'MemTagScope' is a
+ * no-op.
  */
 
 // LHOTSE global include files
@@ -460,15 +459,14 @@ extern void debugMemPrintStats();
 #if defined(MATLAB_MEX) && defined(USE_MATLAB_MM)
 #include "lhotse/matif/MatlabAlloc.h" // Matlab memory allocator
 #endif
-#ifdef USE_OWN_MEMMAN
-#include "lhotse/FixedMemManager.h"   // MM for fixed-sized objects
-#endif
+#include "lhotse/TrackingMemManager.h" // MM tracking allocations by tag
 #include "lhotse/global_mem.h"        // Global overload of new/delete (code
                                       // in global.cc)
 #include "lhotse/AssertMethod.h"      // Assertion method, checking
 #include "lhotse/Handle.h"            // Handles (smart pointers)
 #include "lhotse/ArrayHandle.h"       // Handles for arrays, mem. watchers
 #include "lhotse/ArrayPtrHandle.h"    // Handles for inhomogenous arrays
+#include "lhotse/AsyncLogWriter.h"    // Asynchronous logfile backend
 #include "lhotse/LogFile.h"           // Logfile support
 #include "lhotse/DefaultLogs.h"       // Default logfiles (global,error)
 #ifdef HAVE_DEBUG
@@ -0,0 +1,168 @@
+//NEWCODE
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Library source file
+ * Module: optimize
+ * Desc.:  Header class BatchOneDimSolver
+ * ------------------------------------------------------------------- */
+
+#ifndef BATCHONEDIMSOLVER_H
+#define BATCHONEDIMSOLVER_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "lhotse/optimize/default.h"
+
+//BEGINNS(optimize)
+  /**
+   * Batched variant of 'OneDimSolver::newton' (bracketed case only). Solves
+   * n independent equations
+   *   f_i(x) = 0,  x in [l_i,r_i],  i=0,...,n-1
+   * at the same time. The f_i are encoded by a function object of template
+   * type F, which has to provide
+   *   void eval(int i,double x,double& f,double& df) const
+   * returning f_i(x) and f_i'(x). Since F is a template argument, 'eval' is
+   * inlined into the solver loops (no virtual call per iteration, as with
+   * 'FuncOneDim').
+   * <p>
+   * Equations are processed in blocks of 'numLanes'. Within a block, each
+   * equation occupies a lane, and all per-lane state is held in small
+   * fixed-size arrays, so that the step and bracket update loops are
+   * branch-free and can be vectorized by the compiler. A lane is masked
+   * out once it has converged (or failed), the block is done once all
+   * lanes are masked out.
+   * <p>
+   * The per-lane iteration is the same as in 'OneDimSolver::newton': Newton
+   * step from the last recent point, bisection if this falls out of the
+   * bracket, or if the previous Newton step shrunk the bracket by less than
+   * 15%. A lane stops if |f_i(x)| < 'facc' or the bracket size drops below
+   * 'acc'.
+   * <p>
+   * Different from 'OneDimSolver::newton', failures are not signalled by
+   * exceptions, but by per-lane flags, so that one failing equation does
+   * not stop the others.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class BatchOneDimSolver
+  {
+  public:
+    // Constants
+
+    static const int numLanes=8; // Block size (lanes)
+    static const int maxIter =100;
+
+    // Public static methods
+
+    /**
+     * Batched Newton solver, see header comment. The initial brackets
+     * [l_i,r_i], l_i < r_i, must be s.t. f_i(l_i), f_i(r_i) have opposite
+     * signs (or one of them is below 'facc' in absolute value). If this is
+     * not the case for lane i, or if the iteration does not converge within
+     * 'maxIter' steps, 'succ[i]' is set to false, otherwise to true.
+     * If the lane failed, 'x[i]' contains the last recent iterate.
+     * NOTE: 'x' may coincide with 'l' or 'r'.
+     *
+     * @param func Function object (see header comment)
+     * @param n    Number of equations
+     * @param l    Left bracket ends l_i
+     * @param r    Right bracket ends r_i
+     * @param acc  Accuracy in argument
+     * @param facc Accuracy in function value
+     * @param x    Solutions ret. here
+     * @param succ Success flags ret. here
+     * @return     Number of failed lanes
+     */
+    template<class F> static int newton(const F& func,int n,const double* l,
+					const double* r,double acc,double facc,
+					double* x,bool* succ);
+  };
+
+  // Inline methods
+
+  template<class F> int
+  BatchOneDimSolver::newton(const F& func,int n,const double* l,
+			    const double* r,double acc,double facc,double* x,
+			    bool* succ)
+  {
+    double bl[numLanes],br[numLanes],rts[numLanes],fv[numLanes],
+      dfv[numLanes],sgn[numLanes],olds[numLanes];
+    bool act[numLanes],nextBisect[numLanes];
+    int i0,k,nl,it,nact,nfail=0;
+
+    if (n<0 || acc<=0.0 || facc<=0.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (i0=0; i0<n; i0+=numLanes) {
+      nl=n-i0;
+      if (nl>numLanes) nl=numLanes;
+      // Evaluate at both bracket ends. Lanes which are done already (or have
+      // an invalid bracket) are masked out here
+      for (k=nact=0; k<nl; k++) {
+	double fl,dfl,fr,dfr;
+	bl[k]=l[i0+k]; br[k]=r[i0+k];
+	succ[i0+k]=true; act[k]=false; nextBisect[k]=false;
+	rts[k]=bl[k]; fv[k]=0.0; dfv[k]=1.0; // Masked lanes: harmless values
+	func.eval(i0+k,bl[k],fl,dfl);
+	if (fabs(fl)<facc) {
+	  x[i0+k]=bl[k]; continue;
+	}
+	func.eval(i0+k,br[k],fr,dfr);
+	if (fabs(fr)<facc) {
+	  x[i0+k]=br[k]; continue;
+	}
+	sgn[k]=(fl>=0.0)?1.0:-1.0;
+	if (!(bl[k]<br[k]) || (fr>=0.0)==(fl>=0.0)) {
+	  x[i0+k]=bl[k]; succ[i0+k]=false; nfail++;
+	  continue;
+	}
+	if ((olds[k]=br[k]-bl[k])<acc) {
+	  x[i0+k]=bl[k]; continue;
+	}
+	fv[k]=fl; dfv[k]=dfl;
+	act[k]=true; nact++;
+      }
+      for (it=0; it<=maxIter && nact>0; it++) {
+	// Newton or bisection step (masked lanes keep their iterate)
+	for (k=0; k<nl; k++) {
+	  double temp=rts[k]-fv[k]/dfv[k];
+	  bool bisect=nextBisect[k] || !(temp>bl[k] && temp<br[k]);
+	  double xn=bisect?(0.5*(bl[k]+br[k])):temp;
+	  rts[k]=act[k]?xn:rts[k];
+	  nextBisect[k]=!bisect; // Did Newton (used below)
+	}
+	// Evaluate active lanes
+	for (k=0; k<nl; k++)
+	  if (act[k])
+	    func.eval(i0+k,rts[k],fv[k],dfv[k]);
+	// Update brackets, convergence masks
+	for (k=0; k<nl; k++) {
+	  if (!act[k]) continue;
+	  bool sameSgn=((fv[k]>=0.0)?1.0:-1.0)==sgn[k];
+	  bl[k]=sameSgn?rts[k]:bl[k];
+	  br[k]=sameSgn?br[k]:rts[k];
+	  double temp=br[k]-bl[k];
+	  if (fabs(fv[k])<facc || temp<acc) {
+	    x[i0+k]=rts[k]; act[k]=false; nact--;
+	  } else {
+	    nextBisect[k]=nextBisect[k] && (temp>0.85*olds[k]);
+	    olds[k]=temp;
+	  }
+	}
+      }
+      if (nact>0)
+	// Maximum number of iterations exceeded
+	for (k=0; k<nl; k++)
+	  if (act[k]) {
+	    x[i0+k]=rts[k]; succ[i0+k]=false; nfail++;
+	  }
+    }
+
+    return nfail;
+  }
+//ENDNS
+
+#endif
@@ -21,6 +21,7 @@
 
   class FuncOneDim;
   class OneDimSolver;
+  class BatchOneDimSolver;
 //ENDNS
 
 #endif
@@ -0,0 +1,87 @@
+%FactEPState: Persistent state for factorized EP inference
+%  Owns EP (message) parameters, marginals and selective damping
+%  arrays of a factorized representation REPR in buffers of the MEX
+%  function EPTOOLS_FACT_STATE. Sequential updates (SEQUPDATES) and
+%  refreshes of the marginals (REFRESH) modify these buffers in
+%  place, without copying Matlab arrays for each call. REPR fields
+%  are written on demand only (GETREPR). See EPT.INF_FACT_SEQUENTIAL.
+%  The state is removed when the object is deleted.
+
+classdef FactEPState < handle
+  properties (SetAccess = private, GetAccess = public)
+    hand = -1;  % Handle of EPTOOLS_FACT_STATE state
+    seldamp = 0; % Selective damping active?
+  end % properties
+
+  methods
+    function st = FactEPState(repr)
+      if isfield(repr,'sd_numk')
+	if ~isfield(repr,'sd_numvalid') || ~isfield(repr,'sd_topind') ...
+	      || ~isfield(repr,'sd_topval')
+	  error('REPR must have SD_XXX fields');
+	end
+	st.hand = eptools_fact_state(0,repr.epPi,repr.epBeta,repr.mPi, ...
+				     repr.mBeta,repr.sd_numvalid, ...
+				     repr.sd_topind,repr.sd_topval);
+	st.seldamp = 1;
+      else
+	st.hand = eptools_fact_state(0,repr.epPi,repr.epBeta,repr.mPi, ...
+				     repr.mBeta);
+      end
+    end
+
+    function delete(st)
+      if st.hand>=0
+	eptools_fact_state(4,st.hand);
+	st.hand = -1;
+      end
+    end
+
+    % [SKIP,DELTA,{SD_DAMP}] = SEQUPDATES(ST,MODEL,REPR,UPDIND0,DAMP,
+    %                                     PIMINTHRES)
+    % Runs EPTOOLS_FACT_SEQUPDATES on the state. MODEL must have
+    % internal representations (see EPT.CHECK_MODEL_REPRES), UPDIND0
+    % is int32 (0-floor). SD_SUBIND, SD_SUBEXCL are taken from REPR.
+    function [skip,delta,sd_damp] = sequpdates(st,model,repr,updind0, ...
+						damp,piminthres)
+      [m,n] = size(model.matB);
+      irp = model.potManInt;
+      irb = model.matBInt;
+      args = {1,st.hand,n,m,updind0,irp.potids,irp.numpot,irp.parvec, ...
+	      irp.parshrd,irb.rowind,irb.colind,irb.bvals,piminthres, ...
+	      damp};
+      if st.seldamp && isfield(repr,'sd_subind')
+	args{end+1} = repr.sd_subind;
+	if isfield(repr,'sd_subexcl')
+	  args{end+1} = repr.sd_subexcl;
+	end
+      end
+      if nargout>2
+	[skip,delta,sd_damp] = eptools_fact_state(args{:});
+      else
+	[skip,delta] = eptools_fact_state(args{:});
+      end
+    end
+
+    % REFRESH(ST,MODEL)
+    % Recomputes marginals from EP parameters (see
+    % EPT.REFRESH_REPRES). MODEL must have internal representations.
+    function refresh(st,model)
+      [m,n] = size(model.matB);
+      irb = model.matBInt;
+      eptools_fact_state(2,st.hand,n,m,irb.rowind,irb.colind,irb.bvals);
+    end
+
+    % REPR = GETREPR(ST,REPR)
+    % Writes state contents to REPR fields
+    function repr = getrepr(st,repr)
+      if st.seldamp
+	[repr.epPi,repr.epBeta,repr.mPi,repr.mBeta,repr.sd_numvalid, ...
+	 repr.sd_topind,repr.sd_topval] = eptools_fact_state(3,st.hand);
+      else
+	[repr.epPi,repr.epBeta,repr.mPi,repr.mBeta] = ...
+	    eptools_fact_state(3,st.hand);
+      end
+    end
+  end
+end % classdef
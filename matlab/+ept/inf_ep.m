@@ -92,6 +92,12 @@ function [model,repr,res,res_det] = inf_ep(model,repr,imode,opts)
 %  - SKIP_GAUSS: If true, we do not update on potentials of type
 %    'Gaussian'. Def.: false
 %  - UPD_1STSWEEP: See "coupled, sequential". Optional
+%  - INPLACE: If true, EP parameters, marginals and selective
+%    damping arrays are kept in an EPT.FACTEPSTATE object during
+%    all sweeps, and updated in place (no copies for each sweep).
+%    REPR fields are written only when needed (test set
+%    predictions, debug code) and at the end. Requires the MEX
+%    function EPTOOLS_FACT_STATE. Def.: false
 %  RES fields:
 %  - RSTAT: Return status
 %    - 0: Converged to accuracy DELTAEPS
@@ -304,6 +310,9 @@ switch(imode)
   if ~isfield(opts,'skip_gauss')
     opts.skip_gauss = 0;
   end
+  if ~isfield(opts,'inplace')
+    opts.inplace = 0;
+  end
   if isfield(opts,'upd_1stsweep')
     if ~iscellstr(opts.upd_1stsweep) || isempty(opts.upd_1stsweep)
       error('OPTS.UPD_1STSWEEP wrong');
@@ -330,6 +339,12 @@ switch(imode)
   % Check MODEL, compute internal representations
   % MODEL.potInd: Non-Gaussian potentials
   model = ept.check_model_repres(model,repr,imode);
+  if opts.inplace
+    % REPR fields are fetched from the state only if needed
+    repr.state = ept.FactEPState(repr);
+    need_repr = do_deb_testmaxpi || do_testmodel || do_deb_plotdiff ...
+	|| (~isempty(debug_pydeb) && debug_pydeb);
+  end
   res.rstat = 1;
   res.nskip = zeros(1,5); % BAD: Could be more states in future
   if do_seldamp
@@ -385,13 +400,23 @@ switch(imode)
     end
     % DEBUG:
     if do_deb_testmaxpi
+      if opts.inplace
+	repr = repr.state.getrepr(repr);
+      end
       if test_fact_maxpi(model,repr,opts.debug_testmaxpi)
 	fprintf(1,['DEBUG(inf_ep), it=%d: Max-pi data structure is' ...
 		   ' wrong!'],nit);
       end
     end
     if opts.refresh
-      repr = ept.refresh_repres(model,repr,imode);
+      if opts.inplace
+	repr.state.refresh(model);
+      else
+	repr = ept.refresh_repres(model,repr,imode);
+      end
+    end
+    if opts.inplace && need_repr
+      repr = repr.state.getrepr(repr);
     end
     if opts.verbose>0
       fprintf(1,'It. %d: delta=%f, nnskip=%d\n',nit,res.delta, ...
@@ -453,6 +478,12 @@ switch(imode)
     end
   end
   res.nit = nit;
+  if opts.inplace
+    % Write back, remove state
+    repr = repr.state.getrepr(repr);
+    delete(repr.state);
+    repr = rmfield(repr,'state');
+  end
  otherwise
   error('Unknown IMODE value');
 end
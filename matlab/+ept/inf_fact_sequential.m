@@ -17,6 +17,12 @@ function [model,repr,delta,skip,sd_damp] = ...
 %  active (fields SD_XXX in REPR). In this case, it returns the
 %  effective damping factor used for each update (entries reliable
 %  only for entries which are not skipped).
+%
+%  If REPR.STATE is given (EPT.FACTEPSTATE object), the updates are
+%  done in place on the buffers of this state, and the fields of
+%  REPR are not used or modified (call REPR.STATE.GETREPR to obtain
+%  them). This avoids copying EP parameters and marginals for each
+%  call (see EPT.INF_EP, OPTS.INPLACE).
 
 if nargin<3
   error('Not enough input arguments');
@@ -36,6 +42,22 @@ end
 model = ept.check_model_repres(model,repr,imode);
 irp = model.potManInt;
 irb = model.matBInt;
+if isa(updind,'int32')
+  updind0 = updind-1; % 0-floor
+else
+  updind0 = int32(updind-1);
+end
+if isfield(repr,'state')
+  % Updates in place on persistent state: No copies
+  if nargout>4
+    [skip,delta,sd_damp] = ...
+	repr.state.sequpdates(model,repr,updind0,damp,piminthres);
+  else
+    [skip,delta] = ...
+	repr.state.sequpdates(model,repr,updind0,damp,piminthres);
+  end
+  return;
+end
 
 % Loop over potentials to update
 % Note that EPTOOLS_FACT_SEQUPDATES overwrites the buffers of some
@@ -43,8 +65,8 @@ irb = model.matBInt;
 % lots of return argument memory for each of these
 % calls). Therefore, we work on copies inside the loop, and force a
 % real copy by using (:).
-% ATTENTION: This could be expensive for large models. If so, try
-% what happens if no copies are drawn.
+% ATTENTION: This could be expensive for large models. If so, use
+% REPR.STATE (see above).
 epBeta = repr.epBeta(:);
 epPi = repr.epPi(:);
 mBeta = repr.mBeta(:);
@@ -58,11 +80,6 @@ if isfield(repr,'sd_numk')
   sd_topind = repr.sd_topind(:);
   sd_topval = repr.sd_topval(:);
 end
-if isa(updind,'int32')
-  updind0 = updind-1; % 0-floor
-else
-  updind0 = int32(updind-1);
-end
 % Everything is done by EPTOOLS_FACT_SEQUPDATES
 %fprintf(1,'Calling MEX\n'); % DEBUG
 args = {n,m,updind0,irp.potids,irp.numpot,irp.parvec,irp.parshrd, ...
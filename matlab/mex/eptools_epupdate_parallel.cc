@@ -27,6 +27,8 @@
  * - ALPHA:   Vector of alpha values
  * - NU:      Vector of nu values
  * - LOGZ:    Vector of log Z values (optional)
+ * - DPARVEC: Gradient of sum_j log Z_j w.r.t. PARVEC (optional). See
+ *            EPTWRAP_EPUPDATE_PARALLEL
  * -------------------------------------------------------------------
  * Matlab MEX Function
  * Author: Matthias Seeger
@@ -48,8 +50,8 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   void** annobj;
   int npotids,nnumpot,nparshrd,nupdind=0,nparvec,ncmu,ncrho;
   int* rstat;
-  double* alpha,*nu,*logz=0;
-  int nrstat,nalpha,nnu,nlogz;
+  double* alpha,*nu,*logz=0,*dparvec=0;
+  int nrstat,nalpha,nnu,nlogz,ndparvec=0;
   int errcode;
   char* errstr;
 
@@ -57,7 +59,7 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   /* Read arguments */
   if (nrhs<6)
     mexErrMsgTxt("Not enough input arguments");
-  if (nlhs<3 || nlhs>4)
+  if (nlhs<3 || nlhs>5)
     mexErrMsgTxt("Wrong number of return arguments");
   argidx = -1; /* ++argidx in macro */
   M_GETIARRAY(potids,"POTIDS");
@@ -76,13 +78,17 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   M_MAKEDARRAY(nu);
   if (nlhs>3)
     M_MAKEDARRAY(logz);
+  if (nlhs>4) {
+    ndparvec = nparvec;
+    M_MAKEDARRAY(dparvec);
+  }
   /* Call C++ wrapper, deal with error */
   annobj=getZeroVoidArray(npotids); /* Dummy void* array */
   eptwrap_epupdate_parallel(std::min(nrhs+1,8),nlhs,M_ARR(potids),
 			    M_ARR(numpot),M_ARR(parvec),M_ARR(parshrd),
 			    annobj,npotids,M_ARR(cmu),M_ARR(crho),M_ARR(updind),
 			    M_ARR(rstat),M_ARR(alpha),M_ARR(nu),
-			    M_ARR(logz),&errcode,errstr);
+			    M_ARR(logz),M_ARR(dparvec),&errcode,errstr);
   mxFree((void*) annobj);
   if (errcode!=0)
     mexErrMsgTxt(errstr);
@@ -61,6 +61,16 @@
  * variables (I/O, content is overwritten).
  * SD_NUPD, SD_NREC return statistics about this datastructure (number of
  * update calls and block recomputations).
+ * If ROWTHREADS>1, each update on a potential j with |V_j| >= ROWTHRES is
+ * done by ROWTHREADS threads, each on a part of V_j (intra-row
+ * parallelism). Useful only for very long rows. To pass these arguments
+ * without selective damping, use empty SD_XXX arrays.
+ * If UC_ENTRIES (size 4*M) and UC_COUNTS (int32, size 2*M) are given,
+ * results of local EP updates are cached there and reused if the cavity
+ * changed by less than UC_RELTOL (relative; default 0: cavity must be
+ * equal). UC_COUNTS gets numbers of hits, then misses for each potential.
+ * Both are I/O, their content is overwritten. Zero UC_ENTRIES is an
+ * empty cache. It has to be cleared if PM_PARVEC changes.
  *
  * Input:
  * - N:           Number of variables
@@ -84,6 +94,11 @@
  * - SD_TOPVAL:   " [double array; I/O]
  * - SD_SUBIND    " [int32 array]
  * - SD_SUBEXCL   ". Def.: false
+ * - ROWTHREADS:  Number of threads per update. Def.: 1
+ * - ROWTHRES:    Threshold on |V_j| for using them. Def.: 32768
+ * - UC_ENTRIES:  Local update cache. Optional [double array; I/O]
+ * - UC_COUNTS:   " [int32 array; I/O]
+ * - UC_RELTOL:   ". Def.: 0
  *
  * Return:
  * - RSTAT:       Return stati for each update. Optional
@@ -108,6 +123,11 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
   int n,m,argidx;
   double piminthres,dampfact=0.0,sd_subexcl=0;
+  int rowthreads=1,rowthres=32768;
+  double uc_reltol=0.0;
+  double* uc_entries=0;
+  int* uc_counts=0;
+  int nuc_entries=0,nuc_counts=0;
   int* updjind,*pm_potids,*pm_numpot,*pm_parshrd,*rp_rowind,*rp_colind;
   double* pm_parvec,*rp_bvals,*rp_pi,*rp_beta,*margpi,*margbeta;
   int nupdjind,npm_potids,npm_numpot,npm_parshrd,nrp_rowind,nrp_colind,
@@ -156,8 +176,23 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
       M_GETDARRAY(sd_topval,"SD_TOPVAL");
       if (nrhs>19) {
 	M_GETIARRAY(sd_subind,"SD_SUBIND");
-	if (nrhs>20)
+	if (nrhs>20) {
 	  M_GETISCAL(sd_subexcl,"SD_SUBEXCL");
+	  if (nrhs>21) {
+	    M_GETISCAL(rowthreads,"ROWTHREADS");
+	    if (nrhs>22) {
+	      M_GETISCAL(rowthres,"ROWTHRES");
+	      if (nrhs>23) {
+		if (nrhs<25)
+		  mexErrMsgTxt("Need UC_ENTRIES and UC_COUNTS");
+		M_GETDARRAY(uc_entries,"UC_ENTRIES");
+		M_GETIARRAY(uc_counts,"UC_COUNTS");
+		if (nrhs>25)
+		  M_GETDSCAL(uc_reltol,"UC_RELTOL");
+	      }
+	    }
+	  }
+	}
       }
     }
   }
@@ -176,15 +211,16 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   /*sprintf(errstr,"nupdjind=%d. Call wrapper",nupdjind);
     printMsgStdout(errstr);*/
   annobj=getZeroVoidArray(npm_potids); /* Dummy void* array */
-  eptwrap_fact_sequpdates(std::min(nrhs+1,22),nlhs,n,m,M_ARR(updjind),
+  eptwrap_fact_sequpdates(std::min(nrhs+1,27),nlhs,n,m,M_ARR(updjind),
 			  M_ARR(pm_potids),M_ARR(pm_numpot),M_ARR(pm_parvec),
 			  M_ARR(pm_parshrd),annobj,npm_potids,M_ARR(rp_rowind),
 			  M_ARR(rp_colind),M_ARR(rp_bvals),M_ARR(rp_pi),
 			  M_ARR(rp_beta),M_ARR(margpi),M_ARR(margbeta),
 			  piminthres,dampfact,M_ARR(sd_numvalid),
 			  M_ARR(sd_topind),M_ARR(sd_topval),M_ARR(sd_subind),
-			  sd_subexcl,M_ARR(rstat),M_ARR(delta),
-			  M_ARR(sd_dampfact),&sd_nupd,&sd_nrec,&errcode,errstr);
+			  sd_subexcl,rowthreads,rowthres,M_ARR(uc_entries),
+			  M_ARR(uc_counts),uc_reltol,M_ARR(rstat),M_ARR(delta),M_ARR(sd_dampfact),&sd_nupd,&sd_nrec,
+			  &errcode,errstr);
   mxFree((void*) annobj);
   /*printMsgStdout("Exit from wrapper");*/
   if (errcode!=0)
@@ -0,0 +1,356 @@
+/* -------------------------------------------------------------------
+ * EPTOOLS_FACT_STATE
+ *
+ * EP with factorized Gaussian backbone. Persistent state for
+ * EPTOOLS_FACT_SEQUPDATES: EP (message) parameters, marginals and
+ * selective damping arrays are kept in buffers owned by this MEX
+ * function, across calls. Sequential updates and refreshes of the
+ * marginals modify these buffers in place, so no copies of (large)
+ * Matlab arrays are required for each call (see
+ * EPT.INF_FACT_SEQUENTIAL). Contents are copied out on demand only.
+ * Use this via the handle class EPT.FACTEPSTATE.
+ *
+ * A state is addressed by an integer handle HAND. While states exist, the
+ * MEX function is locked (mexLock), so that 'clear mex' does not remove
+ * them. Each state has to be deleted (CMD==4), which is done by the
+ * destructor of EPT.FACTEPSTATE.
+ *
+ * The first argument CMD selects the operation:
+ * - CMD==0: Create state.
+ *     HAND = EPTOOLS_FACT_STATE(0,RP_PI,RP_BETA,MARGPI,MARGBETA,
+ *                               {SD_NUMVALID,SD_TOPIND,SD_TOPVAL})
+ *   Arguments are copied into the state. SD_XXX as in
+ *   EPTOOLS_FACT_SEQUPDATES (selective damping active iff given).
+ * - CMD==1: Sequential updates (see EPTOOLS_FACT_SEQUPDATES)
+ *     [{RSTAT},{DELTA},{SD_DAMPFACT},{SD_NUPD},{SD_NREC}] =
+ *       EPTOOLS_FACT_STATE(1,HAND,N,M,UPDJIND,PM_POTIDS,PM_NUMPOT,
+ *                          PM_PARVEC,PM_PARSHRD,RP_ROWIND,RP_COLIND,
+ *                          RP_BVALS,PIMINTHRES,{DAMPFACT},{SD_SUBIND},
+ *                          {SD_SUBEXCL},{ROWTHREADS},{ROWTHRES})
+ *   EP parameters, marginals and SD_XXX arrays of the state are used and
+ *   modified. Pass empty SD_SUBIND if not used.
+ * - CMD==2: Recompute marginals from EP parameters (see
+ *   EPTOOLS_FACT_COMPMARGINALS)
+ *     EPTOOLS_FACT_STATE(2,HAND,N,M,RP_ROWIND,RP_COLIND,RP_BVALS)
+ * - CMD==3: Copy out contents
+ *     [RP_PI,{RP_BETA},{MARGPI},{MARGBETA},{SD_NUMVALID},{SD_TOPIND},
+ *      {SD_TOPVAL}] = EPTOOLS_FACT_STATE(3,HAND)
+ *   SD_XXX only if selective damping is active.
+ * - CMD==4: Delete state
+ *     EPTOOLS_FACT_STATE(4,HAND)
+ * -------------------------------------------------------------------
+ * Matlab MEX Function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "matlab/mex/mex_helper.h"
+#include "src/eptools/wrap/eptwrap_fact_sequpdates.h"
+#include "src/eptools/wrap/eptwrap_fact_compmarginals.h"
+#include <string.h>
+
+char errMsg[512];
+
+/* Persistent states */
+
+#define MAX_STATES 64
+
+typedef struct {
+  int n;
+  double* rp_pi,*rp_beta,*margpi,*margbeta;
+  int nrp_pi,nrp_beta,nmargpi,nmargbeta;
+  int* sd_numvalid,*sd_topind;
+  double* sd_topval;
+  int nsd_numvalid,nsd_topind,nsd_topval;
+} fact_state;
+
+static fact_state* states[MAX_STATES];
+static int numStates=0;
+
+/*
+ * Persistent copy of 'sz' bytes at 'src' (0 if 'sz'==0)
+ */
+static void* persistentCopy(const void* src,int sz)
+{
+  void* ptr;
+
+  if (sz==0)
+    return 0;
+  ptr=mxMalloc(sz);
+  mexMakeMemoryPersistent(ptr);
+  memcpy(ptr,src,sz);
+
+  return ptr;
+}
+
+static void freeState(int hand)
+{
+  fact_state* st=states[hand];
+
+  mxFree(st->rp_pi); mxFree(st->rp_beta);
+  mxFree(st->margpi); mxFree(st->margbeta);
+  if (st->sd_numvalid!=0) {
+    mxFree(st->sd_numvalid); mxFree(st->sd_topind); mxFree(st->sd_topval);
+  }
+  mxFree(st);
+  states[hand]=0;
+  if (--numStates==0)
+    mexUnlock();
+}
+
+/*
+ * Only called if MEX function is unloaded, which happens only if no
+ * states exist (locked otherwise)
+ */
+static void cleanupStates(void)
+{
+  int i;
+
+  for (i=0; i<MAX_STATES; i++)
+    if (states[i]!=0)
+      freeState(i);
+}
+
+static fact_state* getState(const mxArray* arg,char* errstr)
+{
+  int hand=getScalInt(arg,"HAND");
+
+  if (hand<0 || hand>=MAX_STATES || states[hand]==0)
+    mexErrMsgTxt("HAND: Invalid state handle");
+
+  return states[hand];
+}
+
+/* Main function EPTOOLS_FACT_STATE */
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
+{
+  int cmd,hand,argidx;
+  char* errstr;
+  fact_state* st;
+
+  errstr = errMsg;
+  mexAtExit(cleanupStates);
+  if (nrhs<1)
+    mexErrMsgTxt("Not enough input arguments");
+  argidx = -1; /* ++argidx in macros */
+  M_GETISCAL(cmd,"CMD");
+  if (cmd==0) {
+    /* Create state */
+    double* rp_pi,*rp_beta,*margpi,*margbeta,*sd_topval;
+    int* sd_numvalid,*sd_topind;
+    int nrp_pi,nrp_beta,nmargpi,nmargbeta,nsd_numvalid,nsd_topind,
+      nsd_topval;
+
+    if (nrhs!=5 && nrhs!=8)
+      mexErrMsgTxt("Wrong number of input arguments");
+    if (nlhs!=1)
+      mexErrMsgTxt("Need one return argument");
+    M_GETDARRAY(rp_pi,"RP_PI");
+    M_GETDARRAY(rp_beta,"RP_BETA");
+    M_GETDARRAY(margpi,"MARGPI");
+    M_GETDARRAY(margbeta,"MARGBETA");
+    if (nrp_pi==0 || nrp_beta!=nrp_pi)
+      mexErrMsgTxt("RP_PI, RP_BETA: Wrong size");
+    if (nmargpi==0 || nmargbeta!=nmargpi)
+      mexErrMsgTxt("MARGPI, MARGBETA: Wrong size");
+    for (hand=0; hand<MAX_STATES && states[hand]!=0; hand++);
+    if (hand==MAX_STATES)
+      mexErrMsgTxt("Too many states. Delete some first");
+    st=(fact_state*) mxMalloc(sizeof(fact_state));
+    mexMakeMemoryPersistent(st);
+    st->n=nmargpi;
+    st->nrp_pi=st->nrp_beta=nrp_pi;
+    st->nmargpi=st->nmargbeta=nmargpi;
+    st->nsd_numvalid=st->nsd_topind=st->nsd_topval=0;
+    st->sd_numvalid=st->sd_topind=0; st->sd_topval=0;
+    if (nrhs>5) {
+      M_GETIARRAY(sd_numvalid,"SD_NUMVALID");
+      M_GETIARRAY(sd_topind,"SD_TOPIND");
+      M_GETDARRAY(sd_topval,"SD_TOPVAL");
+      if (nsd_numvalid!=nmargpi || nsd_topind==0 || nsd_topval!=nsd_topind)
+	mexErrMsgTxt("SD_XXX: Wrong size");
+      st->nsd_numvalid=nsd_numvalid;
+      st->nsd_topind=st->nsd_topval=nsd_topind;
+      st->sd_numvalid=(int*) persistentCopy(sd_numvalid,
+					     nsd_numvalid*sizeof(int));
+      st->sd_topind=(int*) persistentCopy(sd_topind,nsd_topind*sizeof(int));
+      st->sd_topval=(double*) persistentCopy(sd_topval,
+					      nsd_topval*sizeof(double));
+    }
+    st->rp_pi=(double*) persistentCopy(rp_pi,nrp_pi*sizeof(double));
+    st->rp_beta=(double*) persistentCopy(rp_beta,nrp_pi*sizeof(double));
+    st->margpi=(double*) persistentCopy(margpi,nmargpi*sizeof(double));
+    st->margbeta=(double*) persistentCopy(margbeta,nmargpi*sizeof(double));
+    if (numStates++==0)
+      mexLock();
+    states[hand]=st;
+    plhs[0]=mxCreateDoubleScalar((double) hand);
+  } else if (cmd==1) {
+    /* Sequential updates */
+    int n,m,sd_subexcl=0,rowthreads=1,rowthres=32768;
+    double piminthres,dampfact=0.0;
+    int* updjind,*pm_potids,*pm_numpot,*pm_parshrd,*rp_rowind,*rp_colind;
+    double* pm_parvec,*rp_bvals;
+    int nupdjind,npm_potids,npm_numpot,npm_parshrd,nrp_rowind,nrp_colind,
+      npm_parvec,nrp_bvals;
+    int* sd_subind=0;
+    int nsd_subind=0;
+    void** annobj;
+    int* rstat=0;
+    double* delta=0,*sd_dampfact=0;
+    int nrstat,ndelta,nsd_dampfact;
+    int sd_nupd,sd_nrec;
+    int errcode;
+
+    if (nrhs<13 || nrhs>18)
+      mexErrMsgTxt("Wrong number of input arguments");
+    if (nlhs>5)
+      mexErrMsgTxt("Too many return arguments");
+    st=getState(prhs[++argidx],errstr);
+    M_GETISCAL(n,"N");
+    M_GETISCAL(m,"M");
+    if (n!=st->n)
+      mexErrMsgTxt("N: Does not match state");
+    M_GETIARRAY(updjind,"UPDJIND");
+    M_GETIARRAY(pm_potids,"PM_POTIDS");
+    M_GETIARRAY(pm_numpot,"PM_NUMPOT");
+    M_GETDARRAY(pm_parvec,"PM_PARVEC");
+    M_GETIARRAY(pm_parshrd,"PM_PARSHRD");
+    M_GETIARRAY(rp_rowind,"RP_ROWIND");
+    M_GETIARRAY(rp_colind,"RP_COLIND");
+    M_GETDARRAY(rp_bvals,"RP_BVALS");
+    M_GETDSCAL(piminthres,"PIMINTHRES");
+    if (nrhs>13) {
+      M_GETDSCAL(dampfact,"DAMPFACT");
+      if (nrhs>14) {
+	if (mxGetNumberOfElements(prhs[argidx+1])>0)
+	  M_GETIARRAY(sd_subind,"SD_SUBIND");
+	else
+	  argidx++; /* Empty SD_SUBIND */
+	if (nrhs>15) {
+	  M_GETISCAL(sd_subexcl,"SD_SUBEXCL");
+	  if (nrhs>16) {
+	    M_GETISCAL(rowthreads,"ROWTHREADS");
+	    if (nrhs>17)
+	      M_GETISCAL(rowthres,"ROWTHRES");
+	  }
+	}
+      }
+    }
+    /* Create return arguments */
+    argidx = -1; /* ++argidx in macro */
+    if (nlhs>0) {
+      nrstat=ndelta=nsd_dampfact=nupdjind;
+      M_MAKEIARRAY(rstat);
+      if (nlhs>1) {
+	M_MAKEDARRAY(delta);
+	if (nlhs>2)
+	  M_MAKEDARRAY(sd_dampfact);
+      }
+    }
+    /* Call C++ wrapper on state buffers. Empty SD_XXX are treated as not
+       given */
+    annobj=getZeroVoidArray(npm_potids); /* Dummy void* array */
+    eptwrap_fact_sequpdates(24,nlhs,n,m,M_ARR(updjind),M_ARR(pm_potids),
+			    M_ARR(pm_numpot),M_ARR(pm_parvec),
+			    M_ARR(pm_parshrd),annobj,npm_potids,
+			    M_ARR(rp_rowind),M_ARR(rp_colind),
+			    M_ARR(rp_bvals),st->rp_pi,st->nrp_pi,st->rp_beta,
+			    st->nrp_beta,st->margpi,st->nmargpi,st->margbeta,
+			    st->nmargbeta,piminthres,dampfact,
+			    st->sd_numvalid,st->nsd_numvalid,st->sd_topind,
+			    st->nsd_topind,st->sd_topval,st->nsd_topval,
+			    M_ARR(sd_subind),sd_subexcl,rowthreads,rowthres,
+			    0,0,0,0,0.0,M_ARR(rstat),M_ARR(delta),M_ARR(sd_dampfact),
+			    &sd_nupd,&sd_nrec,&errcode,errstr);
+    mxFree((void*) annobj);
+    if (errcode!=0)
+      mexErrMsgTxt(errstr);
+    if (nlhs>3) {
+      argidx = 2; /* ++argidx in macro */
+      M_SETISCAL(sd_nupd);
+      if (nlhs>4)
+	M_SETISCAL(sd_nrec);
+    }
+  } else if (cmd==2) {
+    /* Recompute marginals */
+    int n,m;
+    int* rp_rowind,*rp_colind;
+    double* rp_bvals;
+    int nrp_rowind,nrp_colind,nrp_bvals;
+    int errcode;
+
+    if (nrhs!=7)
+      mexErrMsgTxt("Wrong number of input arguments");
+    if (nlhs>0)
+      mexErrMsgTxt("Too many return arguments");
+    st=getState(prhs[++argidx],errstr);
+    M_GETISCAL(n,"N");
+    M_GETISCAL(m,"M");
+    M_GETIARRAY(rp_rowind,"RP_ROWIND");
+    M_GETIARRAY(rp_colind,"RP_COLIND");
+    M_GETDARRAY(rp_bvals,"RP_BVALS");
+    eptwrap_fact_compmarginals(9,0,n,m,M_ARR(rp_rowind),M_ARR(rp_colind),
+			       M_ARR(rp_bvals),st->rp_pi,st->nrp_pi,
+			       st->rp_beta,st->nrp_beta,st->margpi,
+			       st->nmargpi,st->margbeta,st->nmargbeta,
+			       &errcode,errstr);
+    if (errcode!=0)
+      mexErrMsgTxt(errstr);
+  } else if (cmd==3) {
+    /* Copy out contents */
+    double* rp_pi,*rp_beta,*margpi,*margbeta,*sd_topval;
+    int* sd_numvalid,*sd_topind;
+    int nrp_pi,nrp_beta,nmargpi,nmargbeta,nsd_numvalid,nsd_topind,
+      nsd_topval;
+
+    if (nrhs!=2)
+      mexErrMsgTxt("Wrong number of input arguments");
+    st=getState(prhs[++argidx],errstr);
+    if (nlhs>7 || (nlhs>4 && st->sd_numvalid==0))
+      mexErrMsgTxt("Too many return arguments");
+    nrp_pi=nrp_beta=st->nrp_pi;
+    nmargpi=nmargbeta=st->nmargpi;
+    nsd_numvalid=st->nsd_numvalid;
+    nsd_topind=nsd_topval=st->nsd_topind;
+    argidx = -1; /* ++argidx in macro */
+    M_MAKEDARRAY(rp_pi);
+    memcpy(rp_pi,st->rp_pi,nrp_pi*sizeof(double));
+    if (nlhs>1) {
+      M_MAKEDARRAY(rp_beta);
+      memcpy(rp_beta,st->rp_beta,nrp_beta*sizeof(double));
+      if (nlhs>2) {
+	M_MAKEDARRAY(margpi);
+	memcpy(margpi,st->margpi,nmargpi*sizeof(double));
+	if (nlhs>3) {
+	  M_MAKEDARRAY(margbeta);
+	  memcpy(margbeta,st->margbeta,nmargbeta*sizeof(double));
+	  if (nlhs>4) {
+	    M_MAKEIARRAY(sd_numvalid);
+	    memcpy(sd_numvalid,st->sd_numvalid,nsd_numvalid*sizeof(int));
+	    if (nlhs>5) {
+	      M_MAKEIARRAY(sd_topind);
+	      memcpy(sd_topind,st->sd_topind,nsd_topind*sizeof(int));
+	      if (nlhs>6) {
+		M_MAKEDARRAY(sd_topval);
+		memcpy(sd_topval,st->sd_topval,nsd_topval*sizeof(double));
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  } else if (cmd==4) {
+    /* Delete state */
+    if (nrhs!=2)
+      mexErrMsgTxt("Wrong number of input arguments");
+    if (nlhs>0)
+      mexErrMsgTxt("Too many return arguments");
+    M_GETISCAL(hand,"HAND");
+    if (hand<0 || hand>=MAX_STATES || states[hand]==0)
+      mexErrMsgTxt("HAND: Invalid state handle");
+    freeState(hand);
+  } else
+    mexErrMsgTxt("CMD: Unknown command");
+}
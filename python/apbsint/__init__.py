@@ -13,3 +13,4 @@ HIER: Docstring for apbsint package
 from apbsint.coup_fact import *
 from apbsint.utilities import *
 from apbsint.inference import *
+from apbsint.tracing import *
@@ -10,11 +10,12 @@ basic subclasses of the B coupling factor hierarchy.
 import numpy as np
 import scipy.sparse as ssp
 import numbers
+import os
 
 import apbsint.helpers as helpers
 
 __all__ = ['Mat', 'MatDef', 'MatSparse', 'MatDiag', 'MatEye', 'MatSub',
-           'MatContainer', 'MatFactorizedInf']
+           'MatContainer', 'MatFactorizedInf', 'MatFactorizedPaged']
 
 # Mat class hierarchy
 
@@ -75,6 +76,24 @@ class Mat:
         """
         raise NotImplementedError("Method MVM must be implemented")
 
+    def mmm(self,x):
+        """
+        Returns matrix-matrix product B*X (new matrix), X an n-by-k matrix.
+        The default implementation calls 'mvm' for each column.
+        """
+        m, n = self.shape()
+        if not (isinstance(x,np.ndarray) and x.ndim == 2 and
+                x.shape[0] == n):
+            raise TypeError('X wrong')
+        out = np.empty((m,x.shape[1]))
+        tv1 = np.empty(n)
+        tv2 = np.empty(m)
+        for k in xrange(x.shape[1]):
+            tv1[:] = x[:,k]
+            self.mvm(tv1,tv2)
+            out[:,k] = tv2
+        return out
+
     def getcol(self,i,out=None):
         """
         Returns i-th column of B. If 'out' is given, result is written
@@ -112,6 +131,33 @@ class Mat:
             bt.mvm(tv2,out[i])
         return out
 
+    def mat_btdb_cols(self,v,i0,i1,out=None):
+        """
+        Returns columns i0:i1 of B^T (diag v) B (n-by-(i1-i0) matrix).
+        Used to build B^T (diag v) B block by block, without storing all of
+        it. If 'out' is given, the result is written there directly. 'out'
+        must have exactly the right size and must be C contiguous.
+        """
+        m, n = self.shape()
+        if not helpers.check_vecsize(v,m):
+            raise TypeError('V wrong')
+        if not (isinstance(i0,numbers.Integral) and
+                isinstance(i1,numbers.Integral) and 0<=i0<i1<=n):
+            raise ValueError('I0, I1 wrong')
+        out = self._matbtdbcols_checkout(out,n,i1-i0)
+        bt = self.T()
+        tv1 = np.zeros(n)
+        tv2 = np.empty(m)
+        tv3 = np.empty(n)
+        for i in xrange(i0,i1):
+            tv1[i] = 1.
+            self.mvm(tv1,tv2)
+            tv1[i] = 0.
+            tv2 *= v
+            bt.mvm(tv2,tv3)
+            out[:,i-i0] = tv3
+        return out
+
     def diag_bsbt(self,s,out=None):
         """
         Returns vector diag(B S B^T), where S is a symmetric matrix. If
@@ -169,6 +215,17 @@ class Mat:
                 (out.flags['C_CONTIGUOUS'] or out.flags['F_CONTIGUOUS'])):
             raise TypeError('OUT wrong type or size (internal!)')
 
+    def _matbtdbcols_checkout(self,out,n,k):
+        """
+        'out' must be n-by-k matrix, C contiguous. If None, it is created.
+        """
+        if out is None:
+            return np.empty((n,k))
+        if not (isinstance(out,np.ndarray) and out.ndim == 2 and
+                out.shape == (n,k) and out.flags['C_CONTIGUOUS']):
+            raise TypeError('OUT wrong type or size (internal!)')
+        return out
+
     def _matbtdb_setdgout(self,out,v):
         """
         Set 'out' equal to diag(v)
@@ -213,6 +270,12 @@ class MatDef(Mat):
         np.dot(mx,v,out)
         return out
 
+    def mmm(self,x):
+        if self.transp:
+            return np.dot(self.mx.T,x)
+        else:
+            return np.dot(self.mx,x)
+
     def getcol(self,i,out=None):
         out = self._check_resultvec(out,self.shape(0))
         if self.transp:
@@ -232,6 +295,13 @@ class MatDef(Mat):
             self._matbtdb_checkout(out)
             return np.dot(self.mx.T,self.buffmat1,out)
 
+    def mat_btdb_cols(self,v,i0,i1,out=None):
+        if self.transp:
+            raise NotImplementedError("NOT IMPLEMENTED")
+        out = self._matbtdbcols_checkout(out,self.n,i1-i0)
+        tmat = self.mx[:,i0:i1]*v.reshape(-1,1)
+        return np.dot(self.mx.T,tmat,out)
+
     def diag_bsbt(self,s,out=None):
         out = self._check_resultvec(out,self.shape(0))
         if self.transp:
@@ -271,6 +341,12 @@ class MatSparse(Mat):
         out[:] = mx.dot(v)
         return out
 
+    def mmm(self,x):
+        if self.transp:
+            return self.mx.T.dot(x)
+        else:
+            return self.mx.dot(x)
+
     def getcol(self,i,out=None):
         m = self.shape(0)
         out = self._check_resultvec(out,m)
@@ -291,6 +367,14 @@ class MatSparse(Mat):
         return mx.T.dot(ssp.diags(v,0,format=
                                   mx.getformat()).dot(mx)).toarray(out=out)
 
+    def mat_btdb_cols(self,v,i0,i1,out=None):
+        if self.transp:
+            raise NotImplementedError("NOT IMPLEMENTED")
+        mx = self.mx
+        out = self._matbtdbcols_checkout(out,self.n,i1-i0)
+        return mx.T.dot(ssp.diags(v,0,format=mx.getformat()).dot(
+            mx[:,i0:i1])).toarray(out=out)
+
     def diag_bsbt(self,s,out=None):
         if self.transp:
             raise NotImplementedError("NOT IMPLEMENTED")
@@ -603,24 +687,7 @@ class MatFactorizedInf(MatSparse):
             self.rowind = np.empty(mx.nnz+m+1,dtype=np.int32)
             self.rowind[:m+1] = mx.indptr
             self.rowind[m+1:] = mx.indices
-            # 'colind': V_i are obtained by doing the same on the transpose.
-            # For J_i, we fill a matrix of the same sparsity pattern as 'mx'
-            # with 0:(nnz-1), then read out the values of the transpose. In
-            # fact, we fill in 1:nnz and subtract 1 later, as otherwise the 0
-            # does not count as data entry
-            tmpm = ssp.csr_matrix((np.arange(1,mx.nnz+1),mx.indices,
-                                   mx.indptr),shape=(m,n),dtype=np.int32)
-            tmpm = tmpm.T.tocsr()  # Transpose
-            tmpm.sort_indices()
-            self.colind = np.empty(2*mx.nnz+n+1,dtype=np.int32)
-            self.colind[:n+1] = 2*tmpm.indptr+(n+1)
-            off = 0; off2 = n+1
-            for i in xrange(1,n+1):
-                sz = tmpm.indptr[i]-off
-                self.colind[off2:off2+sz] = tmpm.indices[off:off+sz]
-                self.colind[off2+sz:off2+2*sz] = tmpm.data[off:off+sz]-1
-                off += sz
-                off2 += 2*sz
+            self.colind = _fact_colind(mx)
             # B**2 factor into 'b2fact'
             self.b2fact = ssp.csr_matrix((mx.data**2,mx.indices,mx.indptr),
                                          shape=mx.shape)
@@ -631,6 +698,134 @@ class MatFactorizedInf(MatSparse):
     def get_mat(self):
         return self.mx
 
+class MatFactorizedPaged(Mat):
+    """
+    MatFactorizedPaged
+    ==================
+
+    Coupling factor for EP in factorized mode, stored out-of-core. The
+    potentials (rows of B) are partitioned into blocks of consecutive rows,
+    block b being rows 'blkoff[b]':('blkoff[b+1]'-1). The internal
+    representation 'rowind', 'colind', 'bvals' of each block (see
+    MatFactorizedInf, for the block as B) is stored in files in directory
+    'dirname', and loaded by 'load_block'. Only block offsets and sizes are
+    kept in memory.
+    'mx' is either a scipy.sparse.csr_matrix, split into blocks of
+    'blksize' rows, or a list of scipy.sparse.csr_matrix row blocks with
+    the same number of columns (so that B never has to be in memory as a
+    whole).
+    NOTE: Blocks consist of rows, since an EP update on potential j needs
+    all of B[j,:]. The marginals (size n) are not paged, see
+    apbsint.RepresentationFactorizedPaged.
+    """
+    def __init__(self,mx,dirname=None,blksize=None):
+        if isinstance(mx,MatFactorizedPaged):
+            Mat.__init__(self,mx)
+            self.dirname = mx.dirname
+            self.blkoff = mx.blkoff
+            self.blknnz = mx.blknnz
+            return
+        if not (isinstance(dirname,str) and os.path.isdir(dirname)):
+            raise ValueError('DIRNAME must be existing directory')
+        if isinstance(mx,ssp.csr_matrix):
+            if not (isinstance(blksize,numbers.Integral) and blksize>0):
+                raise TypeError('BLKSIZE must be positive integer')
+            m = mx.shape[0]
+            blocks = (mx[j:min(j+blksize,m)] for j in xrange(0,m,blksize))
+        elif isinstance(mx,list) or isinstance(mx,tuple):
+            blocks = mx
+        else:
+            raise TypeError('MX must be scipy.sparse.csr_matrix or list of such')
+        self.dirname = dirname
+        blkoff = [0]
+        blknnz = []
+        n = None
+        b = 0
+        for blk in blocks:
+            if not isinstance(blk,ssp.csr_matrix):
+                raise TypeError('MX: Blocks must be scipy.sparse.csr_matrix')
+            mb, nb = blk.shape
+            if n is None:
+                n = nb
+            elif nb != n:
+                raise TypeError('MX: Blocks must have the same number of columns')
+            blk.sort_indices()
+            rowind = np.empty(blk.nnz+mb+1,dtype=np.int32)
+            rowind[:mb+1] = blk.indptr
+            rowind[mb+1:] = blk.indices
+            np.save(self.fname(b,'rowind'),rowind)
+            np.save(self.fname(b,'colind'),_fact_colind(blk))
+            np.save(self.fname(b,'bvals'),np.asarray(blk.data,
+                                                     dtype=np.float64))
+            blkoff.append(blkoff[-1]+mb)
+            blknnz.append(blk.nnz)
+            b += 1
+        if b == 0:
+            raise ValueError('MX must not be empty')
+        Mat.__init__(self,blkoff[-1],n)
+        self.blkoff = np.array(blkoff,dtype=np.int64)
+        self.blknnz = np.array(blknnz,dtype=np.int64)
+
+    def nnz(self):
+        return int(self.blknnz.sum())
+
+    def numblocks(self):
+        return self.blknnz.shape[0]
+
+    def fname(self,b,name):
+        """
+        File name for array 'name' of block b
+        """
+        return os.path.join(self.dirname,'blk%d_%s.npy' % (b,name))
+
+    def load_block(self,b):
+        """
+        Returns internal representation of block b, with attributes 'rowind',
+        'colind', 'bvals'.
+        """
+        blk = helpers.Struct()
+        blk.rowind = np.load(self.fname(b,'rowind'))
+        blk.colind = np.load(self.fname(b,'colind'))
+        blk.bvals = np.load(self.fname(b,'bvals'))
+        return blk
+
+    def block_mat(self,b,blk):
+        """
+        Returns block b as scipy.sparse.csr_matrix, given its internal
+        representation 'blk' (see 'load_block').
+        """
+        mb = int(self.blkoff[b+1]-self.blkoff[b])
+        return ssp.csr_matrix((blk.bvals,blk.rowind[mb+1:],
+                               blk.rowind[:mb+1]),shape=(mb,self.n))
+
+# Helper functions
+
+def _fact_colind(mx):
+    """
+    Returns 'colind' part of the internal representation of
+    scipy.sparse.csr_matrix 'mx' (sorted indices), see MatFactorizedInf.
+    V_i are obtained from the transpose. For J_i, we fill a matrix of the
+    same sparsity pattern as 'mx' with 0:(nnz-1), then read out the values
+    of the transpose. In fact, we fill in 1:nnz and subtract 1 later, as
+    otherwise the 0 does not count as data entry.
+    """
+    m, n = mx.shape
+    nnz = mx.nnz
+    tmpm = ssp.csr_matrix((np.arange(1,nnz+1),mx.indices,mx.indptr),
+                          shape=(m,n),dtype=np.int32)
+    tmpm = tmpm.T.tocsr()  # Transpose
+    tmpm.sort_indices()
+    colind = np.empty(2*nnz+n+1,dtype=np.int32)
+    colind[:n+1] = 2*tmpm.indptr+(n+1)
+    # Block for i starts at n+1+2*indptr[i]: V_i, followed by J_i. Entry t
+    # of the transpose (in column i) goes to n+1+indptr[i]+t in V_i
+    sz = tmpm.indptr[1:]-tmpm.indptr[:-1]
+    cols = np.repeat(np.arange(n),sz)
+    pos = (n+1)+tmpm.indptr[cols]+np.arange(nnz)
+    colind[pos] = tmpm.indices
+    colind[pos+sz[cols]] = tmpm.data-1
+    return colind
+
 # Testcode (really basic)
 
 if __name__ == "__main__":
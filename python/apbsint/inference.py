@@ -89,6 +89,133 @@ class InfDriver:
             rho_p = rho_q*tvec
         return (logz, h_p, rho_p)
 
+    def _updcache_check_args(self,opts):
+        """
+        Helper for 'inference'. Checks 'opts.updcache', 'opts.updcache_tol'
+        and assigns default values (False, 0.).
+        """
+        try:
+            if not isinstance(opts.updcache,bool):
+                raise TypeError('OPTS.UPDCACHE wrong')
+        except AttributeError:
+            opts.updcache = False
+        try:
+            if not (isinstance(opts.updcache_tol,numbers.Real) and
+                    opts.updcache_tol>=0.):
+                raise TypeError('OPTS.UPDCACHE_TOL wrong')
+        except AttributeError:
+            opts.updcache_tol = 0.
+
+    def _updcache_stats(self,potman,jind,hits,misses):
+        """
+        Helper for 'inference'. Hit rates of the local update cache per
+        potential type. 'hits', 'misses' are counts for potentials 'jind'.
+        Returns dict: name -> (hits, misses, hit rate).
+        """
+        stats = {}
+        off = 0
+        for el in potman.elem:
+            msk = np.logical_and(jind>=off,jind<off+el.size)
+            h, ms = stats.get(el.name,(0,0,0.))[:2]
+            h += int(hits[msk].sum())
+            ms += int(misses[msk].sum())
+            stats[el.name] = (h, ms, float(h)/max(h+ms,1))
+            off += el.size
+        return stats
+
+    def _updcache_print_stats(self,stats):
+        for name, st in sorted(stats.items()):
+            print '   updcache[%s]: hits=%d, misses=%d (%.2f%%)' % \
+                (name,st[0],st[1],100.*st[2])
+
+    def _quadacc_check_args(self,opts):
+        """
+        Helper for 'inference'. Checks 'opts.quadacc' and assigns default
+        value (None).
+        """
+        try:
+            if opts.quadacc is not None:
+                if not (isinstance(opts.quadacc,tuple) and
+                        len(opts.quadacc)==3 and
+                        all(isinstance(x,numbers.Real) and x>0.
+                            for x in opts.quadacc) and
+                        opts.quadacc[0]<=opts.quadacc[1]):
+                    raise TypeError('OPTS.QUADACC wrong')
+        except AttributeError:
+            opts.quadacc = None
+
+    def _quadacc_start(self,opts,potman):
+        """
+        Helper for 'inference'. If 'opts.quadacc' is given, attaches an
+        accuracy schedule to each annotation object (quadrature services)
+        of 'potman'. Returns list of these objects (empty if
+        'opts.quadacc' is None). Schedules left attached by a previous
+        call which failed are detached first.
+        """
+        for qs in getattr(self,'_quadacc_objs',[]):
+            epx.quad_accsched(4,qs)
+        self._quadacc_objs = []
+        if opts.quadacc is not None:
+            accmin, accmax, accfact = opts.quadacc
+            for qs in np.unique(potman.annobj[potman.annobj != 0]):
+                epx.quad_accsched(0,qs,accmin,accmax,accfact)
+                self._quadacc_objs.append(qs)
+        return self._quadacc_objs
+
+    def _quadacc_sweep(self,qsobjs,delta):
+        """
+        Helper for 'inference'. Starts a new sweep for the schedules on
+        'qsobjs', 'delta' is the value of the previous sweep.
+        """
+        for qs in qsobjs:
+            epx.quad_accsched(1,qs,delta=delta)
+
+    def _quadacc_finish(self,qsobjs,res):
+        """
+        Helper for 'inference'. Detaches schedules from 'qsobjs' and
+        writes their statistics to 'res.quadacc' (summed over 'qsobjs').
+        """
+        if len(qsobjs)>0:
+            stats = None
+            for qs in qsobjs:
+                st = epx.quad_accsched(2,qs)
+                epx.quad_accsched(4,qs)
+                if stats is None:
+                    stats = st
+                else:
+                    stats[:,1:] += st[:,1:]
+            res.quadacc = stats
+        self._quadacc_objs = []
+
+    def _quadfixed_check_args(self,opts):
+        """
+        Helper for 'inference'. Checks 'opts.quadfixed' and assigns default
+        value (None).
+        """
+        try:
+            if opts.quadfixed is not None:
+                if not (isinstance(opts.quadfixed,tuple) and
+                        len(opts.quadfixed)==3 and
+                        isinstance(opts.quadfixed[0],numbers.Integral) and
+                        isinstance(opts.quadfixed[1],numbers.Integral) and
+                        isinstance(opts.quadfixed[2],numbers.Real) and
+                        opts.quadfixed[0]>=0 and opts.quadfixed[1]>0 and
+                        opts.quadfixed[2]>0.):
+                    raise TypeError('OPTS.QUADFIXED wrong')
+        except AttributeError:
+            opts.quadfixed = None
+
+    def _quadfixed_start(self,opts,potman):
+        """
+        Helper for 'inference'. If 'opts.quadfixed' is given, configures
+        fixed-node quadrature on each annotation object (quadrature
+        services) of 'potman'.
+        """
+        if opts.quadfixed is not None:
+            order, checkorder, tol = opts.quadfixed
+            for qs in np.unique(potman.annobj[potman.annobj != 0]):
+                epx.quad_fixednode(qs,order,checkorder,tol)
+
     def _infer_check_commonargs(self,opts):
         """
         Checks common arguments of 'inference' implementations in
@@ -143,6 +270,12 @@ class InfDriver:
                     raise TypeError('OPTS.REFRESH wrong')
             except AttributeError:
                 opts.refresh = True
+        try:
+            if not (opts.sweep_hook is None or callable(opts.sweep_hook)):
+                raise TypeError('OPTS.SWEEP_HOOK wrong')
+        except AttributeError:
+            opts.sweep_hook = None
+        self._quadacc_check_args(opts)
 
     def _binclass_print_teststats(self,pmodel,targets,imode):
         """
@@ -161,6 +294,50 @@ class InfDriver:
         print ('Test set predictions: Accuracy: %4.2f%%, '
                'log likelihood: %.6f') % (acc, loglh)
 
+    def _binclass_testmonitor_init(self,pmodel,targets):
+        """
+        Helper for 'inference'. Allocates state for the incremental test set
+        monitor (see 'bc_testmodel'). The state is initialized by the first
+        call of '_binclass_print_teststats_increm'.
+        """
+        pm, n = pmodel.bfact.shape()
+        pmodel.potman.check_internal()
+        tmon = helpers.Struct()
+        tmon.pmodel = pmodel
+        tmon.targets = targets
+        tmon.margmeans = np.empty(n)
+        tmon.margvars = np.empty(n)
+        tmon.predmeans = np.empty(pm)
+        tmon.predvars = np.empty(pm)
+        tmon.predlogz = np.empty(pm)
+        tmon.stats = np.empty(2)
+        tmon.valid = False
+        return tmon
+
+    def _binclass_print_teststats_increm(self,tmon,tol):
+        """
+        Helper for 'inference'. Same as '_binclass_print_teststats', but
+        test set predictions are updated incrementally via
+        epx.fact_testmonitor. State is in 'tmon' (see
+        '_binclass_testmonitor_init').
+        """
+        rep = self.rep
+        pbfact = tmon.pmodel.bfact
+        ppotman = tmon.pmodel.potman
+        pm, n = pbfact.shape()
+        epx.fact_testmonitor(n,pm,ppotman.potids,ppotman.numpot,
+                             ppotman.parvec,ppotman.parshrd,ppotman.annobj,
+                             pbfact.colind,pbfact.bvals,tmon.targets,
+                             rep.marg_pi,rep.marg_beta,tmon.margmeans,
+                             tmon.margvars,tmon.predmeans,tmon.predvars,
+                             tmon.predlogz,tmon.stats,
+                             tol if tmon.valid else -1.)
+        tmon.valid = True
+        acc = 100.*tmon.stats[0]/pm
+        loglh = tmon.stats[1]/pm
+        print ('Test set predictions: Accuracy: %4.2f%%, '
+               'log likelihood: %.6f') % (acc, loglh)
+
     def _binclass_assemble_targets(self,opts):
         # Assemble test target vector
         pman = opts.bc_testmodel.potman
@@ -263,6 +440,58 @@ class CoupledInfDriver(InfDriver):
         else:
             raise ValueError("Unknown mode '" + mode + "'")
 
+    def logmarglik(self,piminthres=1e-8,grad=False):
+        """
+        EP approximation to the log marginal likelihood, evaluated at the
+        current EP parameters (should be an EP fixed point):
+          log Z_EP = Phi + sum_j [ log Z_j + G(cav_j) - G(marg_j) ],
+          Phi = (n/2) log(2 pi) - sum_i log L_ii + ||c||^2/2,
+        where G(mu,rho) = mu^2/(2 rho) + log(rho)/2, Z_j is the normalization
+        constant of the tilted distribution for potential j, and L, c as in
+        apbsint.RepresentationCoupled. The representation has to be
+        refreshed (or updated) for the current EP parameters.
+        Potentials j are skipped if their cavity pi value is < 'piminthres'/2
+        or the local computation fails, their count is returned in 'nskip'.
+        If 'grad'==True, the gradient w.r.t. 'model.potman.parvec' is
+        returned in 'dparvec' (None otherwise). At an EP fixed point, this is
+        the sum of gradients of log Z_j for fixed cavity moments.
+        Returns '(logz, dparvec, nskip)'.
+        """
+        model = self.model
+        rep = self.rep
+        bfact = model.bfact
+        potman = model.potman
+        m, n = bfact.shape()
+        potman.check_internal()
+        # Marginals, cavities
+        mu = np.empty(m)
+        rho = np.empty(m)
+        rep.predict(bfact,mu,rho,False)
+        cpi = 1./rho - rep.ep_pi
+        indok = np.nonzero(cpi >= 0.5*piminthres)[0]
+        crho = 1./cpi[indok]
+        cmu = crho*(mu[indok]/rho[indok] - rep.ep_beta[indok])
+        sz = indok.shape[0]
+        rstat = np.empty(sz,dtype=np.int32)
+        alpha = np.empty(sz)
+        nu = np.empty(sz)
+        logz_j = np.empty(sz)
+        dparvec = np.empty(potman.parvec.shape[0]) if grad else None
+        epx.epupdate_parallel(potman.potids,potman.numpot,potman.parvec,
+                              potman.parshrd,potman.annobj,cmu,crho,rstat,
+                              alpha,nu,logz_j,indok.astype(np.int32),dparvec)
+        indok2 = np.nonzero(rstat)[0]
+        nskip = m - indok2.shape[0]
+        cmu = cmu[indok2]
+        crho = crho[indok2]
+        indok = indok[indok2]
+        logz = (0.5*n*np.log(2.*np.pi) - np.sum(np.log(rep.diag_lfact())) +
+                0.5*np.inner(rep.cvec,rep.cvec) + np.sum(logz_j[indok2]) +
+                0.5*np.sum(cmu*cmu/crho + np.log(crho)) -
+                0.5*np.sum(mu[indok]*mu[indok]/rho[indok] +
+                           np.log(rho[indok])))
+        return (logz, dparvec, nskip)
+
 class EPCoupParallelInfDriver(CoupledInfDriver):
     """
     EPCoupParallelInfDriver
@@ -293,6 +522,28 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
         - bc_testmodel: Optional. Only for binary classification right now.
           Test set model (type apbsint.ModelCoupled). Test set accuracy and
           avg. log likelihood are computed and printed after each sweep.
+        - sweep_hook: Optional. Called as sweep_hook(nit,delta) at the end
+          of each sweep (sweep number, convergence statistic). Used for
+          profiling (see test/benchmark)
+        - updcache: If True, the results of local EP updates are cached
+          for each potential, and reused in later sweeps if its cavity
+          moments changed by less than 'updcache_tol' (relative; the mean
+          relative to the stddev.). Def.: False
+        - updcache_tol: See 'updcache'. Def.: 0 (cavities must be equal)
+        - quadacc: Optional. Tuple (accmin, accmax, accfact). If given, the
+          accuracy of quadrature potentials follows the convergence
+          statistic delta of the previous sweep, as
+          max(accmin, min(accmax, accfact*delta)), accmax in the first sweep
+          (see C++ class 'QuadAccuracySchedule'). All annotation objects in
+          'model.potman' must be quadrature services. Def.: None
+        - quadfixed: Optional. Tuple (order, checkorder, tol). If given,
+          batched local updates on quadrature potentials use fixed-node
+          Gauss-Hermite quadrature of order 'order', checked against a rule
+          of order 'checkorder' with tolerance 'tol' (failing potentials
+          fall back to adaptive quadrature). 'order'==0 switches it off.
+          The setting stays with the annotation objects in 'model.potman'
+          (quadrature services), so is also used by 'predict'. Def.: None
+          (no change)
         Returns 'res' or '(res, res_det)' (latter if 'opts.res_det'==True).
         'res' attributes:
         - rstat: Return status (0: Converged to 'deltaeps'; 1: Done
@@ -300,6 +551,11 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
         - nit: Number of sweeps done
         - delta: Value convergence statistic after last sweep
         - nskip: Total number of skipped updates across all sweeps
+        - updcache: Only if 'opts.updcache'. Dict, maps potential type name
+          to (hits, misses, hit rate) of the cache, over all sweeps
+        - quadacc: Only if 'opts.quadacc'. Matrix, a row for each sweep:
+          accuracy, number of quadrature calls, number of integrand
+          evaluations (summed over quadrature services)
         'res_det' attributes (optional):
         - delta: Value after each sweep
         - nskip: Value after each sweep
@@ -309,6 +565,8 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
             raise ValueError('REP.KEEP_MARGS must be True')
         opts.imode = 'CoupParallel'
         self._infer_check_commonargs(opts)
+        self._updcache_check_args(opts)
+        self._quadfixed_check_args(opts)
         # Initialization
         res = helpers.Struct()
         res.rstat = 1
@@ -341,7 +599,21 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
         new_beta = np.empty(sz)
         old_margs = np.empty(2*mm)
         new_margs = np.empty(2*mm)
+        if opts.updcache:
+            # Cavities and results of last local update for each position
+            # in 'potman.updind' ('uc_crho'==0: empty)
+            uc_cmu = np.zeros(mm)
+            uc_crho = np.zeros(mm)
+            uc_alpha = np.empty(mm)
+            uc_nu = np.empty(mm)
+            uc_hits = np.zeros(mm,dtype=np.int32)
+            uc_misses = np.zeros(mm,dtype=np.int32)
+        self._quadfixed_start(opts,potman)
+        qsobjs = self._quadacc_start(opts,potman)
         for res.nit in range(1,opts.maxit+1):
+            t_trace = epx.trace_event()  # Timeline tracing
+            if res.nit>1:
+                self._quadacc_sweep(qsobjs,res.delta)
             #t_start1=time.time()
             # Local EP updates
             # We update only on potentials in 'potman.updind' (excludes
@@ -366,9 +638,44 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
             #t_stop=time.time()
             #print 'Time(inference:comp_cav): %.8fs' % (t_stop-t_start)
             #t_start=time.time()
-            epx.epupdate_parallel(potman.potids,potman.numpot,potman.parvec,
-                                  potman.parshrd,potman.annobj,cmu,crho,rstat,
-                                  alpha0,nu0,None,potman.updind)
+            if not opts.updcache:
+                epx.epupdate_parallel(potman.potids,potman.numpot,
+                                      potman.parvec,potman.parshrd,
+                                      potman.annobj,cmu,crho,rstat,alpha0,
+                                      nu0,None,potman.updind)
+            else:
+                # Local updates only where the cache misses
+                tol = opts.updcache_tol
+                hit = np.logical_and(
+                    uc_crho > 0.,
+                    np.logical_and(np.abs(cmu-uc_cmu) <=
+                                   tol*np.sqrt(uc_crho),
+                                   np.abs(crho-uc_crho) <= tol*uc_crho))
+                uc_hits += hit
+                indmiss = np.nonzero(np.logical_not(hit))[0]
+                uc_misses[indmiss] += 1
+                rstat[hit] = 1
+                alpha0[hit] = uc_alpha[hit]
+                nu0[hit] = uc_nu[hit]
+                nmiss = indmiss.shape[0]
+                if nmiss > 0:
+                    tmp_rstat = np.empty(nmiss,dtype=np.int32)
+                    tmp_alpha = np.empty(nmiss)
+                    tmp_nu = np.empty(nmiss)
+                    epx.epupdate_parallel(potman.potids,potman.numpot,
+                                          potman.parvec,potman.parshrd,
+                                          potman.annobj,cmu[indmiss],
+                                          crho[indmiss],tmp_rstat,tmp_alpha,
+                                          tmp_nu,None,
+                                          potman.updind[indmiss])
+                    rstat[indmiss] = tmp_rstat
+                    alpha0[indmiss] = tmp_alpha
+                    nu0[indmiss] = tmp_nu
+                    indst = indmiss[np.nonzero(tmp_rstat)[0]]
+                    uc_cmu[indst] = cmu[indst]
+                    uc_crho[indst] = crho[indst]
+                    uc_alpha[indst] = alpha0[indst]
+                    uc_nu[indst] = nu0[indst]
             #t_stop=time.time()
             #print 'Time(epupdate_parallel): %.8fs' % (t_stop-t_start)
             # Update EP parameters, and figure out where skips happened
@@ -435,15 +742,26 @@ class EPCoupParallelInfDriver(CoupledInfDriver):
                 res_det.nskip.append(nskip)
             if opts.verbose>0:
                 print 'It. %d: delta=%f, nskip=%d' % (res.nit,res.delta,nskip)
+                if opts.updcache:
+                    self._updcache_print_stats(
+                        self._updcache_stats(potman,potman.updind,uc_hits,
+                                             uc_misses))
             if do_teststats:
                 self._binclass_print_teststats(opts.bc_testmodel,targets,
                                                opts.imode)
+            epx.trace_event('sweep','python',t_trace,res.nit)
+            if opts.sweep_hook is not None:
+                opts.sweep_hook(res.nit,res.delta)
             # Convergence?
             if res.delta < opts.deltaeps:
                 res.rstat = 0
                 break
             #t_stop1=time.time()
             #print 'Time(inference::sweep): %.8fs' % (t_stop1-t_start1)
+        if opts.updcache:
+            res.updcache = self._updcache_stats(potman,potman.updind,uc_hits,
+                                                uc_misses)
+        self._quadacc_finish(qsobjs,res)
         # Timing
         #t_stop0=time.time()
         #print 'Time(inference(ALL)): %.8fs' % (t_stop0-t_start0)
@@ -498,6 +816,8 @@ class EPCoupSequentialInfDriver(CoupledInfDriver):
         - res_det: Return detailed results in 'res_det' (below)? Def.: False
         - verbose: Verbosity level (0: no messages, 1: some messages). Def.: 0
         - bc_testmodel: Optional. See EPCoupParallelInfDriver.inference.
+        - sweep_hook: Optional. See EPCoupParallelInfDriver.inference.
+        - quadacc: Optional. See EPCoupParallelInfDriver.inference.
         Returns 'res' or '(res, res_det)' (latter if 'opts.res_det'==True).
         Each update results in a skip status, summarized in 'nskip'
         histograms:
@@ -512,6 +832,7 @@ class EPCoupSequentialInfDriver(CoupledInfDriver):
         - delta: Value convergence statistic after last sweep
         - nskip: Skip status histogram (vector of size 4), summed over all
           updates and sweeps
+        - quadacc: See EPCoupParallelInfDriver.inference
         'res_det' attributes (optional):
         - delta: Value after each sweep
         - nskip: Matrix, each row skip status histogram for a sweep
@@ -552,7 +873,11 @@ class EPCoupSequentialInfDriver(CoupledInfDriver):
             do_teststats = False
         # Loop over sweeps
         vvec = np.empty(n)
+        qsobjs = self._quadacc_start(opts,potman)
         for res.nit in range(1,opts.maxit+1):
+            t_trace = epx.trace_event()  # Timeline tracing
+            if res.nit>1:
+                self._quadacc_sweep(qsobjs,res.delta)
             updind = np.random.permutation(potman.updind)
             if do_1stsweep and res.nit==1:
                 updind = [x for x in updind if x in ind_swp1]
@@ -638,9 +963,13 @@ class EPCoupSequentialInfDriver(CoupledInfDriver):
             if do_teststats:
                 self._binclass_print_teststats(opts.bc_testmodel,targets,
                                                opts.imode)
+            epx.trace_event('sweep','python',t_trace,res.nit)
+            if opts.sweep_hook is not None:
+                opts.sweep_hook(res.nit,res.delta)
             if res.delta < opts.deltaeps:
                 res.rstat = 0
                 break
+        self._quadacc_finish(qsobjs,res)
         # Return stuff
         if opts.res_det:
             return (res, res_det)
@@ -654,12 +983,21 @@ class EPFactorizedInfDriver(InfDriver):
 
     Implements expectation propagation inference in factorized mode.
 
+    Out-of-core mode: If 'rep' is of type
+    apbsint.RepresentationFactorizedPaged (B of type
+    apbsint.MatFactorizedPaged), B and messages are paged in block by
+    block. In a sweep, blocks are visited in random ordering, and updates
+    of each block are done in random ordering.
+
     """
     def __init__(self,model,rep):
         if not isinstance(model,ut.ModelFactorized):
             raise TypeError('MODEL must be instance of apbsint.ModelFactorized')
         if not isinstance(rep,ut.RepresentationFactorized):
             raise TypeError('REP must be instance of apbsint.RepresentationFactorized')
+        self.paged = isinstance(rep,ut.RepresentationFactorizedPaged)
+        if self.paged != isinstance(model.bfact,cf.MatFactorizedPaged):
+            raise TypeError('REP must be apbsint.RepresentationFactorizedPaged iff MODEL.BFACT is apbsint.MatFactorizedPaged')
         InfDriver.__init__(self,model,rep)
 
     def init(self,mode,refresh=True,cav_var=1.):
@@ -675,47 +1013,95 @@ class EPFactorizedInfDriver(InfDriver):
         """
         if mode.upper() == 'ADF':
             bfact = self.model.bfact
-            bmat = bfact.get_mat()
             potman = self.model.potman
             rep = self.rep
-            m, n = bfact.shape()
-            potman.check_internal()
-            ep_pi = np.zeros(rep.size_pars())
-            ep_beta = np.zeros(rep.size_pars())
-            off = 0
-            for el in potman.elem:
-                numk = el.size
-                if el.name == 'Gaussian':
-                    # If potential is N(s | y_j,ssq_j) and cv=='cav_var':
-                    #   pi_ji = b_ji^2 / ( (|V_j|-1) cv + ssq_j )
-                    #   beta_ji = b_ji y_j / ( (|V_j|-1) cv + ssq_j )
-                    # Offset into EP parameter vectors:
-                    off2 = bmat[:off].getnnz() if off>0 else 0
-                    mx_tmp = bfact.b2fact[off:off+numk].copy()
-                    sz2 = mx_tmp.getnnz()
-                    # Number of nonzeros per row minus 1:
-                    vjsz = mx_tmp.indptr[1:] - mx_tmp.indptr[:-1] - 1
-                    tvec = 1./(cav_var*vjsz + el.pars[1])
-                    mx_dg = ssp.diags(tvec,0)
-                    mx_tmp = mx_dg * mx_tmp
-                    ep_pi[off2:off2+sz2] = mx_tmp.data
-                    mx_tmp = bmat[off:off+numk].copy()
-                    assert mx_tmp.getnnz() == sz2
-                    # Some y_j's could be zero, which would change the sparsity
-                    # pattern. Have to go a detour here
-                    nzind = mx_tmp.nonzero()
-                    tvec *= el.pars[0]
-                    mx_dg = ssp.diags(tvec,0)
-                    mx_tmp = mx_dg * mx_tmp
-                    ep_beta[off2:off2+sz2] = mx_tmp[nzind[0],nzind[1]]
-                off += numk
-            rep.setpi(ep_pi)
-            rep.setbeta(ep_beta)
+            if not self.paged:
+                ep_pi, ep_beta = self._init_adf(bfact.get_mat(),bfact.b2fact,
+                                                potman,cav_var)
+                rep.setpi(ep_pi)
+                rep.setbeta(ep_beta)
+            else:
+                # Block by block
+                def init_block(b,blk):
+                    bmat = bfact.block_mat(b,blk)
+                    b2mat = ssp.csr_matrix((bmat.data**2,bmat.indices,
+                                            bmat.indptr),shape=bmat.shape)
+                    blk.ep_pi[:], blk.ep_beta[:] = self._init_adf(
+                        bmat,b2mat,potman.subrange(int(bfact.blkoff[b]),
+                                                   int(bfact.blkoff[b+1])),
+                        cav_var)
+                rep.sweep(xrange(bfact.numblocks()),init_block)
             if refresh:
                 rep.refresh()
         else:
             raise ValueError("Unknown mode '" + mode + "'")
 
+    def _init_adf(self,bmat,b2mat,potman,cav_var):
+        """
+        ADF initialization (see 'init') for B in 'bmat', B**2 in 'b2mat'
+        (scipy.sparse.csr_matrix), potential manager 'potman'. Returns
+        '(ep_pi, ep_beta)'.
+        """
+        potman.check_internal()
+        ep_pi = np.zeros(bmat.getnnz())
+        ep_beta = np.zeros(bmat.getnnz())
+        off = 0
+        for el in potman.elem:
+            numk = el.size
+            if el.name == 'Gaussian':
+                # If potential is N(s | y_j,ssq_j) and cv=='cav_var':
+                #   pi_ji = b_ji^2 / ( (|V_j|-1) cv + ssq_j )
+                #   beta_ji = b_ji y_j / ( (|V_j|-1) cv + ssq_j )
+                # Offset into EP parameter vectors:
+                off2 = bmat[:off].getnnz() if off>0 else 0
+                mx_tmp = b2mat[off:off+numk].copy()
+                sz2 = mx_tmp.getnnz()
+                # Number of nonzeros per row minus 1:
+                vjsz = mx_tmp.indptr[1:] - mx_tmp.indptr[:-1] - 1
+                tvec = 1./(cav_var*vjsz + el.pars[1])
+                mx_dg = ssp.diags(tvec,0)
+                mx_tmp = mx_dg * mx_tmp
+                ep_pi[off2:off2+sz2] = mx_tmp.data
+                mx_tmp = bmat[off:off+numk].copy()
+                assert mx_tmp.getnnz() == sz2
+                # Some y_j's could be zero, which would change the sparsity
+                # pattern. Have to go a detour here
+                nzind = mx_tmp.nonzero()
+                tvec *= el.pars[0]
+                mx_dg = ssp.diags(tvec,0)
+                mx_tmp = mx_dg * mx_tmp
+                ep_beta[off2:off2+sz2] = mx_tmp[nzind[0],nzind[1]]
+            off += numk
+        return (ep_pi, ep_beta)
+
+    def logmarglik(self,piminthres=1e-8,grad=False):
+        """
+        EP approximation to the log marginal likelihood, evaluated at the
+        current EP parameters (should be an EP fixed point). See
+        apbsint.CoupledInfDriver.logmarglik for arguments and return values.
+        The prior on x is improper (flat), so 'logz' is defined up to a
+        constant. Marginals must be up-2-date (see
+        apbsint.RepresentationFactorized.refresh).
+        NOTE: Only univariate potentials are supported right now. Not
+        supported in out-of-core mode.
+        """
+        if self.paged:
+            raise NotImplementedError('LOGMARGLIK not supported in out-of-core mode')
+        model = self.model
+        rep = self.rep
+        bfact = model.bfact
+        potman = model.potman
+        m, n = bfact.shape()
+        potman.check_internal()
+        dparvec = np.empty(potman.parvec.shape[0]) if grad else None
+        logz, nskip = epx.fact_logmarglik(n,m,potman.potids,potman.numpot,
+                                          potman.parvec,potman.parshrd,
+                                          potman.annobj,bfact.rowind,
+                                          bfact.colind,bfact.bvals,rep.ep_pi,
+                                          rep.ep_beta,rep.marg_pi,
+                                          rep.marg_beta,piminthres,dparvec)
+        return (logz, dparvec, nskip)
+
     def predict(self,pmodel,opts):
         """
         Prediction on test model 'pmodel' (type apbsint.ModelFactorized).
@@ -779,7 +1165,31 @@ class EPFactorizedInfDriver(InfDriver):
         - res_det: Return detailed results in 'res_det' (below)? Def.: False
         - verbose: Verbosity level (0: no messages, 1: some messages). Def.: 0
         - bc_testmodel: See apbsint.EPCoupParallelInfDriver.inference.
+          Optional. Test set predictions are kept up-2-date incrementally
+          (see C++ class 'FactEPTestMonitor'): after each sweep, only
+          variables whose marginals changed by more than 'bc_testtol'
+          (relative change in mean or stddev.) are propagated
+        - bc_testtol: See 'bc_testmodel'. Def.: 0 (propagate all changed
+          variables)
+        - sweep_hook: See apbsint.EPCoupParallelInfDriver.inference.
+          Optional
+        - rowthreads: Updates on potentials with at least 'rowthres'
+          nonzeros in their row of B are done by this many threads, each
+          on a part of the row (see C++ class 'FactorizedEPDriver'). Pays
+          off only for very long rows. Def.: 1 (no threads)
+        - rowthres: See 'rowthreads'. Def.: 32768
+        - updcache: See apbsint.EPCoupParallelInfDriver.inference. The cache
+          is kept in C++ code (see C++ class 'LocalUpdateCache'). Only
+          cavities on s_j are compared. Def.: False
+        - updcache_tol: See 'updcache'. Def.: 0
+        - quadacc: Optional. See EPCoupParallelInfDriver.inference
+        - checkpoint: File name. If given, a checkpoint of the
+          representation is taken after every 'checkpoint_every' sweeps
+          (see apbsint.RepresentationFactorized.checkpoint_save). It is
+          written in the background while the next sweeps run. To resume
+          a fit, use apbsint.RepresentationFactorized.checkpoint_load.
           Optional
+        - checkpoint_every: See 'checkpoint'. Def.: 1
         Returns 'res' or '(res, res_det)' (latter if 'opts.res_det'==True).
         Each update results in a skip status, summarized in 'nskip'
         histograms:
@@ -797,6 +1207,8 @@ class EPFactorizedInfDriver(InfDriver):
           updates and sweeps
         - nsdamp: Only if selective damping active. Number of non-skipped
           updates which were selectively damped
+        - updcache: See apbsint.EPCoupParallelInfDriver.inference
+        - quadacc: See apbsint.EPCoupParallelInfDriver.inference
         'res_det' attributes (optional):
         - delta: Value after each sweep
         - nskip: Matrix, each row skip status histogram for a sweep
@@ -821,6 +1233,36 @@ class EPFactorizedInfDriver(InfDriver):
                 raise TypeError('OPTS.SKIP_GAUSS wrong')
         except AttributeError:
             opts.skip_gauss = False
+        try:
+            if not (isinstance(opts.rowthreads,numbers.Integral) and
+                    opts.rowthreads>=1):
+                raise TypeError('OPTS.ROWTHREADS wrong')
+        except AttributeError:
+            opts.rowthreads = 1
+        try:
+            if not (isinstance(opts.rowthres,numbers.Integral) and
+                    opts.rowthres>=1):
+                raise TypeError('OPTS.ROWTHRES wrong')
+        except AttributeError:
+            opts.rowthres = 32768
+        self._updcache_check_args(opts)
+        if self.paged and opts.updcache:
+            raise NotImplementedError('OPTS.UPDCACHE not supported in out-of-core mode')
+        try:
+            if not (isinstance(opts.checkpoint,str) and
+                    len(opts.checkpoint)>0):
+                raise TypeError('OPTS.CHECKPOINT wrong')
+            if self.paged:
+                raise NotImplementedError('OPTS.CHECKPOINT not supported in out-of-core mode')
+            do_checkpoint = True
+        except AttributeError:
+            do_checkpoint = False
+        try:
+            if not (isinstance(opts.checkpoint_every,numbers.Integral) and
+                    opts.checkpoint_every>=1):
+                raise TypeError('OPTS.CHECKPOINT_EVERY wrong')
+        except AttributeError:
+            opts.checkpoint_every = 1
         # Initialization
         bfact = self.model.bfact
         potman = self.model.potman
@@ -831,6 +1273,11 @@ class EPFactorizedInfDriver(InfDriver):
             do_seldamp = (rep.sd_numk>0)
         except AttributeError:
             do_seldamp = False
+        if opts.updcache:
+            uc_entries = np.zeros(4*m)
+            uc_counts = np.zeros(2*m,dtype=np.int32)
+        else:
+            uc_entries = uc_counts = None
         res = helpers.Struct()
         res.rstat = 1
         res.nskip = np.zeros(5,dtype=np.int32)
@@ -848,6 +1295,14 @@ class EPFactorizedInfDriver(InfDriver):
             do_teststats = True
         except AttributeError:
             do_teststats = False
+        if do_teststats:
+            try:
+                if not (isinstance(opts.bc_testtol,numbers.Real) and
+                        opts.bc_testtol>=0.):
+                    raise TypeError('OPTS.BC_TESTTOL wrong')
+            except AttributeError:
+                opts.bc_testtol = 0.
+            tmon = self._binclass_testmonitor_init(opts.bc_testmodel,targets)
         # DEBUG:
         # If 'opts.deb_matcomp_fname' is given, we directly compare against
         # intermediate results stored by Matlab. This is a file name string
@@ -859,8 +1314,16 @@ class EPFactorizedInfDriver(InfDriver):
             do_deb_matcomp = True
         except AttributeError:
             do_deb_matcomp = False
+        if self.paged:
+            if do_deb_matcomp:
+                raise NotImplementedError('OPTS.DEB_MATCOMP_FNAME not supported in out-of-core mode')
+            self._pm_blocks = {}
         # Loop over sweeps
+        qsobjs = self._quadacc_start(opts,potman)
         for res.nit in range(1,opts.maxit+1):
+            t_trace = epx.trace_event()  # Timeline tracing
+            if res.nit>1:
+                self._quadacc_sweep(qsobjs,res.delta)
             if not do_deb_matcomp:
                 if not opts.skip_gauss:
                     updind = np.int32(np.random.permutation(m))
@@ -879,13 +1342,19 @@ class EPFactorizedInfDriver(InfDriver):
             sz = updind.shape[0]
             rstat = np.empty(sz,dtype=np.int32)
             delta = np.empty(sz)
-            if not do_seldamp:
+            if self.paged:
+                self._sequpdates_paged(updind,opts,rstat,delta)
+            elif not do_seldamp:
                 epx.fact_sequpdates(n,m,updind,potman.potids,potman.numpot,
                                     potman.parvec,potman.parshrd,potman.annobj,
                                     bfact.rowind,bfact.colind,bfact.bvals,
                                     rep.ep_pi,rep.ep_beta,rep.marg_pi,
                                     rep.marg_beta,opts.piminthres,opts.damp,
-                                    rstat,delta)
+                                    rstat,delta,rowthreads=opts.rowthreads,
+                                    rowthres=opts.rowthres,
+                                    uc_entries=uc_entries,
+                                    uc_counts=uc_counts,
+                                    uc_reltol=opts.updcache_tol)
             else:
                 sd_dampfact = np.empty(sz)
                 sd_nupd, sd_nrec = \
@@ -897,7 +1366,10 @@ class EPFactorizedInfDriver(InfDriver):
                                         opts.piminthres,opts.damp,rstat,delta,
                                         rep.sd_numvalid,rep.sd_topind,
                                         rep.sd_topval,rep.sd_subind,
-                                        rep.sd_subexcl,sd_dampfact)
+                                        rep.sd_subexcl,sd_dampfact,
+                                        opts.rowthreads,opts.rowthres,
+                                        uc_entries,uc_counts,
+                                        opts.updcache_tol)
                 # Among non-skipped updates, count those for which SD_DAMPFACT
                 # larger than OPTS.DAMP
                 nsdamp = np.sum(sd_dampfact[np.nonzero(rstat==0)] > opts.damp)
@@ -921,9 +1393,12 @@ class EPFactorizedInfDriver(InfDriver):
                     print '   nskip=', nskip, ', nsdamp=%d' % nsdamp
                 else:
                     print '   nskip=', nskip
+                if opts.updcache:
+                    self._updcache_print_stats(
+                        self._updcache_stats(potman,np.arange(m),
+                                             uc_counts[:m],uc_counts[m:]))
             if do_teststats:
-                self._binclass_print_teststats(opts.bc_testmodel,targets,
-                                               opts.imode)
+                self._binclass_print_teststats_increm(tmon,opts.bc_testtol)
             # DEBUG
             if do_deb_matcomp:
                 deb_ep_pi = deb_mc['ep_pi'].ravel()
@@ -937,15 +1412,75 @@ class EPFactorizedInfDriver(InfDriver):
                         helpers.maxreldiff(rep.marg_pi,deb_marg_pi),
                         helpers.maxreldiff(rep.marg_beta,deb_marg_beta))
             # TODO: Plot absolute differences means, stddevs (as in Matlab)
+            if do_checkpoint and (res.nit % opts.checkpoint_every == 0 or
+                                  res.delta < opts.deltaeps):
+                rep.checkpoint_save(opts.checkpoint,res.nit)
+            epx.trace_event('sweep','python',t_trace,res.nit)
+            if opts.sweep_hook is not None:
+                opts.sweep_hook(res.nit,res.delta)
             if res.delta < opts.deltaeps:
                 res.rstat = 0
                 break
+        if do_checkpoint:
+            rep.checkpoint_wait()
+        if opts.updcache:
+            res.updcache = self._updcache_stats(potman,np.arange(m),
+                                                uc_counts[:m],uc_counts[m:])
+        if self.paged:
+            del self._pm_blocks
+        self._quadacc_finish(qsobjs,res)
         # Return stuff
         if opts.res_det:
             return (res, res_det)
         else:
             return res
 
+    def _sequpdates_paged(self,updind,opts,rstat,delta):
+        """
+        Helper for 'inference' in out-of-core mode. Runs EP updates on
+        potentials 'updind' (one sweep). Blocks are visited in random
+        ordering, and the updates of a block in their ordering in 'updind'.
+        Results for update k are written to 'rstat[k]', 'delta[k]'.
+        """
+        bfact = self.model.bfact
+        potman = self.model.potman
+        rep = self.rep
+        n = bfact.shape()[1]
+        nb = bfact.numblocks()
+        blk = np.searchsorted(bfact.blkoff,updind,'right') - 1
+        bperm = np.random.permutation(nb)
+        # Stable, so that ordering within blocks is kept
+        pos = np.argsort(bperm[blk],kind='mergesort')
+        cnt = np.bincount(bperm[blk],minlength=nb)
+        boff = np.concatenate(([0],np.cumsum(cnt)))
+        border = np.argsort(bperm)  # Blocks in rank ordering
+        blks = [border[r] for r in xrange(nb) if cnt[r]>0]
+        bpos = dict([(border[r],pos[boff[r]:boff[r+1]]) for r in xrange(nb)
+                     if cnt[r]>0])
+        def update_block(b,blkst):
+            j0 = int(bfact.blkoff[b])
+            j1 = int(bfact.blkoff[b+1])
+            try:
+                pm = self._pm_blocks[b]
+            except KeyError:
+                pm = potman.subrange(j0,j1)
+                pm.check_internal()
+                self._pm_blocks[b] = pm
+            p = bpos[b]
+            sz = p.shape[0]
+            brstat = np.empty(sz,dtype=np.int32)
+            bdelta = np.empty(sz)
+            epx.fact_sequpdates(n,j1-j0,np.int32(updind[p]-j0),pm.potids,
+                                pm.numpot,pm.parvec,pm.parshrd,pm.annobj,
+                                blkst.rowind,blkst.colind,blkst.bvals,
+                                blkst.ep_pi,blkst.ep_beta,rep.marg_pi,
+                                rep.marg_beta,opts.piminthres,opts.damp,
+                                brstat,bdelta,rowthreads=opts.rowthreads,
+                                rowthres=opts.rowthres)
+            rstat[p] = brstat
+            delta[p] = bdelta
+        rep.sweep(blks,update_block)
+
 # Testcode (really basic)
 
 #if __name__ == "__main__":
@@ -0,0 +1,95 @@
+"""
+tracing
+=======
+
+Timeline tracing of inference runs. Events (time intervals) are recorded
+in the C++ code (wrapper calls, sweeps and batches of the EP drivers,
+single EP updates by potential type, quadrature calls) and by the
+inference drivers here (sweeps), and written as Chrome trace-event JSON
+(view with chrome://tracing or ui.perfetto.dev). Gaps between wrapper
+calls on the main thread are spent in Python.
+
+Example:
+    import apbsint as abt
+    abt.trace_start(period=10)
+    res = inf_driv.inference(opts)
+    abt.trace_stop('trace.json')
+
+Fine-grained events (single EP updates, quadrature calls) are sampled:
+only every 'period'-th is recorded (per thread). Each thread keeps the
+last 'bufsize' events. Tracing is off by default, and then costs next to
+nothing.
+
+Allocation statistics (by tag: EP representation, messages, selective
+damping, potential managers, scratch buffers) are returned by 'memstats'.
+They are only available if the C++ code has been compiled with
+USE_OWN_MEMMAN (see lhotse/global.h).
+
+"""
+
+import numpy as np
+import apbsint.eptools_ext as epx
+
+__all__ = ['trace_start', 'trace_stop', 'TraceSpan', 'memstats']
+
+# Must correspond to 'EPMemoryTags'
+_memtag_names = ['other', 'repres', 'messages', 'seldamp', 'potman',
+                 'scratch']
+_memstat_names = ['num_alloc', 'num_free', 'bytes_cur', 'bytes_peak',
+                  'bytes_total', 'alloc_rate']
+
+def trace_start(period=1,bufsize=65536):
+    """
+    Enables tracing, removes events recorded so far.
+    """
+    epx.trace_control(1,period,bufsize)
+
+def trace_stop(fname=None):
+    """
+    Disables tracing. If 'fname' is given, recorded events are written to
+    this file, and their number is returned.
+    """
+    epx.trace_control(0)
+    if fname is not None:
+        return epx.trace_control(2,fname=fname)
+
+class TraceSpan:
+    """
+    Records the code in a 'with' block as event:
+        with TraceSpan('predict'):
+            ...
+    """
+    def __init__(self,name,cat='python',arg=-1):
+        self.name = name
+        self.cat = cat
+        self.arg = arg
+
+    def __enter__(self):
+        self.ts = epx.trace_event()
+        return self
+
+    def __exit__(self,exc_type,exc_value,traceback):
+        epx.trace_event(self.name,self.cat,self.ts,self.arg)
+        return False
+
+def memstats(reset=False):
+    """
+    Returns allocation statistics as dict (keys: tag names), each entry a
+    dict with 'num_alloc', 'num_free', 'bytes_cur', 'bytes_peak',
+    'bytes_total', 'alloc_rate' (allocations per second). Apart from
+    'bytes_cur', these refer to the time since the last reset. If
+    'reset' is True, statistics are reset after being returned. Returns
+    None if statistics are not available (USE_OWN_MEMMAN not defined).
+    """
+    stats = np.zeros(6*len(_memtag_names))
+    active, ntags = epx.memstats(0,stats)
+    if not active:
+        return None
+    if ntags != len(_memtag_names):
+        raise ValueError('Tag names do not correspond to EPMemoryTags')
+    if reset:
+        epx.memstats(1)
+    stats = stats.reshape((ntags,6))
+    return dict((tnam, dict(zip(_memstat_names,
+                                [float(x) for x in stats[k]])))
+                for k, tnam in enumerate(_memtag_names))
@@ -13,6 +13,12 @@ import numpy as np
 import scipy.sparse as ssp
 import scipy.linalg as sla
 import numbers
+import os
+import threading
+try:
+    import Queue as queue
+except ImportError:
+    import queue
 import time  # For profiling
 
 import apbsint.helpers as helpers
@@ -22,7 +28,7 @@ import apbsint.ptannotate_ext as pta
 
 __all__ = ['ElemPotManager', 'PotManager', 'Model', 'ModelCoupled',
            'ModelFactorized', 'Representation', 'RepresentationCoupled',
-           'RepresentationFactorized']
+           'RepresentationFactorized', 'RepresentationFactorizedPaged']
 
 # Potential manager classes
 
@@ -202,6 +208,27 @@ class PotManager:
             off += numk
         return np.array(res,dtype=np.int32)
 
+    def subrange(self,j0,j1):
+        """
+        Returns potential manager for potentials j0:(j1-1). Parameter
+        vectors are sliced (views), shared parameters and annotations are
+        kept.
+        """
+        if not (isinstance(j0,numbers.Integral) and
+                isinstance(j1,numbers.Integral) and j0>=0 and j0<j1 and
+                j1<=self.size):
+            raise ValueError('J0, J1 wrong')
+        elem = []
+        off = 0
+        for el in self.elem:
+            a = max(j0,off); b = min(j1,off+el.size)
+            if a < b:
+                pars = tuple([p if isinstance(p,float) or len(p)==1 else
+                              p[a-off:b-off] for p in el.pars])
+                elem.append(ElemPotManager(el.name,b-a,pars,el.annobj))
+            off += el.size
+        return PotManager(tuple(elem))
+
 class Model:
     """
     Model
@@ -239,12 +266,13 @@ class ModelFactorized(Model):
     ===============
 
     Model for factorized mode. The B factor must be of type
-    apbsint.MatFactorizedInf.
+    apbsint.MatFactorizedInf, or apbsint.MatFactorizedPaged (out-of-core).
 
     """
     def __init__(self,bfact,potman):
-        if not isinstance(bfact,cf.MatFactorizedInf):
-            raise TypeError('BFACT must be instance of apbsint.MatFactorizedInf')
+        if not (isinstance(bfact,cf.MatFactorizedInf) or
+                isinstance(bfact,cf.MatFactorizedPaged)):
+            raise TypeError('BFACT must be instance of apbsint.MatFactorizedInf or apbsint.MatFactorizedPaged')
         Model.__init__(self,bfact,potman)
         if bfact.shape(0) != potman.size:
             raise TypeError('BFACT, POTMAN must have same size')
@@ -304,12 +332,55 @@ class RepresentationCoupled(Representation):
       c = L^-1 B^T beta,
     B the factor given in 'bfact' (must be type 'Mat'). If 'keep_margs'
     is True, we also keep marginal moments in 'marg_means', 'marg_vars'.
+
+    If 'packed'==True, L is kept in packed storage (LAPACK 'L' convention:
+    the lower triangle column by column, a vector of size n*(n+1)/2), which
+    halves the memory for 'lfact'. In 'refresh', A is built in packed
+    storage, 'mvblk' columns at a time ('bfact.mat_btdb_cols'), and
+    factorized in place (LAPACK 'dpptrf'), so no n-by-n matrix is formed.
+    The covariance A^-1 is never formed either ('post_cov' is not used):
+    marginal (and predictive) variances are computed from triangular
+    solves with blocks of 'mvblk' columns of B^T.
+
+    If 'mixed'==True, L is kept in single precision (float32, full storage),
+    which halves memory and bandwidth for 'lfact'. In 'refresh', A is built
+    in single precision, 'mvblk' columns at a time, and overwritten by L.
+    Factorization, rank one up/downdates and triangular solves use the
+    single precision factor. In 'refresh' and 'predict', marginal
+    (predictive) means and variances are recovered to double precision
+    accuracy by iterative refinement, for blocks of 'mvblk' variables at a
+    time: the residuals are computed in double precision with
+    A = B^T (diag pi) B, applied via 'bfact.mmm' (A is not stored in double
+    precision). Refinement stops once the
+    relative residual is below 'ref_tol', and fails if it does not converge
+    within 'ref_maxit' steps (or stalls), which happens if A is too badly
+    conditioned for single precision. In this case, the representation
+    falls back to double precision for good ('mixed_active' becomes
+    False). A^-1 is never formed ('post_cov' is not used).
+    NOTE: Marginals maintained by 'update_single' (if 'keep_margs'==True),
+    and those returned by 'get_marg', are of single precision accuracy
+    only. They are recovered by the next 'refresh'.
     """
-    def __init__(self,bfact,ep_pi=None,ep_beta=None,keep_margs=False):
+    def __init__(self,bfact,ep_pi=None,ep_beta=None,keep_margs=False,
+                 packed=False,mvblk=256,mixed=False,ref_tol=1e-10,
+                 ref_maxit=5):
         if not isinstance(bfact,cf.Mat):
             raise TypeError('BFACT must be instance of apbsint.Mat')
+        if not (isinstance(mvblk,numbers.Integral) and mvblk>0):
+            raise ValueError('MVBLK must be positive integer')
+        if packed and mixed:
+            raise ValueError('PACKED and MIXED cannot be used together')
+        if not (isinstance(ref_maxit,numbers.Integral) and ref_maxit>0 and
+                ref_tol>0.):
+            raise ValueError('REF_TOL or REF_MAXIT wrong')
         Representation.__init__(self,bfact,ep_pi,ep_beta)
         self.keep_margs = keep_margs
+        self.packed = packed
+        self.mvblk = mvblk
+        self.luplo = 'LP' if packed else 'L'
+        self.mixed_active = mixed
+        self.ref_tol = ref_tol
+        self.ref_maxit = ref_maxit
 
     def size_pars(self):
         return self.bfact.shape(0)
@@ -319,7 +390,7 @@ class RepresentationCoupled(Representation):
         Recompute representation from scratch, given EP paraemeters and B
         coupling factor. If 'keep_margs'==True, the covariance A^-1 is
         computed as byproduct. In this case, A^-1 is kept as attribute
-        'post_cov'.
+        'post_cov' (not if 'packed'==True).
         ATTENTION: 'post_cov' is valid only directly after a call of
         'refresh'. It is not kept up-2-date, and may even be overwritten
         by other methods.
@@ -327,6 +398,18 @@ class RepresentationCoupled(Representation):
         #t_start0=time.time()
         bfact = self.bfact
         m, n = bfact.shape()
+        if self.packed:
+            self._refresh_packed()
+            return
+        if self.mixed_active:
+            if self._refresh_mixed():
+                return
+            # Refinement failed: Fall back to double precision
+            self.mixed_active = False
+            try:
+                del self.lfact
+            except AttributeError:
+                pass
         # Cholesky factor L and c vector
         # We build the A matrix in 'self.lfact'. 'sla.cholesky' overwrites A
         # directly by L.
@@ -424,16 +507,15 @@ class RepresentationCoupled(Representation):
             if self.keep_margs:
                 if vvec is None:
                     # Need 'vvec' below, so compute it here
-                    vvec = sla.solve_triangular(self.lfact,bvec,lower=True,
-                                                trans='N')
+                    vvec = self._trsolve(bvec,'N')
                 mu = np.inner(vvec,self.cvec)
                 rho = np.inner(vvec,vvec)
             bvec *= tscal
             yscal = np.empty(1)
             yscal[0] = delbeta/tscal
             self.cup_z[0] = self.cvec
-            stat = epx.choluprk1(self.lfact,'L',bvec,self.cup_c,self.cup_s,
-                                 self.cup_wk,self.cup_z,yscal)
+            stat = epx.choluprk1(self.lfact,self.luplo,bvec,self.cup_c,
+                                 self.cup_s,self.cup_wk,self.cup_z,yscal)
             if stat != 0:
                 raise sla.LinAlgError("Numerical error in 'choluprk1' (external)")
             self.cvec[:] = self.cup_z.ravel()
@@ -442,8 +524,7 @@ class RepresentationCoupled(Representation):
             tscal = np.sqrt(-delpi)
             if vvec is None:
                 bfact.T().getcol(j,bvec)
-                vvec = sla.solve_triangular(self.lfact,bvec,lower=True,
-                                            trans='N')
+                vvec = self._trsolve(bvec,'N')
             if self.keep_margs:
                 mu = np.inner(vvec,self.cvec)
                 rho = np.inner(vvec,vvec)
@@ -451,8 +532,8 @@ class RepresentationCoupled(Representation):
             yscal[0] = -delbeta/tscal
             self.cup_z[0] = self.cvec
             bvec[:] = vvec; bvec *= tscal
-            stat = epx.choldnrk1(self.lfact,'L',bvec,self.cup_c,self.cup_s,
-                                 self.cup_wk,self.cup_z,yscal)
+            stat = epx.choldnrk1(self.lfact,self.luplo,bvec,self.cup_c,
+                                 self.cup_s,self.cup_wk,self.cup_z,yscal)
             if stat != 0:
                 raise sla.LinAlgError("Numerical error in 'choldnrk1' (external)")
             self.cvec[:] = self.cup_z.ravel()
@@ -461,8 +542,7 @@ class RepresentationCoupled(Representation):
         if self.keep_margs:
             # Update marginal moments
             assert vvec is not None
-            bfact.mvm(sla.solve_triangular(self.lfact,vvec,lower=True,
-                                           trans='T'),wvec)
+            bfact.mvm(self._trsolve(vvec,'T'),wvec)
             tscal = 1./(delpi*rho+1.);
             w2vec[:] = wvec; w2vec *= ((delbeta-delpi*mu)*tscal)
             self.marg_means += w2vec
@@ -495,8 +575,7 @@ class RepresentationCoupled(Representation):
         except AttributeError:
             self.us_bvec = np.empty(n)
         bfact.T().getcol(j,self.us_bvec)
-        vvec[:] = sla.solve_triangular(self.lfact,self.us_bvec,lower=True,
-                                       trans='N')
+        vvec[:] = self._trsolve(self.us_bvec,'N')
         mu = np.inner(vvec,self.cvec)
         rho = np.inner(vvec,vvec)
         if self.keep_margs:
@@ -514,6 +593,8 @@ class RepresentationCoupled(Representation):
         computed here (and written into 'post_cov').
         NOTE: Use 'use_cov'=True if 'refresh' with 'keep_margs'=True has
         been called just before.
+        If 'packed'==True or 'mixed_active'==True, A^-1 is not used ('use_cov'
+        is ignored).
         """
         if not isinstance(pbfact,cf.Mat):
             raise TypeError('PBFACT must be instance of apbsint.Mat')
@@ -524,9 +605,24 @@ class RepresentationCoupled(Representation):
                 (pvars is None or helpers.check_vecsize(pvars,pm))):
             raise TypeError('PMEANS or PVARS wrong')
         # Predictive means
-        pbfact.mvm(sla.solve_triangular(self.lfact,self.cvec,lower=True,
-                                        trans='T'),pmeans)
-        if pvars is not None:
+        pmean = None
+        if self.mixed_active:
+            pmean = self._refine_solve(self.bfact.T().mvm(self.ep_beta))
+            if pmean is None:
+                self._mixed_fallback()
+                use_cov = False
+            else:
+                pmean = pmean[0]
+        if pmean is None:
+            pmean = self._trsolve(self.cvec,'T')
+        pbfact.mvm(pmean,pmeans)
+        if pvars is not None and self.mixed_active:
+            if not self._comp_margvars_mixed(pbfact,pvars):
+                self._mixed_fallback()
+                use_cov = False
+        if pvars is not None and self.packed:
+            self._comp_margvars(pbfact,pvars)
+        elif pvars is not None and not self.mixed_active:
             # Predictive variances: Need inverse A^-1
             try:
                 if self.post_cov.shape != (n,n):
@@ -540,8 +636,205 @@ class RepresentationCoupled(Representation):
                 self._comp_inva(amat)
             pbfact.diag_bsbt(amat,pvars)
 
+    def diag_lfact(self):
+        """
+        Returns diagonal of Cholesky factor L (either storage)
+        """
+        if not self.packed:
+            return np.diag(self.lfact).astype(np.float64)
+        n = self.bfact.shape(1)
+        ind = np.arange(n)
+        return self.lfact[ind*n - (ind*(ind-1))//2]
+
     # Internal methods
 
+    def _refresh_packed(self):
+        """
+        Part of 'refresh' for 'packed'==True. A is built in packed 'lfact',
+        'mvblk' columns at a time, and overwritten by its Cholesky factor.
+        """
+        bfact = self.bfact
+        m, n = bfact.shape()
+        try:
+            self.lfact.resize(n*(n+1)//2,refcheck=False)
+        except AttributeError:
+            self.lfact = np.empty(n*(n+1)//2)
+        blk = min(self.mvblk,n)
+        tbuff = np.empty(n*blk)
+        off = 0
+        for i0 in xrange(0,n,blk):
+            sz = min(blk,n-i0)
+            tview = tbuff[:n*sz].reshape((n,sz))
+            bfact.mat_btdb_cols(self.ep_pi,i0,i0+sz,tview)
+            for k in xrange(sz):
+                i = i0+k
+                self.lfact[off:off+n-i] = tview[i:,k]
+                off += n-i
+        del tbuff, tview
+        self.lfact, info = sla.lapack.dpptrf(n,self.lfact,lower=1,
+                                             overwrite_ap=1)
+        if info != 0:
+            raise sla.LinAlgError('%d-th leading minor not positive definite' % info)
+        self.cvec = self._trsolve(bfact.T().mvm(self.ep_beta),'N')
+        if self.keep_margs:
+            # Recompute marginal moments
+            self.marg_means = bfact.mvm(self._trsolve(self.cvec,'T'))
+            self.marg_vars = np.empty(m)
+            self._comp_margvars(bfact,self.marg_vars)
+
+    def _trsolve(self,vec,trans):
+        """
+        Returns L^-1 vec ('trans'=='N') or L^-T vec ('trans'=='T').
+        """
+        if self.mixed_active:
+            return self._solve_single(vec,trans)
+        if not self.packed:
+            return sla.solve_triangular(self.lfact,vec,lower=True,
+                                        trans=trans)
+        x = np.array(vec,dtype=np.float64)
+        epx.choltrsolve(self.lfact,self.luplo,x,0 if trans=='N' else 1)
+        return x
+
+    def _comp_margvars(self,bmat,out):
+        """
+        Writes b_j^T A^-1 b_j into 'out', where b_j are the rows of 'bmat'
+        (type 'Mat'), computing L^-1 b_j for blocks of 'mvblk' rows at a
+        time. Used instead of A^-1 if 'packed'==True.
+        """
+        m, n = bmat.shape()
+        bmatT = bmat.T()
+        blk = min(self.mvblk,m)
+        tmat = np.empty((n,blk),order='F')
+        for j0 in xrange(0,m,blk):
+            sz = min(blk,m-j0)
+            tview = tmat if sz==blk else np.empty((n,sz),order='F')
+            for k in xrange(sz):
+                tview[:,k] = bmatT.getcol(j0+k)
+            epx.choltrsolve(self.lfact,self.luplo,tview,0,out[j0:j0+sz])
+
+    def _refresh_mixed(self):
+        """
+        Part of 'refresh' for 'mixed_active'==True. A is built in single
+        precision, 'mvblk' columns at a time, then L is computed in single
+        precision. Returns False if iterative refinement fails.
+        """
+        bfact = self.bfact
+        m, n = bfact.shape()
+        try:
+            del self.lfact
+        except AttributeError:
+            pass
+        # A is F contiguous, so that 'sla.cholesky' overwrites it by L
+        # without a copy
+        amat = np.empty((n,n),dtype=np.float32,order='F')
+        blk = min(self.mvblk,n)
+        tbuff = np.empty(n*blk)
+        for i0 in xrange(0,n,blk):
+            sz = min(blk,n-i0)
+            tview = tbuff[:n*sz].reshape((n,sz))
+            bfact.mat_btdb_cols(self.ep_pi,i0,i0+sz,tview)
+            amat[:,i0:i0+sz] = tview
+        del tbuff, tview
+        try:
+            self.lfact = sla.cholesky(amat,lower=True,overwrite_a=True)
+        except sla.LinAlgError:
+            return False # Not positive definite in single precision
+        del amat
+        bbeta = bfact.T().mvm(self.ep_beta)
+        self.cvec = self._solve_single(bbeta,'N')
+        if self.keep_margs:
+            # Recompute marginal moments, using refinement
+            pmean = self._refine_solve(bbeta)
+            if pmean is None:
+                return False
+            self.marg_means = bfact.mvm(pmean[0])
+            self.marg_vars = np.empty(m)
+            if not self._comp_margvars_mixed(bfact,self.marg_vars):
+                return False
+        return True
+
+    def _mixed_fallback(self):
+        """
+        Iterative refinement failed: Switch to double precision for good,
+        and recompute the representation.
+        """
+        self.mixed_active = False
+        del self.lfact
+        self.refresh()
+
+    def _solve_single(self,vec,trans):
+        """
+        Returns L^-1 vec ('trans'=='N') or L^-T vec ('trans'=='T'), or
+        A^-1 vec ('trans'=='A'), for single precision L. 'vec' can be a
+        matrix. The result is double precision.
+        """
+        x = np.asarray(vec,dtype=np.float32)
+        if trans != 'T':
+            x = sla.solve_triangular(self.lfact,x,lower=True,trans='N')
+        if trans != 'N':
+            x = sla.solve_triangular(self.lfact,x,lower=True,trans='T')
+        return x.astype(np.float64)
+
+    def _amvm(self,x):
+        """
+        Returns A*x = B^T (diag pi) B x in double precision. 'x' can be a
+        matrix (matrix-matrix products then).
+        """
+        bfact = self.bfact
+        if x.ndim == 1:
+            return bfact.T().mvm(self.ep_pi*bfact.mvm(x))
+        return bfact.T().mmm(self.ep_pi.reshape((-1,1))*bfact.mmm(x))
+
+    def _refine_solve(self,bvec):
+        """
+        Solves A x = b by iterative refinement, using single precision L
+        for the correction steps. Returns (x, r), r = b - A x the final
+        residual, or None if refinement fails. 'bvec' can be a matrix,
+        whose columns are solved for jointly (refinement fails if it fails
+        for some column).
+        """
+        bnrm = np.sqrt(np.sum(bvec*bvec,0))
+        x = self._solve_single(bvec,'A')
+        rnrm_old = None
+        for it in xrange(self.ref_maxit+1):
+            r = bvec - self._amvm(x)
+            rnrm = np.sqrt(np.sum(r*r,0))
+            if np.all(rnrm <= self.ref_tol*bnrm):
+                return (x, r)
+            if it == self.ref_maxit or (rnrm_old is not None and
+                                        np.any(np.logical_and(
+                                            rnrm > 0.5*rnrm_old,
+                                            rnrm > self.ref_tol*bnrm))):
+                return None # Not converged or stalled
+            rnrm_old = rnrm
+            x += self._solve_single(r,'A')
+
+    def _comp_margvars_mixed(self,bmat,out):
+        """
+        Writes b_j^T A^-1 b_j into 'out', where b_j are the rows of 'bmat'
+        (type 'Mat'), for single precision L. A x_j = b_j is solved by
+        iterative refinement, for blocks of 'mvblk' rows at a time, then
+        b_j^T x_j + r_j^T x_j is returned, whose error is quadratic in the
+        error of x_j. Returns False if refinement fails for some j.
+        """
+        m, n = bmat.shape()
+        bmatT = bmat.T()
+        blk = min(self.mvblk,m)
+        tmat = np.empty((n,blk),order='F')
+        for j0 in xrange(0,m,blk):
+            sz = min(blk,m-j0)
+            tview = tmat if sz==blk else np.empty((n,sz),order='F')
+            for k in xrange(sz):
+                tview[:,k] = bmatT.getcol(j0+k)
+            res = self._refine_solve(tview)
+            if res is None:
+                return False
+            x, r = res
+            r += tview
+            r *= x
+            np.sum(r,0,out=out[j0:j0+sz])
+        return True
+
     def _comp_inva(self,amat):
         """
         Compute inverse of A and write into 'amat' (must be right size and
@@ -573,6 +866,10 @@ class RepresentationFactorized(Representation):
     Selective damping is supported if 'sd_numk' is given. The SD
     representation tracks max_k pi_{k,i} for each variable, it is
     initialized/recomputed by 'seldamp_reset'.
+
+    Checkpoints: 'checkpoint_save' takes a snapshot of the state, which is
+    written to file in the background, 'checkpoint_load' restores it (to
+    resume a fit).
     """
     def __init__(self,bfact,ep_pi=None,ep_beta=None):
         if not isinstance(bfact,cf.MatFactorizedInf):
@@ -643,6 +940,259 @@ class RepresentationFactorized(Representation):
         self.sd_subexcl = subexcl
         self.sd_numk = numk
 
+    def checkpoint_save(self,fname,sweep=0):
+        """
+        Takes a checkpoint: message parameters, marginals and SD
+        representation (if active) are copied, and written to file 'fname'
+        by a background thread (see C++ class 'CheckpointServices'), so that
+        this call returns quickly. Waits for the previous checkpoint write
+        to finish first (and raises its error). 'sweep' is stored with the
+        checkpoint. Use 'checkpoint_wait' to wait for the write.
+        """
+        epx.checkpoint_save(0,sweep=sweep)
+        epx.checkpoint_save(1,b'ep_pi',dvec=self.ep_pi)
+        epx.checkpoint_save(1,b'ep_beta',dvec=self.ep_beta)
+        epx.checkpoint_save(1,b'marg_pi',dvec=self.marg_pi)
+        epx.checkpoint_save(1,b'marg_beta',dvec=self.marg_beta)
+        try:
+            sd_numk = self.sd_numk
+        except AttributeError:
+            sd_numk = 0
+        if sd_numk>0:
+            epx.checkpoint_save(2,b'sd_pars',ivec=np.array(
+                [sd_numk,int(self.sd_subexcl)],dtype=np.int32))
+            epx.checkpoint_save(2,b'sd_numvalid',ivec=self.sd_numvalid)
+            epx.checkpoint_save(2,b'sd_topind',ivec=self.sd_topind)
+            epx.checkpoint_save(1,b'sd_topval',dvec=self.sd_topval)
+            if self.sd_subind is not None:
+                epx.checkpoint_save(2,b'sd_subind',ivec=self.sd_subind)
+        epx.checkpoint_save(3,fname)
+
+    def checkpoint_wait(self):
+        """
+        Waits for the checkpoint write to finish, raises its error.
+        """
+        epx.checkpoint_save(4)
+
+    def checkpoint_load(self,fname):
+        """
+        Restores the state from checkpoint file 'fname' (see
+        'checkpoint_save'), checking its checksums. Returns the sweep number
+        stored with the checkpoint.
+        """
+        m, n = self.bfact.shape()
+        sz = self.size_pars()
+        arrs = {}
+        for name in ['ep_pi', 'ep_beta', 'marg_pi', 'marg_beta']:
+            arrs[name], sweep = epx.checkpoint_load(fname,name.encode())
+            if arrs[name] is None or \
+                    arrs[name].shape[0] != (sz if name[:3]=='ep_' else n):
+                raise ValueError('Checkpoint does not match: ' + name)
+        sd_pars = epx.checkpoint_load(fname,b'sd_pars')[0]
+        if sd_pars is not None:
+            for name in ['sd_numvalid', 'sd_topind', 'sd_topval',
+                         'sd_subind']:
+                arrs[name] = epx.checkpoint_load(fname,name.encode())[0]
+        # Assign only once everything has been read
+        self.ep_pi = arrs['ep_pi']
+        self.ep_beta = arrs['ep_beta']
+        self.marg_pi = arrs['marg_pi']
+        self.marg_beta = arrs['marg_beta']
+        if sd_pars is not None:
+            self.sd_numvalid = arrs['sd_numvalid']
+            self.sd_topind = arrs['sd_topind']
+            self.sd_topval = arrs['sd_topval']
+            self.sd_subind = arrs['sd_subind']
+            self.sd_subexcl = bool(sd_pars[1])
+            self.sd_numk = int(sd_pars[0])
+        else:
+            self.sd_numk = 0
+        return sweep
+
+class RepresentationFactorizedPaged(RepresentationFactorized):
+    """
+    RepresentationFactorizedPaged
+    =============================
+
+    EP posterior representation in factorized mode, out-of-core. B (in
+    'bfact') is of type apbsint.MatFactorizedPaged. The message parameters
+    of each block of potentials are stored in files in directory 'dirname'
+    (def.: 'bfact.dirname'), only the marginals 'marg_pi', 'marg_beta'
+    (size n) are kept in memory. Messages are initialized to zero.
+    Blocks are processed by 'sweep', which pages in messages and B of one
+    block at a time: the next block is read ahead, and modified blocks are
+    written behind by an I/O thread, so that at most three blocks are in
+    memory. The C++ updates release the GIL, so I/O overlaps with them.
+    Selective damping is not supported.
+    """
+    def __init__(self,bfact,dirname=None):
+        if not isinstance(bfact,cf.MatFactorizedPaged):
+            raise TypeError('BFACT must be apbsint.MatFactorizedPaged')
+        if dirname is None:
+            dirname = bfact.dirname
+        elif not (isinstance(dirname,str) and os.path.isdir(dirname)):
+            raise ValueError('DIRNAME must be existing directory')
+        Representation.__init__(self,bfact)
+        self.dirname = dirname
+        m, n = bfact.shape()
+        for b in xrange(bfact.numblocks()):
+            tvec = np.zeros(bfact.blknnz[b])
+            self._write_array(b,'pi',tvec)
+            self._write_array(b,'beta',tvec)
+        self.marg_pi = np.zeros(n)
+        self.marg_beta = np.zeros(n)
+
+    def setpi(self,ep_pi):
+        self._set_pars(ep_pi,'pi')
+
+    def setbeta(self,ep_beta):
+        self._set_pars(ep_beta,'beta')
+
+    def refresh(self):
+        """
+        Recomputes marginals 'marg_pi', 'marg_beta' from message parameters
+        (one pass over the blocks).
+        """
+        bf = self.bfact
+        m, n = bf.shape()
+        self.marg_pi[:] = 0.
+        self.marg_beta[:] = 0.
+        tpi = np.empty(n)
+        tbeta = np.empty(n)
+        def accum(b,blk):
+            mb = int(bf.blkoff[b+1]-bf.blkoff[b])
+            epx.fact_compmarginals(n,mb,blk.rowind,blk.colind,blk.bvals,
+                                   blk.ep_pi,blk.ep_beta,tpi,tbeta)
+            self.marg_pi += tpi
+            self.marg_beta += tbeta
+        self.sweep(xrange(bf.numblocks()),accum,False)
+
+    def seldamp_reset(self,numk,subind=None,subexcl=False):
+        raise NotImplementedError('Selective damping not supported for paged representation')
+
+    def checkpoint_save(self,fname,sweep=0):
+        raise NotImplementedError('Checkpoints not supported for paged representation')
+
+    def checkpoint_load(self,fname):
+        raise NotImplementedError('Checkpoints not supported for paged representation')
+
+    def sweep(self,blks,func,write=True):
+        """
+        Calls 'func(b,blk)' for each block b in 'blks' (in this order), where
+        'blk' has attributes 'rowind', 'colind', 'bvals' (see
+        apbsint.MatFactorizedPaged.load_block), 'ep_pi', 'ep_beta' for
+        block b. If 'write'==True, 'ep_pi', 'ep_beta' are written back
+        afterwards (so 'func' may modify them in place). Blocks must not be
+        repeated in 'blks'.
+        """
+        pager = _BlockPager(self,blks,write)
+        try:
+            for b in pager.blks:
+                blk = pager.get()
+                func(b,blk)
+                pager.put(b,blk)
+        finally:
+            pager.close()
+
+    # Internal methods
+
+    def fname(self,b,name):
+        return os.path.join(self.dirname,'blk%d_%s.npy' % (b,name))
+
+    def _read_block(self,b):
+        blk = self.bfact.load_block(b)
+        blk.ep_pi = np.load(self.fname(b,'pi'))
+        blk.ep_beta = np.load(self.fname(b,'beta'))
+        return blk
+
+    def _write_array(self,b,name,arr):
+        # Write to temp. file, then rename, so the file is never partial
+        fname = self.fname(b,name)
+        tname = fname + '.tmp'
+        with open(tname,'wb') as f:
+            np.save(f,arr)
+        os.rename(tname,fname)
+
+    def _write_block(self,b,blk):
+        self._write_array(b,'pi',blk.ep_pi)
+        self._write_array(b,'beta',blk.ep_beta)
+
+    def _set_pars(self,vec,name):
+        bf = self.bfact
+        sz = self.size_pars()
+        if not helpers.check_vecsize(vec,sz):
+            raise TypeError('EP_{0} must be vector of size {1}'.format(
+                name.upper(),sz))
+        off = 0
+        for b in xrange(bf.numblocks()):
+            nz = int(bf.blknnz[b])
+            self._write_array(b,name,np.asarray(vec[off:off+nz],
+                                                dtype=np.float64))
+            off += nz
+
+class _BlockPager:
+    """
+    I/O thread for RepresentationFactorizedPaged.sweep. Blocks in 'blks'
+    are read in order, at most one ahead of the consumer ('get'). Blocks
+    passed to 'put' are written back (if 'write'). 'close' waits for all
+    writes, and raises an I/O error of the thread, if any.
+    """
+    def __init__(self,rep,blks,write):
+        self.rep = rep
+        self.blks = list(blks)
+        self.write = write
+        self.rdq = queue.Queue()
+        self.wrq = queue.Queue()
+        self.slot = threading.Semaphore(1)  # Read-ahead of one block
+        self.stop = False
+        self.error = None
+        self.thread = threading.Thread(target=self._run)
+        self.thread.daemon = True
+        self.thread.start()
+
+    def get(self):
+        blk = self.rdq.get()
+        self.slot.release()
+        if blk is None:
+            raise self.error
+        return blk
+
+    def put(self,b,blk):
+        if self.write:
+            self.wrq.put((b,blk))
+
+    def close(self):
+        self.stop = True
+        self.slot.release()  # Thread may wait for a slot
+        self.wrq.put(None)
+        self.thread.join()
+        if self.error is not None:
+            raise self.error
+
+    def _run(self):
+        try:
+            for b in self.blks:
+                self.slot.acquire()
+                if self.stop:
+                    break
+                self._write_pending(False)
+                self.rdq.put(self.rep._read_block(b))
+            self._write_pending(True)
+        except Exception as ex:
+            self.error = ex
+            self.rdq.put(None)
+
+    def _write_pending(self,wait):
+        # If 'wait', blocks are written until 'close' is called
+        while True:
+            try:
+                item = self.wrq.get(wait)
+            except queue.Empty:
+                return
+            if item is None:
+                return
+            self.rep._write_block(item[0],item[1])
+
 # Testcode (really basic)
 
 if __name__ == "__main__":
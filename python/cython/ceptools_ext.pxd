@@ -6,7 +6,8 @@
 # -------------------------------------------------------------------
 
 # Declarations: Pointer_to_function types for BLAS functions. Required by
-# eptwrap_choluprk1, eptwrap_choldnrk1
+# eptwrap_choluprk1, eptwrap_choldnrk1, eptwrap_choltrsolve. fst_smatrix
+# (single precision) is used by eptwrap_chol{up|dn}rk1_single
 
 cdef extern from "src/eptools/wrap/matrix_types.h":
     ctypedef int blasint_t
@@ -38,6 +39,12 @@ cdef extern from "src/eptools/wrap/matrix_types.h":
         int stride
         char strcode[4]
 
+    ctypedef struct fst_smatrix:
+        float* buff
+        int m,n
+        int stride
+        char strcode[4]
+
 # Declarations: C wrapper functions
 
 cdef extern from "src/eptools/wrap/eptwrap_epupdate_parallel.h":
@@ -49,7 +56,8 @@ cdef extern from "src/eptools/wrap/eptwrap_epupdate_parallel.h":
                                    int* updind,int nupdind,int* rstat,
                                    int nrstat,double* alpha,int nalpha,
                                    double* nu,int nnu,double* logz,int nlogz,
-                                   int* errcode,char* errstr)
+                                   double* dparvec,int ndparvec,int* errcode,
+                                   char* errstr)
 
 cdef extern from "src/eptools/wrap/eptwrap_getpotid.h":
     void eptwrap_getpotid(int ain,int aout,char* name,int* pid,int* errcode,
@@ -80,6 +88,40 @@ cdef extern from "src/eptools/wrap/eptwrap_fact_compmaxpi.h":
                                 double* sd_topval,int nsd_topval,int* errcode,
                                 char* errstr)
 
+cdef extern from "src/eptools/wrap/eptwrap_fact_logmarglik.h":
+    void eptwrap_fact_logmarglik(int ain,int aout,int n,int m,int* pm_potids,
+                                 int npm_potids,int* pm_numpot,int npm_numpot,
+                                 double* pm_parvec,int npm_parvec,
+                                 int* pm_parshrd,int npm_parshrd,
+                                 void** pm_annobj,int npm_annobj,
+                                 int* rp_rowind,int nrp_rowind,int* rp_colind,
+                                 int nrp_colind,double* rp_bvals,int nrp_bvals,
+                                 double* rp_pi,int nrp_pi,double* rp_beta,
+                                 int nrp_beta,double* margpi,int nmargpi,
+                                 double* margbeta,int nmargbeta,
+                                 double piminthres,double* logz,int* nskip,
+                                 double* dparvec,int ndparvec,int* errcode,
+                                 char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_fact_testmonitor.h":
+    void eptwrap_fact_testmonitor(int ain,int aout,int n,int p,int* tp_potids,
+                                  int ntp_potids,int* tp_numpot,int ntp_numpot,
+                                  double* tp_parvec,int ntp_parvec,
+                                  int* tp_parshrd,int ntp_parshrd,
+                                  void** tp_annobj,int ntp_annobj,
+                                  int* tp_colind,int ntp_colind,
+                                  double* tp_bvals,int ntp_bvals,
+                                  double* targets,int ntargets,double* margpi,
+                                  int nmargpi,double* margbeta,int nmargbeta,
+                                  double* st_margmeans,int nst_margmeans,
+                                  double* st_margvars,int nst_margvars,
+                                  double* st_predmeans,int nst_predmeans,
+                                  double* st_predvars,int nst_predvars,
+                                  double* st_predlogz,int nst_predlogz,
+                                  double* st_stats,int nst_stats,double tol,
+                                  int* nvars,int* nrows,int* errcode,
+                                  char* errstr)
+
 cdef extern from "src/eptools/wrap/eptwrap_fact_sequpdates.h":
     void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,int* updjind,
                                  int nupdjind,int* pm_potids,int npm_potids,
@@ -97,10 +139,14 @@ cdef extern from "src/eptools/wrap/eptwrap_fact_sequpdates.h":
                                  int* sd_topind,int nsd_topind,
                                  double* sd_topval,int nsd_topval,
                                  int* sd_subind,int nsd_subind,int sd_subexcl,
+                                 int rowthreads,int rowthres,
+                                 double* uc_entries,int nuc_entries,
+                                 int* uc_counts,int nuc_counts,
+                                 double uc_reltol,
                                  int* rstat,int nrstat,double* delta,
                                  int ndelta,double* sd_dampfact,
                                  int nsd_dampfact,int* sd_nupd,int* sd_nrec,
-                                 int* errcode,char* errstr)
+                                 int* errcode,char* errstr) nogil
 
 cdef extern from "src/eptools/wrap/eptwrap_potmanager_isvalid.h":
     void eptwrap_potmanager_isvalid(int ain,int aout,int* potids,int npotids,
@@ -151,5 +197,81 @@ cdef extern from "src/eptools/wrap/eptwrap_choldnrk1.h":
                            drot_type f_drot,dscal_type f_dscal,
                            daxpy_type f_daxpy,int* errcode,char* errstr)
 
+cdef extern from "src/eptools/wrap/eptwrap_choluprk1_single.h":
+    void eptwrap_choluprk1_single(int ain,int aout,fst_smatrix* lmat,
+                                  double* vvec,int nvvec,double* cvec,
+                                  int ncvec,double* svec,int nsvec,
+                                  double* wkvec,int nwkvec,fst_matrix* zmat,
+                                  double* yvec,int nyvec,int* stat,
+                                  int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_choldnrk1_single.h":
+    void eptwrap_choldnrk1_single(int ain,int aout,fst_smatrix* lmat,
+                                  double* vvec,int nvvec,double* cvec,
+                                  int ncvec,double* svec,int nsvec,
+                                  double* wkvec,int nwkvec,int isp,
+                                  fst_matrix* zmat,double* yvec,int nyvec,
+                                  int* stat,int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_choltrsolve.h":
+    void eptwrap_choltrsolve(int ain,int aout,fst_matrix* lmat,
+                             fst_matrix* bmat,int mode,double* sqnrm,
+                             int nsqnrm,ddot_type f_ddot,daxpy_type f_daxpy,
+                             int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_numa_place.h":
+    void eptwrap_numa_place(int ain,int aout,char* arr,int narr,int* nodes,
+                            int nnodes,int* blkoff,int nblkoff,int* succ,
+                            int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_numa_pagenodes.h":
+    void eptwrap_numa_pagenodes(int ain,int aout,char* arr,int narr,
+                                int* pnodes,int npnodes,int* npages,
+                                int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_numa_pinthread.h":
+    void eptwrap_numa_pinthread(int ain,int aout,int cpu,int* succ,int* node,
+                                int* nnodes,int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_threadpool_config.h":
+    void eptwrap_threadpool_config(int ain,int aout,int nthreads,int* thrcpus,
+                                   int nthrcpus,int* numthr,int* errcode,
+                                   char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_trace_control.h":
+    void eptwrap_trace_control(int ain,int aout,int mode,int period,
+                               int bufsize,char* fname,int* ret,int* errcode,
+                               char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_trace_event.h":
+    void eptwrap_trace_event(int ain,int aout,char* name,char* cat,double ts,
+                             int arg,double* tnow,int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_checkpoint_save.h":
+    void eptwrap_checkpoint_save(int ain,int aout,int mode,char* str,
+                                 double* dvec,int ndvec,int* ivec,int nivec,
+                                 int sweep,int* errcode,char* errstr) nogil
+
+cdef extern from "src/eptools/wrap/eptwrap_checkpoint_load.h":
+    void eptwrap_checkpoint_load(int ain,int aout,char* fname,char* name,
+                                 double* dvec,int ndvec,int* ivec,int nivec,
+                                 int* size,int* type,int* sweep,int* errcode,
+                                 char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_memstats.h":
+    void eptwrap_memstats(int ain,int aout,int mode,double* stats,int nstats,
+                          int* active,int* ntags,int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_quad_accsched.h":
+    void eptwrap_quad_accsched(int ain,int aout,int mode,void* annobj,
+                               double accmin,double accmax,double accfact,
+                               double delta,double* stats,int nstats,
+                               int* nsweeps,int* errcode,char* errstr)
+
+cdef extern from "src/eptools/wrap/eptwrap_quad_fixednode.h":
+    void eptwrap_quad_fixednode(int ain,int aout,void* annobj,int order,
+                                int checkorder,double tol,int* errcode,
+                                char* errstr)
+
 cdef extern from "src/eptools/wrap/eptwrap_debug_castannobj.h":
     void eptwrap_debug_castannobj(void* annobj,int* errcode,char* errstr)
@@ -46,10 +46,64 @@ cdef check_contiguous_array_size(np.ndarray a,str nma,int sz):
         raise TypeError('%s must be contiguous array of size %d' %
                         (nma.upper(),sz))
 
+# Sets up fst_matrix for Cholesky factor L. Full storage: L is 2D Fortran
+# contiguous, LUPLO is 'L' or 'U'. Packed storage (lower triangular only):
+# L is 1D contiguous of size n*(n+1)/2, LUPLO is 'LP'
+cdef set_cholfact_matrix(fst_matrix* lmat,np.ndarray l,bytes luplo):
+    cdef int n
+    if l.dtype != np.float64:
+        raise TypeError('L must be double array')
+    lmat.strcode[0] = luplo[0]; lmat.strcode[1] = 0
+    lmat.strcode[2] = 'N'; lmat.strcode[3] = 0
+    if len(luplo) > 1 and luplo[1:2] == b'P':
+        if not (l.ndim == 1 and l.flags.c_contiguous):
+            raise TypeError('L must be contiguous vector (packed storage)')
+        n = int((np.sqrt(8.*l.shape[0]+1.)-1.)/2.+0.5)
+        if n*(n+1)/2 != l.shape[0]:
+            raise TypeError('L has wrong size for packed storage')
+        lmat.m, lmat.n = n, n
+        lmat.stride = n
+        lmat.strcode[1] = 'P'
+    else:
+        if not (l.ndim == 2 and l.flags.f_contiguous):
+            raise TypeError('L must be Fortran contiguous (column-major)')
+        lmat.m, lmat.n = l.shape[0], l.shape[1]
+        lmat.stride = l.shape[0]
+    lmat.buff = <double*>l.data
+
+# Same as 'set_cholfact_matrix' for single precision L (float32, 2D Fortran
+# contiguous, lower triangular)
+cdef set_cholfact_smatrix(fst_smatrix* lmat,np.ndarray l,bytes luplo):
+    if not (l.ndim == 2 and l.flags.f_contiguous):
+        raise TypeError('L must be Fortran contiguous (column-major)')
+    if luplo != b'L':
+        raise TypeError('Single precision L: Only lower triangular, full')
+    lmat.buff = <float*>l.data
+    lmat.m, lmat.n = l.shape[0], l.shape[1]
+    lmat.stride = l.shape[0]
+    lmat.strcode[0] = 'L'; lmat.strcode[1] = 0
+    lmat.strcode[2] = 'N'; lmat.strcode[3] = 0
+
+# Sets up fst_matrix for dragging along matrix Z (optional)
+cdef set_drag_matrix(fst_matrix* zmat,np.ndarray[np.double_t,ndim=2] z,
+                     np.ndarray[np.double_t,ndim=1] y):
+    if not z.flags.f_contiguous:
+        raise TypeError('Z must be Fortran contiguous (column-major)')
+    if not y.flags.c_contiguous:
+        raise TypeError('Y must be contiguous array')
+    zmat.buff = &z[0,0]
+    zmat.m, zmat.n = z.shape[0], z.shape[1]
+    zmat.stride = z.shape[0]
+    # Not used:
+    zmat.strcode[0] = ' '; zmat.strcode[1] = 0
+    zmat.strcode[2] = ' '; zmat.strcode[3] = 0
+
 # Cython functions
 
 # rstat, alpha, nu, logz (optional) are return arguments (contiguous vectors
 # of same size as cmu, rstat is int32, others are double).
+# dparvec (optional, requires logz) returns the gradient of sum(logz) w.r.t.
+# parvec (same size). Cavity moments are kept fixed.
 @cython.boundscheck(False)
 @cython.wraparound(False)
 def epupdate_parallel(np.ndarray[int,ndim=1] potids not None,
@@ -63,13 +117,15 @@ def epupdate_parallel(np.ndarray[int,ndim=1] potids not None,
                       np.ndarray[np.double_t,ndim=1] alpha not None,
                       np.ndarray[np.double_t,ndim=1] nu not None,
                       np.ndarray[np.double_t,ndim=1] logz = None,
-                      np.ndarray[int,ndim=1] updind = None):
+                      np.ndarray[int,ndim=1] updind = None,
+                      np.ndarray[np.double_t,ndim=1] dparvec = None):
     cdef int rsz, errcode, ain, aout
     cdef char errstr[512]
     cdef void** annobj_p
-    cdef int logz_n, updind_n
+    cdef int logz_n, updind_n, dparvec_n
     cdef double* logz_p
     cdef int* updind_p
+    cdef double* dparvec_p
     # Ensure that input/output arguments are contiguous
     rsz = cmu.shape[0]
     check_contiguous_array_size(rstat,'RSTAT',rsz)
@@ -77,6 +133,10 @@ def epupdate_parallel(np.ndarray[int,ndim=1] potids not None,
     check_contiguous_array_size(nu,'NU',rsz)
     if logz is not None:
         check_contiguous_array_size(logz,'LOGZ',rsz)
+    if dparvec is not None:
+        if logz is None:
+            raise ValueError('LOGZ must be given if DPARVEC is given')
+        check_contiguous_array_size(dparvec,'DPARVEC',parvec.shape[0])
     potids = np.ascontiguousarray(potids)
     numpot = np.ascontiguousarray(numpot)
     parvec = np.ascontiguousarray(parvec)
@@ -109,13 +169,21 @@ def epupdate_parallel(np.ndarray[int,ndim=1] potids not None,
         logz_n = logz.shape[0]
         logz_p = &logz[0]
         aout = 4
+    if dparvec is None:
+        dparvec_n = 0
+        dparvec_p = NULL
+    else:
+        dparvec_n = dparvec.shape[0]
+        dparvec_p = &dparvec[0]
+        aout = 5
     eptwrap_epupdate_parallel(ain,aout,&potids[0],potids.shape[0],&numpot[0],
                               numpot.shape[0],&parvec[0],parvec.shape[0],
                               &parshrd[0],parshrd.shape[0],annobj_p,
                               annobj.shape[0],&cmu[0],cmu.shape[0],&crho[0],
                               crho.shape[0],updind_p,updind_n,&rstat[0],
                               rstat.shape[0],&alpha[0],alpha.shape[0],&nu[0],
-                              nu.shape[0],logz_p,logz_n,&errcode,errstr)
+                              nu.shape[0],logz_p,logz_n,dparvec_p,dparvec_n,
+                              &errcode,errstr)
     PyMem_Free(annobj_p)  # Free temp. void* array
     # Check for error, raise exception
     if errcode != 0:
@@ -222,8 +290,76 @@ def fact_compmaxpi(int n,int m,np.ndarray[int,ndim=1] rp_rowind not None,
         raise exc.ApBsWrapError(<bytes>errstr)
     return (sd_numvalid,sd_topind,sd_topval)
 
+# Returns (logz, nskip). dparvec (optional) returns the gradient of logz
+# w.r.t. pm_parvec (same size).
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def fact_logmarglik(int n,int m,np.ndarray[int,ndim=1] pm_potids not None,
+                    np.ndarray[int,ndim=1] pm_numpot not None,
+                    np.ndarray[np.double_t,ndim=1] pm_parvec not None,
+                    np.ndarray[int,ndim=1] pm_parshrd not None,
+                    np.ndarray[np.uint64_t,ndim=1] pm_annobj not None,
+                    np.ndarray[int,ndim=1] rp_rowind not None,
+                    np.ndarray[int,ndim=1] rp_colind not None,
+                    np.ndarray[np.double_t,ndim=1] rp_bvals not None,
+                    np.ndarray[np.double_t,ndim=1] rp_pi not None,
+                    np.ndarray[np.double_t,ndim=1] rp_beta not None,
+                    np.ndarray[np.double_t,ndim=1] margpi not None,
+                    np.ndarray[np.double_t,ndim=1] margbeta not None,
+                    double piminthres,
+                    np.ndarray[np.double_t,ndim=1] dparvec = None):
+    cdef int errcode, nskip, aout, dparvec_n
+    cdef double logz
+    cdef char errstr[512]
+    cdef void** annobj_p
+    cdef double* dparvec_p
+    # Ensure that input/output arguments are contiguous
+    pm_potids = np.ascontiguousarray(pm_potids)
+    pm_numpot = np.ascontiguousarray(pm_numpot)
+    pm_parvec = np.ascontiguousarray(pm_parvec)
+    pm_parshrd = np.ascontiguousarray(pm_parshrd)
+    rp_rowind = np.ascontiguousarray(rp_rowind)
+    rp_colind = np.ascontiguousarray(rp_colind)
+    rp_bvals = np.ascontiguousarray(rp_bvals)
+    rp_pi = np.ascontiguousarray(rp_pi)
+    rp_beta = np.ascontiguousarray(rp_beta)
+    margpi = np.ascontiguousarray(margpi)
+    margbeta = np.ascontiguousarray(margbeta)
+    if dparvec is None:
+        dparvec_n = 0
+        dparvec_p = NULL
+        aout = 2
+    else:
+        check_contiguous_array_size(dparvec,'DPARVEC',pm_parvec.shape[0])
+        dparvec_n = dparvec.shape[0]
+        dparvec_p = &dparvec[0]
+        aout = 3
+    # Call C function
+    annobj_p = make_voidptr_array(pm_annobj)  # Convert to void* array
+    eptwrap_fact_logmarglik(15,aout,n,m,&pm_potids[0],pm_potids.shape[0],
+                            &pm_numpot[0],pm_numpot.shape[0],&pm_parvec[0],
+                            pm_parvec.shape[0],&pm_parshrd[0],
+                            pm_parshrd.shape[0],annobj_p,pm_annobj.shape[0],
+                            &rp_rowind[0],rp_rowind.shape[0],&rp_colind[0],
+                            rp_colind.shape[0],&rp_bvals[0],rp_bvals.shape[0],
+                            &rp_pi[0],rp_pi.shape[0],&rp_beta[0],
+                            rp_beta.shape[0],&margpi[0],margpi.shape[0],
+                            &margbeta[0],margbeta.shape[0],piminthres,&logz,
+                            &nskip,dparvec_p,dparvec_n,&errcode,errstr)
+    PyMem_Free(annobj_p)  # Free temp. void* array
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (logz, nskip)
+
 # NOTE: sd_nupd, sd_nrec are returned only if rstat, delta, sd_dampfact and
 # sd_numvalid are all given
+# If rowthreads>1, updates on potentials with at least rowthres entries in
+# their row of B are split over rowthreads threads (intra-row parallelism)
+# If uc_entries (size 4*m), uc_counts (size 2*m) are given, results of local
+# EP updates are cached there (I/O, kept by the caller between calls) and
+# reused if the cavity changed by less than uc_reltol (relative). uc_counts
+# gets hits, then misses for each potential
 @cython.boundscheck(False)
 @cython.wraparound(False)
 def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
@@ -247,7 +383,11 @@ def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
                     np.ndarray[np.double_t,ndim=1] sd_topval = None,
                     np.ndarray[int,ndim=1] sd_subind = None,
                     int sd_subexcl = 0,
-                    np.ndarray[np.double_t,ndim=1] sd_dampfact = None):
+                    np.ndarray[np.double_t,ndim=1] sd_dampfact = None,
+                    int rowthreads = 1,int rowthres = 32768,
+                    np.ndarray[np.double_t,ndim=1] uc_entries = None,
+                    np.ndarray[int,ndim=1] uc_counts = None,
+                    double uc_reltol = 0.):
     cdef int errcode, rsz, sd_nupd, sd_nrec, aout, ain
     cdef char errstr[512]
     cdef void** annobj_p
@@ -260,6 +400,21 @@ def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
     cdef double* topval_p
     cdef int* subind_p
     cdef double* dampfact_p
+    cdef int ucent_n, uccnt_n
+    cdef double* ucent_p
+    cdef int* uccnt_p
+    cdef int* updjind_p
+    cdef int* potids_p
+    cdef int* numpot_p
+    cdef double* parvec_p
+    cdef int* parshrd_p
+    cdef int* rowind_p
+    cdef int* colind_p
+    cdef double* bvals_p
+    cdef double* pi_p
+    cdef double* beta_p
+    cdef double* margpi_p
+    cdef double* margbeta_p
     # Ensure that input/output arguments are contiguous
     updjind = np.ascontiguousarray(updjind)
     pm_potids = np.ascontiguousarray(pm_potids)
@@ -283,6 +438,11 @@ def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
         check_contiguous_array(sd_topval,'SD_TOPVAL')
         if sd_dampfact is not None:
             check_contiguous_array(sd_dampfact,'SD_DAMPFACT')
+    if uc_entries is not None:
+        check_contiguous_array(uc_entries,'UC_ENTRIES')
+        if uc_counts is None:
+            raise ValueError('UC_COUNTS must be given')
+        check_contiguous_array(uc_counts,'UC_COUNTS')
     # Call C function
     rsz = updjind.shape[0]
     if rsz<1:
@@ -329,21 +489,51 @@ def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
             dampfact_p = &sd_dampfact[0]
             if aout==2:
                 aout = 5
+    ucent_n = 0
+    ucent_p = NULL
+    uccnt_n = 0
+    uccnt_p = NULL
+    if rowthreads>1:
+        ain = 24  # Empty SD_XXX are treated as not given
+    if uc_entries is not None:
+        ucent_n = uc_entries.shape[0]
+        ucent_p = &uc_entries[0]
+        uccnt_n = uc_counts.shape[0]
+        uccnt_p = &uc_counts[0]
+        ain = 27
     annobj_p = make_voidptr_array(pm_annobj)  # Convert to void* array
-    eptwrap_fact_sequpdates(ain,aout,n,m,&updjind[0],updjind.shape[0],
-                            &pm_potids[0],pm_potids.shape[0],&pm_numpot[0],
-                            pm_numpot.shape[0],&pm_parvec[0],
-                            pm_parvec.shape[0],&pm_parshrd[0],
-                            pm_parshrd.shape[0],annobj_p,pm_annobj.shape[0],
-                            &rp_rowind[0],rp_rowind.shape[0],&rp_colind[0],
-                            rp_colind.shape[0],&rp_bvals[0],rp_bvals.shape[0],
-                            &rp_pi[0],rp_pi.shape[0],&rp_beta[0],
-                            rp_beta.shape[0],&margpi[0],margpi.shape[0],
-                            &margbeta[0],margbeta.shape[0],piminthres,dampfact,
-                            numvalid_p,numvalid_n,topind_p,topind_n,topval_p,
-                            topval_n,subind_p,subind_n,sd_subexcl,rstat_p,
-                            rstat_n,delta_p,delta_n,dampfact_p,dampfact_n,
-                            &sd_nupd,&sd_nrec,&errcode,errstr)
+    # The GIL is released during the updates, so that other Python threads
+    # can run (f.ex., block I/O in apbsint.RepresentationFactorizedPaged)
+    updjind_p = &updjind[0]
+    potids_p = &pm_potids[0]
+    numpot_p = &pm_numpot[0]
+    parvec_p = &pm_parvec[0]
+    parshrd_p = &pm_parshrd[0]
+    rowind_p = &rp_rowind[0]
+    colind_p = &rp_colind[0]
+    bvals_p = &rp_bvals[0]
+    pi_p = &rp_pi[0]
+    beta_p = &rp_beta[0]
+    margpi_p = &margpi[0]
+    margbeta_p = &margbeta[0]
+    with nogil:
+        eptwrap_fact_sequpdates(ain,aout,n,m,updjind_p,rsz,potids_p,
+                                pm_potids.shape[0],numpot_p,
+                                pm_numpot.shape[0],parvec_p,
+                                pm_parvec.shape[0],parshrd_p,
+                                pm_parshrd.shape[0],annobj_p,
+                                pm_annobj.shape[0],rowind_p,
+                                rp_rowind.shape[0],colind_p,
+                                rp_colind.shape[0],bvals_p,
+                                rp_bvals.shape[0],pi_p,rp_pi.shape[0],beta_p,
+                                rp_beta.shape[0],margpi_p,margpi.shape[0],
+                                margbeta_p,margbeta.shape[0],piminthres,
+                                dampfact,numvalid_p,numvalid_n,topind_p,
+                                topind_n,topval_p,topval_n,subind_p,subind_n,
+                                sd_subexcl,rowthreads,rowthres,ucent_p,
+                                ucent_n,uccnt_p,uccnt_n,uc_reltol,rstat_p,
+                                rstat_n,delta_p,delta_n,dampfact_p,dampfact_n,
+                                &sd_nupd,&sd_nrec,&errcode,errstr)
     PyMem_Free(annobj_p)  # Free temp. void* array
     # Check for error, raise exception
     if errcode != 0:
@@ -351,6 +541,76 @@ def fact_sequpdates(int n,int m,np.ndarray[int,ndim=1] updjind not None,
     if aout>2:
         return (sd_nupd,sd_nrec)
 
+# st_margmeans, st_margvars, st_predmeans, st_predvars, st_predlogz, st_stats
+# are the monitor state (I/O, contiguous). If tol<0, the state is
+# recomputed from scratch. targets may be empty. Returns (nvars, nrows).
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def fact_testmonitor(int n,int p,np.ndarray[int,ndim=1] tp_potids not None,
+                     np.ndarray[int,ndim=1] tp_numpot not None,
+                     np.ndarray[np.double_t,ndim=1] tp_parvec not None,
+                     np.ndarray[int,ndim=1] tp_parshrd not None,
+                     np.ndarray[np.uint64_t,ndim=1] tp_annobj not None,
+                     np.ndarray[int,ndim=1] tp_colind not None,
+                     np.ndarray[np.double_t,ndim=1] tp_bvals not None,
+                     np.ndarray[np.double_t,ndim=1] targets not None,
+                     np.ndarray[np.double_t,ndim=1] margpi not None,
+                     np.ndarray[np.double_t,ndim=1] margbeta not None,
+                     np.ndarray[np.double_t,ndim=1] st_margmeans not None,
+                     np.ndarray[np.double_t,ndim=1] st_margvars not None,
+                     np.ndarray[np.double_t,ndim=1] st_predmeans not None,
+                     np.ndarray[np.double_t,ndim=1] st_predvars not None,
+                     np.ndarray[np.double_t,ndim=1] st_predlogz not None,
+                     np.ndarray[np.double_t,ndim=1] st_stats not None,
+                     double tol):
+    cdef int errcode, nvars, nrows, targets_n
+    cdef char errstr[512]
+    cdef void** annobj_p
+    cdef double* targets_p
+    # Ensure that input/output arguments are contiguous
+    tp_potids = np.ascontiguousarray(tp_potids)
+    tp_numpot = np.ascontiguousarray(tp_numpot)
+    tp_parvec = np.ascontiguousarray(tp_parvec)
+    tp_parshrd = np.ascontiguousarray(tp_parshrd)
+    tp_colind = np.ascontiguousarray(tp_colind)
+    tp_bvals = np.ascontiguousarray(tp_bvals)
+    margpi = np.ascontiguousarray(margpi)
+    margbeta = np.ascontiguousarray(margbeta)
+    check_contiguous_array(st_margmeans,'ST_MARGMEANS')
+    check_contiguous_array(st_margvars,'ST_MARGVARS')
+    check_contiguous_array(st_predmeans,'ST_PREDMEANS')
+    check_contiguous_array(st_predvars,'ST_PREDVARS')
+    check_contiguous_array(st_predlogz,'ST_PREDLOGZ')
+    check_contiguous_array(st_stats,'ST_STATS')
+    if targets.shape[0]>0:
+        targets = np.ascontiguousarray(targets)
+        targets_n = targets.shape[0]
+        targets_p = &targets[0]
+    else:
+        targets_n = 0
+        targets_p = NULL
+    # Call C function
+    annobj_p = make_voidptr_array(tp_annobj)  # Convert to void* array
+    eptwrap_fact_testmonitor(19,2,n,p,&tp_potids[0],tp_potids.shape[0],
+                             &tp_numpot[0],tp_numpot.shape[0],&tp_parvec[0],
+                             tp_parvec.shape[0],&tp_parshrd[0],
+                             tp_parshrd.shape[0],annobj_p,tp_annobj.shape[0],
+                             &tp_colind[0],tp_colind.shape[0],&tp_bvals[0],
+                             tp_bvals.shape[0],targets_p,targets_n,&margpi[0],
+                             margpi.shape[0],&margbeta[0],margbeta.shape[0],
+                             &st_margmeans[0],st_margmeans.shape[0],
+                             &st_margvars[0],st_margvars.shape[0],
+                             &st_predmeans[0],st_predmeans.shape[0],
+                             &st_predvars[0],st_predvars.shape[0],
+                             &st_predlogz[0],st_predlogz.shape[0],
+                             &st_stats[0],st_stats.shape[0],tol,&nvars,
+                             &nrows,&errcode,errstr)
+    PyMem_Free(annobj_p)  # Free temp. void* array
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (nvars, nrows)
+
 # tauind must be passed iff the potential manager contains bivariate precision
 # potentials.
 @cython.boundscheck(False)
@@ -447,7 +707,7 @@ def epupdate_single_pman(np.ndarray[int,ndim=1] potids not None,
 
 @cython.boundscheck(False)
 @cython.wraparound(False)
-def choluprk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
+def choluprk1(np.ndarray l not None,bytes luplo not None,
               np.ndarray[np.double_t,ndim=1] vec not None,
               np.ndarray[np.double_t,ndim=1] cvec not None,
               np.ndarray[np.double_t,ndim=1] svec not None,
@@ -456,9 +716,9 @@ def choluprk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
               np.ndarray[np.double_t,ndim=1] y = None):
     cdef int errcode, stat
     cdef char errstr[512]
+    if l.dtype == np.float32:
+        return choluprk1_single(l,luplo,vec,cvec,svec,workv,z,y)
     # Ensure that input/output arguments are contiguous
-    if not l.flags.f_contiguous:
-        raise TypeError('L must be Fortran contiguous (column-major)')
     if not vec.flags.c_contiguous:
         raise TypeError('VEC must be contiguous array')
     if not cvec.flags.c_contiguous:
@@ -469,11 +729,7 @@ def choluprk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
         raise TypeError('WORKV must be contiguous array')
     # We use fst_matrix transfer type
     cdef fst_matrix lmat, zmat
-    lmat.buff = &l[0,0]
-    lmat.m, lmat.n = l.shape[0], l.shape[1]
-    lmat.stride = l.shape[0]
-    lmat.strcode[0] = luplo[0]; lmat.strcode[1] = 0
-    lmat.strcode[2] = 'N'; lmat.strcode[3] = 0
+    set_cholfact_matrix(&lmat,l,luplo)
     # Get BLAS function pointers from scipy
     cdef dcopy_type f_dcopy = <dcopy_type>PyCObject_AsVoidPtr( \
         scipy.linalg.blas.cblas.dcopy._cpointer)
@@ -507,24 +763,24 @@ def choluprk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
         raise exc.ApBsWrapError(<bytes>errstr)
     return stat
 
-# NOTE: The ISP argument, which can be used for the MEX version, is not
-# exposed here, but is fixed to 1 (so VEC must contain the p vector
-# already). This is because BLAS dtrsv cannot be accessed via scipy
+# NOTE: BLAS dtrsv cannot be accessed via scipy. If ISP is False, p = L\v is
+# computed without it, which works for lower triangular L only (full or
+# packed).
 @cython.boundscheck(False)
 @cython.wraparound(False)
-def choldnrk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
+def choldnrk1(np.ndarray l not None,bytes luplo not None,
               np.ndarray[np.double_t,ndim=1] vec not None,
               np.ndarray[np.double_t,ndim=1] cvec not None,
               np.ndarray[np.double_t,ndim=1] svec not None,
               np.ndarray[np.double_t,ndim=1] workv not None,
               np.ndarray[np.double_t,ndim=2] z = None,
-              np.ndarray[np.double_t,ndim=1] y = None):
-    cdef int errcode, stat, isp
+              np.ndarray[np.double_t,ndim=1] y = None,isp = True):
+    cdef int errcode, stat
     cdef char errstr[512]
-    isp = 1
+    cdef int cisp = 1 if isp else 0
+    if l.dtype == np.float32:
+        return choldnrk1_single(l,luplo,vec,cvec,svec,workv,z,y,isp)
     # Ensure that input/output arguments are contiguous
-    if not l.flags.f_contiguous:
-        raise TypeError('L must be Fortran contiguous (column-major)')
     if not vec.flags.c_contiguous:
         raise TypeError('VEC must be contiguous array')
     if not cvec.flags.c_contiguous:
@@ -535,11 +791,7 @@ def choldnrk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
         raise TypeError('WORKV must be contiguous array')
     # We use fst_matrix transfer type
     cdef fst_matrix lmat, zmat
-    lmat.buff = &l[0,0]
-    lmat.m, lmat.n = l.shape[0], l.shape[1]
-    lmat.stride = l.shape[0]
-    lmat.strcode[0] = luplo[0]; lmat.strcode[1] = 0
-    lmat.strcode[2] = 'N'; lmat.strcode[3] = 0
+    set_cholfact_matrix(&lmat,l,luplo)
     # Get BLAS function pointers from scipy
     cdef dcopy_type f_dcopy = <dcopy_type>PyCObject_AsVoidPtr( \
         scipy.linalg.blas.cblas.dcopy._cpointer)
@@ -557,7 +809,7 @@ def choldnrk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
     if z is None:
         eptwrap_choldnrk1(6,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
                           cvec.shape[0],&svec[0],svec.shape[0],&workv[0],
-                          workv.shape[0],isp,NULL,NULL,0,&stat,f_dcopy,NULL,
+                          workv.shape[0],cisp,NULL,NULL,0,&stat,f_dcopy,NULL,
                           f_ddot,f_drotg,f_drot,f_dscal,f_daxpy,&errcode,
                           errstr)
     else:
@@ -573,7 +825,7 @@ def choldnrk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
         zmat.strcode[2] = ' '; zmat.strcode[3] = 0
         eptwrap_choldnrk1(8,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
                           cvec.shape[0],&svec[0],svec.shape[0],&workv[0],
-                          workv.shape[0],isp,&zmat,&y[0],y.shape[0],&stat,
+                          workv.shape[0],cisp,&zmat,&y[0],y.shape[0],&stat,
                           f_dcopy,NULL,f_ddot,f_drotg,f_drot,f_dscal,f_daxpy,
                           &errcode,errstr)
     # Check for error, raise exception
@@ -581,6 +833,365 @@ def choldnrk1(np.ndarray[np.double_t,ndim=2] l not None,bytes luplo not None,
         raise exc.ApBsWrapError(<bytes>errstr)
     return stat
 
+# Single precision L (float32), called by 'choluprk1' if L is float32. All
+# other arguments are double precision
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def choluprk1_single(np.ndarray l not None,bytes luplo not None,
+                     np.ndarray[np.double_t,ndim=1] vec not None,
+                     np.ndarray[np.double_t,ndim=1] cvec not None,
+                     np.ndarray[np.double_t,ndim=1] svec not None,
+                     np.ndarray[np.double_t,ndim=1] workv not None,
+                     np.ndarray[np.double_t,ndim=2] z = None,
+                     np.ndarray[np.double_t,ndim=1] y = None):
+    cdef int errcode, stat
+    cdef char errstr[512]
+    check_contiguous_array(vec,'vec')
+    check_contiguous_array(cvec,'cvec')
+    check_contiguous_array(svec,'svec')
+    check_contiguous_array(workv,'workv')
+    cdef fst_smatrix lmat
+    cdef fst_matrix zmat
+    set_cholfact_smatrix(&lmat,l,luplo)
+    # Call C function
+    if z is None:
+        eptwrap_choluprk1_single(5,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
+                                 cvec.shape[0],&svec[0],svec.shape[0],
+                                 &workv[0],workv.shape[0],NULL,NULL,0,&stat,
+                                 &errcode,errstr)
+    else:
+        set_drag_matrix(&zmat,z,y)
+        eptwrap_choluprk1_single(7,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
+                                 cvec.shape[0],&svec[0],svec.shape[0],
+                                 &workv[0],workv.shape[0],&zmat,&y[0],
+                                 y.shape[0],&stat,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return stat
+
+# Single precision L (float32), called by 'choldnrk1' if L is float32. All
+# other arguments are double precision
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def choldnrk1_single(np.ndarray l not None,bytes luplo not None,
+                     np.ndarray[np.double_t,ndim=1] vec not None,
+                     np.ndarray[np.double_t,ndim=1] cvec not None,
+                     np.ndarray[np.double_t,ndim=1] svec not None,
+                     np.ndarray[np.double_t,ndim=1] workv not None,
+                     np.ndarray[np.double_t,ndim=2] z = None,
+                     np.ndarray[np.double_t,ndim=1] y = None,isp = True):
+    cdef int errcode, stat
+    cdef char errstr[512]
+    cdef int cisp = 1 if isp else 0
+    check_contiguous_array(vec,'vec')
+    check_contiguous_array(cvec,'cvec')
+    check_contiguous_array(svec,'svec')
+    check_contiguous_array(workv,'workv')
+    cdef fst_smatrix lmat
+    cdef fst_matrix zmat
+    set_cholfact_smatrix(&lmat,l,luplo)
+    # Call C function
+    if z is None:
+        eptwrap_choldnrk1_single(6,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
+                                 cvec.shape[0],&svec[0],svec.shape[0],
+                                 &workv[0],workv.shape[0],cisp,NULL,NULL,0,
+                                 &stat,&errcode,errstr)
+    else:
+        set_drag_matrix(&zmat,z,y)
+        eptwrap_choldnrk1_single(8,1,&lmat,&vec[0],vec.shape[0],&cvec[0],
+                                 cvec.shape[0],&svec[0],svec.shape[0],
+                                 &workv[0],workv.shape[0],cisp,&zmat,&y[0],
+                                 y.shape[0],&stat,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return stat
+
+# MODE: 0 (B <- L\B), 1 (B <- L'\B), 2 (B <- A\B, A = L*L'). If SQNRM is
+# given (MODE 0, 2), squared column norms of L\B are written there (marginal
+# variances b_j'*inv(A)*b_j). L is lower triangular (full or packed, see
+# 'choluprk1'), B must be Fortran contiguous (1D: single column)
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def choltrsolve(np.ndarray l not None,bytes luplo not None,
+                np.ndarray b not None,int mode = 0,
+                np.ndarray[np.double_t,ndim=1] sqnrm = None):
+    cdef int errcode
+    cdef char errstr[512]
+    # We use fst_matrix transfer type
+    cdef fst_matrix lmat, bmat
+    set_cholfact_matrix(&lmat,l,luplo)
+    if not (b.dtype == np.float64 and b.flags.f_contiguous):
+        raise TypeError('B must be Fortran contiguous double array')
+    bmat.buff = <double*>b.data
+    bmat.m = b.shape[0]
+    bmat.n = b.shape[1] if b.ndim > 1 else 1
+    bmat.stride = b.shape[0]
+    # Not used:
+    bmat.strcode[0] = ' '; bmat.strcode[1] = 0
+    bmat.strcode[2] = ' '; bmat.strcode[3] = 0
+    # Get BLAS function pointers from scipy
+    cdef ddot_type f_ddot   = <ddot_type>PyCObject_AsVoidPtr( \
+        scipy.linalg.blas.cblas.ddot._cpointer)
+    cdef daxpy_type f_daxpy = <daxpy_type>PyCObject_AsVoidPtr( \
+        scipy.linalg.blas.cblas.daxpy._cpointer)
+    # Call C function
+    if sqnrm is None:
+        eptwrap_choltrsolve(3,0,&lmat,&bmat,mode,NULL,0,f_ddot,f_daxpy,
+                            &errcode,errstr)
+    else:
+        check_contiguous_array(sqnrm,'sqnrm')
+        eptwrap_choltrsolve(3,1,&lmat,&bmat,mode,&sqnrm[0],sqnrm.shape[0],
+                            f_ddot,f_daxpy,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def numa_place(np.ndarray arr not None,np.ndarray[int,ndim=1] nodes not None,
+               np.ndarray[int,ndim=1] blkoff = None):
+    cdef int errcode, succ
+    cdef char errstr[512]
+    # Ensure that input/output arguments are contiguous
+    if not (arr.flags.c_contiguous or arr.flags.f_contiguous):
+        raise TypeError('ARR must be contiguous array')
+    if not nodes.flags.c_contiguous:
+        raise TypeError('NODES must be contiguous array')
+    if arr.nbytes == 0:
+        return True
+    # Call C function
+    if blkoff is None:
+        eptwrap_numa_place(2,1,<char*>arr.data,arr.nbytes,&nodes[0],
+                           nodes.shape[0],NULL,0,&succ,&errcode,errstr)
+    else:
+        if not blkoff.flags.c_contiguous:
+            raise TypeError('BLKOFF must be contiguous array')
+        eptwrap_numa_place(3,1,<char*>arr.data,arr.nbytes,&nodes[0],
+                           nodes.shape[0],&blkoff[0],blkoff.shape[0],&succ,
+                           &errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (succ != 0)
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def numa_pagenodes(np.ndarray arr not None,
+                   np.ndarray[int,ndim=1] pnodes not None):
+    cdef int errcode, npages
+    cdef char errstr[512]
+    # Ensure that input/output arguments are contiguous
+    if not (arr.flags.c_contiguous or arr.flags.f_contiguous):
+        raise TypeError('ARR must be contiguous array')
+    if not pnodes.flags.c_contiguous:
+        raise TypeError('PNODES must be contiguous array')
+    if arr.nbytes == 0:
+        return 0
+    # Call C function
+    eptwrap_numa_pagenodes(2,1,<char*>arr.data,arr.nbytes,&pnodes[0],
+                           pnodes.shape[0],&npages,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return npages
+
+def numa_pinthread(int cpu):
+    cdef int errcode, succ, node, nnodes
+    cdef char errstr[512]
+    # Call C function
+    eptwrap_numa_pinthread(1,3,cpu,&succ,&node,&nnodes,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (succ != 0, node, nnodes)
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def threadpool_config(int nthreads=0,
+                      np.ndarray[int,ndim=1] thrcpus = None):
+    cdef int errcode, numthr
+    cdef char errstr[512]
+    # Call C function
+    if thrcpus is None or thrcpus.shape[0] == 0:
+        eptwrap_threadpool_config(1,1,nthreads,NULL,0,&numthr,&errcode,
+                                  errstr)
+    else:
+        if not thrcpus.flags.c_contiguous:
+            raise TypeError('THRCPUS must be contiguous array')
+        eptwrap_threadpool_config(2,1,nthreads,&thrcpus[0],thrcpus.shape[0],
+                                  &numthr,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return numthr
+
+def trace_control(int mode,int period=1,int bufsize=65536,bytes fname=b''):
+    cdef int errcode, ret
+    cdef char errstr[512]
+    # Call C function
+    eptwrap_trace_control(4,1,mode,period,bufsize,<char*>fname,&ret,&errcode,
+                          errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return ret
+
+def trace_event(bytes name=None,bytes cat=None,double ts=0.,int arg=-1):
+    cdef int errcode
+    cdef double tnow
+    cdef char errstr[512]
+    # Call C function
+    if name is None:
+        eptwrap_trace_event(0,1,NULL,NULL,0.,-1,&tnow,&errcode,errstr)
+    else:
+        if cat is None:
+            raise TypeError('CAT must be given')
+        eptwrap_trace_event(4,1,<char*>name,<char*>cat,ts,arg,&tnow,&errcode,
+                            errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return tnow
+
+# Background checkpoint writing (see 'CheckpointServices'). Snapshot: mode 0
+# (start, sweep number), mode 1 (array 'dvec', name 'name'), mode 2 (array
+# 'ivec', name 'name'), mode 3 (write to file 'name'). Mode 4 waits for the
+# write to finish
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def checkpoint_save(int mode,bytes name=b'',
+                    np.ndarray[np.double_t,ndim=1] dvec=None,
+                    np.ndarray[int,ndim=1] ivec=None,int sweep=0):
+    cdef int errcode
+    cdef char errstr[512]
+    cdef char* name_p = <char*>name
+    cdef double* dvec_p = NULL
+    cdef int* ivec_p = NULL
+    cdef int dvec_n = 0, ivec_n = 0
+    if dvec is not None and dvec.shape[0]>0:
+        if not dvec.flags.c_contiguous:
+            raise TypeError('DVEC must be contiguous array')
+        dvec_p = &dvec[0]
+        dvec_n = dvec.shape[0]
+    if ivec is not None and ivec.shape[0]>0:
+        if not ivec.flags.c_contiguous:
+            raise TypeError('IVEC must be contiguous array')
+        ivec_p = &ivec[0]
+        ivec_n = ivec.shape[0]
+    # Call C function (may wait for the writer thread)
+    with nogil:
+        eptwrap_checkpoint_save(5,0,mode,name_p,dvec_p,dvec_n,ivec_p,ivec_n,
+                                sweep,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+
+# Returns '(arr, sweep)', where 'arr' is array 'name' from checkpoint file
+# 'fname' (None if not in file), 'sweep' the sweep number of the snapshot
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def checkpoint_load(bytes fname,bytes name):
+    cdef int errcode, size, tp, sweep
+    cdef char errstr[512]
+    cdef double ddummy
+    cdef int idummy
+    cdef np.ndarray[np.double_t,ndim=1] dvec
+    cdef np.ndarray[int,ndim=1] ivec
+    # Call C function
+    eptwrap_checkpoint_load(2,3,<char*>fname,<char*>name,&ddummy,0,&idummy,
+                            0,&size,&tp,&sweep,&errcode,errstr)
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    if size < 0:
+        return (None, sweep)
+    if tp == 0:
+        dvec = np.empty(size,dtype=np.float64)
+        eptwrap_checkpoint_load(4,3,<char*>fname,<char*>name,
+                                &dvec[0] if size>0 else &ddummy,size,
+                                &idummy,0,&size,&tp,&sweep,&errcode,errstr)
+        arr = dvec
+    else:
+        ivec = np.empty(size,dtype=np.int32)
+        eptwrap_checkpoint_load(4,3,<char*>fname,<char*>name,&ddummy,0,
+                                &ivec[0] if size>0 else &idummy,size,&size,
+                                &tp,&sweep,&errcode,errstr)
+        arr = ivec
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (arr, sweep)
+
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def memstats(int mode=0,np.ndarray[np.double_t,ndim=1] stats=None):
+    cdef int errcode, active, ntags
+    cdef double dummy
+    cdef char errstr[512]
+    # Call C function
+    if mode == 0:
+        if stats is None:
+            raise TypeError('STATS must be given')
+        if not stats.flags.c_contiguous:
+            raise TypeError('STATS must be contiguous array')
+        eptwrap_memstats(2,2,mode,&stats[0],stats.shape[0],&active,&ntags,
+                         &errcode,errstr)
+    else:
+        eptwrap_memstats(2,2,mode,&dummy,0,&active,&ntags,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    return (active != 0, ntags)
+
+# Accuracy schedule attached to quadrature services 'annobj' (see
+# 'QuadAccuracySchedule'): mode 0 (attach, 'accmin', 'accmax', 'accfact'),
+# mode 1 (start sweep, 'delta' of previous one), mode 2 (statistics, matrix
+# with rows (accuracy, number of quad calls, number of nodes) per sweep),
+# mode 3 (number of sweeps), mode 4 (detach)
+@cython.boundscheck(False)
+@cython.wraparound(False)
+def quad_accsched(int mode,np.uint64_t annobj,double accmin=0.,
+                  double accmax=0.,double accfact=0.1,double delta=-1.):
+    cdef int errcode, nsweeps
+    cdef double dummy
+    cdef char errstr[512]
+    cdef np.ndarray[np.double_t,ndim=1] stats
+    # Call C function
+    if mode == 2:
+        eptwrap_quad_accsched(8,1,3,<void*>annobj,accmin,accmax,accfact,
+                              delta,&dummy,0,&nsweeps,&errcode,errstr)
+        if errcode != 0:
+            raise exc.ApBsWrapError(<bytes>errstr)
+        stats = np.empty(3*nsweeps+1)
+        eptwrap_quad_accsched(8,1,mode,<void*>annobj,accmin,accmax,accfact,
+                              delta,&stats[0],stats.shape[0],&nsweeps,
+                              &errcode,errstr)
+    else:
+        eptwrap_quad_accsched(8,1,mode,<void*>annobj,accmin,accmax,accfact,
+                              delta,&dummy,0,&nsweeps,&errcode,errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+    if mode == 2:
+        return stats[:3*nsweeps].reshape((nsweeps,3))
+    return nsweeps
+
+# Fixed-node Gauss-Hermite quadrature for batched updates on quadrature
+# services 'annobj' (see 'QuadratureServices::setFixedNodeQuad'): rule of
+# order 'order', check rule of order 'checkorder', tolerance 'tol'.
+# 'order'==0 switches it off
+def quad_fixednode(np.uint64_t annobj,int order=30,int checkorder=20,
+                   double tol=1e-5):
+    cdef int errcode
+    cdef char errstr[512]
+    # Call C function
+    eptwrap_quad_fixednode(4,0,<void*>annobj,order,checkorder,tol,&errcode,
+                           errstr)
+    # Check for error, raise exception
+    if errcode != 0:
+        raise exc.ApBsWrapError(<bytes>errstr)
+
 def debug_castannobj(np.uint64_t annobj):
     cdef int errcode
     cdef char errstr[512]
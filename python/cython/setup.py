@@ -33,7 +33,7 @@ else:
 nwa_include_dirs = df_include_dirs[:]
 df_define_macros = [('HAVE_NO_BLAS', None), ('HAVE_FORTRAN', None)]
 nwa_define_macros = df_define_macros[:]
-df_libraries = ['m']
+df_libraries = ['m', 'pthread']
 nwa_libraries = df_libraries[:]
 tlst = aprof.get_library_dirs()
 if type(tlst) == str:
@@ -53,11 +53,18 @@ eptools_ext_sources = [
     'base/lhotse/global.cc',
     'base/lhotse/StandardException.cc',
     'base/lhotse/FileUtils.cc',
+    'base/lhotse/AsyncLogWriter.cc',
     'base/lhotse/IntVal.cc',
     'base/lhotse/Interval.cc',
     'base/lhotse/Range.cc',
     'base/lhotse/optimize/OneDimSolver.cc',
     'base/src/eptools/FactorizedEPDriver.cc',
+    'base/src/eptools/ParallelFactEPDriver.cc',
+    'base/src/eptools/FactEPTestMonitor.cc',
+    'base/src/eptools/NumaServices.cc',
+    'base/src/eptools/ThreadPool.cc',
+    'base/src/eptools/CheckpointServices.cc',
+    'base/src/eptools/TraceServices.cc',
     'base/src/eptools/potentials/EPScalarPotential.cc',
     'base/src/eptools/potentials/DefaultPotManager.cc',
     'base/src/eptools/potentials/EPPotentialFactory.cc',
@@ -67,15 +74,34 @@ eptools_ext_sources = [
     'base/src/eptools/potentials/quad/QuadPotProximalNewton.cc',
     'base/src/eptools/potentials/quad/EPPotQuadLaplaceApprox.cc',
     'base/src/eptools/potentials/quad/EPPotPoissonExpRate.cc',
+    'base/src/eptools/potentials/quad/QuadAccuracySchedule.cc',
+    'base/src/eptools/potentials/quad/GaussHermiteRule.cc',
+    'base/src/eptools/potentials/quad/GaussLaguerreRule.cc',
     'base/src/eptools/wrap/eptools_helper_basic.cc',
     'base/src/eptools/wrap/eptools_helper.cc',
     'base/src/eptools/wrap/eptwrap_choldnrk1.cc',
+    'base/src/eptools/wrap/eptwrap_choldnrk1_single.cc',
     'base/src/eptools/wrap/eptwrap_choluprk1.cc',
+    'base/src/eptools/wrap/eptwrap_choluprk1_single.cc',
+    'base/src/eptools/wrap/eptwrap_choltrsolve.cc',
     'base/src/eptools/wrap/eptwrap_epupdate_parallel.cc',
     'base/src/eptools/wrap/eptwrap_epupdate_single.cc',
     'base/src/eptools/wrap/eptwrap_fact_compmarginals.cc',
     'base/src/eptools/wrap/eptwrap_fact_compmaxpi.cc',
+    'base/src/eptools/wrap/eptwrap_fact_logmarglik.cc',
     'base/src/eptools/wrap/eptwrap_fact_sequpdates.cc',
+    'base/src/eptools/wrap/eptwrap_fact_testmonitor.cc',
+    'base/src/eptools/wrap/eptwrap_numa_place.cc',
+    'base/src/eptools/wrap/eptwrap_numa_pagenodes.cc',
+    'base/src/eptools/wrap/eptwrap_numa_pinthread.cc',
+    'base/src/eptools/wrap/eptwrap_threadpool_config.cc',
+    'base/src/eptools/wrap/eptwrap_trace_control.cc',
+    'base/src/eptools/wrap/eptwrap_trace_event.cc',
+    'base/src/eptools/wrap/eptwrap_checkpoint_save.cc',
+    'base/src/eptools/wrap/eptwrap_checkpoint_load.cc',
+    'base/src/eptools/wrap/eptwrap_memstats.cc',
+    'base/src/eptools/wrap/eptwrap_quad_accsched.cc',
+    'base/src/eptools/wrap/eptwrap_quad_fixednode.cc',
     'base/src/eptools/wrap/eptwrap_getpotid.cc',
     'base/src/eptools/wrap/eptwrap_getpotname.cc',
     'base/src/eptools/wrap/eptwrap_potmanager_isvalid.cc',
@@ -94,6 +120,7 @@ apbtest_ext_sources = [
     'base/lhotse/global.cc',
     'base/lhotse/StandardException.cc',
     'base/lhotse/FileUtils.cc',
+    'base/lhotse/AsyncLogWriter.cc',
     'base/lhotse/IntVal.cc',
     'base/lhotse/Interval.cc',
     'base/lhotse/Range.cc',
@@ -107,6 +134,7 @@ apbtest_workaround_ext_sources = [
     'base/lhotse/global.cc',
     'base/lhotse/StandardException.cc',
     'base/lhotse/FileUtils.cc',
+    'base/lhotse/AsyncLogWriter.cc',
     'base/lhotse/IntVal.cc',
     'base/lhotse/Interval.cc',
     'base/lhotse/Range.cc',
@@ -119,6 +147,7 @@ ptannotate_ext_sources = [
     'base/lhotse/global.cc',
     'base/lhotse/StandardException.cc',
     'base/lhotse/FileUtils.cc',
+    'base/lhotse/AsyncLogWriter.cc',
     'base/lhotse/IntVal.cc',
     'base/lhotse/Interval.cc',
     'base/lhotse/Range.cc'
@@ -0,0 +1,415 @@
+#! /usr/bin/env python
+
+# EPTOOLS Python Interface
+# Benchmark suite: End-to-end timing of the EP inference drivers
+#   EPCoupParallelInfDriver   ('CoupParallel')
+#   EPCoupSequentialInfDriver ('CoupSequential')
+#   EPFactorizedInfDriver     ('Factorized')
+# on binary classification (probit likelihood, Laplace or Gaussian prior),
+# same setup as test/binclass/eptest_binclass.py.
+#
+# Datasets:
+# - synthetic: Sparse binary inputs (dimension --dim, density --density),
+#   targets from a random linear classifier plus noise. Training set sizes
+#   from --sizes, test set size --ntest
+# - adult_a9a: Bundled with test/binclass. Training sets are the first N
+#   of the 2561 training cases (N from --sizes, capped), test set are the
+#   first --ntest of the 30000 test cases
+#
+# Each configuration (dataset, size, driver) runs in its own subprocess,
+# so that memory high-water marks are not mixed up. Per sweep, we record:
+# - wall: Wall time of the sweep (test set predictions excluded)
+# - cpp: Time spent in calls to apbsint.eptools_ext (C++ code)
+# - python: wall - cpp (Python code, including numpy/scipy)
+# - delta: Convergence statistic
+# - acc, loglh: Test set accuracy (%) and avg. log likelihood
+# - t_cum: Cumulative wall time (for accuracy-vs-time curves)
+# Per configuration, we also record setup time and the memory high-water
+# mark (ru_maxrss, in KB) after setup and after inference.
+# Results are written to a JSON file (--out).
+#
+# Regressions: With --compare FILE, the mean sweep time of each
+# configuration is compared against the results in FILE (written by an
+# earlier run). Configurations slower by more than a factor 1+--tol are
+# reported, and the exit status is 1.
+#
+# Example:
+#   python eptest_benchmark.py --datasets synthetic,adult_a9a \
+#     --sizes 500,2000 --out bench.json
+#   python eptest_benchmark.py --sizes 500,2000 --out bench2.json \
+#     --compare bench.json
+
+import sys
+import os
+import time
+import json
+import types
+import resource
+import platform
+import subprocess
+import argparse
+import numpy as np
+import scipy.sparse as ssp
+
+import apbsint as abt
+import apbsint.eptools_ext as epx
+
+# Helper functions
+
+class CppTimer:
+    """
+    Wraps all functions of a module (apbsint.eptools_ext), accumulating
+    wall time and number of calls. All Python code calling these functions
+    via the module (as apbsint does) is timed.
+    """
+    def __init__(self,mod):
+        self.mod = mod
+        self.total = 0.
+        self.ncalls = 0
+        self.orig = {}
+
+    def install(self):
+        for nam in dir(self.mod):
+            f = getattr(self.mod,nam)
+            if nam.startswith('_') or not isinstance(
+                f,(types.BuiltinFunctionType,types.FunctionType)):
+                continue
+            self.orig[nam] = f
+            setattr(self.mod,nam,self._wrap(f))
+
+    def uninstall(self):
+        for nam, f in self.orig.items():
+            setattr(self.mod,nam,f)
+        self.orig = {}
+
+    def _wrap(self,f):
+        def wrapped(*args,**kwargs):
+            t_start = time.time()
+            try:
+                return f(*args,**kwargs)
+            finally:
+                self.total += time.time()-t_start
+                self.ncalls += 1
+        return wrapped
+
+def maxrss_kb():
+    val = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    if sys.platform == 'darwin':
+        val /= 1024  # Bytes on Mac OS
+    return int(val)
+
+def load_synthetic(cfg):
+    """
+    Sparse binary inputs, targets sign(x^T w + noise). Returns
+    (inp_train, targ_train, inp_test, targ_test).
+    """
+    rst = np.random.RandomState(cfg['seed'])
+    n = cfg['dim']
+    nall = cfg['size'] + cfg['ntest']
+    inp = ssp.rand(nall,n,density=cfg['density'],format='csr',
+                   random_state=rst)
+    inp.data[:] = 1.
+    # Every feature must be touched by some training case
+    inp = ssp.hstack([inp, ssp.csr_matrix(np.ones((nall,1)))],format='csr')
+    wvec = rst.randn(n+1)
+    targ = np.sign(inp.dot(wvec) + 0.5*rst.randn(nall))
+    targ[targ==0.] = 1.
+    ntr = cfg['size']
+    return (inp[:ntr,:].copy(), targ[:ntr].copy(), inp[ntr:,:].copy(),
+            targ[ntr:].copy())
+
+def load_adult(cfg):
+    """
+    Adult (a9a), see test/binclass/eptest_binclass.py. Returns
+    (inp_train, targ_train, inp_test, targ_test).
+    """
+    ddir = os.path.join(os.path.dirname(os.path.abspath(__file__)),'..',
+                        'binclass')
+    n = 120  # After removing 3 attributes
+    tmat = []
+    fid = open(os.path.join(ddir,'adult_a9a_inputs_comp.csv'),'r')
+    for line in fid:
+        ind = [int(x) for x in line.split(',')]
+        v = np.zeros(n+3,dtype=np.float64)
+        v[ind] = 1.
+        tmat.append(list(np.hstack((v[:45], v[46:116], v[117:122]))))
+    fid.close()
+    inp_all = ssp.csr_matrix(tmat)
+    del tmat
+    fid = open(os.path.join(ddir,'adult_a9a_targets.csv'),'r')
+    targ_all = np.array([float(x) for x in fid.readline().split(',')],
+                        dtype=np.float64)
+    fid.close()
+    num_test = 30000
+    ntr = min(cfg['size'],targ_all.size-num_test)
+    nte = min(cfg['ntest'],num_test)
+    return (inp_all[num_test:num_test+ntr,:].copy(),
+            targ_all[num_test:num_test+ntr].copy(), inp_all[:nte,:].copy(),
+            targ_all[:nte].copy())
+
+def setup_driver(cfg,inp_train,targ_train,inp_test,targ_test):
+    """
+    Creates models, representation and driver, and initializes the
+    representation (as in test/binclass/eptest_binclass.py). Returns
+    (inf_driv, model_test, opts), 'opts' for 'inference'.
+    """
+    imode = cfg['driver']
+    is_fact = (imode == 'Factorized')
+    do_laplace = (cfg['prior'] == 'Laplace')
+    num_train, n = inp_train.shape
+    if not is_fact:
+        bfct_test = abt.MatSparse(inp_test)
+        bfct_train = abt.MatContainer([abt.MatEye(n),
+                                       abt.MatSparse(inp_train)])
+    else:
+        bfct_test = abt.MatFactorizedInf(inp_test)
+        bfct_train = abt.MatFactorizedInf(
+            ssp.vstack([ssp.eye(n,format='csr'), inp_train],format='csr'))
+    m = bfct_train.shape(0)
+    if not do_laplace:
+        pm_elem1 = abt.ElemPotManager('Gaussian',n,(0., 25./4.))
+    else:
+        pm_elem1 = abt.ElemPotManager('Laplace',n,(0., 2./5.))
+    pm_elem2 = abt.ElemPotManager('Probit',num_train,(targ_train, 0.))
+    pman_train = abt.PotManager((pm_elem1, pm_elem2))
+    pman_test = abt.PotManager(abt.ElemPotManager('Probit',targ_test.size,
+                                                  (targ_test, 0.)))
+    opts = abt.helpers.Struct()
+    opts.imode = imode
+    opts.maxit = cfg['maxit']
+    opts.deltaeps = cfg['deltaeps']
+    opts.damp = 0.
+    opts.verbose = 0
+    if not is_fact:
+        model_train = abt.ModelCoupled(bfct_train,pman_train)
+        model_test = abt.ModelCoupled(bfct_test,pman_test)
+        repres = abt.RepresentationCoupled(bfct_train,
+                                           keep_margs=(imode == 'CoupParallel'))
+        if imode == 'CoupParallel':
+            inf_driv = abt.EPCoupParallelInfDriver(model_train,repres)
+        else:
+            inf_driv = abt.EPCoupSequentialInfDriver(model_train,repres)
+            opts.skipeps = 1e-7
+            opts.refresh = True
+        opts.caveps = 1e-5
+        if not do_laplace:
+            inf_driv.init('ADF')
+        else:
+            tvec = np.empty(m)
+            tvec[:] = 1.
+            repres.setpi(tvec)
+            tvec[:n] = 0.
+            tvec[n:] = 0.5*targ_train
+            repres.setbeta(tvec)
+            repres.refresh()
+    else:
+        model_train = abt.ModelFactorized(bfct_train,pman_train)
+        model_test = abt.ModelFactorized(bfct_test,pman_test)
+        repres = abt.RepresentationFactorized(bfct_train)
+        inf_driv = abt.EPFactorizedInfDriver(model_train,repres)
+        opts.piminthres = 1e-7
+        opts.refresh = True
+        if not do_laplace:
+            inf_driv.init('ADF')
+            opts.skip_gauss = True
+        else:
+            tvec = np.zeros(repres.size_pars())
+            repres.setbeta(tvec)
+            tvec[:n] = 1.
+            repres.setpi(tvec)
+            repres.refresh()
+            opts.upd_1stsweep = set(['Probit'])
+        if cfg['seldamp']:
+            if not do_laplace:
+                sd_subind = pman_train.filterpots(set(['Gaussian']))
+                repres.seldamp_reset(5,sd_subind,True)
+            else:
+                repres.seldamp_reset(5)
+    return (inf_driv, model_test, opts)
+
+def test_stats(inf_driv,model_test,targ_test,imode):
+    popts = abt.helpers.Struct()
+    popts.imode = imode
+    popts.ptype = 3
+    (h_q, rho_q, logz, h_p, rho_p) = inf_driv.predict(model_test,popts)
+    nte = targ_test.size
+    acc = 100.*float((np.sign(h_q)==targ_test).sum())/nte
+    return (acc, float(logz.sum()/nte))
+
+def run_config(cfg):
+    """
+    Runs a single configuration (in the subprocess), returns result dict.
+    """
+    res = dict(cfg)
+    t_start = time.time()
+    if cfg['dataset'] == 'synthetic':
+        data = load_synthetic(cfg)
+    elif cfg['dataset'] == 'adult_a9a':
+        data = load_adult(cfg)
+    else:
+        raise ValueError("Unknown dataset '%s'" % cfg['dataset'])
+    (inp_train, targ_train, inp_test, targ_test) = data
+    res['num_train'], res['dim'] = inp_train.shape
+    res['num_test'] = targ_test.size
+    timer = CppTimer(epx)
+    timer.install()
+    (inf_driv, model_test, opts) = setup_driver(cfg,*data)
+    res['t_setup'] = time.time()-t_start
+    res['maxrss_setup_kb'] = maxrss_kb()
+    (acc, loglh) = test_stats(inf_driv,model_test,targ_test,cfg['driver'])
+    res['acc_init'] = acc
+    res['loglh_init'] = loglh
+    # Per-sweep statistics are collected by the sweep hook. Test set
+    # predictions are excluded from the timings
+    sweeps = []
+    state = {'t_last': 0., 'c_last': 0., 't_cum': 0.}
+    def sweep_hook(nit,delta):
+        t_now = time.time()
+        sw = {'sweep': nit, 'delta': float(delta),
+              'wall': t_now-state['t_last'],
+              'cpp': timer.total-state['c_last']}
+        sw['python'] = sw['wall']-sw['cpp']
+        state['t_cum'] += sw['wall']
+        sw['t_cum'] = state['t_cum']
+        (sw['acc'], sw['loglh']) = test_stats(inf_driv,model_test,targ_test,
+                                              cfg['driver'])
+        sweeps.append(sw)
+        state['t_last'] = time.time()
+        state['c_last'] = timer.total
+    opts.sweep_hook = sweep_hook
+    state['t_last'] = time.time()
+    state['c_last'] = timer.total
+    ires = inf_driv.inference(opts)
+    timer.uninstall()
+    res['sweeps'] = sweeps
+    res['nit'] = ires.nit
+    res['converged'] = (ires.rstat == 0)
+    res['t_inference'] = state['t_cum']
+    res['t_cpp'] = sum([sw['cpp'] for sw in sweeps])
+    res['t_python'] = res['t_inference']-res['t_cpp']
+    res['t_sweep_mean'] = res['t_inference']/max(len(sweeps),1)
+    res['maxrss_kb'] = maxrss_kb()
+    return res
+
+def config_key(res):
+    return '%s/%d/%s/%s' % (res['dataset'],res['size'],res['driver'],
+                            res['prior'])
+
+def git_revision():
+    try:
+        proc = subprocess.Popen(['git','rev-parse','HEAD'],
+                                stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE,
+                                cwd=os.path.dirname(os.path.abspath(__file__)))
+        out = proc.communicate()[0]
+        if proc.returncode == 0:
+            return out.strip()
+    except OSError:
+        pass
+    return None
+
+def compare_results(runs,fname,tol):
+    """
+    Compares mean sweep times against results file 'fname'. Returns number
+    of regressions.
+    """
+    fid = open(fname,'r')
+    base = dict([(config_key(r),r) for r in json.load(fid)['runs']])
+    fid.close()
+    nreg = 0
+    print '\nComparison against %s (tol=%.2f):' % (fname,tol)
+    for res in runs:
+        key = config_key(res)
+        if not key in base:
+            print '  %-45s  (not in baseline)' % key
+            continue
+        ratio = res['t_sweep_mean']/max(base[key]['t_sweep_mean'],1e-12)
+        flag = ''
+        if ratio > 1.+tol:
+            flag = '  <== REGRESSION'
+            nreg += 1
+        print '  %-45s  %.4fs/sweep (base %.4fs): x%.3f%s' % \
+            (key,res['t_sweep_mean'],base[key]['t_sweep_mean'],ratio,flag)
+    return nreg
+
+# Main code
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='Benchmark suite for apbsint EP inference drivers')
+    parser.add_argument('--out',default='eptest_benchmark.json',
+                        help='Output JSON file')
+    parser.add_argument('--drivers',
+                        default='CoupParallel,CoupSequential,Factorized',
+                        help='Comma-separated list of drivers')
+    parser.add_argument('--datasets',default='synthetic,adult_a9a',
+                        help='Comma-separated list (synthetic, adult_a9a)')
+    parser.add_argument('--sizes',default='500,1000,2561',
+                        help='Comma-separated list of training set sizes')
+    parser.add_argument('--ntest',type=int,default=5000,
+                        help='Test set size')
+    parser.add_argument('--dim',type=int,default=120,
+                        help='Input dimension (synthetic)')
+    parser.add_argument('--density',type=float,default=0.1,
+                        help='Input density (synthetic)')
+    parser.add_argument('--prior',default='Laplace',
+                        choices=['Laplace','Gaussian'])
+    parser.add_argument('--maxit',type=int,default=10,
+                        help='Number of sweeps')
+    parser.add_argument('--deltaeps',type=float,default=1e-6,
+                        help='Convergence threshold')
+    parser.add_argument('--no_seldamp',action='store_true',
+                        help='No selective damping (Factorized)')
+    parser.add_argument('--seed',type=int,default=1)
+    parser.add_argument('--compare',default=None,
+                        help='Results file to compare against')
+    parser.add_argument('--tol',type=float,default=0.2,
+                        help='Relative slowdown flagged as regression')
+    parser.add_argument('--run',default=None,help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    if args.run is not None:
+        # Subprocess: Run single configuration, result to stdout
+        res = run_config(json.loads(args.run))
+        sys.stdout.write('RESULT ' + json.dumps(res) + '\n')
+        sys.exit(0)
+    runs = []
+    for dset in args.datasets.split(','):
+        for size in [int(x) for x in args.sizes.split(',')]:
+            for driver in args.drivers.split(','):
+                cfg = {'dataset': dset, 'size': size, 'driver': driver,
+                       'prior': args.prior, 'ntest': args.ntest,
+                       'dim': args.dim, 'density': args.density,
+                       'maxit': args.maxit, 'deltaeps': args.deltaeps,
+                       'seldamp': not args.no_seldamp, 'seed': args.seed}
+                print 'Running %s ...' % config_key(cfg)
+                sys.stdout.flush()
+                proc = subprocess.Popen([sys.executable,
+                                         os.path.abspath(__file__),'--run',
+                                         json.dumps(cfg)],
+                                        stdout=subprocess.PIPE)
+                out = proc.communicate()[0]
+                res = None
+                for line in out.splitlines():
+                    if line.startswith('RESULT '):
+                        res = json.loads(line[7:])
+                if proc.returncode != 0 or res is None:
+                    print '  FAILED (return code %d)' % proc.returncode
+                    continue
+                print ('  %d sweeps: %.3fs (C++ %.3fs, Python %.3fs), '
+                       'maxrss=%dKB, acc=%.2f%%') % \
+                       (res['nit'],res['t_inference'],res['t_cpp'],
+                        res['t_python'],res['maxrss_kb'],
+                        res['sweeps'][-1]['acc'] if res['sweeps'] else
+                        res['acc_init'])
+                runs.append(res)
+    meta = {'date': time.strftime('%Y-%m-%d %H:%M:%S'),
+            'host': platform.node(), 'platform': platform.platform(),
+            'python': platform.python_version(), 'numpy': np.__version__,
+            'git': git_revision(), 'argv': sys.argv[1:]}
+    fid = open(args.out,'w')
+    json.dump({'meta': meta, 'runs': runs},fid,indent=1,sort_keys=True)
+    fid.close()
+    print 'Results written to %s' % args.out
+    if args.compare is not None:
+        if compare_results(runs,args.compare,args.tol) > 0:
+            sys.exit(1)
@@ -0,0 +1,122 @@
+#! /usr/bin/env python
+
+# EPTOOLS Python Interface
+# Benchmark: NUMA placement of the factorized EP representation
+#
+# The process is pinned to CPU --cpu (node L). The arrays of the
+# factorized representation (B index and values, EP parameters, marginals)
+# are placed on
+# - local:      Node L
+# - remote:     Another node (--remote, or the first node other than L)
+# - interleave: All nodes
+# (see apbsint.eptools_ext.numa_place), and sweeps of
+# EPFactorizedInfDriver (probit, synthetic data, as in eptest_benchmark.py)
+# are timed. For each placement, we report the distribution of pages over
+# nodes (numa_pagenodes) and the mean wall time per sweep. The EP state is
+# reset in place before each placement, so all runs do the same work.
+#
+# On a machine with a single NUMA node (or without NUMA support), there is
+# nothing to compare, and the script exits.
+#
+# Example:
+#   python eptest_numa.py --size 100000 --dim 2000 --maxit 5
+
+import sys
+import time
+import resource
+import argparse
+import numpy as np
+
+import apbsint as abt
+import apbsint.eptools_ext as epx
+from eptest_benchmark import load_synthetic, setup_driver
+
+# Helper functions
+
+def place_arrays(arrs,nodes):
+    succ = True
+    nodes = np.array(nodes,dtype=np.int32)
+    for arr in arrs:
+        succ = epx.numa_place(arr,nodes) and succ
+    return succ
+
+def page_histogram(arrs,nnodes):
+    """
+    Returns counts of pages per node (entry nnodes: pages not placed, or
+    not available).
+    """
+    cnt = np.zeros(nnodes+1,dtype=np.int64)
+    psz = resource.getpagesize()
+    for arr in arrs:
+        pnodes = np.empty(arr.nbytes//psz+2,dtype=np.int32)
+        npg = epx.numa_pagenodes(arr,pnodes)
+        if npg < 0:
+            cnt[nnodes] += arr.nbytes//psz+1
+            continue
+        pnodes = pnodes[:npg]
+        pnodes[np.logical_or(pnodes < 0,pnodes >= nnodes)] = nnodes
+        cnt += np.bincount(pnodes,minlength=nnodes+1)
+    return cnt
+
+# Main code
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='NUMA placement benchmark for factorized EP')
+    parser.add_argument('--cpu',type=int,default=0,
+                        help='CPU the process is pinned to')
+    parser.add_argument('--remote',type=int,default=-1,
+                        help='Remote node (def.: first node not local)')
+    parser.add_argument('--size',type=int,default=50000,
+                        help='Training set size')
+    parser.add_argument('--dim',type=int,default=1000,
+                        help='Input dimension')
+    parser.add_argument('--density',type=float,default=0.01,
+                        help='Input density')
+    parser.add_argument('--maxit',type=int,default=5,
+                        help='Number of sweeps per placement')
+    parser.add_argument('--seed',type=int,default=1)
+    args = parser.parse_args()
+    (succ, lnode, nnodes) = epx.numa_pinthread(args.cpu)
+    if not succ or lnode < 0 or nnodes < 2:
+        print ('Single NUMA node, or NUMA not supported (pinned=%d, node=%d, '
+               'nnodes=%d). Nothing to compare.') % (succ,lnode,nnodes)
+        sys.exit(0)
+    rnode = args.remote
+    if rnode < 0:
+        rnode = [nd for nd in range(nnodes) if nd != lnode][0]
+    print 'Pinned to CPU %d (node %d), remote node %d, %d nodes' % \
+        (args.cpu,lnode,rnode,nnodes)
+    cfg = {'dataset': 'synthetic', 'size': args.size, 'driver': 'Factorized',
+           'prior': 'Gaussian', 'ntest': 10, 'dim': args.dim,
+           'density': args.density, 'maxit': args.maxit, 'deltaeps': 0.,
+           'seldamp': False, 'seed': args.seed}
+    data = load_synthetic(cfg)
+    (inf_driv, model_test, opts) = setup_driver(cfg,*data)
+    bfact = inf_driv.model.bfact
+    rep = inf_driv.rep
+    arrs = [bfact.rowind, bfact.colind, bfact.bvals, rep.ep_pi, rep.ep_beta,
+            rep.marg_pi, rep.marg_beta]
+    mbytes = sum([arr.nbytes for arr in arrs])/float(1 << 20)
+    print 'n=%d, m=%d, representation: %.1fMB' % \
+        (bfact.shape(1),bfact.shape(0),mbytes)
+    ep_pi0 = rep.ep_pi.copy()
+    ep_beta0 = rep.ep_beta.copy()
+    for (name, nodes) in [('local', [lnode]), ('remote', [rnode]),
+                          ('interleave', range(nnodes))]:
+        if not place_arrays(arrs,nodes):
+            print '%-10s: numa_place failed' % name
+            continue
+        # Reset EP state in place (placement stays with the memory)
+        rep.ep_pi[:] = ep_pi0
+        rep.ep_beta[:] = ep_beta0
+        rep.refresh()
+        cnt = page_histogram(arrs,nnodes)
+        t_start = time.time()
+        ires = inf_driv.inference(opts)
+        t_sweep = (time.time()-t_start)/max(ires.nit,1)
+        print '%-10s: %.4fs/sweep (%d sweeps), pages per node: %s' % \
+            (name,t_sweep,ires.nit,
+             ' '.join(['%d:%d' % (nd,cnt[nd]) for nd in range(nnodes)
+                       if cnt[nd] > 0]) +
+             (' none:%d' % cnt[nnodes] if cnt[nnodes] > 0 else ''))
@@ -0,0 +1,309 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class CheckpointServices
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/CheckpointServices.h"
+#include "src/eptools/TraceServices.h"
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <string>
+
+//BEGINNS(eptools)
+  const int CheckpointServices::formatVersion;
+  const int CheckpointServices::maxNameLen;
+  const int CheckpointServices::typeDouble;
+  const int CheckpointServices::typeInt;
+  const int CheckpointServices::endianTag;
+
+  static const char ckptMagic[8]={'E','P','T','C','K','P','T','\n'};
+
+  struct CkptHeader
+  {
+    char magic[8];
+    int version,numArr,sweep,endian;
+    unsigned int tableCrc,headCrc;
+  };
+
+  struct CkptEntry
+  {
+    char name[CheckpointServices::maxNameLen];
+    int type,size;
+    unsigned int crc,reserved;
+  };
+
+  /*
+   * Snapshot being built or written. 'ckptWriting' is true from 'commit'
+   * until the thread has been joined ('wait'). The writer thread only
+   * reads the snapshot, and sets 'ckptError'.
+   */
+  static int ckptSweep=0;
+  static bool ckptOpen=false,ckptWriting=false;
+  static pthread_t ckptThread;
+  static std::vector<CkptEntry> ckptTable;
+  static std::vector<char> ckptData;
+  static std::string ckptFname,ckptError;
+  static unsigned int ckptCrcTable[256];
+  static pthread_once_t ckptOnce=PTHREAD_ONCE_INIT;
+
+  static void ckptInitCrcTable()
+  {
+    unsigned int c;
+    int i,k;
+
+    for (i=0; i<256; i++) {
+      c=(unsigned int) i;
+      for (k=0; k<8; k++)
+	c=((c&1)!=0)?(0xEDB88320U^(c>>1)):(c>>1);
+      ckptCrcTable[i]=c;
+    }
+  }
+
+  static inline int ckptElemSize(int type)
+  {
+    return (type==CheckpointServices::typeDouble)?sizeof(double):sizeof(int);
+  }
+
+  static inline unsigned int ckptTableCrc(const std::vector<CkptEntry>& table)
+  {
+    return CheckpointServices::crc32((table.size()>0)?&table[0]:0,
+				     table.size()*sizeof(CkptEntry));
+  }
+
+  static void ckptAdd(const char* name,const void* a,int n,int type)
+  {
+    CkptEntry ent;
+    int k;
+    size_t off,sz;
+
+    if (!ckptOpen)
+      throw WrongStatusException(EXCEPT_MSG("No snapshot started"));
+    if (name==0 || *name==0 || strlen(name)>=CheckpointServices::maxNameLen ||
+	n<0 || (n>0 && a==0))
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (k=0; k<(int) ckptTable.size(); k++)
+      if (strcmp(ckptTable[k].name,name)==0)
+	throw InvalidParameterException(EXCEPT_MSG("Name already in snapshot"));
+    memset(&ent,0,sizeof(ent));
+    strcpy(ent.name,name);
+    ent.type=type; ent.size=n;
+    off=ckptData.size();
+    sz=((size_t) n)*ckptElemSize(type);
+    ckptData.resize(off+sz);
+    if (sz>0)
+      memcpy(&ckptData[off],a,sz);
+    ent.crc=CheckpointServices::crc32(a,sz);
+    ckptTable.push_back(ent);
+  }
+
+  static void* ckptWriterMain(void*)
+  {
+    TraceScope trace("checkpoint_write","ckpt",ckptSweep);
+    std::string tname=ckptFname+".tmp";
+    CkptHeader head;
+    FILE* fd;
+    int numArr=ckptTable.size();
+    bool ok;
+
+    memcpy(head.magic,ckptMagic,8);
+    head.version=CheckpointServices::formatVersion;
+    head.numArr=numArr; head.sweep=ckptSweep;
+    head.endian=CheckpointServices::endianTag;
+    head.tableCrc=ckptTableCrc(ckptTable);
+    head.headCrc=CheckpointServices::crc32(&head,offsetof(CkptHeader,
+							 headCrc));
+    if ((fd=fopen(tname.c_str(),"wb"))==0) {
+      ckptError="Cannot open file "+tname;
+      return 0;
+    }
+    ok=(fwrite(&head,sizeof(head),1,fd)==1 &&
+	(numArr==0 ||
+	 fwrite(&ckptTable[0],sizeof(CkptEntry),numArr,fd)==(size_t) numArr) &&
+	(ckptData.size()==0 ||
+	 fwrite(&ckptData[0],1,ckptData.size(),fd)==ckptData.size()) &&
+	fflush(fd)==0 && fsync(fileno(fd))==0);
+    ok=(fclose(fd)==0 && ok);
+    if (!ok) {
+      ckptError="Cannot write file "+tname;
+      remove(tname.c_str());
+    } else if (rename(tname.c_str(),ckptFname.c_str())!=0) {
+      ckptError="Cannot rename file "+tname;
+      remove(tname.c_str());
+    }
+
+    return 0;
+  }
+
+  /*
+   * Opens checkpoint file 'fname' and reads header and table, checking
+   * them. Returns the file descriptor.
+   */
+  static FILE* ckptReadTable(const char* fname,CkptHeader& head,
+			     std::vector<CkptEntry>& table)
+  {
+    FILE* fd;
+    std::string msg;
+
+    if ((fd=fopen(fname,"rb"))==0) {
+      msg=std::string("Cannot open file ")+fname;
+      throw FileUtilsException(EXCEPT_MSG(msg.c_str()));
+    }
+    if (fread(&head,sizeof(head),1,fd)!=1 ||
+	memcmp(head.magic,ckptMagic,8)!=0 ||
+	head.headCrc!=CheckpointServices::crc32(&head,
+						offsetof(CkptHeader,headCrc))) {
+      fclose(fd);
+      msg=std::string("Not a checkpoint file: ")+fname;
+      throw FileFormatException(EXCEPT_MSG(msg.c_str()));
+    }
+    if (head.endian!=CheckpointServices::endianTag ||
+	head.version<1 || head.version>CheckpointServices::formatVersion ||
+	head.numArr<0) {
+      fclose(fd);
+      msg=std::string("Unsupported version or byte order: ")+fname;
+      throw FileFormatException(EXCEPT_MSG(msg.c_str()));
+    }
+    table.resize(head.numArr);
+    if ((head.numArr>0 &&
+	 fread(&table[0],sizeof(CkptEntry),head.numArr,fd)!=(size_t) head.numArr) ||
+	head.tableCrc!=ckptTableCrc(table)) {
+      fclose(fd);
+      msg=std::string("Corrupt checkpoint file: ")+fname;
+      throw FileFormatException(EXCEPT_MSG(msg.c_str()));
+    }
+
+    return fd;
+  }
+
+  static void ckptRead(const char* fname,const char* name,void* a,int n,
+		       int type)
+  {
+    CkptHeader head;
+    std::vector<CkptEntry> table;
+    FILE* fd=ckptReadTable(fname,head,table);
+    off_t off=sizeof(head)+table.size()*sizeof(CkptEntry);
+    int k;
+    size_t sz;
+    bool ok;
+    std::string msg;
+
+    for (k=0; k<(int) table.size() && strncmp(table[k].name,name,
+					      CheckpointServices::maxNameLen);
+	 k++)
+      off+=((off_t) table[k].size)*ckptElemSize(table[k].type);
+    if (k==(int) table.size() || table[k].type!=type ||
+	table[k].size!=n) {
+      fclose(fd);
+      msg=std::string("Array ")+name+" not in file, or wrong type or size";
+      throw InvalidParameterException(EXCEPT_MSG(msg.c_str()));
+    }
+    sz=((size_t) n)*ckptElemSize(type);
+    ok=(sz==0 || (fseeko(fd,off,SEEK_SET)==0 && fread(a,1,sz,fd)==sz));
+    fclose(fd);
+    if (!ok || table[k].crc!=CheckpointServices::crc32(a,sz)) {
+      msg=std::string("Corrupt data for array ")+name+" in "+fname;
+      throw FileFormatException(EXCEPT_MSG(msg.c_str()));
+    }
+  }
+
+  void CheckpointServices::begin(int sweep)
+  {
+    wait();
+    ckptTable.clear();
+    ckptData.clear(); // Capacity is kept
+    ckptSweep=sweep; ckptOpen=true;
+  }
+
+  void CheckpointServices::add(const char* name,const double* a,int n)
+  {
+    ckptAdd(name,a,n,typeDouble);
+  }
+
+  void CheckpointServices::add(const char* name,const int* a,int n)
+  {
+    ckptAdd(name,a,n,typeInt);
+  }
+
+  void CheckpointServices::commit(const char* fname)
+  {
+    if (!ckptOpen)
+      throw WrongStatusException(EXCEPT_MSG("No snapshot started"));
+    if (fname==0 || *fname==0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    ckptFname=fname; ckptError.clear();
+    ckptOpen=false;
+    if (pthread_create(&ckptThread,0,ckptWriterMain,0)!=0) {
+      // Write in calling thread
+      ckptWriterMain(0);
+      ckptWriting=false;
+      wait();
+    } else
+      ckptWriting=true;
+  }
+
+  void CheckpointServices::wait()
+  {
+    std::string msg;
+
+    if (ckptWriting) {
+      pthread_join(ckptThread,0);
+      ckptWriting=false;
+    }
+    if (!ckptError.empty()) {
+      msg=ckptError; ckptError.clear();
+      throw FileUtilsException(EXCEPT_MSG(msg.c_str()));
+    }
+  }
+
+  int CheckpointServices::find(const char* fname,const char* name,int& type,
+			       int& sweep)
+  {
+    CkptHeader head;
+    std::vector<CkptEntry> table;
+    int k;
+
+    fclose(ckptReadTable(fname,head,table));
+    sweep=head.sweep;
+    for (k=0; k<(int) table.size(); k++)
+      if (strncmp(table[k].name,name,maxNameLen)==0) {
+	type=table[k].type;
+	return table[k].size;
+      }
+
+    return -1;
+  }
+
+  void CheckpointServices::read(const char* fname,const char* name,double* a,
+				int n)
+  {
+    ckptRead(fname,name,a,n,typeDouble);
+  }
+
+  void CheckpointServices::read(const char* fname,const char* name,int* a,
+				int n)
+  {
+    ckptRead(fname,name,a,n,typeInt);
+  }
+
+  unsigned int CheckpointServices::crc32(const void* buff,size_t sz,
+					 unsigned int crc)
+  {
+    const unsigned char* p=(const unsigned char*) buff;
+    size_t i;
+
+    pthread_once(&ckptOnce,ckptInitCrcTable);
+    crc=~crc;
+    for (i=0; i<sz; i++)
+      crc=ckptCrcTable[(crc^p[i])&0xff]^(crc>>8);
+
+    return ~crc;
+  }
+//ENDNS
@@ -0,0 +1,140 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class CheckpointServices
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_CHECKPOINTSERVICES_H
+#define EPTOOLS_CHECKPOINTSERVICES_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+
+//BEGINNS(eptools)
+  /**
+   * Checkpoints of EP state (static methods only), written in the
+   * background.
+   * <p>
+   * A snapshot consists of named arrays (double or int), f.ex. messages,
+   * marginals and selective damping state of a representation. It is
+   * taken at a sweep boundary: 'begin', then 'add' for each array, which
+   * copies it into a staging buffer, then 'commit', which starts a
+   * background thread writing the snapshot to a file. The caller
+   * continues with the next sweep right away, the only cost is the copy.
+   * The staging buffer is reused: 'begin' waits for the previous write
+   * to finish (so checkpoints should not be taken more often than they
+   * can be written). 'wait' waits for the write and reports its errors.
+   * <p>
+   * File format (version 'formatVersion', native byte order):
+   * - Header: magic "EPTCKPT\n" (8 bytes), then int: version, number of
+   *   arrays, sweep, 'endianTag', then unsigned int: CRC-32 of the
+   *   table, CRC-32 of the header up to here
+   * - Table: one entry per array: name (zero-padded, 'maxNameLen'
+   *   bytes), then int: type ('typeDouble', 'typeInt'), size, then
+   *   unsigned int: CRC-32 of the data, reserved (0)
+   * - Data: the arrays, in the order of the table
+   * The file is written to <fname>.tmp, synced and renamed, so that
+   * <fname> is always a complete snapshot (the last one committed
+   * successfully).
+   * Checksums of header and table are verified by 'find', the one of the
+   * data by 'read'.
+   * <p>
+   * NOTE: Methods must not be called from different threads
+   * concurrently (there is a single staging buffer).
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class CheckpointServices
+  {
+  public:
+    // Constants
+
+    static const int formatVersion=1;
+    static const int maxNameLen=32; // Incl. trailing 0
+    static const int typeDouble=0;
+    static const int typeInt=1;
+    static const int endianTag=0x01020304;
+
+    // Public static methods
+
+    /**
+     * Starts a new snapshot. Waits for the previous write to finish, and
+     * throws its error (see 'wait'), in which case the snapshot is not
+     * started.
+     *
+     * @param sweep Sweep number stored with the snapshot
+     */
+    static void begin(int sweep);
+
+    /**
+     * Copies array 'a' into the snapshot, under 'name' (unique within
+     * the snapshot).
+     *
+     * @param name Name (less than 'maxNameLen' chars)
+     * @param a    Array
+     * @param n    Size of 'a'
+     */
+    static void add(const char* name,const double* a,int n);
+
+    static void add(const char* name,const int* a,int n);
+
+    /**
+     * Starts writing the snapshot to file 'fname' in the background.
+     *
+     * @param fname File name
+     */
+    static void commit(const char* fname);
+
+    /**
+     * Waits for the current write to finish. If it failed,
+     * 'FileUtilsException' is thrown (once).
+     */
+    static void wait();
+
+    /**
+     * Looks up array 'name' in checkpoint file 'fname'. Throws
+     * 'FileUtilsException' if the file cannot be read,
+     * 'FileFormatException' if it is not a valid checkpoint file.
+     *
+     * @param fname File name
+     * @param name  Array name
+     * @param type  Type of array ret. here
+     * @param sweep Sweep number of snapshot ret. here
+     * @return      Size of array, -1 if not in file
+     */
+    static int find(const char* fname,const char* name,int& type,
+		    int& sweep);
+
+    /**
+     * Reads array 'name' from checkpoint file 'fname'. The array must
+     * exist with the type of 'a' and size 'n'. Throws
+     * 'FileFormatException' if the data checksum does not match (see
+     * also 'find').
+     *
+     * @param fname File name
+     * @param name  Array name
+     * @param a     Array ret. here
+     * @param n     Size of 'a'
+     */
+    static void read(const char* fname,const char* name,double* a,int n);
+
+    static void read(const char* fname,const char* name,int* a,int n);
+
+    /**
+     * @param buff Buffer
+     * @param sz   Size (bytes)
+     * @param crc  CRC of preceding data. Def.: 0
+     * @return     CRC-32 (IEEE 802.3) of 'buff', continuing 'crc'
+     */
+    static unsigned int crc32(const void* buff,size_t sz,
+			      unsigned int crc=0);
+  };
+//ENDNS
+
+#endif
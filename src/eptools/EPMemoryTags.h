@@ -0,0 +1,62 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class EPMemoryTags
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_EPMEMORYTAGS_H
+#define EPTOOLS_EPMEMORYTAGS_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+
+//BEGINNS(eptools)
+  /**
+   * Tags for allocation tracking in eptools (see 'TrackingMemManager',
+   * 'MemTagScope'; only active if USE_OWN_MEMMAN is defined):
+   * - tagOther:    Untagged
+   * - tagRepres:   EP representations ('FactorizedEPRepresentation')
+   * - tagMessages: Message buffers kept by drivers (f.ex., accumulated
+   *                tau message changes in 'ParallelFactEPDriver')
+   * - tagSelDamp:  Selective damping ('MaximumValuesService' subclasses)
+   * - tagPotMan:   Potential managers and potentials
+   * - tagScratch:  Temporary buffers in EP updates and batch calls
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class EPMemoryTags
+  {
+  public:
+    // Constants
+
+    static const int tagOther   =0;
+    static const int tagRepres  =1;
+    static const int tagMessages=2;
+    static const int tagSelDamp =3;
+    static const int tagPotMan  =4;
+    static const int tagScratch =5;
+    static const int numTags    =6;
+
+    // Public static methods
+
+    /**
+     * @param tag Tag
+     * @return    Name of tag
+     */
+    static const char* getName(int tag) {
+      static const char* names[]={"other","repres","messages","seldamp",
+				  "potman","scratch"};
+
+      if (tag<0 || tag>=numTags) throw OutOfRangeException(EXCEPT_MSG(""));
+      return names[tag];
+    }
+  };
+//ENDNS
+
+#endif
@@ -0,0 +1,142 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class FactEPTestMonitor
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/FactEPTestMonitor.h"
+#include <vector>
+
+//BEGINNS(eptools)
+#define MAXRELDIFF(a,b) (fabs((a)-(b))/std::max(fabs(a),std::max(fabs(b),1e-8)))
+
+  FactEPTestMonitor::FactEPTestMonitor(int pnumN,int pnumP,
+				       const ArrayHandle<int>& pcolInd,
+				       const ArrayHandle<double>& pbmatVals,
+				       const Handle<PotentialManager>& ptestPots,
+				       const ArrayHandle<double>& ptargets,
+				       const ArrayHandle<double>& pmargMeans,
+				       const ArrayHandle<double>& pmargVars,
+				       const ArrayHandle<double>& ppredMeans,
+				       const ArrayHandle<double>& ppredVars,
+				       const ArrayHandle<double>& ppredLogZ,
+				       const ArrayHandle<double>& ppredStats) :
+    numN(pnumN),numP(pnumP),colInd(pcolInd),bmatVals(pbmatVals),
+    testPots(ptestPots),targets(ptargets),margMeans(pmargMeans),
+    margVars(pmargVars),predMeans(ppredMeans),predVars(ppredVars),
+    predLogZ(ppredLogZ),predStats(ppredStats)
+  {
+    int nnz;
+
+    if (pnumN<1 || pnumP<1 || testPots==0 || testPots->size()!=pnumP ||
+	testPots->numArgumentGroup(EPScalarPotential::atypeUnivariate)!=
+	pnumP)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if (pcolInd.size()<=pnumN+1 || pcolInd[0]!=pnumN+1)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    nnz=(pcolInd[pnumN]-pnumN-1)>>1;
+    if (pcolInd.size()!=2*nnz+pnumN+1 || pbmatVals.size()!=nnz)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if ((ptargets.size()>0 && ptargets.size()!=pnumP) ||
+	pmargMeans.size()!=pnumN || pmargVars.size()!=pnumN ||
+	ppredMeans.size()!=pnumP || ppredVars.size()!=pnumP ||
+	ppredLogZ.size()!=pnumP || ppredStats.size()!=2)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+  }
+
+  void FactEPTestMonitor::reset(const double* margBeta,const double* margPi)
+  {
+    int i,r,ii,viOff,viSz;
+    double mu,rho,bval;
+    const int* viInd,*jiInd;
+
+    std::fill(predMeans.p(),predMeans.p()+numP,0.0);
+    std::fill(predVars.p(),predVars.p()+numP,0.0);
+    for (i=0; i<numN; i++) {
+      margMeans[i]=mu=margBeta[i]/margPi[i];
+      margVars[i]=rho=1.0/margPi[i];
+      viOff=colInd[i]; viSz=(colInd[i+1]-viOff)>>1;
+      viInd=colInd.p()+viOff; jiInd=viInd+viSz;
+      for (ii=0; ii<viSz; ii++) {
+	r=viInd[ii]; bval=bmatVals[jiInd[ii]];
+	predMeans[r]+=bval*mu;
+	predVars[r]+=bval*bval*rho;
+      }
+    }
+    predStats[0]=predStats[1]=0.0;
+    for (r=0; r<numP; r++) {
+      predStats[1]+=(predLogZ[r]=evalLogZ(r));
+      if (isCorrect(r))
+	predStats[0]+=1.0;
+    }
+  }
+
+  /*
+   * Before h_r, rho_r are changed for the first time, the contribution of
+   * r to 'predStats' is removed, and r is appended to 'dirty'. At the end,
+   * the contributions of all r in 'dirty' are recomputed.
+   */
+  int FactEPTestMonitor::update(const double* margBeta,const double* margPi,
+				double tol,int* nrows)
+  {
+    int i,r,ii,viOff,viSz,nprop=0;
+    double mu,rho,dmu,drho,bval;
+    const int* viInd,*jiInd;
+    std::vector<int> dirty;
+    std::vector<bool> mark(numP,false);
+
+    if (tol<0.0) throw InvalidParameterException(EXCEPT_MSG(""));
+    for (i=0; i<numN; i++) {
+      mu=margBeta[i]/margPi[i]; rho=1.0/margPi[i];
+      if (MAXRELDIFF(margMeans[i],mu)<=tol &&
+	  MAXRELDIFF(sqrt(margVars[i]),sqrt(rho))<=tol)
+	continue;
+      dmu=mu-margMeans[i]; drho=rho-margVars[i];
+      margMeans[i]=mu; margVars[i]=rho;
+      viOff=colInd[i]; viSz=(colInd[i+1]-viOff)>>1;
+      viInd=colInd.p()+viOff; jiInd=viInd+viSz;
+      for (ii=0; ii<viSz; ii++) {
+	r=viInd[ii]; bval=bmatVals[jiInd[ii]];
+	if (!mark[r]) {
+	  mark[r]=true; dirty.push_back(r);
+	  predStats[1]-=predLogZ[r];
+	  if (isCorrect(r))
+	    predStats[0]-=1.0;
+	}
+	predMeans[r]+=bval*dmu;
+	predVars[r]+=bval*bval*drho;
+      }
+      nprop++;
+    }
+    for (ii=0; ii<(int) dirty.size(); ii++) {
+      r=dirty[ii];
+      predStats[1]+=(predLogZ[r]=evalLogZ(r));
+      if (isCorrect(r))
+	predStats[0]+=1.0;
+    }
+    if (nrows!=0)
+      *nrows=dirty.size();
+
+    return nprop;
+  }
+
+  /*
+   * Same failure handling as for predictions in 'apbsint.InfDriver': log
+   * Z_r = 0 if the local computation fails, or if the predictive variance
+   * would not be positive.
+   */
+  double FactEPTestMonitor::evalLogZ(int r) const
+  {
+    double inp[2],ret[2],logz;
+
+    inp[0]=predMeans[r]; inp[1]=predVars[r];
+    if (inp[1]<=0.0 ||
+	!testPots->getPot(r).compMoments(inp,ret,&logz) ||
+	1.0-ret[1]*inp[1]<1e-9)
+      return 0.0;
+
+    return logz;
+  }
+//ENDNS
@@ -0,0 +1,173 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class FactEPTestMonitor
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_FACTEPTESTMONITOR_H
+#define EPTOOLS_FACTEPTESTMONITOR_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+#include "src/eptools/potentials/PotentialManager.h"
+
+//BEGINNS(eptools)
+  /**
+   * Keeps test set predictions of EP with factorized backbone in sync with
+   * the variable marginals during training. The test set is given by a
+   * coupling factor B_p (p rows) and a potential manager (univariate
+   * potentials t_r(s_r), r=0:(p-1)). Under the factorized posterior
+   * q(x) = prod_i N(x_i|mu_i,rho_i), the Gaussian predictive moments are
+   *
+   *   h_r = sum_i b_ri mu_i,  rho_r = sum_i b_ri^2 rho_i,
+   *
+   * and log Z_r, the log normalization constant of t_r(s) N(s|h_r,rho_r),
+   * is the predictive log likelihood (see 'EPScalarPotential::compMoments').
+   * If target values y_r are given, a prediction is correct if
+   * sign(h_r)==y_r (binary classification).
+   * <p>
+   * 'update' compares new marginals against the snapshot (mu_i, rho_i)
+   * used for the current predictions. Variable i is propagated only if
+   * the relative change in mean or stddev. is larger than 'tol' (same
+   * statistic as 'delta' in 'FactorizedEPDriver::sequentialUpdate'). Its
+   * changes are added to h_r, rho_r for r in V_i (column i of B_p), and
+   * log Z_r and the statistics are recomputed for these r only. The cost
+   * is linear in the number of nonzeros of B_p in propagated columns.
+   * Since changes below 'tol' are not dropped, but accumulated until they
+   * exceed 'tol', the predictions never lag behind by more than 'tol'.
+   * Rounding errors do accumulate, 'reset' recomputes everything from
+   * scratch.
+   * <p>
+   * Internal representation:
+   * As in 'FactorizedEPRepresentation', arrays are passed from outside
+   * and referred to, so that the state can be kept between calls of a
+   * (stateless) wrapper function. Only the column index of B_p is needed
+   * (see 'FactorizedEPRepresentation' for 'colInd', 'bmatVals'). The
+   * state consists of:
+   * - 'margMeans', 'margVars': Snapshot mu_i, rho_i [n]
+   * - 'predMeans', 'predVars', 'predLogZ': h_r, rho_r, log Z_r [p]. If
+   *   the local computation fails for r, log Z_r = 0
+   * - 'predStats': Number of correct predictions, sum of log Z_r [2]
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class FactEPTestMonitor
+  {
+  protected:
+    // Members
+
+    int numN,numP;
+    ArrayHandle<int> colInd;
+    ArrayHandle<double> bmatVals;
+    Handle<PotentialManager> testPots;
+    ArrayHandle<double> targets;
+    ArrayHandle<double> margMeans,margVars;
+    ArrayHandle<double> predMeans,predVars,predLogZ;
+    ArrayHandle<double> predStats;
+
+  public:
+    // Public methods
+
+    /**
+     * Constructor. Arrays are not copied, but referred to. The state is
+     * not initialized here, use 'reset' if it is not valid.
+     *
+     * @param pnumN      Number of variables n
+     * @param pnumP      Number of test points p
+     * @param pcolInd    Column index of B_p
+     * @param pbmatVals  Nonzeros of B_p
+     * @param ptestPots  Test potentials (size p, 'atypeUnivariate')
+     * @param ptargets   Targets y_r (size p), or empty (no accuracy)
+     * @param pmargMeans State (see header comment)
+     * @param pmargVars  "
+     * @param ppredMeans "
+     * @param ppredVars  "
+     * @param ppredLogZ  "
+     * @param ppredStats "
+     */
+    FactEPTestMonitor(int pnumN,int pnumP,const ArrayHandle<int>& pcolInd,
+		      const ArrayHandle<double>& pbmatVals,
+		      const Handle<PotentialManager>& ptestPots,
+		      const ArrayHandle<double>& ptargets,
+		      const ArrayHandle<double>& pmargMeans,
+		      const ArrayHandle<double>& pmargVars,
+		      const ArrayHandle<double>& ppredMeans,
+		      const ArrayHandle<double>& ppredVars,
+		      const ArrayHandle<double>& ppredLogZ,
+		      const ArrayHandle<double>& ppredStats);
+
+    virtual ~FactEPTestMonitor() {}
+
+    int numVariables() const {
+      return numN;
+    }
+
+    int numTestPoints() const {
+      return numP;
+    }
+
+    /**
+     * Recomputes the state from scratch, given marginals in 'margBeta',
+     * 'margPi' (natural parameters, as in 'FactorizedEPDriver').
+     *
+     * @param margBeta Marginal pars. beta
+     * @param margPi   Marginal pars. pi
+     */
+    virtual void reset(const double* margBeta,const double* margPi);
+
+    /**
+     * Incremental update of the state, given new marginals. See header
+     * comment.
+     *
+     * @param margBeta Marginal pars. beta
+     * @param margPi   Marginal pars. pi
+     * @param tol      Tolerance for propagating a variable. Nonnegative
+     * @param nrows    Number of test points recomputed ret. here. Optional
+     * @return         Number of variables propagated
+     */
+    virtual int update(const double* margBeta,const double* margPi,
+		       double tol,int* nrows=0);
+
+    /**
+     * @return Test set accuracy (fraction of correct predictions)
+     */
+    double accuracy() const {
+      return predStats[0]/((double) numP);
+    }
+
+    /**
+     * @return Test set average log likelihood
+     */
+    double avgLogLik() const {
+      return predStats[1]/((double) numP);
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * @param r Test point
+     * @return  log Z_r for current h_r, rho_r (0 if computation fails)
+     */
+    double evalLogZ(int r) const;
+
+    /**
+     * @param r Test point
+     * @return  Is prediction for r correct (current h_r)?
+     */
+    bool isCorrect(int r) const {
+      double h=predMeans[r];
+
+      return (targets.size()>0 &&
+	      ((h>0.0)?1.0:((h<0.0)?-1.0:0.0))==targets[r]);
+    }
+  };
+//ENDNS
+
+#endif
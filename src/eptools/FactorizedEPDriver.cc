@@ -7,6 +7,9 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/FactorizedEPDriver.h"
+#include "src/eptools/ThreadPool.h"
+#include <pthread.h>
+#include <vector>
 
 //BEGINNS(eptools)
   const int FactorizedEPDriver::updSuccess;
@@ -14,4 +17,294 @@
   const int FactorizedEPDriver::updNumericalError;
   const int FactorizedEPDriver::updMarginalsInvalid;
   const int FactorizedEPDriver::updCavCondSkipped;
+  const int FactorizedEPDriver::defRowParThres;
+  const int FactorizedEPDriver::maxRowThreads;
+  const int FactorizedEPDriver::rowPhaseCavity;
+  const int FactorizedEPDriver::rowPhaseUndamped;
+  const int FactorizedEPDriver::rowPhaseDamped;
+  const int FactorizedEPDriver::rowPhaseCommit;
+
+  /*
+   * Guards temporary changes of 'epMaxPi' in 'rowPhaseUndamped' (if
+   * kappa_i==pi_ji), when done by several threads.
+   */
+  static pthread_mutex_t rowMaxMutex=PTHREAD_MUTEX_INITIALIZER;
+
+  int FactorizedEPDriver::compLogMarginal(double& logz,double* dpvec)
+  {
+    int i,ii,j,k,vjSz,nskip=0,numN=numVariables(),numM=numPotentials(),
+      numK=epRepr->numPrecVariables();
+    double cPi,cBeta,cH,cRho,cA,cC,bval,temp,lzj,thres2=0.5*piMinThres;
+    double inp[4],ret[4];
+    const int* vjInd;
+    const double* bP,*mBetaP=margBeta.p(),*mPiP=margPi.p();
+    double* betaP,*piP,*aP,*cP,*dpotP;
+    ArrayHandle<double> dpot;
+    bool isBVPrec;
+
+    if (dpvec!=0)
+      std::fill(dpvec,dpvec+epPots->parVecSize(),0.0);
+    // Marginal terms
+    for (i=0,logz=0.0; i<numN; i++)
+      logz+=logPartGauss(mBetaP[i],mPiP[i]);
+    for (k=0; k<numK; k++)
+      logz+=logPartGamma(margA[k],margC[k]);
+    // Potential terms
+    for (j=0; j<numM; j++) {
+      const EPScalarPotential& pot=epPots->getPot(j);
+      isBVPrec=(pot.getArgumentGroup()==EPScalarPotential::atypeBivarPrec);
+      epRepr->accessRow(j,vjSz,vjInd,bP,betaP,piP);
+      cH=cRho=lzj=0.0;
+      for (ii=0; ii<vjSz; ii++) {
+	i=vjInd[ii];
+	if ((cPi=mPiP[i]-piP[ii])<thres2)
+	  break; // Cavity invalid
+	cBeta=mBetaP[i]-betaP[ii];
+	bval=bP[ii]; temp=bval/cPi;
+	cRho+=bval*temp;
+	cH+=temp*cBeta;
+	lzj+=logPartGauss(cBeta,cPi)-logPartGauss(mBetaP[i],mPiP[i]);
+      }
+      if (ii<vjSz) {
+	nskip++; continue;
+      }
+      inp[0]=cH; inp[1]=cRho;
+      if (isBVPrec) {
+	k=epRepr->accessTauRow(j,aP,cP);
+	if ((cA=margA[k]-(*aP))<0.5*aMinThres ||
+	    (cC=margC[k]-(*cP))<0.5*cMinThres) {
+	  nskip++; continue;
+	}
+	inp[2]=cA; inp[3]=cC;
+	lzj+=logPartGamma(cA,cC)-logPartGamma(margA[k],margC[k]);
+      }
+      dpotP=0;
+      if (dpvec!=0 && pot.numPars()>0) {
+	if (dpot.size()<pot.numPars()) {
+	  MemTagScope mtag(EPMemoryTags::tagScratch);
+	  dpot.changeRep(pot.numPars());
+	}
+	dpotP=dpot.p();
+      }
+      if (!pot.compMomentsDerivs(inp,ret,&temp,dpotP)) {
+	nskip++; continue;
+      }
+      logz+=(lzj+temp);
+      if (dpotP!=0)
+	epPots->addParGradient(j,dpotP,dpvec);
+    }
+
+    return nskip;
+  }
+  /*
+   * Reduction body for 'runRowPhaseParallel'. Each chunk of V_j writes
+   * its partial result to 'chunkRes'. 'join' combines them in chunk
+   * order, stopping at the first chunk which failed.
+   */
+  class FactorizedEPDriver::RowPhaseBody : public ReduceBody
+  {
+  public:
+    FactorizedEPDriver* drv;
+    const RowUpdateCtx* ctx;
+    int phase;
+    RowPhaseRes* res;
+    std::vector<RowPhaseRes> chunkRes;
+
+    virtual void prepare(int nchunk) {
+      chunkRes.resize(nchunk);
+      res->stat=updSuccess;
+      res->sum[0]=res->sum[1]=res->sum[2]=res->sum[3]=res->eta=0.0;
+    }
+
+    virtual void run(int chunk,int beg,int end) {
+      drv->rowPhase(phase,*ctx,beg,end,false,chunkRes[chunk]);
+    }
+
+    virtual void join(int chunk) {
+      const RowPhaseRes& cres=chunkRes[chunk];
+
+      if (res->stat!=updSuccess) return;
+      if (cres.stat!=updSuccess) {
+	res->stat=cres.stat; return;
+      }
+      res->sum[0]+=cres.sum[0]; res->sum[1]+=cres.sum[1];
+      res->sum[2]+=cres.sum[2]; res->sum[3]+=cres.sum[3];
+      res->eta=std::max(res->eta,cres.eta);
+    }
+  };
+
+  /*
+   * Loops of 'sequentialUpdate' over V_j, see comments there. Different
+   * positions in V_j are independent, except for the reductions.
+   * 'epMaxPi' is changed only temporarily here (if kappa_i==pi_ji), which
+   * is guarded by 'rowMaxMutex' if called by several threads
+   * ('verbose'==false).
+   */
+  void FactorizedEPDriver::rowPhase(int phase,const RowUpdateCtx& ctx,
+				    int lo,int hi,bool verbose,
+				    RowPhaseRes& res)
+  {
+    int i,ii,j=ctx.j;
+    double temp,temp2,bval,cPi,cBeta,pi,beta,tilPi,tilBeta,prPi,prBeta,kappa,
+      eta,thres2=0.5*piMinThres,nu=ctx.nu,alpha=ctx.alpha,
+      dampFact=ctx.dampFact;
+    const int* vjInd=ctx.vjInd;
+    const double* bP=ctx.bP;
+    double* betaP=ctx.betaP,*piP=ctx.piP,*cBetaP=ctx.cBetaP,*cPiP=ctx.cPiP,
+      *mprBetaP=ctx.mprBetaP,*mprPiP=ctx.mprPiP,*mBetaP=ctx.mBetaP,
+      *mPiP=ctx.mPiP;
+    char debMsg[200];
+
+    res.stat=updSuccess;
+    res.sum[0]=res.sum[1]=res.sum[2]=res.sum[3]=res.eta=0.0;
+    switch (phase) {
+    case rowPhaseCavity:
+      // 'sum': cH, cRho, mH, mRho
+      for (ii=lo; ii<hi; ii++) {
+	i=vjInd[ii];
+	if ((cPiP[ii]=cPi=mPiP[i]-piP[ii])<thres2) {
+	  res.stat=updCavityInvalid; return;
+	}
+	cBetaP[ii]=cBeta=mBetaP[i]-betaP[ii];
+	bval=bP[ii]; temp=bval/cPi;
+	res.sum[1]+=bval*temp;
+	res.sum[0]+=temp*cBeta;
+	temp=bval/mPiP[i];
+	res.sum[3]+=bval*temp;
+	res.sum[2]+=temp*mBetaP[i];
+      }
+      break;
+    case rowPhaseUndamped:
+      for (ii=lo; ii<hi; ii++) {
+	// Undamped EP update
+	i=vjInd[ii];
+	bval=bP[ii]; // b_{ji}
+	pi=piP[ii]; // pi_{ji}
+	cPi=cPiP[ii]; cBeta=cBetaP[ii]; // pi_{-ji}, beta_{-ji}
+	// 'tilPi', 'tilBeta': tilde{pi}_{ji}, tilde{beta}_{ji}, EP updates
+	// without damping
+	if (fabs(bval)>1e-6) {
+	  // |b_ji| large enough: Simpler equations
+	  // 'temp2' is pi_{-ji}/b_ji. 'temp' is (pi_ji)'/(pi_{-ji} nu_j)
+	  temp2=cPi/bval;
+	  if ((temp=temp2/bval-nu)<1e-10) {
+	    if (verbose) {
+	      sprintf(debMsg,
+		      "UUPS: j=%d, alpha=%f, nu=%f\n"
+		      "      b=%f, denom=%f",j,alpha,nu,bval,temp);
+	      printMsgStdout(debMsg);
+	    }
+	    res.stat=updNumericalError; return; // EP update failed
+	  }
+	  temp=1.0/temp; // e_ji
+	  tilPi=temp*cPi*nu;
+	  tilBeta=temp*(cBeta*nu+temp2*alpha);
+	} else {
+	  // Very small but non-zero |b_ji| (will probably never happen)
+	  // 'temp' is b_ji / (pi_{-ji} - b_ji^2 nu_j)
+	  if ((temp=cPi-nu*bval*bval)<1e-10) {
+	    res.stat=updNumericalError; return; // EP update failed
+	  }
+	  temp=bval/temp;
+	  tilPi=temp*bval*nu*cPi;
+	  tilBeta=temp*(cBeta*bval*nu+cPi*alpha);
+	}
+	mprPiP[ii]=tilPi; mprBetaP[ii]=tilBeta; // Intermed. storage
+	if (!(epMaxPi==0) && tilPi<pi) {
+	  // Selective damping to ensure that pi_{-ki} >= eps for all k,i
+	  kappa=epMaxPi->getMaxValue(i); // kappa_i
+	  if (kappa<=0.0) {
+	    if (verbose) {
+	      sprintf(debMsg,"ERROR(maxPi,j=%d,i=%d): kappa_i=%f (negative)",
+		      j,i,kappa);
+	      printMsgStdout(debMsg);
+	    }
+	    res.stat=updNumericalError; return;
+	  }
+	  // Value for eta:
+	  eta=1.0-std::min((mPiP[i]-kappa-piMinThres)/(pi-tilPi),1.0);
+	  if (eta>=0.98) {
+	    // EP update has to be skipped
+	    res.stat=updCavCondSkipped; return;
+	  }
+	  if (kappa==pi) {
+	    // This should not happen often. Have to ensure that new kappa_i
+	    // is positive. If this is not the case, the update is skipped.
+	    // ATTENTION: If this case happens frequently, have to choose
+	    // better response, f.ex. increasing 'eta' in small steps.
+	    prPi=eta*pi+(1.0-eta)*tilPi; // pi_{ji}' for current 'eta'
+	    if (!verbose) pthread_mutex_lock(&rowMaxMutex);
+	    piP[ii]=prPi;
+	    epMaxPi->update(i,j,prPi);
+	    kappa=epMaxPi->getMaxValue(i); // kappa_i'
+	    piP[ii]=pi; // Back to old state
+	    epMaxPi->update(i,j,pi);
+	    if (!verbose) pthread_mutex_unlock(&rowMaxMutex);
+	    if (kappa<=0.0) {
+	      // Assuming this case almost never happens, we just skip the
+	      // update
+	      if (verbose)
+		printMsgStdout("UUPS(pi selective damping; skipping update due to negative kappa)");
+	      res.stat=updCavCondSkipped; return;
+	    }
+	  }
+	  res.eta=std::max(res.eta,eta);
+	}
+      }
+      break;
+    case rowPhaseDamped:
+      for (ii=lo; ii<hi; ii++) {
+	pi=piP[ii]; beta=betaP[ii]; // Current parameters
+	cPi=cPiP[ii]; cBeta=cBetaP[ii]; // Cavity
+	prPi=mprPiP[ii]; prBeta=mprBetaP[ii]; // Undamped update
+	// Damping
+	if (dampFact>0.0) {
+	  prPi+=dampFact*(pi-prPi);
+	  prBeta+=dampFact*(beta-prBeta);
+	}
+	// New marginals (overwrite 'mprXXP') and EP parameters (overwrite
+	// 'cXXP')
+	if ((mprPiP[ii]=cPi+prPi)<thres2) {
+	  res.stat=updMarginalsInvalid; return; // EP update failed
+	}
+	mprBetaP[ii]=cBeta+prBeta;
+	cPiP[ii]=prPi; cBetaP[ii]=prBeta; // New EP parameters
+      }
+      break;
+    case rowPhaseCommit:
+      // 'sum': mprH, mprRho
+      for (ii=lo; ii<hi; ii++) {
+	i=vjInd[ii];
+	betaP[ii]=cBetaP[ii]; piP[ii]=cPiP[ii]; // New EP pars
+	mBetaP[i]=mprBetaP[ii]; mPiP[i]=mprPiP[ii]; // New marginals
+	// For '*delta':
+	bval=bP[ii]; temp=bval/mprPiP[ii];
+	res.sum[1]+=bval*temp;
+	res.sum[0]+=temp*mprBetaP[ii];
+      }
+      break;
+    default:
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    }
+  }
+
+  /*
+   * V_j is split into 'rowThreads' contiguous chunks (the last one may be
+   * smaller), which are run on the thread pool. A failure is reported for
+   * the first chunk (in order) which failed, which is the status for the
+   * first failing position, as without threads.
+   */
+  int FactorizedEPDriver::runRowPhaseParallel(int phase,
+					      const RowUpdateCtx& ctx,
+					      RowPhaseRes& res)
+  {
+    RowPhaseBody body;
+    TraceScope trace("rowPhase","row",phase);
+
+    body.drv=this; body.ctx=&ctx; body.phase=phase; body.res=&res;
+    ThreadPool::parallelReduce(ctx.vjSz,body,
+			       (ctx.vjSz+rowThreads-1)/rowThreads);
+
+    return res.stat;
+  }
 //ENDNS
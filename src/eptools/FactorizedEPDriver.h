@@ -14,10 +14,14 @@
 #endif
 
 #include "src/eptools/potentials/PotentialManager.h"
+#include "src/eptools/potentials/SpecfunServices.h"
 #include "src/eptools/FactorizedEPRepresentation.h"
 #include "src/eptools/FactEPMaximumPiValues.h"
 #include "src/eptools/FactEPMaximumAValues.h"
 #include "src/eptools/FactEPMaximumCValues.h"
+#include "src/eptools/LocalUpdateCache.h"
+#include "src/eptools/TraceServices.h"
+#include "src/eptools/EPMemoryTags.h"
 
 //BEGINNS(eptools)
 #define MAXRELDIFF(a,b) (fabs((a)-(b))/std::max(fabs(a),std::max(fabs(b),1e-8)))
@@ -76,6 +80,30 @@
    * is skipped.
    * Same for a's (c's) with 'aMinThres' ('cMinThres') respectively. We
    * use the smallest damping factor s.t. all constraints are fulfilled.
+   * <p>
+   * Intra-row parallelism:
+   * The loops over V_j in 'sequentialUpdate' are split into four phases
+   * (see 'rowPhase'): cavity (sum reduction for cavity and marginal
+   * moments on s_j), undamped update (with max reduction for the pi
+   * selective damping factor), damped update (check of new marginals),
+   * write-back (sum reduction for '*delta'). The local EP update and
+   * everything w.r.t. tau_k is done in between, by the calling thread.
+   * If 'setRowParallel' has been called with 'nthr'>1, each phase for a
+   * row with |V_j| >= 'thres' is split into 'nthr' contiguous chunks of
+   * V_j, which are run on the thread pool ('ThreadPool', which should
+   * have 'nthr' threads). Rows should be long enough (default
+   * 'defRowParThres') for this to pay off. Results are the same as
+   * without threads, up to the summation order of the reductions, and
+   * debug messages are not printed for such rows. The potentials
+   * themselves are only accessed by the calling thread. 'epMaxPi' is
+   * updated by the calling thread after the write-back.
+   * <p>
+   * Local update cache:
+   * If a 'LocalUpdateCache' is set ('setUpdateCache'), results of
+   * 'EPScalarPotential::compMoments' are looked up there before calling
+   * it, and stored afterwards. The cache must have 4 arguments iff there
+   * are bivariate precision potentials (for univariate potentials, a, c
+   * are passed as 0 then).
    *
    * @author  Matthias Seeger
    * @version %I% %G%
@@ -91,7 +119,45 @@
     static const int updMarginalsInvalid=3;
     static const int updCavCondSkipped  =4;
 
+    static const int defRowParThres=32768;
+    static const int maxRowThreads =64;
+
   protected:
+    // Internal types
+
+    /*
+     * Row being updated in 'sequentialUpdate', passed to 'rowPhase'.
+     * Arrays as in 'sequentialUpdate'. 'alpha', 'nu' are the results of
+     * the local EP update.
+     */
+    struct RowUpdateCtx
+    {
+      int j,vjSz;
+      const int* vjInd;
+      const double* bP;
+      double* betaP,*piP,*cBetaP,*cPiP,*mprBetaP,*mprPiP,*mBetaP,*mPiP;
+      double alpha,nu,dampFact;
+    };
+
+    /*
+     * Result of a phase on a chunk of V_j. 'stat' is the status for the
+     * first failing position in the chunk (the chunk is not completed
+     * then). 'sum', 'eta' for the reductions.
+     */
+    struct RowPhaseRes
+    {
+      int stat;
+      double sum[4];
+      double eta;
+    };
+
+    class RowPhaseBody; // Used by 'runRowPhaseParallel' (defined in .cc)
+
+    static const int rowPhaseCavity  =0;
+    static const int rowPhaseUndamped=1;
+    static const int rowPhaseDamped  =2;
+    static const int rowPhaseCommit  =3;
+
     // Members
 
     Handle<PotentialManager> epPots;       // Potential manager
@@ -104,6 +170,8 @@
     Handle<FactEPMaximumAValues> epMaxA;
     Handle<FactEPMaximumCValues> epMaxC;
     ArrayHandle<double> buffVec;
+    int rowThreads,rowParThres;            // Intra-row parallelism
+    Handle<LocalUpdateCache> updCache;     // Optional
 
   public:
     // Public methods
@@ -126,7 +194,8 @@
 		       const Handle<FactEPMaximumPiValues>& pepMaxPi=
 		       HandleZero<FactEPMaximumPiValues>::get()) :
       epPots(pepPots),epRepr(pepRepr),margBeta(pmargBeta),margPi(pmargPi),
-      piMinThres(ppiMinThres),epMaxPi(pepMaxPi),aMinThres(0.0),cMinThres(0.0) {
+      piMinThres(ppiMinThres),epMaxPi(pepMaxPi),aMinThres(0.0),cMinThres(0.0),
+      rowThreads(1),rowParThres(defRowParThres) {
       int numN=pepRepr->numVariables();
 
       if (ppiMinThres<=0.0 || pmargBeta.size()!=numN || pmargPi.size()!=numN)
@@ -169,7 +238,7 @@
       epPots(pepPots),epRepr(pepRepr),margBeta(pmargBeta),margPi(pmargPi),
       piMinThres(ppiMinThres),epMaxPi(pepMaxPi),aMinThres(paMinThres),
       cMinThres(pcMinThres),margA(pmargA),margC(pmargC),epMaxA(pepMaxA),
-      epMaxC(pepMaxC) {
+      epMaxC(pepMaxC),rowThreads(1),rowParThres(defRowParThres) {
       int numN=pepRepr->numVariables(),numK=pepRepr->numPrecVariables();
 
       if (ppiMinThres<=0.0 || numK<=0 || pmargBeta.size()!=numN ||
@@ -227,6 +296,46 @@
       return margC;
     }
 
+    /**
+     * Activates intra-row parallelism (see header comment): rows with
+     * |V_j| >= 'thres' are split into 'nthr' chunks, run on the thread
+     * pool. 'nthr'==1 switches it off (default).
+     *
+     * @param nthr  Number of chunks (<= 'maxRowThreads')
+     * @param thres Threshold on |V_j|. Def.: 'defRowParThres'
+     */
+    void setRowParallel(int nthr,int thres=defRowParThres) {
+      if (nthr<1 || nthr>maxRowThreads || thres<1)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      rowThreads=nthr; rowParThres=thres;
+    }
+
+    int getRowThreads() const {
+      return rowThreads;
+    }
+
+    int getRowParThres() const {
+      return rowParThres;
+    }
+
+    /**
+     * Sets cache for local EP updates (see header comment). Pass zero
+     * handle to remove it.
+     *
+     * @param pcache Cache
+     */
+    void setUpdateCache(const Handle<LocalUpdateCache>& pcache) {
+      if (!(pcache==0) &&
+	  (pcache->numPotentials()!=epRepr->numPotentials() ||
+	   pcache->numArguments()!=((epRepr->numPrecVariables()>0)?4:2)))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      updCache=pcache;
+    }
+
+    const Handle<LocalUpdateCache>& getUpdateCache() const {
+      return updCache;
+    }
+
     /**
      * Runs sequential EP update on potential t_j(.). See header comment.
      * If selective damping is active ('epMaxXXX'!=0), the effective damping
@@ -244,6 +353,101 @@
      */
     virtual int sequentialUpdate(int j,double dampFact=0.0,double* delta=0,
 				 double* effDamp=0);
+
+    /**
+     * Computes the EP approximation log Z_EP to the log marginal likelihood
+     * in one pass over all potentials, using the current EP parameters and
+     * marginals (typically after convergence). Cavity marginals are
+     * determined as in 'sequentialUpdate'.
+     * If 'dpvec' is given, the gradient of log Z_EP w.r.t. the flat
+     * parameter vector of 'epPots' is written there (size
+     * 'epPots->parVecSize()'). This is valid at an EP fixed point only,
+     * where it is the sum of the gradients of log Z_j w.r.t. the parameters
+     * of t_j, for fixed cavities (see
+     * 'EPScalarPotential::compMomentsDerivs'). It requires all potentials
+     * with parameters to support these derivatives.
+     * <p>
+     * We use
+     *   log Z_EP = sum_j ( log Z_j + sum_{i in V_j} (G_{-ji} - G_i) )
+     *              + sum_i G_i,
+     * where G(beta,pi) = log int exp(beta x - pi x^2/2) d x, G_i for the
+     * marginal, G_{-ji} for the cavity. For bivariate precision potentials,
+     * there are corr. terms with H(a,c) = log Gamma(a) - a log c for the
+     * Gamma marginals and cavities on tau_k. This corresponds to the
+     * improper prior tau_k^{-1} implied by a_k = sum_j a_jk.
+     * <p>
+     * Potentials for which the cavity is invalid (see 'sequentialUpdate')
+     * or the local computation fails are skipped (no contribution to log
+     * Z_EP or the gradient). Their number is returned.
+     *
+     * @param logz  log Z_EP ret. here
+     * @param dpvec Gradient ret. here. Optional
+     * @return      Number of skipped potentials
+     */
+    virtual int compLogMarginal(double& logz,double* dpvec=0);
+
+  protected:
+    // Internal methods
+
+    /**
+     * Runs phase 'phase' of 'sequentialUpdate' on V_j positions
+     * 'lo':('hi'-1) of row 'ctx':
+     * - rowPhaseCavity:   Cavities (to 'cXXP'); 'sum' gets partial sums
+     *                     for cH, cRho, mH, mRho
+     * - rowPhaseUndamped: Undamped EP parameters (to 'mprXXP'); 'eta'
+     *                     gets max. selective damping factor for pi (0 if
+     *                     not active)
+     * - rowPhaseDamped:   Damped EP parameters (to 'cXXP'), new marginals
+     *                     (to 'mprXXP'), using 'ctx.dampFact'
+     * - rowPhaseCommit:   Write back EP parameters and marginals (not
+     *                     'epMaxPi'); 'sum' gets partial sums for mprH,
+     *                     mprRho
+     * Debug messages are printed iff 'verbose'.
+     *
+     * @param phase   Phase
+     * @param ctx     Row
+     * @param lo      S.a.
+     * @param hi      S.a.
+     * @param verbose S.a.
+     * @param res     Result ret. here
+     */
+    void rowPhase(int phase,const RowUpdateCtx& ctx,int lo,int hi,
+		  bool verbose,RowPhaseRes& res);
+
+    /**
+     * Runs phase 'phase' on all of V_j, by several threads if intra-row
+     * parallelism applies to this row (see header comment). Partial
+     * results are combined in chunk order.
+     *
+     * @param phase Phase
+     * @param ctx   Row
+     * @param res   Result ret. here
+     * @return      'res.stat'
+     */
+    int runRowPhase(int phase,const RowUpdateCtx& ctx,RowPhaseRes& res) {
+      if (rowThreads<=1 || ctx.vjSz<rowParThres) {
+	rowPhase(phase,ctx,0,ctx.vjSz,true,res);
+	return res.stat;
+      }
+      return runRowPhaseParallel(phase,ctx,res);
+    }
+
+    int runRowPhaseParallel(int phase,const RowUpdateCtx& ctx,
+			    RowPhaseRes& res);
+
+    /**
+     * @return G(beta,pi) = log int exp(beta x - pi x^2/2) d x
+     */
+    static double logPartGauss(double beta,double pi) {
+      return 0.5*(beta*beta/pi-log(pi)+SpecfunServices::m_ln2pi);
+    }
+
+    /**
+     * @return H(a,c) = log int tau^(a-1) exp(-c tau) d tau
+     */
+    static double logPartGamma(double a,double c) {
+      return SpecfunServices::logGamma(a)-a*log(c);
+    }
   };
 
   // Inline methods
@@ -258,26 +462,27 @@
    * - mprXXP: First updated EP pars (without damping), then
    *           new XX_i, marginals
    * Required, because an update can be skipped until the very end.
+   * The loops over V_j are done in 'rowPhase'.
    */
   inline int FactorizedEPDriver::sequentialUpdate(int j,double dampFact,
 						  double* delta,double* effDamp)
   {
-    int i,ii,vjSz,k=0;
-    double temp,temp2,cH,cRho,bval,nu,alpha,cPi,cBeta,pi,beta,tilPi,tilBeta,
-      prPi,prBeta,kappa,thres2=0.5*piMinThres,mH,mRho,cA=0.0,cC=0.0,hatA,hatC,
-      prA,prC,mnTau=0.0,stdTau=0.0,eta;
-    const int* vjInd;
-    const double* bP;
-    double* betaP,*piP,*cBetaP,*cPiP,*mBetaP,*mPiP,*mprBetaP,*mprPiP,*aP,*cP;
+    int ii,vjSz,k=0,stat;
+    double temp,temp2,cH,cRho,mH,mRho,cA=0.0,cC=0.0,hatA,hatC,prA,prC,
+      mnTau=0.0,stdTau=0.0,kappa,eta;
+    double* aP,*cP;
     double inp[4],ret[4];
     bool isBVPrec=(epPots->getPot(j).getArgumentGroup()==
-		   EPScalarPotential::atypeBivarPrec);
+		   EPScalarPotential::atypeBivarPrec),succ;
     char debMsg[200]; // DEBUG!
+    RowUpdateCtx ctx;
+    RowPhaseRes res;
 
     if (dampFact<0.0 || dampFact>=1.0)
       throw InvalidParameterException(EXCEPT_MSG(""));
     // Access to data for j. Temporary arrays
-    epRepr->accessRow(j,vjSz,vjInd,bP,betaP,piP);
+    epRepr->accessRow(j,vjSz,ctx.vjInd,ctx.bP,ctx.betaP,ctx.piP);
+    ctx.j=j; ctx.vjSz=vjSz;
     if (isBVPrec) {
       // 'k' is k(j). 'aP', 'cP' point to message parameters
       // a_{j k}, c_{j k} (read and write access). Note that different to x,
@@ -286,27 +491,19 @@
       mnTau=margA[k]/margC[k]; // For '*delta' below
       stdTau=sqrt(margA[k])/margC[k];
     }
-    mBetaP=margBeta.p(); mPiP=margPi.p();
-    if (buffVec.size()<4*vjSz)
+    ctx.mBetaP=margBeta.p(); ctx.mPiP=margPi.p();
+    if (buffVec.size()<4*vjSz) {
+      MemTagScope mtag(EPMemoryTags::tagScratch);
       buffVec.changeRep(4*vjSz);
-    cBetaP=buffVec.p(); cPiP=cBetaP+vjSz;
-    mprBetaP=cPiP+vjSz; mprPiP=mprBetaP+vjSz;
+    }
+    ctx.cBetaP=buffVec.p(); ctx.cPiP=ctx.cBetaP+vjSz;
+    ctx.mprBetaP=ctx.cPiP+vjSz; ctx.mprPiP=ctx.mprBetaP+vjSz;
     // Compute cavity marginals
     // The marginal moments on s_j ('mH', 'mRho') are required to compute
     // '*delta' below
-    cH=cRho=mH=mRho=0.0;
-    for (ii=0; ii<vjSz; ii++) {
-      i=vjInd[ii];
-      if ((cPiP[ii]=cPi=mPiP[i]-piP[ii])<thres2)
-	return updCavityInvalid; // EP update failed
-      cBetaP[ii]=cBeta=mBetaP[i]-betaP[ii];
-      bval=bP[ii]; temp=bval/cPi;
-      cRho+=bval*temp;
-      cH+=temp*cBeta;
-      temp=bval/mPiP[i];
-      mRho+=bval*temp;
-      mH+=temp*mBetaP[i];
-    }
+    if ((stat=runRowPhase(rowPhaseCavity,ctx,res))!=updSuccess)
+      return stat; // EP update failed
+    cH=res.sum[0]; cRho=res.sum[1]; mH=res.sum[2]; mRho=res.sum[3];
     if (isBVPrec) {
       if ((cA=margA[k]-(*aP))<0.5*aMinThres)
 	return updCavityInvalid; // EP update failed
@@ -315,10 +512,15 @@
     }
     // Local EP update
     inp[0]=cH; inp[1]=cRho;
-    if (isBVPrec) {
-      inp[2]=cA; inp[3]=cC;
+    inp[2]=cA; inp[3]=cC; // 0 if not 'isBVPrec'
+    if (updCache==0 || !(succ=updCache->lookup(j,inp,ret))) {
+      // Traced by potential type (sampled)
+      const EPScalarPotential& pot=epPots->getPot(j);
+      TraceScope trace(typeid(pot),"potential",j,true);
+      if ((succ=pot.compMoments(inp,ret)) && !(updCache==0))
+	updCache->store(j,inp,ret);
     }
-    if (!epPots->getPot(j).compMoments(inp,ret)) {
+    if (!succ) {
       // DEBUG:
       if (!isBVPrec)
 	sprintf(debMsg,"UUPS: j=%d, cH=%f,cRho=%f",j,cH,cRho);
@@ -328,7 +530,7 @@
       printMsgStdout(debMsg);
       return updNumericalError; // EP update failed
     }
-    alpha=ret[0]; nu=ret[1];
+    ctx.alpha=ret[0]; ctx.nu=ret[1];
     if (isBVPrec) {
       // New marginal a, c parameters (without damping)
       hatA=ret[2]; hatC=ret[3];
@@ -336,76 +538,11 @@
     // Compute new EP parameters without damping (to 'mprXXP'). If
     // selective damping is active, we also determine the effective damping
     // factor (overwrites 'dampFact')
-    for (ii=0; ii<vjSz; ii++) {
-      // Undamped EP update
-      i=vjInd[ii];
-      bval=bP[ii]; // b_{ji}
-      pi=piP[ii]; beta=betaP[ii]; // pi_{ji}, beta_{ji}
-      cPi=cPiP[ii]; cBeta=cBetaP[ii]; // pi_{-ji}, beta_{-ji}
-      // 'tilPi', 'tilBeta': tilde{pi}_{ji}, tilde{beta}_{ji}, EP updates
-      // without damping
-      if (fabs(bval)>1e-6) {
-	// |b_ji| large enough: Simpler equations
-	// 'temp2' is pi_{-ji}/b_ji. 'temp' is (pi_ji)'/(pi_{-ji} nu_j)
-	temp2=cPi/bval;
-	if ((temp=temp2/bval-nu)<1e-10) {
-	  // DEBUG
-	  sprintf(debMsg,
-		  "UUPS: j=%d, cH=%f, cRho=%f, alpha=%f, nu=%f\n"
-		  "      b=%f, denom=%f",j,cH,cRho,alpha,nu,bval,temp);
-	  printMsgStdout(debMsg);
-	  return updNumericalError; // EP update failed
-	}
-	temp=1.0/temp; // e_ji
-	tilPi=temp*cPi*nu;
-	tilBeta=temp*(cBeta*nu+temp2*alpha);
-      } else {
-	// Very small but non-zero |b_ji| (will probably never happen)
-	// 'temp' is b_ji / (pi_{-ji} - b_ji^2 nu_j)
-	if ((temp=cPi-nu*bval*bval)<1e-10)
-	  return updNumericalError; // EP update failed
-	temp=bval/temp;
-	tilPi=temp*bval*nu*cPi;
-	tilBeta=temp*(cBeta*bval*nu+cPi*alpha);
-      }
-      mprPiP[ii]=tilPi; mprBetaP[ii]=tilBeta; // Intermed. storage
-      if (!(epMaxPi==0) && tilPi<pi) {
-	// Selective damping to ensure that pi_{-ki} >= eps for all k,i
-	kappa=epMaxPi->getMaxValue(i); // kappa_i
-	if (kappa<=0.0) {
-	  sprintf(debMsg,"ERROR(maxPi,j=%d,i=%d): kappa_i=%f (negative)",j,i,
-		  kappa);
-	  printMsgStdout(debMsg);
-	  return updNumericalError;
-	}
-	// Value for eta:
-	eta=1.0-std::min((mPiP[i]-kappa-piMinThres)/(pi-tilPi),1.0);
-	if (eta>=0.98) {
-	  // EP update has to be skipped
-	  if (effDamp!=0) *effDamp=1.0;
-	  return updCavCondSkipped;
-	}
-	if (kappa==pi) {
-	  // This should not happen often. Have to ensure that new kappa_i is
-	  // positive. If this is not the case, the update is skipped.
-	  // ATTENTION: If this case happens frequently, have to choose better
-	  // response, f.ex. increasing 'eta' in small steps.
-	  prPi=eta*pi+(1.0-eta)*tilPi; // pi_{ji}' for current 'eta'
-	  piP[ii]=prPi;
-	  epMaxPi->update(i,j,prPi);
-	  kappa=epMaxPi->getMaxValue(i); // kappa_i'
-	  piP[ii]=pi; // Back to old state
-	  epMaxPi->update(i,j,pi);
-	  if (kappa<=0.0) {
-	    // Assuming this case almost never happens, we just skip the update
-	    printMsgStdout("UUPS(pi selective damping; skipping update due to negative kappa)");
-	    if (effDamp!=0) *effDamp=1.0;
-	    return updCavCondSkipped;
-	  }
-	}
-	dampFact=std::max(dampFact,eta);
-      }
+    if ((stat=runRowPhase(rowPhaseUndamped,ctx,res))!=updSuccess) {
+      if (stat==updCavCondSkipped && effDamp!=0) *effDamp=1.0;
+      return stat; // EP update failed
     }
+    dampFact=std::max(dampFact,res.eta);
     if (isBVPrec) {
       // Selective damping
       prA=hatA-cA; prC=hatC-cC;
@@ -480,22 +617,9 @@
     // Determine new EP parameters with damping (overwrite 'cXXP') and
     // new marginals (to 'mprXXP'). This is done because the update can
     // still fail ('updMarginalsInvalid')
-    for (ii=0; ii<vjSz; ii++) {
-      pi=piP[ii]; beta=betaP[ii]; // Current parameters
-      cPi=cPiP[ii]; cBeta=cBetaP[ii]; // Cavity
-      prPi=mprPiP[ii]; prBeta=mprBetaP[ii]; // Undamped update
-      // Damping
-      if (dampFact>0.0) {
-	prPi+=dampFact*(pi-prPi);
-	prBeta+=dampFact*(beta-prBeta);
-      }
-      // New marginals (overwrite 'mprXXP') and EP parameters (overwrite
-      // 'cXXP')
-      if ((mprPiP[ii]=cPi+prPi)<thres2)
-	return updMarginalsInvalid; // EP update failed
-      mprBetaP[ii]=cBeta+prBeta;
-      cPiP[ii]=prPi; cBetaP[ii]=prBeta; // New EP parameters
-    }
+    ctx.dampFact=dampFact;
+    if ((stat=runRowPhase(rowPhaseDamped,ctx,res))!=updSuccess)
+      return stat; // EP update failed
     // New EP parameters and marginals for Gamma parameters: Write back
     if (isBVPrec) {
       prA=hatA-cA; prC=hatC-cC;
@@ -513,21 +637,13 @@
 	epMaxC->update(k,j,prC);
     }
     // Update succeeded: Write back new EP parameters and marginals
-    double mprH=0.0,mprRho=0.0; // For '*delta'
-    for (ii=0; ii<vjSz; ii++) {
-      i=vjInd[ii];
-      betaP[ii]=cBetaP[ii]; piP[ii]=cPiP[ii]; // New EP pars
-      mBetaP[i]=mprBetaP[ii]; mPiP[i]=mprPiP[ii]; // New marginals
-      // For '*delta':
-      bval=bP[ii]; temp=bval/mprPiP[ii];
-      mprRho+=bval*temp;
-      mprH+=temp*mprBetaP[ii];
-      if (!(epMaxPi==0))
-	epMaxPi->update(i,j,piP[ii]); // Update max-pi object
-    }
+    runRowPhase(rowPhaseCommit,ctx,res);
+    if (!(epMaxPi==0))
+      for (ii=0; ii<vjSz; ii++)
+	epMaxPi->update(ctx.vjInd[ii],j,ctx.piP[ii]); // Update max-pi object
     if (delta!=0) {
-      mRho=sqrt(mRho); mprRho=sqrt(mprRho);
-      *delta=std::max(MAXRELDIFF(mH,mprH),MAXRELDIFF(mRho,mprRho));
+      mRho=sqrt(mRho); temp=sqrt(res.sum[1]); // mprRho
+      *delta=std::max(MAXRELDIFF(mH,res.sum[0]),MAXRELDIFF(mRho,temp));
       if (isBVPrec) {
 	temp=margA[k]/margC[k]; temp2=sqrt(margA[k])/margC[k];
 	*delta=std::max(*delta,MAXRELDIFF(mnTau,temp));
@@ -15,6 +15,9 @@
 
 #include "src/eptools/default.h"
 #include "src/eptools/potentials/PotManagerFactory.h"
+#include "src/eptools/NumaServices.h"
+#include "src/eptools/ThreadPool.h"
+#include <vector>
 
 //BEGINNS(eptools)
   /**
@@ -230,6 +233,7 @@
     /**
      * Compute Gaussian marginals on variables from 'betaVals', 'piVals'.
      * If 'increm'==true, the marginals are added to 'margBeta', 'margPi'.
+     * Variables are processed in parallel (see 'ThreadPool').
      *
      * @param margBeta Marginal pars. beta ret. here
      * @param margPi   Marginal pars. pi ret. here
@@ -238,6 +242,18 @@
     virtual void compMarginals(double* margBeta,double* margPi,
 			       bool increm=false);
 
+    /**
+     * Same as 'compMarginals', but only for variables i in beg:(end-1).
+     *
+     * @param beg      Range start
+     * @param end      Range end (excl.)
+     * @param margBeta Marginal pars. beta ret. here
+     * @param margPi   Marginal pars. pi ret. here
+     * @param increm   Incremental?
+     */
+    virtual void compMarginalsRange(int beg,int end,double* margBeta,
+				    double* margPi,bool increm);
+
     /**
      * Only if bivar. prec. potentials.
      * Access to precision parameter data for potential j.
@@ -271,6 +287,7 @@
      * Compute parameters of Gamma marginals on [tau_k] from message
      * parameters 'aVals', 'cVals'.
      * If 'increm'==true, the marginals are added to 'margA', 'margC'.
+     * Variables are processed in parallel (see 'ThreadPool').
      *
      * @param margA  Marginal pars. a ret. here
      * @param margC  Marginal pars. c ret. here
@@ -278,7 +295,56 @@
      */
     virtual void compTauMarginals(double* margA,double* margC,
 				  bool increm=false);
-    
+
+    /**
+     * Same as 'compTauMarginals', but only for k in beg:(end-1).
+     *
+     * @param beg    Range start
+     * @param end    Range end (excl.)
+     * @param margA  Marginal pars. a ret. here
+     * @param margC  Marginal pars. c ret. here
+     * @param increm Incremental?
+     */
+    virtual void compTauMarginalsRange(int beg,int end,double* margA,
+				       double* margC,bool increm);
+
+    /**
+     * NUMA placement (see 'NumaServices'). Potentials are partitioned
+     * into 'nblk' row blocks of (almost) equal size, block b being
+     * j = floor(b m/nblk):(floor((b+1) m/nblk)-1). Row-wise arrays
+     * ('bmatVals', EP parameters, support indexes V_j in 'rowInd') are
+     * placed blockwise, block b on node 'nodes[b]'. 'colInd' is accessed
+     * by variable, it is interleaved over 'nodes'.
+     *
+     * @param nblk  Number of row blocks
+     * @param nodes NUMA nodes
+     * @return      Success?
+     */
+    virtual bool numaPlace(int nblk,const int* nodes);
+  };
+
+  /**
+   * Loop body for 'FactorizedEPRepresentation::compMarginals' (or
+   * 'compTauMarginals' if 'tau'==true), see 'ThreadPool'.
+   */
+  class FactEPMarginalsLoop : public LoopBody
+  {
+  protected:
+    FactorizedEPRepresentation& repr;
+    double* marg1,*marg2;
+    bool tau,increm;
+
+  public:
+    FactEPMarginalsLoop(FactorizedEPRepresentation& prepr,double* pmarg1,
+			double* pmarg2,bool ptau,bool pincrem) :
+      repr(prepr),marg1(pmarg1),marg2(pmarg2),tau(ptau),increm(pincrem) {}
+
+    virtual void run(int beg,int end) {
+      if (!tau)
+	repr.compMarginalsRange(beg,end,marg1,marg2,increm);
+      else
+	repr.compTauMarginalsRange(beg,end,marg1,marg2,increm);
+    }
   };
 
   // Inline methods
@@ -351,13 +417,23 @@
   inline void
   FactorizedEPRepresentation::compMarginals(double* margBeta,double* margPi,
 					    bool increm)
+  {
+    FactEPMarginalsLoop body(*this,margBeta,margPi,false,increm);
+
+    ThreadPool::parallelFor(numVariables(),body);
+  }
+
+  inline void
+  FactorizedEPRepresentation::compMarginalsRange(int beg,int end,
+						 double* margBeta,
+						 double* margPi,bool increm)
   {
     int i,j,jj,viSz;
     double mBeta,mPi;
     const double* bP,*betaP,*piP;
     const int* viInd,*jiInd;
 
-    for (i=0; i<numVariables(); i++) {
+    for (i=beg; i<end; i++) {
       viSz=accessCol(i,viInd,jiInd,bP,betaP,piP);
       for (j=0,mBeta=mPi=0.0; j<viSz; j++) {
 	jj=jiInd[j];
@@ -384,6 +460,38 @@
     return tauInd[j];
   }
 
+  inline bool
+  FactorizedEPRepresentation::numaPlace(int nblk,const int* nodes)
+  {
+    int b,j,startPos=numM-aVals.size();
+    bool ret;
+    std::vector<size_t> boff(nblk+1),boffI(nblk+1),boffT(nblk+1);
+
+    if (nblk<1) throw InvalidParameterException(EXCEPT_MSG(""));
+    for (b=0; b<=nblk; b++) {
+      j=(int) (((double) b)*numM/nblk);
+      boff[b]=rowInd[j];
+      boffI[b]=(b<nblk)?(rowInd[j]+numM+1)*sizeof(int):
+	rowInd.size()*sizeof(int);
+      boffT[b]=std::max(j-startPos,0)*sizeof(double);
+    }
+    boffI[0]=0;
+    ret=NumaServices::placeBlocks(rowInd.p(),&boffI[0],nodes,nblk);
+    for (b=0; b<=nblk; b++)
+      boff[b]*=sizeof(double);
+    ret&=NumaServices::placeBlocks(bmatVals.p(),&boff[0],nodes,nblk);
+    ret&=NumaServices::placeBlocks(betaVals.p(),&boff[0],nodes,nblk);
+    ret&=NumaServices::placeBlocks(piVals.p(),&boff[0],nodes,nblk);
+    if (numK>0) {
+      ret&=NumaServices::placeBlocks(aVals.p(),&boffT[0],nodes,nblk);
+      ret&=NumaServices::placeBlocks(cVals.p(),&boffT[0],nodes,nblk);
+    }
+    ret&=NumaServices::placeInterleaved(colInd.p(),colInd.size()*sizeof(int),
+					nodes,nblk);
+
+    return ret;
+  }
+
   inline int
   FactorizedEPRepresentation::accessTauCol(int k,const int*& jInd,
 					   const double*& aP,const double*& cP)
@@ -402,13 +510,23 @@
   inline void
   FactorizedEPRepresentation::compTauMarginals(double* margA,double* margC,
 					       bool increm)
+  {
+    FactEPMarginalsLoop body(*this,margA,margC,true,increm);
+
+    ThreadPool::parallelFor(numK,body);
+  }
+
+  inline void
+  FactorizedEPRepresentation::compTauMarginalsRange(int beg,int end,
+						    double* margA,
+						    double* margC,bool increm)
   {
     int k,j,jj,sz;
     double mA,mC;
     const double* aP,*cP;
     const int* jInd;
 
-    for (k=0; k<numK; k++) {
+    for (k=beg; k<end; k++) {
       sz=accessTauCol(k,jInd,aP,cP);
       for (j=0,mA=mC=0.0; j<sz; j++) {
 	jj=jInd[j];
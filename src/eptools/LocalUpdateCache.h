@@ -0,0 +1,188 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class LocalUpdateCache
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_LOCALUPDATECACHE_H
+#define EPTOOLS_LOCALUPDATECACHE_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+#include "src/eptools/EPMemoryTags.h"
+
+//BEGINNS(eptools)
+  /**
+   * Cache for results of local EP updates
+   * ('EPScalarPotential::compMoments'), one entry per potential j. The
+   * entry stores the last cavity passed for t_j, together with the
+   * results. Late in EP convergence, most cavities hardly change between
+   * sweeps, and the cached results can be reused instead of recomputing
+   * them (quadrature potentials are expensive).
+   * <p>
+   * An entry consists of 'numInp' cavity arguments, followed by 'numInp'
+   * results, in the layout of 'compMoments':
+   * - 'numInp'==2: (h, rho), (alpha, nu)
+   * - 'numInp'==4: (h, rho, a, c), (alpha, nu, hat{a}, hat{c}) (bivariate
+   *   precision potentials)
+   * An entry with rho <= 0 is empty (so a zero-initialized buffer is an
+   * empty cache). A cavity hits entry j if
+   *   |h - h_j| <= relTol sqrt(rho_j),  |rho - rho_j| <= relTol rho_j,
+   * and the same as for rho for a, c. For 'relTol'==0, cavities must be
+   * equal, and results are the same as without cache.
+   * <p>
+   * The buffers can be passed at construction (f.ex., owned by Matlab or
+   * Python code, which keeps them between calls). 'counts' maintains
+   * numbers of hits (first half) and misses (second half) for each j.
+   * NOTE: Entries depend on the potential parameters. If these change,
+   * the cache has to be cleared ('clear').
+   * <p>
+   * Different entries can be accessed by different threads concurrently
+   * (as in 'ParallelFactEPDriver', where an update list contains every j
+   * at most once per batch).
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class LocalUpdateCache
+  {
+  protected:
+    // Members
+
+    int numPots,numInp;
+    double relTol;
+    ArrayHandle<double> entries; // Size 2*'numInp'*'numPots'
+    ArrayHandle<int> counts;     // Size 2*'numPots'
+
+  public:
+    // Public methods
+
+    /**
+     * Constructor. If 'pentries' is not given, buffers are allocated and
+     * the cache is empty. Otherwise, 'pentries', 'pcounts' must have the
+     * correct sizes (see header comment), their content is used.
+     *
+     * @param pnumPots Number of potentials
+     * @param pnumInp  Number of cavity arguments (2 or 4)
+     * @param prelTol  Relative tolerance (nonneg.)
+     * @param pentries Entries. Optional
+     * @param pcounts  Hit and miss counts. Optional
+     */
+    LocalUpdateCache(int pnumPots,int pnumInp,double prelTol,
+		     const ArrayHandle<double>& pentries=
+		     ArrayHandleZero<double>::get(),
+		     const ArrayHandle<int>& pcounts=
+		     ArrayHandleZero<int>::get()) :
+      numPots(pnumPots),numInp(pnumInp),relTol(prelTol),entries(pentries),
+      counts(pcounts) {
+      if (pnumPots<1 || (pnumInp!=2 && pnumInp!=4) || prelTol<0.0)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      if (pentries.size()==0) {
+	MemTagScope mtag(EPMemoryTags::tagMessages);
+	entries.changeRep(2*pnumInp*pnumPots);
+	counts.changeRep(2*pnumPots);
+	clear();
+      } else if (pentries.size()!=2*pnumInp*pnumPots ||
+		 pcounts.size()!=2*pnumPots)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+    }
+
+    int numPotentials() const {
+      return numPots;
+    }
+
+    int numArguments() const {
+      return numInp;
+    }
+
+    double getRelTol() const {
+      return relTol;
+    }
+
+    /**
+     * Looks up cavity 'inp' for potential j. On a hit, the cached results
+     * are written to 'ret'. Hit or miss is counted.
+     *
+     * @param j   Potential index
+     * @param inp Cavity arguments
+     * @param ret Results ret. here (hit)
+     * @return    Hit?
+     */
+    bool lookup(int j,const double* inp,double* ret);
+
+    /**
+     * Stores cavity 'inp' and results 'ret' for potential j.
+     *
+     * @param j   Potential index
+     * @param inp Cavity arguments
+     * @param ret Results
+     */
+    void store(int j,const double* inp,const double* ret) {
+      double* eP=entries.p()+2*numInp*j;
+      int k;
+
+      if (j<0 || j>=numPots)
+	throw OutOfRangeException(EXCEPT_MSG(""));
+      for (k=0; k<numInp; k++) {
+	eP[k]=inp[k]; eP[k+numInp]=ret[k];
+      }
+    }
+
+    /**
+     * Removes all entries and resets the counts.
+     */
+    void clear() {
+      std::fill(entries.p(),entries.p()+entries.size(),0.0);
+      std::fill(counts.p(),counts.p()+counts.size(),0);
+    }
+
+    int numHits(int j) const {
+      if (j<0 || j>=numPots)
+	throw OutOfRangeException(EXCEPT_MSG(""));
+      return counts[j];
+    }
+
+    int numMisses(int j) const {
+      if (j<0 || j>=numPots)
+	throw OutOfRangeException(EXCEPT_MSG(""));
+      return counts[j+numPots];
+    }
+  };
+
+  // Inline methods
+
+  inline bool LocalUpdateCache::lookup(int j,const double* inp,double* ret)
+  {
+    const double* eP=entries.p()+2*numInp*j;
+    int k;
+    bool hit;
+
+    if (j<0 || j>=numPots)
+      throw OutOfRangeException(EXCEPT_MSG(""));
+    if ((hit=(eP[1]>0.0))) {
+      if (relTol==0.0) {
+	for (k=0; k<numInp && hit; k++)
+	  hit=(inp[k]==eP[k]);
+      } else {
+	hit=(fabs(inp[0]-eP[0])<=relTol*sqrt(eP[1]));
+	for (k=1; k<numInp && hit; k++)
+	  hit=(fabs(inp[k]-eP[k])<=relTol*eP[k]);
+      }
+    }
+    if (hit) {
+      for (k=0; k<numInp; k++)
+	ret[k]=eP[k+numInp];
+      counts[j]++;
+    } else
+      counts[j+numPots]++;
+
+    return hit;
+  }
+//ENDNS
+
+#endif
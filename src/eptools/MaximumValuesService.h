@@ -14,6 +14,10 @@
 #endif
 
 #include <algorithm>
+#include <vector>
+#include <utility>
+#include "src/eptools/NumaServices.h"
+#include "src/eptools/ThreadPool.h"
 
 //BEGINNS(eptools)
   /**
@@ -52,15 +56,26 @@
    * If 'subInd' is given, max_j x_ji does not run over all j. If
    * 'subExcl'==false, max_j runs over 'subInd'. If 'subExcl'==true, max_j
    * runs over the complement of 'subInd'. 'subInd' must be sorted in
-   * ascending order.
-   * NOTE: Involves binary search over 'subInd' for every 'update' and
-   * 'recompute' call, so choose 'subExcl' to keep 'subInd' small.
+   * ascending order. Membership is tested with a bitmap over 0:(m-1),
+   * built by the constructor.
+   * <p>
+   * Recomputing all top-K lists ('recompute()') is done in parallel over
+   * variables. For K>='selectMinSize', the top K values x_ji for each i
+   * are found by partial selection ('recomputeSelect'). For smaller K,
+   * inserting entries one by one into the sorted list ('recompute(i)') is
+   * faster. Ties are broken in favour of smaller j, so both give the same
+   * result.
    *
    * @author  Matthias Seeger
    * @version %I% %G%
    */
   class MaximumValuesService
   {
+  public:
+    // Constants
+
+    static const int selectMinSize=48;
+
   protected:
     // Members
 
@@ -70,6 +85,7 @@
     ArrayHandle<double> topVal;
     ArrayHandle<int> subInd;
     bool subExcl;
+    ArrayHandle<unsigned int> subMask; // Bitmap for 'subInd' (size m)
     int statNUpd,statNRec;
 
   public:
@@ -111,6 +127,10 @@
 	  throw InvalidParameterException(EXCEPT_MSG("psubInd: Out of range"));
 	if ((!psubExcl && sz<pmaxSize) || (psubExcl && pm-sz<pmaxSize))
 	  throw InvalidParameterException(EXCEPT_MSG("psubInd: Too small"));
+	subMask.changeRep((pm+31)/32);
+	std::fill(subMask.p(),subMask.p()+subMask.size(),0U);
+	for (int k=0; k<sz; k++)
+	  subMask[psubInd[k]>>5]|=(1U<<(psubInd[k]&31));
       }
       resetStats();
     }
@@ -157,9 +177,25 @@
      */
     virtual void recompute(int i);
 
-    virtual void recompute() {
-      for (int i=0; i<numVariables(); i++)
-	recompute(i);
+    /**
+     * Recompute all top-K lists. Variables are processed in parallel (see
+     * 'ThreadPool'), so 'getFactorValues' must be thread-safe (if
+     * 'numValid[i]'==0 for some i, the exception thrown is
+     * 'NumericalException' in this case).
+     */
+    virtual void recompute();
+
+    /**
+     * Recompute top-K list for variable i by partial selection (see
+     * header comment). Same result as 'recompute(i)', faster for large K.
+     *
+     * @param i    Variable index
+     * @param buff Scratch buffer (entries (x_ji,j))
+     */
+    void recomputeSelect(int i,std::vector<std::pair<double,int> >& buff);
+
+    int getMaxSize() const {
+      return maxSize;
     }
 
     /**
@@ -197,9 +233,42 @@
       statNUpd=statNRec=0;
     }
 
+    /**
+     * Interleaves the top-K arrays over NUMA nodes 'nodes' (see
+     * 'NumaServices'). They are accessed by variable i, which has no
+     * relation to row blocks of B.
+     *
+     * @param nodes  NUMA nodes
+     * @param nnodes Number of entries in 'nodes'
+     * @return       Success?
+     */
+    virtual bool numaInterleave(const int* nodes,int nnodes) {
+      bool ret;
+
+      ret=NumaServices::placeInterleaved(numValid.p(),
+					 numValid.size()*sizeof(int),nodes,
+					 nnodes);
+      ret&=NumaServices::placeInterleaved(topInd.p(),topInd.size()*sizeof(int),
+					  nodes,nnodes);
+      ret&=NumaServices::placeInterleaved(topVal.p(),
+					  topVal.size()*sizeof(double),nodes,
+					  nnodes);
+
+      return ret;
+    }
+
   protected:
     // Helper methods
 
+    /**
+     * @param j Factor index
+     * @return  Does max_j run over j (see 'subInd')?
+     */
+    bool isIncluded(int j) const {
+      return (subMask==0 ||
+	      (((subMask[j>>5]>>(j&31))&1U)!=0)!=subExcl);
+    }
+
     /**
      * Insert entry (val,j) into top-K list for i. Assumes that j is not
      * in 'topInd' for i, and that j is not excluded by 'subInd'.
@@ -216,8 +285,51 @@
     bool removeEntry(int i,int j);
   };
 
+  /**
+   * Loop body for 'MaximumValuesService::recompute', see 'ThreadPool'.
+   */
+  class MaxValuesRecomputeLoop : public LoopBody
+  {
+  protected:
+    MaximumValuesService& serv;
+
+  public:
+    MaxValuesRecomputeLoop(MaximumValuesService& pserv) : serv(pserv) {}
+
+    virtual void run(int beg,int end) {
+      std::vector<std::pair<double,int> > buff;
+      bool select=(serv.getMaxSize()>=MaximumValuesService::selectMinSize);
+
+      for (int i=beg; i<end; i++) {
+	if (select)
+	  serv.recomputeSelect(i,buff);
+	else
+	  serv.recompute(i);
+      }
+    }
+  };
+
+  /**
+   * Order for top-K lists: descending in value, ascending in index for
+   * equal values.
+   */
+  struct MaxValuesEntryGreater
+  {
+    bool operator()(const std::pair<double,int>& a,
+		    const std::pair<double,int>& b) const {
+      return (a.first>b.first || (a.first==b.first && a.second<b.second));
+    }
+  };
+
   // Inline methods
 
+  inline void MaximumValuesService::recompute()
+  {
+    MaxValuesRecomputeLoop body(*this);
+
+    ThreadPool::parallelFor(numVariables(),body);
+  }
+
   inline void MaximumValuesService::recompute(int i)
   {
     int j,jj,k,viSz;
@@ -229,15 +341,61 @@
     for (k=0; k<viSz; k++) {
       jj=jiInd[k]; j=viInd[k];
       // Skip j if excluded by 'subInd'
-      if (!(subInd==0) &&
-	  std::binary_search(subInd.p(),subInd.p()+subInd.size(),j)==subExcl)
-	continue;
-      insertEntry(i,j,xP[jj]);
+      if (isIncluded(j))
+	insertEntry(i,j,xP[jj]);
     }
     if (numValid[i]==0)
       throw WrongStatusException(EXCEPT_MSG("Cannot have numValid[i]==0. Representation invalid now!"));
   }
 
+  /*
+   * Candidates are collected in 'buff'. Whenever it holds 2K entries, it
+   * is pruned to the top K (partial selection), and the smallest of them
+   * becomes a threshold: later entries not above it cannot enter the list
+   * (V_i is increasing, so they lose ties).
+   */
+  inline void MaximumValuesService::recomputeSelect(int i,std::vector<std::pair<double,int> >& buff)
+  {
+    int j,k,num,viSz;
+    double val,thres=0.0;
+    bool haveThres=false;
+    const double* xP;
+    const int* viInd,*jiInd;
+    int* tiP;
+    double* tvP;
+    MaxValuesEntryGreater comp;
+
+    viSz=getFactorValues(i,viInd,jiInd,xP);
+    buff.clear();
+    for (k=0; k<viSz; k++) {
+      j=viInd[k]; val=xP[jiInd[k]];
+      if ((haveThres && val<=thres) || !isIncluded(j))
+	continue;
+      buff.push_back(std::make_pair(val,j));
+      if ((int) buff.size()==2*maxSize) {
+	std::nth_element(buff.begin(),buff.begin()+(maxSize-1),buff.end(),
+			 comp);
+	buff.resize(maxSize);
+	thres=buff[maxSize-1].first; haveThres=true;
+      }
+    }
+    if ((num=buff.size())==0) {
+      numValid[i]=0;
+      throw WrongStatusException(EXCEPT_MSG("Cannot have numValid[i]==0. Representation invalid now!"));
+    }
+    if (num>maxSize) {
+      std::nth_element(buff.begin(),buff.begin()+maxSize,buff.end(),comp);
+      num=maxSize;
+    }
+    std::sort(buff.begin(),buff.begin()+num,comp);
+    k=i*(maxSize+1);
+    tiP=topInd.p()+k; tvP=topVal.p()+k;
+    for (k=0; k<num; k++) {
+      tvP[k]=buff[k].first; tiP[k]=buff[k].second;
+    }
+    numValid[i]=num;
+  }
+
   inline void MaximumValuesService::update(int i,int j,double val)
   {
     if (i<0 || j<0 || i>=numVariables() || j>=numFactors())
@@ -0,0 +1,208 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class NumaServices
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/NumaServices.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sched.h>
+#  include <dirent.h>
+#  include <sys/syscall.h>
+#  if defined(SYS_mbind) && defined(SYS_move_pages)
+#    define EPT_NUMA_SYSCALLS 1
+#  endif
+#endif
+
+//BEGINNS(eptools)
+  const int NumaServices::maxNodes;
+
+#ifdef EPT_NUMA_SYSCALLS
+  // From <linux/mempolicy.h>
+  static const int eptMpolPreferred =1;
+  static const int eptMpolInterleave=3;
+  static const int eptMpolMfMove    =(1<<1);
+  static const int eptMaskLongs=NumaServices::maxNodes/(8*sizeof(unsigned long));
+
+  /*
+   * Page-aligned range covering [p,p+nbytes). Returns the start address,
+   * the length is written to 'len'.
+   */
+  static inline char* eptPageRange(const void* p,size_t nbytes,size_t& len)
+  {
+    size_t psz=(size_t) sysconf(_SC_PAGESIZE);
+    size_t st=((size_t) p)&~(psz-1),en=((size_t) p)+nbytes;
+
+    len=((en-st+psz-1)/psz)*psz;
+    return (char*) st;
+  }
+
+  static inline bool eptMbind(const void* p,size_t nbytes,int mode,
+			      const unsigned long* mask)
+  {
+    size_t len;
+    char* st;
+
+    if (nbytes==0) return true;
+    st=eptPageRange(p,nbytes,len);
+    return (syscall(SYS_mbind,st,len,mode,mask,
+		    (unsigned long) (NumaServices::maxNodes+1),
+		    (unsigned) eptMpolMfMove)==0);
+  }
+#endif
+
+  int NumaServices::numNodes()
+  {
+#ifdef __linux__
+    int num=0,nd;
+    char dummy;
+    DIR* dir;
+    struct dirent* ent;
+
+    if ((dir=opendir("/sys/devices/system/node"))==0)
+      return 0;
+    while ((ent=readdir(dir))!=0)
+      if (sscanf(ent->d_name,"node%d%c",&nd,&dummy)==1)
+	num++;
+    closedir(dir);
+
+    return num;
+#else
+    return 0;
+#endif
+  }
+
+  int NumaServices::nodeOfCpu(int cpu)
+  {
+#ifdef __linux__
+    int nd,node=-1;
+    char buff[64],dummy;
+    DIR* dir;
+    struct dirent* ent;
+
+    if (cpu<0) return -1;
+    sprintf(buff,"/sys/devices/system/cpu/cpu%d",cpu);
+    if ((dir=opendir(buff))==0)
+      return -1;
+    while ((ent=readdir(dir))!=0)
+      if (sscanf(ent->d_name,"node%d%c",&nd,&dummy)==1) {
+	node=nd; break;
+      }
+    closedir(dir);
+
+    return node;
+#else
+    return -1;
+#endif
+  }
+
+  bool NumaServices::setThreadCpu(pthread_attr_t* attr,int cpu)
+  {
+#ifdef __linux__
+    cpu_set_t cset;
+
+    if (cpu<0 || cpu>=CPU_SETSIZE) return false;
+    CPU_ZERO(&cset); CPU_SET(cpu,&cset);
+    return (pthread_attr_setaffinity_np(attr,sizeof(cpu_set_t),&cset)==0);
+#else
+    return false;
+#endif
+  }
+
+  bool NumaServices::pinCurrentThread(int cpu)
+  {
+#ifdef __linux__
+    cpu_set_t cset;
+
+    if (cpu<0 || cpu>=CPU_SETSIZE) return false;
+    CPU_ZERO(&cset); CPU_SET(cpu,&cset);
+    return (pthread_setaffinity_np(pthread_self(),sizeof(cpu_set_t),
+				   &cset)==0);
+#else
+    return false;
+#endif
+  }
+
+  bool NumaServices::placeOnNode(const void* p,size_t nbytes,int node)
+  {
+#ifdef EPT_NUMA_SYSCALLS
+    unsigned long mask[eptMaskLongs];
+
+    if (node<0 || node>=maxNodes) return false;
+    std::fill(mask,mask+eptMaskLongs,0UL);
+    mask[node/(8*sizeof(unsigned long))]|=
+      1UL<<(node%(8*sizeof(unsigned long)));
+    return eptMbind(p,nbytes,eptMpolPreferred,mask);
+#else
+    return false;
+#endif
+  }
+
+  bool NumaServices::placeInterleaved(const void* p,size_t nbytes,
+				      const int* nodes,int nnodes)
+  {
+#ifdef EPT_NUMA_SYSCALLS
+    unsigned long mask[eptMaskLongs];
+    int i,node;
+
+    std::fill(mask,mask+eptMaskLongs,0UL);
+    for (i=0; i<nnodes; i++) {
+      if ((node=nodes[i])<0 || node>=maxNodes) return false;
+      mask[node/(8*sizeof(unsigned long))]|=
+	1UL<<(node%(8*sizeof(unsigned long)));
+    }
+    return (nnodes>0 && eptMbind(p,nbytes,eptMpolInterleave,mask));
+#else
+    return false;
+#endif
+  }
+
+  bool NumaServices::placeBlocks(const void* p,const size_t* boff,
+				 const int* nodes,int nblk)
+  {
+    bool ret=true;
+
+    for (int b=0; b<nblk; b++)
+      if (boff[b+1]>boff[b])
+	ret&=placeOnNode(((const char*) p)+boff[b],boff[b+1]-boff[b],
+			 nodes[b]);
+
+    return ret;
+  }
+
+  int NumaServices::numPages(const void* p,size_t nbytes)
+  {
+#ifdef __linux__
+    size_t psz=(size_t) sysconf(_SC_PAGESIZE);
+    size_t st=((size_t) p)&~(psz-1),en=((size_t) p)+nbytes;
+
+    return (nbytes==0)?0:((int) ((en-st+psz-1)/psz));
+#else
+    return 0;
+#endif
+  }
+
+  bool NumaServices::pageNodes(const void* p,size_t nbytes,int* nodes)
+  {
+#ifdef EPT_NUMA_SYSCALLS
+    int i,np=numPages(p,nbytes);
+    size_t psz=(size_t) sysconf(_SC_PAGESIZE),len;
+    std::vector<void*> pages(np);
+    char* st=eptPageRange(p,nbytes,len);
+
+    for (i=0; i<np; i++)
+      pages[i]=(void*) (st+i*psz);
+    return (np==0 ||
+	    syscall(SYS_move_pages,0,(unsigned long) np,&pages[0],0,nodes,
+		    0)==0);
+#else
+    return false;
+#endif
+  }
+//ENDNS
@@ -0,0 +1,138 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class NumaServices
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_NUMASERVICES_H
+#define EPTOOLS_NUMASERVICES_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+#include <pthread.h>
+
+//BEGINNS(eptools)
+  /**
+   * Services for NUMA-aware memory placement and thread affinity (static
+   * methods only).
+   * <p>
+   * Arrays used by EP drivers are allocated outside (Matlab, numpy), and
+   * are typically first-touched by a single thread, so they end up on one
+   * NUMA node. The placement methods here set a memory policy for an
+   * existing address range and migrate pages which are already placed
+   * ('mbind' with MPOL_MF_MOVE). Pages not touched yet are placed
+   * according to the policy on first touch. Partial pages at the ends of
+   * a range are included, so neighbouring ranges can compete for a page
+   * (the last call wins).
+   * NOTE: The policy stays with the address range. If the memory is freed
+   * and reused by the allocator, the policy still applies.
+   * <p>
+   * This is implemented for Linux, via system calls (no dependence on
+   * libnuma). Otherwise, or if a call fails (e.g., kernel without NUMA
+   * support), methods return false (or -1), and nothing is changed.
+   * Node numbers are obtained from /sys/devices/system.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class NumaServices
+  {
+  public:
+    // Constants
+
+    static const int maxNodes=1024;
+
+    // Public static methods
+
+    /**
+     * @return Number of NUMA nodes (0 if not available)
+     */
+    static int numNodes();
+
+    /**
+     * @param cpu CPU number
+     * @return    NUMA node of CPU 'cpu' (-1 if not available)
+     */
+    static int nodeOfCpu(int cpu);
+
+    /**
+     * Sets affinity of threads created with 'attr' to CPU 'cpu'.
+     *
+     * @param attr Thread attributes
+     * @param cpu  CPU number
+     * @return     Success?
+     */
+    static bool setThreadCpu(pthread_attr_t* attr,int cpu);
+
+    /**
+     * Pins the calling thread to CPU 'cpu'.
+     *
+     * @param cpu CPU number
+     * @return    Success?
+     */
+    static bool pinCurrentThread(int cpu);
+
+    /**
+     * Places address range [p,p+nbytes) on node 'node' (preferred).
+     *
+     * @param p      Start address
+     * @param nbytes Size (bytes)
+     * @param node   NUMA node
+     * @return       Success?
+     */
+    static bool placeOnNode(const void* p,size_t nbytes,int node);
+
+    /**
+     * Interleaves pages of address range [p,p+nbytes) over the nodes
+     * 'nodes[0:nnodes-1]' (duplicates are allowed).
+     *
+     * @param p      Start address
+     * @param nbytes Size (bytes)
+     * @param nodes  NUMA nodes
+     * @param nnodes Number of entries in 'nodes'
+     * @return       Success?
+     */
+    static bool placeInterleaved(const void* p,size_t nbytes,
+				 const int* nodes,int nnodes);
+
+    /**
+     * Block partition: the range [p,p+nbytes) is split at byte offsets
+     * 'boff[0:nblk]' ('boff[0]'==0, 'boff[nblk]'==nbytes), block b is
+     * placed on node 'nodes[b]'.
+     *
+     * @param p      Start address
+     * @param boff   Block offsets (bytes)
+     * @param nodes  NUMA nodes
+     * @param nblk   Number of blocks
+     * @return       Success?
+     */
+    static bool placeBlocks(const void* p,const size_t* boff,
+			    const int* nodes,int nblk);
+
+    /**
+     * @param p      Start address
+     * @param nbytes Size (bytes)
+     * @return       Number of pages covered by range [p,p+nbytes)
+     */
+    static int numPages(const void* p,size_t nbytes);
+
+    /**
+     * Determines the node of each page covered by [p,p+nbytes). 'nodes'
+     * must have size 'numPages(p,nbytes)'. For a page not yet placed, the
+     * entry is negative.
+     *
+     * @param p      Start address
+     * @param nbytes Size (bytes)
+     * @param nodes  Nodes ret. here
+     * @return       Success?
+     */
+    static bool pageNodes(const void* p,size_t nbytes,int* nodes);
+  };
+//ENDNS
+
+#endif
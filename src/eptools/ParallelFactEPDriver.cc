@@ -0,0 +1,575 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class ParallelFactEPDriver
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/ParallelFactEPDriver.h"
+#include "src/eptools/ThreadPool.h"
+
+//BEGINNS(eptools)
+#define MAXRELDIFF(a,b) (fabs((a)-(b))/std::max(fabs(a),std::max(fabs(b),1e-8)))
+
+  const int ParallelFactEPDriver::maxThreads;
+
+  /*
+   * Loop body over the workers of a batch, see 'runWorker'
+   */
+  class ParallelFactEPDriver::WorkerBody : public LoopBody
+  {
+  public:
+    ParallelFactEPDriver* drv;
+    int nthr;
+    double dampFact;
+
+    virtual void run(int beg,int end) {
+      for (int t=beg; t<end; t++)
+	drv->runWorker(t,nthr,dampFact);
+    }
+  };
+
+  /*
+   * Constraint h(e) >= thres, where h(e) is linear in the damping factor
+   * e, h(0)=='h0', h(1)=='h1'. Returns the smallest e in [0,1] for which
+   * the constraint holds (1 if there is none).
+   */
+  static inline double minDampFact(double h0,double h1,double thres)
+  {
+    if (h0>=thres) return 0.0;
+    if (h1<=h0) return 1.0;
+    return std::min((thres-h0)/(h1-h0),1.0);
+  }
+
+  ParallelFactEPDriver::ParallelFactEPDriver(const Handle<PotentialManager>& pepPots,
+					     const Handle<FactorizedEPRepresentation>& pepRepr,
+					     const ArrayHandle<double>& pmargBeta,
+					     const ArrayHandle<double>& pmargPi,
+					     const ArrayHandle<double>& pmargA,
+					     const ArrayHandle<double>& pmargC,
+					     double ppiMinThres,
+					     double paMinThres,
+					     double pcMinThres,
+					     const ArrayHandle<Handle<PotentialManager> >& pthrPots,
+					     double pdenseFrac,
+					     const Handle<FactEPMaximumPiValues>& pepMaxPi,
+					     const Handle<FactEPMaximumAValues>& pepMaxA,
+					     const Handle<FactEPMaximumCValues>& pepMaxC) :
+    FactorizedEPDriver(pepPots,pepRepr,pmargBeta,pmargPi,pmargA,pmargC,
+		       ppiMinThres,paMinThres,pcMinThres,pepMaxPi,pepMaxA,
+		       pepMaxC),denseFrac(pdenseFrac),curBatchSz(0)
+  {
+    int t,nthr=pthrPots.size(),numK=pepRepr->numPrecVariables();
+
+    if (nthr<1 || nthr>maxThreads || pdenseFrac<=0.0 || pdenseFrac>1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (t=0; t<nthr; t++)
+      if (pthrPots[t]==0 || pthrPots[t]->size()!=pepPots->size())
+	throw InvalidParameterException(EXCEPT_MSG("pthrPots: Must represent same potentials as pepPots"));
+    if (nthr>1 && !pepPots->isThreadSafe())
+      throw InvalidParameterException(EXCEPT_MSG("Potentials are not thread-safe"));
+    thrPots.copy(pthrPots);
+    MemTagScope mtag(EPMemoryTags::tagMessages);
+    kFirst.changeRep(numK); kDeltaA.changeRep(numK); kDeltaC.changeRep(numK);
+    std::fill(kFirst.p(),kFirst.p()+numK,-1);
+    pthread_mutex_init(&maxMutex,0);
+    pthread_mutex_init(&errMutex,0);
+  }
+
+  ParallelFactEPDriver::~ParallelFactEPDriver()
+  {
+    pthread_mutex_destroy(&errMutex);
+    pthread_mutex_destroy(&maxMutex);
+  }
+
+  void ParallelFactEPDriver::setAffinity(const ArrayHandle<int>& pthrCpus)
+  {
+    int t,nthr=numThreads();
+
+    if (pthrCpus.size()==0) {
+      thrCpus.changeRep(0);
+      return;
+    }
+    if (pthrCpus.size()!=nthr)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (t=0; t<nthr; t++)
+      if (pthrCpus[t]<0)
+	throw InvalidParameterException(EXCEPT_MSG("pthrCpus: Entries must be nonnegative"));
+    thrCpus.copy(pthrCpus);
+  }
+
+  bool ParallelFactEPDriver::numaPlace()
+  {
+    int t,nthr=numThreads();
+    ArrayHandle<int> nodes(nthr);
+    bool ret;
+
+    if (thrCpus.size()==0)
+      throw WrongStatusException(EXCEPT_MSG("Call 'setAffinity' first"));
+    for (t=0; t<nthr; t++)
+      if ((nodes[t]=NumaServices::nodeOfCpu(thrCpus[t]))<0)
+	return false;
+    ret=epRepr->numaPlace(nthr,nodes.p());
+    ret&=NumaServices::placeInterleaved(margBeta.p(),
+					margBeta.size()*sizeof(double),
+					nodes.p(),nthr);
+    ret&=NumaServices::placeInterleaved(margPi.p(),
+					margPi.size()*sizeof(double),
+					nodes.p(),nthr);
+    if (margA.size()>0) {
+      ret&=NumaServices::placeInterleaved(margA.p(),
+					  margA.size()*sizeof(double),
+					  nodes.p(),nthr);
+      ret&=NumaServices::placeInterleaved(margC.p(),
+					  margC.size()*sizeof(double),
+					  nodes.p(),nthr);
+    }
+    if (!(epMaxPi==0))
+      ret&=epMaxPi->numaInterleave(nodes.p(),nthr);
+    if (!(epMaxA==0))
+      ret&=epMaxA->numaInterleave(nodes.p(),nthr);
+    if (!(epMaxC==0))
+      ret&=epMaxC->numaInterleave(nodes.p(),nthr);
+
+    return ret;
+  }
+
+  /*
+   * Scheduling: 'level[pos]' is the batch of update 'jind[pos]', one plus
+   * the maximum batch of earlier updates on the same resources, which are
+   * the variables i in V_j and (if not dense) k(j). 'lastX', 'lastK' hold
+   * the last batch for each resource.
+   * The slots of a batch are in list order. Cavities, undamped EP
+   * parameters for slot s are in 'xBuff' from 'slots[s].xOff' onwards.
+   */
+  int ParallelFactEPDriver::parallelUpdates(int nupd,const int* jind,
+					    double dampFact,int* rstat,
+					    double* delta,double* effDamp)
+  {
+    int numN=epRepr->numVariables(),numK=epRepr->numPrecVariables();
+    int numM=epRepr->numPotentials(),startBV=numM-epRepr->numBVPrecPotentials();
+    int pos,ii,j,k,vjSz,lev,nlev=0,nbv=0,s,nb,b,xsz;
+    bool pinned=(thrCpus.size()>0);
+    const int* vjInd;
+    const double* bP;
+    double* betaP,*piP,*aP,*cP;
+
+    if (nupd<0 || (nupd>0 && (jind==0 || rstat==0)) || dampFact<0.0 ||
+	dampFact>=1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if (nupd==0) return 0;
+    TraceScope trace("parallelUpdates","sweep",nupd);
+    // Dense tau indices
+    ArrayHandle<int> kCnt(numK);
+    std::fill(kCnt.p(),kCnt.p()+numK,0);
+    for (pos=0; pos<nupd; pos++) {
+      if ((j=jind[pos])<0 || j>=numM)
+	throw InvalidParameterException(EXCEPT_MSG("jind: Entries out of range"));
+      if (j>=startBV) {
+	kCnt[epRepr->accessTauRow(j,aP,cP)]++; nbv++;
+      }
+    }
+    // Batches
+    ArrayHandle<int> level(nupd),lastX(numN),lastK(numK);
+    std::fill(lastX.p(),lastX.p()+numN,-1);
+    std::fill(lastK.p(),lastK.p()+numK,-1);
+    for (pos=0; pos<nupd; pos++) {
+      j=jind[pos];
+      epRepr->accessRow(j,vjSz,vjInd,bP,betaP,piP);
+      for (ii=0,lev=-1; ii<vjSz; ii++)
+	lev=std::max(lev,lastX[vjInd[ii]]);
+      k=-1;
+      if (j>=startBV) {
+	k=epRepr->accessTauRow(j,aP,cP);
+	if (kCnt[k]<2 || (double) kCnt[k]<=denseFrac*nbv)
+	  lev=std::max(lev,lastK[k]);
+	else
+	  k=-1; // Dense: Not in conflict graph
+      }
+      level[pos]=++lev;
+      for (ii=0; ii<vjSz; ii++)
+	lastX[vjInd[ii]]=lev;
+      if (k>=0) lastK[k]=lev;
+      nlev=std::max(nlev,lev+1);
+    }
+    // Order updates by batch (counting sort, stable)
+    ArrayHandle<int> bStart(nlev+1),bOrder(nupd);
+    std::fill(bStart.p(),bStart.p()+(nlev+1),0);
+    for (pos=0; pos<nupd; pos++)
+      bStart[level[pos]+1]++;
+    for (b=0; b<nlev; b++)
+      bStart[b+1]+=bStart[b];
+    for (pos=0; pos<nupd; pos++)
+      bOrder[bStart[level[pos]]++]=pos;
+    for (b=nlev; b>0; b--)
+      bStart[b]=bStart[b-1];
+    bStart[0]=0;
+    // Main loop over batches
+    WorkerBody body;
+    body.drv=this; body.dampFact=dampFact;
+    for (b=0; b<nlev; b++) {
+      // Set up slots
+      nb=bStart[b+1]-bStart[b];
+      TraceScope btrace("batch","batch",nb);
+      MemTagScope mtag(EPMemoryTags::tagScratch);
+      if (slots.size()<nb) slots.changeRep(nb);
+      for (s=xsz=0; s<nb; s++) {
+	BatchSlot& sl=slots[s];
+	sl.pos=pos=bOrder[bStart[b]+s];
+	sl.j=j=jind[pos];
+	sl.xOff=xsz;
+	epRepr->accessRow(j,vjSz,vjInd,bP,betaP,piP);
+	xsz+=4*vjSz;
+	sl.k=(j>=startBV)?epRepr->accessTauRow(j,aP,cP):-1;
+	sl.owner=pinned?rowOwner(j):-1;
+	sl.next=-1;
+      }
+      if (xBuff.size()<xsz) xBuff.changeRep(xsz);
+      curBatchSz=nb;
+      // Workers compute proposals, on the thread pool
+      body.nthr=pinned?numThreads():std::min(numThreads(),nb);
+      thrErrMsg.clear();
+      ThreadPool::parallelFor(body.nthr,body,1);
+      if (!thrErrMsg.empty())
+	throw NumericalException(EXCEPT_MSG(thrErrMsg.c_str()));
+      // Barrier: Merge updates on tau_k for each k touched by the batch.
+      // Slots are linked into per-k lists in list order
+      for (s=nb-1; s>=0; s--) {
+	BatchSlot& sl=slots[s];
+	if (sl.k>=0 && sl.stat==updSuccess) {
+	  sl.next=kFirst[sl.k]; kFirst[sl.k]=s;
+	}
+      }
+      for (s=0; s<nb; s++) {
+	k=slots[s].k;
+	if (k>=0 && kFirst[k]>=0) {
+	  mergeTauUpdates(k);
+	  kFirst[k]=-1;
+	}
+      }
+      // Write back updates on x
+      for (s=0; s<nb; s++) {
+	BatchSlot& sl=slots[s];
+	pos=sl.pos;
+	if (sl.stat==updSuccess && sl.k<0 && !checkMarginals(sl,sl.eta))
+	  sl.stat=updMarginalsInvalid;
+	if (sl.stat==updSuccess) {
+	  commitUpdate(sl,(delta!=0)?(delta+pos):0);
+	  if (effDamp!=0) effDamp[pos]=sl.eta;
+	} else {
+	  if (delta!=0) delta[pos]=0.0;
+	  if (effDamp!=0) effDamp[pos]=1.0;
+	}
+	rstat[pos]=sl.stat;
+      }
+    }
+    curBatchSz=0;
+
+    return nlev;
+  }
+
+  void ParallelFactEPDriver::runWorker(int tid,int nthr,double dampFact)
+  {
+    const PotentialManager& pots=*thrPots[tid];
+    bool blocks=(thrCpus.size()>0);
+    TraceScope trace("worker","batch",tid);
+
+    for (int s=blocks?0:tid; s<curBatchSz; s+=blocks?1:nthr) {
+      BatchSlot& sl=slots[s];
+      if (blocks && sl.owner!=tid) continue;
+      try {
+	sl.stat=proposeUpdate(pots,dampFact,sl,xBuff.p()+sl.xOff);
+      } catch (StandardException ex) {
+	sl.stat=updNumericalError;
+	pthread_mutex_lock(&errMutex);
+	if (thrErrMsg.empty()) thrErrMsg=ex.msg();
+	pthread_mutex_unlock(&errMutex);
+      } catch (...) {
+	sl.stat=updNumericalError;
+	pthread_mutex_lock(&errMutex);
+	if (thrErrMsg.empty())
+	  thrErrMsg="Unspecified exception in worker thread";
+	pthread_mutex_unlock(&errMutex);
+      }
+    }
+  }
+
+  /*
+   * Same as the first part of 'FactorizedEPDriver::sequentialUpdate', see
+   * comments there. 'xb' holds cavities pi_{-ji}, beta_{-ji}, then undamped
+   * updates tilde{pi}_{ji}, tilde{beta}_{ji}.
+   * 'epMaxPi' is only changed temporarily (if kappa_i==pi_ji), which is
+   * guarded by 'maxMutex'. Only this update touches V_j within the batch.
+   */
+  int ParallelFactEPDriver::proposeUpdate(const PotentialManager& pots,
+					  double dampFact,BatchSlot& sl,
+					  double* xb)
+  {
+    int i,ii,vjSz,j=sl.j,k=sl.k;
+    double temp,temp2,cH,cRho,bval,nu,alpha,cPi,cBeta,pi,tilPi,tilBeta,prPi,
+      kappa,thres2=0.5*piMinThres,cA=0.0,cC=0.0,eta;
+    const int* vjInd;
+    const double* bP;
+    double* betaP,*piP,*cBetaP,*cPiP,*tilBetaP,*tilPiP,*aP,*cP;
+    double inp[4],ret[4];
+    const double* mBetaP=margBeta.p(),*mPiP=margPi.p();
+    bool succ;
+
+    epRepr->accessRow(j,vjSz,vjInd,bP,betaP,piP);
+    cPiP=xb; cBetaP=xb+vjSz; tilPiP=cBetaP+vjSz; tilBetaP=tilPiP+vjSz;
+    if (k>=0) {
+      epRepr->accessTauRow(j,aP,cP);
+      sl.oldA=*aP; sl.oldC=*cP;
+      sl.mnTau=margA[k]/margC[k];
+      sl.stdTau=sqrt(margA[k])/margC[k];
+    }
+    sl.eta=dampFact;
+    // Cavity marginals
+    cH=cRho=sl.mH=sl.mRho=0.0;
+    for (ii=0; ii<vjSz; ii++) {
+      i=vjInd[ii];
+      if ((cPiP[ii]=cPi=mPiP[i]-piP[ii])<thres2)
+	return updCavityInvalid;
+      cBetaP[ii]=cBeta=mBetaP[i]-betaP[ii];
+      bval=bP[ii]; temp=bval/cPi;
+      cRho+=bval*temp;
+      cH+=temp*cBeta;
+      temp=bval/mPiP[i];
+      sl.mRho+=bval*temp;
+      sl.mH+=temp*mBetaP[i];
+    }
+    if (k>=0) {
+      if ((cA=margA[k]-sl.oldA)<0.5*aMinThres ||
+	  (cC=margC[k]-sl.oldC)<0.5*cMinThres)
+	return updCavityInvalid;
+    }
+    // Local EP update
+    inp[0]=cH; inp[1]=cRho;
+    inp[2]=cA; inp[3]=cC; // 0 if univariate
+    if (updCache==0 || !(succ=updCache->lookup(j,inp,ret))) {
+      const EPScalarPotential& pot=pots.getPot(j);
+      TraceScope trace(typeid(pot),"potential",j,true);
+      if ((succ=pot.compMoments(inp,ret)) && !(updCache==0))
+	updCache->store(j,inp,ret);
+    }
+    if (!succ)
+      return updNumericalError;
+    alpha=ret[0]; nu=ret[1];
+    if (k>=0) {
+      sl.prA=ret[2]-cA; sl.prC=ret[3]-cC;
+    }
+    // Undamped EP updates, selective damping factor for pi
+    for (ii=0; ii<vjSz; ii++) {
+      i=vjInd[ii];
+      bval=bP[ii]; pi=piP[ii];
+      cPi=cPiP[ii]; cBeta=cBetaP[ii];
+      if (fabs(bval)>1e-6) {
+	temp2=cPi/bval;
+	if ((temp=temp2/bval-nu)<1e-10)
+	  return updNumericalError;
+	temp=1.0/temp;
+	tilPi=temp*cPi*nu;
+	tilBeta=temp*(cBeta*nu+temp2*alpha);
+      } else {
+	if ((temp=cPi-nu*bval*bval)<1e-10)
+	  return updNumericalError;
+	temp=bval/temp;
+	tilPi=temp*bval*nu*cPi;
+	tilBeta=temp*(cBeta*bval*nu+cPi*alpha);
+      }
+      tilPiP[ii]=tilPi; tilBetaP[ii]=tilBeta;
+      if (!(epMaxPi==0) && tilPi<pi) {
+	if ((kappa=epMaxPi->getMaxValue(i))<=0.0)
+	  return updNumericalError;
+	eta=1.0-std::min((mPiP[i]-kappa-piMinThres)/(pi-tilPi),1.0);
+	if (eta>=0.98)
+	  return updCavCondSkipped;
+	if (kappa==pi) {
+	  // Ensure that new kappa_i is positive
+	  prPi=eta*pi+(1.0-eta)*tilPi;
+	  pthread_mutex_lock(&maxMutex);
+	  piP[ii]=prPi;
+	  epMaxPi->update(i,j,prPi);
+	  kappa=epMaxPi->getMaxValue(i);
+	  piP[ii]=pi;
+	  epMaxPi->update(i,j,pi);
+	  pthread_mutex_unlock(&maxMutex);
+	  if (kappa<=0.0)
+	    return updCavCondSkipped;
+	}
+	sl.eta=std::max(sl.eta,eta);
+      }
+    }
+
+    return updSuccess;
+  }
+
+  bool ParallelFactEPDriver::checkMarginals(const BatchSlot& sl,
+					    double eta) const
+  {
+    int ii,vjSz;
+    const int* vjInd;
+    const double* bP;
+    double* betaP,*piP;
+    const double* xb=xBuff.p()+sl.xOff;
+    double tilPi;
+
+    epRepr->accessRow(sl.j,vjSz,vjInd,bP,betaP,piP);
+    for (ii=0; ii<vjSz; ii++) {
+      tilPi=xb[2*vjSz+ii];
+      if (xb[ii]+tilPi+eta*(piP[ii]-tilPi)<0.5*piMinThres)
+	return false;
+    }
+
+    return true;
+  }
+
+  /*
+   * Constraints are linear in the common damping factor e (see
+   * 'minDampFact'), with e==1 corresponding to the state before the batch.
+   * With 'dA' the sum of undamped changes:
+   *   a_k(e) = a_k + (1-e) dA
+   * - j not updated: a_k(e) - kappa_k >= 'aMinThres', kappa_k the max.
+   *   before the batch (conservative). Only if dA<0
+   * - j updated: a_k(e) - a_jk(e) >= 'aMinThres'. Only if more than one
+   *   j is updated (otherwise, this is the cavity, which does not depend
+   *   on e)
+   * Slots failing 'checkMarginals' for the common factor are removed,
+   * which requires redetermining the factor.
+   */
+  void ParallelFactEPDriver::mergeTauUpdates(int k)
+  {
+    int s,nact,stat=updSuccess;
+    double margAk=margA[k],margCk=margC[k],kappaA=0.0,kappaC=0.0,eta,temp,
+      prA,prC;
+    double* aP,*cP;
+    bool changed;
+
+    if ((!(epMaxA==0) && (kappaA=epMaxA->getMaxValue(k))<=0.0) ||
+	(!(epMaxC==0) && (kappaC=epMaxC->getMaxValue(k))<=0.0))
+      stat=updNumericalError;
+    do {
+      changed=false;
+      eta=0.0; kDeltaA[k]=kDeltaC[k]=0.0;
+      for (s=kFirst[k],nact=0; s>=0; s=slots[s].next) {
+	const BatchSlot& sl=slots[s];
+	if (sl.stat==updSuccess) {
+	  eta=std::max(eta,sl.eta);
+	  kDeltaA[k]+=sl.prA-sl.oldA; kDeltaC[k]+=sl.prC-sl.oldC;
+	  nact++;
+	}
+      }
+      if (nact==0) return;
+      if (stat==updSuccess) {
+	// Selective damping
+	if (!(epMaxA==0) && kDeltaA[k]<0.0)
+	  eta=std::max(eta,minDampFact(margAk+kDeltaA[k]-kappaA,margAk-kappaA,
+				       aMinThres));
+	if (!(epMaxC==0) && kDeltaC[k]<0.0)
+	  eta=std::max(eta,minDampFact(margCk+kDeltaC[k]-kappaC,margCk-kappaC,
+				       cMinThres));
+	if (nact>1)
+	  for (s=kFirst[k]; s>=0; s=slots[s].next) {
+	    const BatchSlot& sl=slots[s];
+	    if (sl.stat!=updSuccess) continue;
+	    if (!(epMaxA==0))
+	      eta=std::max(eta,minDampFact(margAk+kDeltaA[k]-sl.prA,
+					   margAk-sl.oldA,aMinThres));
+	    if (!(epMaxC==0))
+	      eta=std::max(eta,minDampFact(margCk+kDeltaC[k]-sl.prC,
+					   margCk-sl.oldC,cMinThres));
+	  }
+	temp=1.0-eta;
+	if (eta>=0.98)
+	  stat=updCavCondSkipped;
+	else if (margAk+temp*kDeltaA[k]<0.5*aMinThres ||
+		 margCk+temp*kDeltaC[k]<0.5*cMinThres)
+	  stat=updMarginalsInvalid;
+      }
+      for (s=kFirst[k]; s>=0; s=slots[s].next) {
+	BatchSlot& sl=slots[s];
+	if (sl.stat!=updSuccess) continue;
+	if (stat!=updSuccess)
+	  sl.stat=stat;
+	else if (!checkMarginals(sl,eta)) {
+	  sl.stat=updMarginalsInvalid; changed=true;
+	}
+      }
+    } while (changed);
+    if (stat!=updSuccess) return;
+    // Write back
+    temp=1.0-eta;
+    for (s=kFirst[k]; s>=0; s=slots[s].next) {
+      BatchSlot& sl=slots[s];
+      if (sl.stat!=updSuccess) continue;
+      sl.eta=eta;
+      epRepr->accessTauRow(sl.j,aP,cP);
+      *aP=prA=sl.prA+eta*(sl.oldA-sl.prA);
+      *cP=prC=sl.prC+eta*(sl.oldC-sl.prC);
+      if (!(epMaxA==0))
+	epMaxA->update(k,sl.j,prA);
+      if (!(epMaxC==0))
+	epMaxC->update(k,sl.j,prC);
+    }
+    margA[k]=margAk+temp*kDeltaA[k];
+    margC[k]=margCk+temp*kDeltaC[k];
+    if ((!(epMaxA==0) && epMaxA->getMaxValue(k)<=0.0) ||
+	(!(epMaxC==0) && epMaxC->getMaxValue(k)<=0.0)) {
+      // New kappa_k not positive: Skip all updates (back to old state)
+      for (s=kFirst[k]; s>=0; s=slots[s].next) {
+	BatchSlot& sl=slots[s];
+	if (sl.stat!=updSuccess) continue;
+	sl.stat=updCavCondSkipped;
+	epRepr->accessTauRow(sl.j,aP,cP);
+	*aP=sl.oldA; *cP=sl.oldC;
+	if (!(epMaxA==0))
+	  epMaxA->update(k,sl.j,sl.oldA);
+	if (!(epMaxC==0))
+	  epMaxC->update(k,sl.j,sl.oldC);
+      }
+      margA[k]=margAk; margC[k]=margCk;
+    }
+  }
+
+  void ParallelFactEPDriver::commitUpdate(const BatchSlot& sl,double* delta)
+  {
+    int i,ii,vjSz,k=sl.k;
+    double prPi,prBeta,mprPi,mprBeta,bval,temp,temp2,mprH=0.0,mprRho=0.0,
+      eta=sl.eta;
+    const int* vjInd;
+    const double* bP;
+    double* betaP,*piP;
+    const double* xb=xBuff.p()+sl.xOff;
+    double* mBetaP=margBeta.p(),*mPiP=margPi.p();
+
+    epRepr->accessRow(sl.j,vjSz,vjInd,bP,betaP,piP);
+    for (ii=0; ii<vjSz; ii++) {
+      i=vjInd[ii];
+      prPi=xb[2*vjSz+ii]; prBeta=xb[3*vjSz+ii];
+      if (eta>0.0) {
+	prPi+=eta*(piP[ii]-prPi);
+	prBeta+=eta*(betaP[ii]-prBeta);
+      }
+      mprPi=xb[ii]+prPi; mprBeta=xb[vjSz+ii]+prBeta;
+      betaP[ii]=prBeta; piP[ii]=prPi;
+      mBetaP[i]=mprBeta; mPiP[i]=mprPi;
+      bval=bP[ii]; temp=bval/mprPi;
+      mprRho+=bval*temp;
+      mprH+=temp*mprBeta;
+      if (!(epMaxPi==0))
+	epMaxPi->update(i,sl.j,prPi);
+    }
+    if (delta!=0) {
+      *delta=std::max(MAXRELDIFF(sl.mH,mprH),
+		      MAXRELDIFF(sqrt(sl.mRho),sqrt(mprRho)));
+      if (k>=0) {
+	temp=margA[k]/margC[k]; temp2=sqrt(margA[k])/margC[k];
+	*delta=std::max(*delta,MAXRELDIFF(sl.mnTau,temp));
+	*delta=std::max(*delta,MAXRELDIFF(sl.stdTau,temp2));
+      }
+    }
+  }
+
+#undef MAXRELDIFF
+//ENDNS
@@ -0,0 +1,294 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class ParallelFactEPDriver
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_PARALLELFACTEPDRIVER_H
+#define EPTOOLS_PARALLELFACTEPDRIVER_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/FactorizedEPDriver.h"
+#include "src/eptools/NumaServices.h"
+#include <pthread.h>
+
+//BEGINNS(eptools)
+  /**
+   * Extension of 'FactorizedEPDriver' (bivariate precision case), adding
+   * a parallel scheduling mode for a list of EP updates: 'parallelUpdates'.
+   * <p>
+   * Scheduling:
+   * The update list is partitioned into batches (levels of the conflict
+   * graph). Two updates j, j' conflict if V_j, V_j' intersect, or if both
+   * are bivariate precision potentials with k(j)==k(j'), unless k is
+   * dense (see below). Potential j is placed in the batch after the last
+   * one containing an earlier conflicting update, so that the order of
+   * conflicting updates in the list is maintained. Updates in the same
+   * batch are done concurrently, a barrier separates batches.
+   * <p>
+   * Dense tau indices:
+   * If a precision variable tau_k is shared by most bivariate potentials
+   * in the list (more than 'denseFrac' times their number), including k
+   * in the conflict graph would serialize the sweep. Such k are left out
+   * of the conflict graph. All updates j with k(j)==k in a batch use the
+   * same tau cavity, computed from the marginal a_k, c_k at the start of
+   * the batch (parallel EP w.r.t. tau_k). Their changes a_jk, c_jk are
+   * accumulated in per-k delta buffers, which are merged at the barrier.
+   * <p>
+   * Merge and selective damping:
+   * Workers only compute proposals (cavities, local EP update, undamped
+   * new message parameters, pi selective damping factor), nothing is
+   * written back. At the barrier, for each k touched by the batch, a
+   * common damping factor is determined for all updates j with k(j)==k:
+   * the maximum of 'dampFact', their pi selective damping factors, and the
+   * smallest factor for which the 'epMaxA', 'epMaxC' constraints
+   *   a_k - max_j a_jk >= 'aMinThres',  c_k - max_j c_jk >= 'cMinThres'
+   * hold after the merged update (the max over j not updated in the
+   * batch is bounded by the value before the batch, which is
+   * conservative). If this factor is >= 0.98, all these updates are
+   * skipped ('updCavCondSkipped'). If k is not dense, there is a single
+   * such j, and damping is the same as in 'sequentialUpdate'. The merge
+   * is done by the calling thread, in list order, so results do not
+   * depend on the number of threads.
+   * <p>
+   * Threads:
+   * The workers of a batch (one per potential manager) are run on the
+   * thread pool ('ThreadPool', which should have 'numThreads' threads,
+   * pinned to 'thrCpus' if CPUs are assigned). Each worker needs its own
+   * potential manager (see 'PotentialManager': these are not
+   * thread-safe), passed at construction. They must represent the
+   * same potentials as 'epPots' (f.ex., created from the same arguments),
+   * the first one may be 'epPots' itself. For more than one worker,
+   * 'epPots' must be thread-safe (see 'PotentialManager::isThreadSafe'),
+   * otherwise the constructor throws 'InvalidParameterException'.
+   * Different to 'sequentialUpdate', no debug messages are printed from
+   * within workers. A local update cache ('setUpdateCache') is accessed
+   * by the workers, each on its own entries.
+   * <p>
+   * Affinity and NUMA placement:
+   * If CPUs are assigned to the threads ('setAffinity'), updates in a
+   * batch are assigned to workers by row blocks: potential j goes to
+   * worker 'rowOwner(j)'. Worker t starts on pool thread t, so it runs on
+   * CPU 'thrCpus[t]' if the pool is pinned to 'thrCpus' (see
+   * 'ThreadPool::configure'), unless its work is stolen. 'numaPlace' places the row
+   * blocks of the representation on the NUMA node of their thread, and
+   * interleaves arrays indexed by variables (marginals, selective damping)
+   * over these nodes. This only changes which thread does which update,
+   * results are the same.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class ParallelFactEPDriver : public FactorizedEPDriver
+  {
+  public:
+    // Constants
+
+    static const int maxThreads=64;
+
+  protected:
+    // Internal types
+
+    /*
+     * Proposal computed by a worker for an update in the current batch
+     * (see 'proposeUpdate').
+     */
+    class WorkerBody; // Used by 'parallelUpdates' (defined in .cc)
+
+    struct BatchSlot
+    {
+      int pos;             // Position in update list
+      int j;               // Potential index
+      int stat;            // Return status
+      int xOff;            // Offset into 'xBuff'
+      int k;               // k(j), or -1 (univariate)
+      int owner;           // Thread (row blocks), or -1 (round robin)
+      int next;            // Next slot with same k
+      double eta;          // Damping factor (selective damping for pi)
+      double mH,mRho;      // Marginal moments on s_j (before update)
+      double prA,prC;      // Undamped new a_jk, c_jk
+      double oldA,oldC;    // a_jk, c_jk before update
+      double mnTau,stdTau; // Marginal moments on tau_k (before update)
+    };
+
+    // Members
+
+    ArrayHandle<Handle<PotentialManager> > thrPots; // One per thread
+    ArrayHandle<int> thrCpus;        // Affinity (optional)
+    double denseFrac;
+    ArrayHandle<BatchSlot> slots;
+    ArrayHandle<double> xBuff;       // Cavities, undamped pi_ji, beta_ji
+    ArrayHandle<int> kFirst;         // Per-k lists of slots
+    ArrayHandle<double> kDeltaA,kDeltaC; // Per-k delta buffers
+    pthread_mutex_t maxMutex;        // Guards temp. changes of 'epMaxPi'
+    pthread_mutex_t errMutex;
+    std::string thrErrMsg;
+    int curBatchSz;
+
+  public:
+    // Public methods
+
+    /**
+     * Constructor. Arguments as for the 'FactorizedEPDriver' constructor
+     * (bivariate precision potentials), plus the per-thread potential
+     * managers and the threshold for dense tau indices.
+     *
+     * @param pepPots
+     * @param pepRepr
+     * @param pmargBeta
+     * @param pmargPi
+     * @param pmargA
+     * @param pmargC
+     * @param ppiMinThres
+     * @param paMinThres
+     * @param pcMinThres
+     * @param pthrPots    Potential managers, one per thread (size is the
+     *                    number of threads, <= 'maxThreads')
+     * @param pdenseFrac  See header comment. In (0,1]. Def.: 0.5
+     * @param pepMaxPi    Optional
+     * @param pepMaxA     "
+     * @param pepMaxC     "
+     */
+    ParallelFactEPDriver(const Handle<PotentialManager>& pepPots,
+			 const Handle<FactorizedEPRepresentation>& pepRepr,
+			 const ArrayHandle<double>& pmargBeta,
+			 const ArrayHandle<double>& pmargPi,
+			 const ArrayHandle<double>& pmargA,
+			 const ArrayHandle<double>& pmargC,double ppiMinThres,
+			 double paMinThres,double pcMinThres,
+			 const ArrayHandle<Handle<PotentialManager> >& pthrPots,
+			 double pdenseFrac=0.5,
+			 const Handle<FactEPMaximumPiValues>& pepMaxPi=
+			 HandleZero<FactEPMaximumPiValues>::get(),
+			 const Handle<FactEPMaximumAValues>& pepMaxA=
+			 HandleZero<FactEPMaximumAValues>::get(),
+			 const Handle<FactEPMaximumCValues>& pepMaxC=
+			 HandleZero<FactEPMaximumCValues>::get());
+
+    virtual ~ParallelFactEPDriver();
+
+    int numThreads() const {
+      return thrPots.size();
+    }
+
+    /**
+     * Assigns CPU 'pthrCpus[t]' to thread t (size 'numThreads'), see
+     * header comment. Pass an empty array to remove the assignment.
+     *
+     * @param pthrCpus CPU numbers
+     */
+    virtual void setAffinity(const ArrayHandle<int>& pthrCpus);
+
+    /**
+     * NUMA placement of representation, marginals and selective damping
+     * arrays (see header comment). Requires 'setAffinity' to be called
+     * before. Best called before any of these arrays is written to, pages
+     * which are already placed are migrated.
+     *
+     * @return Success? False if NUMA information or system calls are not
+     *         available
+     */
+    virtual bool numaPlace();
+
+    /**
+     * Row block assignment: potentials
+     *   j = floor(t m/T):(floor((t+1) m/T)-1)
+     * belong to thread t, T the number of threads (same as in
+     * 'FactorizedEPRepresentation::numaPlace').
+     *
+     * @param j Potential index
+     * @return  Thread t owning potential j
+     */
+    int rowOwner(int j) const {
+      return (int) ceil(((double) (j+1))*numThreads()/
+			epRepr->numPotentials())-1;
+    }
+
+    /**
+     * Runs EP updates on potentials 'jind[0:nupd-1]', in parallel (see
+     * header comment). Return status and (optionally) 'delta', 'effDamp'
+     * values (see 'sequentialUpdate') are written to 'rstat[i]',
+     * 'delta[i]', 'effDamp[i]' for the update 'jind[i]'.
+     *
+     * @param nupd     Number of updates
+     * @param jind     Potential indexes
+     * @param dampFact Damping factor in [0,1)
+     * @param rstat    Return stati ret. here
+     * @param delta    S.a. Optional
+     * @param effDamp  S.a. Optional
+     * @return         Number of batches
+     */
+    virtual int parallelUpdates(int nupd,const int* jind,double dampFact,
+				int* rstat,double* delta=0,double* effDamp=0);
+
+  protected:
+    // Internal methods
+
+    /**
+     * Computes cavity, local EP update and undamped new message parameters
+     * for potential 'sl.j', using the potential manager 'pots'. Nothing is
+     * written back. The cavity w.r.t. tau_k is determined from the current
+     * marginals. If 'epMaxPi' is given, the selective damping factor for
+     * pi is written to 'sl.eta' ('dampFact' otherwise).
+     * Cavities and undamped pi_ji, beta_ji are written to 'xb' (size
+     * 4*|V_j|).
+     *
+     * @param pots     Potential manager
+     * @param dampFact Damping factor
+     * @param sl       Slot (I/O)
+     * @param xb       Buffer
+     * @return         Return status
+     */
+    int proposeUpdate(const PotentialManager& pots,double dampFact,
+		      BatchSlot& sl,double* xb);
+
+    /**
+     * Checks whether the new marginals on x for slot 'sl' are valid when
+     * its update is done with damping factor 'eta'.
+     *
+     * @param sl  Slot
+     * @param eta Damping factor
+     * @return    Valid?
+     */
+    bool checkMarginals(const BatchSlot& sl,double eta) const;
+
+    /**
+     * Merges updates on tau_k for all slots in the list for k (see header
+     * comment). The common damping factor is determined here, and slots
+     * for which the update fails obtain the corresponding status. The
+     * remaining slots are written back w.r.t. tau_k, their 'eta' field is
+     * set to the common damping factor.
+     *
+     * @param k Precision variable index
+     */
+    void mergeTauUpdates(int k);
+
+    /**
+     * Writes back update on x for slot 'sl' (damping factor 'sl.eta'), and
+     * computes 'delta' value (see 'sequentialUpdate').
+     *
+     * @param sl    Slot
+     * @param delta S.a. Optional
+     */
+    void commitUpdate(const BatchSlot& sl,double* delta);
+
+    /**
+     * Worker 'tid' (of 'nthr') computes proposals for slots tid, tid+nthr,
+     * ... of the current batch, or for the slots it owns if CPUs are
+     * assigned (row blocks). Exceptions are caught, the first message is
+     * stored in 'thrErrMsg'.
+     *
+     * @param tid      Worker
+     * @param nthr     Number of workers
+     * @param dampFact Damping factor
+     */
+    void runWorker(int tid,int nthr,double dampFact);
+  };
+//ENDNS
+
+#endif
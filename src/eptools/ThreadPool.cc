@@ -0,0 +1,307 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class ThreadPool
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/ThreadPool.h"
+#include "src/eptools/NumaServices.h"
+#include "src/eptools/TraceServices.h"
+#include <pthread.h>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+//BEGINNS(eptools)
+  const int ThreadPool::maxThreads;
+  const int ThreadPool::minGrain;
+  const int ThreadPool::maxChunks;
+
+  /*
+   * Loop currently run by the pool. Exactly one of 'lbody', 'rbody' is
+   * given. 'abort', 'errMsg' are guarded by 'poolStateMutex'.
+   */
+  struct PoolJob
+  {
+    LoopBody* lbody;
+    ReduceBody* rbody;
+    int n,grain,nchunk;
+    bool abort;
+    std::string errMsg;
+  };
+
+  /*
+   * Deque of chunk indexes lo:(hi-1) of one thread. The owner takes
+   * chunks from the front, thieves from the back.
+   */
+  struct PoolDeque
+  {
+    pthread_mutex_t mutex;
+    int lo,hi;
+  };
+
+  // 'poolMutex' is held while a loop runs, or during 'configure'. The
+  // other state is guarded by 'poolStateMutex'
+  static pthread_mutex_t poolMutex=PTHREAD_MUTEX_INITIALIZER;
+  static pthread_mutex_t poolStateMutex=PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t poolWorkCond=PTHREAD_COND_INITIALIZER;
+  static pthread_cond_t poolDoneCond=PTHREAD_COND_INITIALIZER;
+  static pthread_once_t poolOnce=PTHREAD_ONCE_INIT;
+  static int poolNThr=1;
+  static std::vector<int> poolCpus;
+  static std::vector<pthread_t> poolIds;
+  static int poolTid[ThreadPool::maxThreads];
+  static bool poolStarted=false,poolExit=false;
+  static unsigned long poolGen=0;
+  static int poolActive=0;
+  static PoolJob* poolJob=0;
+  static PoolDeque poolDeques[ThreadPool::maxThreads];
+
+  static void poolInitDeques()
+  {
+    for (int t=0; t<ThreadPool::maxThreads; t++) {
+      pthread_mutex_init(&poolDeques[t].mutex,0);
+      poolDeques[t].lo=poolDeques[t].hi=0;
+    }
+  }
+
+  /*
+   * Next chunk for thread t: front of own deque, otherwise steal the back
+   * half of another deque (the first stolen chunk is returned, the rest
+   * goes to the own deque).
+   */
+  static bool poolNextChunk(int t,int nthr,int& chunk)
+  {
+    PoolDeque& own=poolDeques[t];
+    int k,sz,mid,hi;
+
+    pthread_mutex_lock(&own.mutex);
+    if (own.lo<own.hi) {
+      chunk=own.lo++;
+      pthread_mutex_unlock(&own.mutex);
+      return true;
+    }
+    pthread_mutex_unlock(&own.mutex);
+    for (k=1; k<nthr; k++) {
+      PoolDeque& vic=poolDeques[(t+k)%nthr];
+      pthread_mutex_lock(&vic.mutex);
+      if ((sz=vic.hi-vic.lo)>0) {
+	hi=vic.hi; mid=hi-(sz+1)/2;
+	vic.hi=mid;
+	pthread_mutex_unlock(&vic.mutex);
+	// Locks are not nested (thieves may steal from each other)
+	chunk=mid;
+	pthread_mutex_lock(&own.mutex);
+	own.lo=mid+1; own.hi=hi;
+	pthread_mutex_unlock(&own.mutex);
+	return true;
+      }
+      pthread_mutex_unlock(&vic.mutex);
+    }
+
+    return false;
+  }
+
+  static void poolRunChunk(PoolJob& job,int chunk)
+  {
+    int beg=chunk*job.grain,end=std::min(beg+job.grain,job.n);
+
+    if (job.lbody!=0)
+      job.lbody->run(beg,end);
+    else
+      job.rbody->run(chunk,beg,end);
+  }
+
+  /*
+   * Records the first error of 'job', and empties all deques, so that
+   * chunks not yet started are skipped.
+   */
+  static void poolAbort(PoolJob& job,int nthr,const char* msg)
+  {
+    pthread_mutex_lock(&poolStateMutex);
+    if (!job.abort) job.errMsg=msg;
+    job.abort=true;
+    pthread_mutex_unlock(&poolStateMutex);
+    for (int t=0; t<nthr; t++) {
+      pthread_mutex_lock(&poolDeques[t].mutex);
+      poolDeques[t].lo=poolDeques[t].hi;
+      pthread_mutex_unlock(&poolDeques[t].mutex);
+    }
+  }
+
+  static void poolWork(PoolJob& job,int t,int nthr)
+  {
+    int chunk;
+    TraceScope trace("worker","pool",t);
+
+    while (poolNextChunk(t,nthr,chunk)) {
+      try {
+	poolRunChunk(job,chunk);
+      } catch (StandardException ex) {
+	poolAbort(job,nthr,ex.msg());
+      } catch (...) {
+	poolAbort(job,nthr,"Unspecified exception in worker thread");
+      }
+    }
+  }
+
+  static void* poolThreadMain(void* arg)
+  {
+    int t=*((int*) arg);
+    unsigned long gen=0;
+    PoolJob* job;
+
+    pthread_mutex_lock(&poolStateMutex);
+    for (;;) {
+      while (!poolExit && poolGen==gen)
+	pthread_cond_wait(&poolWorkCond,&poolStateMutex);
+      if (poolExit) break;
+      gen=poolGen; job=poolJob;
+      pthread_mutex_unlock(&poolStateMutex);
+      poolWork(*job,t,poolNThr);
+      pthread_mutex_lock(&poolStateMutex);
+      if (--poolActive==0)
+	pthread_cond_signal(&poolDoneCond);
+    }
+    pthread_mutex_unlock(&poolStateMutex);
+
+    return 0;
+  }
+
+  /*
+   * Starts pool threads. Thread 0 is the calling thread, unless threads
+   * are pinned. Threads which cannot be started are skipped (their chunks
+   * are stolen by the others). Requires 'poolMutex'.
+   */
+  static void poolStartThreads()
+  {
+    int t;
+    pthread_t tid;
+    bool pinned=(poolCpus.size()>0);
+
+    pthread_mutex_lock(&poolStateMutex);
+    poolGen=0;
+    pthread_mutex_unlock(&poolStateMutex);
+    for (t=pinned?0:1; t<poolNThr; t++) {
+      pthread_attr_t attr;
+      pthread_attr_init(&attr);
+      if (pinned)
+	NumaServices::setThreadCpu(&attr,poolCpus[t]);
+      poolTid[t]=t;
+      if (pthread_create(&tid,&attr,poolThreadMain,(void*) (poolTid+t))==0)
+	poolIds.push_back(tid);
+      pthread_attr_destroy(&attr);
+    }
+    poolStarted=true;
+  }
+
+  // Requires 'poolMutex'
+  static void poolStopThreads()
+  {
+    pthread_mutex_lock(&poolStateMutex);
+    poolExit=true;
+    pthread_cond_broadcast(&poolWorkCond);
+    pthread_mutex_unlock(&poolStateMutex);
+    for (int i=0; i<(int) poolIds.size(); i++)
+      pthread_join(poolIds[i],0);
+    poolIds.clear();
+    poolExit=poolStarted=false;
+  }
+
+  /*
+   * Runs 'job' on the pool, or in the calling thread if the pool is busy
+   * or has a single thread. Partial results of a reduction are joined
+   * by the caller.
+   */
+  static void poolRun(PoolJob& job)
+  {
+    int t,nthr,c;
+
+    if (job.n<=0) return;
+    job.nchunk=(job.n+job.grain-1)/job.grain;
+    job.abort=false;
+    if (job.rbody!=0)
+      job.rbody->prepare(job.nchunk);
+    if (job.nchunk==1 || pthread_mutex_trylock(&poolMutex)!=0) {
+      for (c=0; c<job.nchunk; c++)
+	poolRunChunk(job,c);
+    } else if ((nthr=poolNThr)==1) {
+      pthread_mutex_unlock(&poolMutex);
+      for (c=0; c<job.nchunk; c++)
+	poolRunChunk(job,c);
+    } else {
+      pthread_once(&poolOnce,poolInitDeques);
+      if (!poolStarted)
+	poolStartThreads();
+      for (t=0; t<nthr; t++) {
+	poolDeques[t].lo=(int) (((long) t)*job.nchunk/nthr);
+	poolDeques[t].hi=(int) (((long) t+1)*job.nchunk/nthr);
+      }
+      pthread_mutex_lock(&poolStateMutex);
+      poolJob=&job; poolActive=poolIds.size(); poolGen++;
+      pthread_cond_broadcast(&poolWorkCond);
+      pthread_mutex_unlock(&poolStateMutex);
+      if (poolCpus.size()==0 || poolIds.size()==0)
+	poolWork(job,0,nthr);
+      pthread_mutex_lock(&poolStateMutex);
+      while (poolActive>0)
+	pthread_cond_wait(&poolDoneCond,&poolStateMutex);
+      poolJob=0;
+      pthread_mutex_unlock(&poolStateMutex);
+      pthread_mutex_unlock(&poolMutex);
+      if (job.abort)
+	throw NumericalException(EXCEPT_MSG(job.errMsg.c_str()));
+    }
+    if (job.rbody!=0)
+      for (c=0; c<job.nchunk; c++)
+	job.rbody->join(c);
+  }
+
+  void ThreadPool::configure(int nthr,const int* cpus)
+  {
+    if (nthr<1 || nthr>maxThreads)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if (pthread_mutex_trylock(&poolMutex)!=0)
+      throw WrongStatusException(EXCEPT_MSG("Cannot configure thread pool while a loop is running"));
+    if (nthr==poolNThr &&
+	((cpus==0 && poolCpus.empty()) ||
+	 (cpus!=0 && !poolCpus.empty() &&
+	  std::equal(poolCpus.begin(),poolCpus.end(),cpus)))) {
+      pthread_mutex_unlock(&poolMutex);
+      return;
+    }
+    if (poolStarted)
+      poolStopThreads();
+    poolNThr=nthr;
+    if (cpus!=0)
+      poolCpus.assign(cpus,cpus+nthr);
+    else
+      poolCpus.clear();
+    pthread_mutex_unlock(&poolMutex);
+  }
+
+  int ThreadPool::numThreads()
+  {
+    return poolNThr;
+  }
+
+  void ThreadPool::parallelFor(int n,LoopBody& body,int grain)
+  {
+    PoolJob job;
+
+    job.lbody=&body; job.rbody=0;
+    job.n=n; job.grain=grainSize(n,grain);
+    poolRun(job);
+  }
+
+  void ThreadPool::parallelReduce(int n,ReduceBody& body,int grain)
+  {
+    PoolJob job;
+
+    job.lbody=0; job.rbody=&body;
+    job.n=n; job.grain=grainSize(n,grain);
+    poolRun(job);
+  }
+//ENDNS
@@ -0,0 +1,162 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class ThreadPool
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_THREADPOOL_H
+#define EPTOOLS_THREADPOOL_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+
+//BEGINNS(eptools)
+  /**
+   * Body of a parallel loop over 0:(n-1), see 'ThreadPool::parallelFor'.
+   * 'run' is called for disjoint ranges beg:(end-1), from different
+   * threads concurrently.
+   */
+  class LoopBody
+  {
+  public:
+    virtual ~LoopBody() {}
+
+    /**
+     * @param beg Range start
+     * @param end Range end (excl.)
+     */
+    virtual void run(int beg,int end) = 0;
+  };
+
+  /**
+   * Body of a parallel reduction over 0:(n-1), see
+   * 'ThreadPool::parallelReduce'. The range is split into 'nchunk'
+   * chunks. 'prepare' is called first (calling thread), so that partial
+   * results can be allocated per chunk. 'run' is called for each chunk,
+   * from different threads concurrently, and has to write the partial
+   * result for the chunk only. Finally, 'join' is called for each chunk,
+   * in order c=0,1,... (calling thread), to combine the partial results.
+   */
+  class ReduceBody
+  {
+  public:
+    virtual ~ReduceBody() {}
+
+    /**
+     * @param nchunk Number of chunks
+     */
+    virtual void prepare(int nchunk) = 0;
+
+    /**
+     * @param chunk Chunk index
+     * @param beg   Range start
+     * @param end   Range end (excl.)
+     */
+    virtual void run(int chunk,int beg,int end) = 0;
+
+    /**
+     * @param chunk Chunk index
+     */
+    virtual void join(int chunk) = 0;
+  };
+
+  /**
+   * Thread pool shared by parallel kernels of eptools (static methods
+   * only).
+   * <p>
+   * 'parallelFor', 'parallelReduce' split 0:(n-1) into chunks of 'grain'
+   * consecutive indexes (the last one may be smaller). The default grain
+   * size gives at most 'maxChunks' chunks of at least 'minGrain' indexes,
+   * independent of the number of threads. Each thread starts with a
+   * contiguous range of chunks in its own deque, and processes it from
+   * the front. A thread running out of work steals the back half of
+   * the deque of another thread. Chunks are never split further, so for
+   * a fixed grain size, 'parallelReduce' combines the same partial
+   * results in the same order for any number of threads, and results do
+   * not depend on it.
+   * <p>
+   * Threads:
+   * The pool has 'numThreads' threads, set by 'configure' (default: 1,
+   * loops run in the calling thread). POSIX threads are created on first
+   * use and wait for work between calls, the calling thread acts as
+   * thread 0. If CPUs are assigned ('configure' with 'cpus'), pool thread
+   * t is pinned to CPU 'cpus[t]' (also t==0, the calling thread then only
+   * waits).
+   * The pool runs one loop at a time. If a loop is started while another
+   * one runs (calls from a loop body, f.ex. 'ParallelFactEPDriver'
+   * workers, or from other threads), it is run by the calling thread.
+   * Bodies must not use non-thread-safe objects shared between chunks
+   * (see 'PotentialManager').
+   * <p>
+   * Errors:
+   * If 'run' throws an exception, chunks not yet started are skipped,
+   * and 'NumericalException' with the message of the first exception is
+   * thrown by the calling thread, once all threads are done.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class ThreadPool
+  {
+  public:
+    // Constants
+
+    static const int maxThreads=64;
+    static const int minGrain=64;
+    static const int maxChunks=1024;
+
+    // Public static methods
+
+    /**
+     * Sets number of threads and (optionally) CPUs they are pinned to.
+     * If either differs from the current setting, running pool threads
+     * are terminated, new ones are created on next use. Otherwise,
+     * nothing is done. Must not be called while a loop is running.
+     *
+     * @param nthr Number of threads (1: serial), <= 'maxThreads'
+     * @param cpus CPU for each thread (size 'nthr'). Optional
+     */
+    static void configure(int nthr,const int* cpus=0);
+
+    /**
+     * @return Number of threads
+     */
+    static int numThreads();
+
+    /**
+     * @param n     Loop size
+     * @param grain Grain size. Optional
+     * @return      Grain size used for 'n', 'grain'
+     */
+    static int grainSize(int n,int grain=0) {
+      if (grain<=0)
+	grain=std::max((n+maxChunks-1)/maxChunks,minGrain);
+      return grain;
+    }
+
+    /**
+     * Runs 'body' over 0:(n-1), see header comment.
+     *
+     * @param n     Loop size
+     * @param body  Loop body
+     * @param grain Grain size. Def.: see 'grainSize'
+     */
+    static void parallelFor(int n,LoopBody& body,int grain=0);
+
+    /**
+     * Runs reduction 'body' over 0:(n-1), see header comment.
+     *
+     * @param n     Loop size
+     * @param body  Reduction body
+     * @param grain Grain size. Def.: see 'grainSize'
+     */
+    static void parallelReduce(int n,ReduceBody& body,int grain=0);
+  };
+//ENDNS
+
+#endif
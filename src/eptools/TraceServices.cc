@@ -0,0 +1,261 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class TraceServices
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/TraceServices.h"
+#include <pthread.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <sys/time.h>
+#include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <string>
+#ifdef __GNUC__
+#  include <cxxabi.h>
+#endif
+
+//BEGINNS(eptools)
+  const int TraceServices::defBufSize;
+  const int TraceServices::flagTypeName;
+  volatile int TraceServices::enabled=0;
+
+  struct TraceEvent
+  {
+    const char* name,*cat;
+    double ts,dur;
+    int arg,flags;
+  };
+
+  static inline bool traceEventBefore(const TraceEvent& a,const TraceEvent& b)
+  {
+    return (a.ts<b.ts);
+  }
+
+  /*
+   * Ring buffer of one thread. 'pos' is the next entry to be written,
+   * 'num' the number of valid entries. 'inUse' is false once the thread
+   * has terminated.
+   */
+  struct TraceBuffer
+  {
+    std::vector<TraceEvent> evts;
+    int pos,num,scount;
+    bool inUse;
+  };
+
+  static pthread_mutex_t traceMutex=PTHREAD_MUTEX_INITIALIZER;
+  static pthread_once_t traceOnce=PTHREAD_ONCE_INIT;
+  static pthread_key_t traceKey;
+  static std::vector<TraceBuffer*> traceBuffs; // Never shrinks
+  static std::set<std::string> traceStrings;
+  static int tracePeriod=1;
+  static int traceBufSize=TraceServices::defBufSize;
+
+  static void traceReleaseBuffer(void* p)
+  {
+    pthread_mutex_lock(&traceMutex);
+    ((TraceBuffer*) p)->inUse=false;
+    pthread_mutex_unlock(&traceMutex);
+  }
+
+  static void traceCreateKey()
+  {
+    pthread_key_create(&traceKey,traceReleaseBuffer);
+  }
+
+  static inline void traceResetBuffer(TraceBuffer* buf)
+  {
+    buf->evts.resize(traceBufSize);
+    buf->pos=buf->num=buf->scount=0;
+  }
+
+  /*
+   * Buffer of the calling thread. A new thread takes over the first
+   * released buffer (events are kept), or a new one is created.
+   */
+  static TraceBuffer* traceGetBuffer()
+  {
+    TraceBuffer* buf;
+    int b;
+
+    pthread_once(&traceOnce,traceCreateKey);
+    if ((buf=(TraceBuffer*) pthread_getspecific(traceKey))!=0)
+      return buf;
+    pthread_mutex_lock(&traceMutex);
+    for (b=0; b<(int) traceBuffs.size() && traceBuffs[b]->inUse; b++);
+    if (b==(int) traceBuffs.size()) {
+      traceBuffs.push_back(buf=new TraceBuffer());
+      traceResetBuffer(buf);
+    } else
+      buf=traceBuffs[b];
+    buf->inUse=true;
+    pthread_mutex_unlock(&traceMutex);
+    pthread_setspecific(traceKey,buf);
+
+    return buf;
+  }
+
+  static void traceWriteString(FILE* fd,const char* str)
+  {
+    for (; *str!=0; str++) {
+      if (*str=='"' || *str=='\\')
+	fputc('\\',fd);
+      if ((unsigned char) *str>=32)
+	fputc(*str,fd);
+    }
+  }
+
+  void TraceServices::enable(int period,int bufSize)
+  {
+    if (period<1 || bufSize<1)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    tracePeriod=period; traceBufSize=bufSize;
+    clear();
+    enabled=1;
+  }
+
+  void TraceServices::disable()
+  {
+    enabled=0;
+  }
+
+  void TraceServices::clear()
+  {
+    pthread_mutex_lock(&traceMutex);
+    for (int b=0; b<(int) traceBuffs.size(); b++)
+      traceResetBuffer(traceBuffs[b]);
+    pthread_mutex_unlock(&traceMutex);
+  }
+
+  double TraceServices::now()
+  {
+#ifdef CLOCK_MONOTONIC
+    struct timespec tsp;
+
+    clock_gettime(CLOCK_MONOTONIC,&tsp);
+    return 1e6*((double) tsp.tv_sec)+1e-3*((double) tsp.tv_nsec);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv,0);
+    return 1e6*((double) tv.tv_sec)+((double) tv.tv_usec);
+#endif
+  }
+
+  bool TraceServices::sample()
+  {
+    TraceBuffer* buf=traceGetBuffer();
+    bool ret=(buf->scount==0);
+
+    if (++buf->scount>=tracePeriod)
+      buf->scount=0;
+
+    return ret;
+  }
+
+  void TraceServices::record(const char* name,const char* cat,double ts,
+			     double dur,int arg,int flags)
+  {
+    TraceBuffer* buf=traceGetBuffer();
+    int sz=buf->evts.size();
+    TraceEvent& evt=buf->evts[buf->pos];
+
+    evt.name=name; evt.cat=cat; evt.ts=ts; evt.dur=dur;
+    evt.arg=arg; evt.flags=flags;
+    if (++buf->pos==sz) buf->pos=0;
+    if (buf->num<sz) buf->num++;
+  }
+
+  const char* TraceServices::intern(const char* str)
+  {
+    const char* ret;
+
+    pthread_mutex_lock(&traceMutex);
+    ret=traceStrings.insert(std::string(str)).first->c_str();
+    pthread_mutex_unlock(&traceMutex);
+
+    return ret;
+  }
+
+  int TraceServices::numEvents()
+  {
+    int b,num=0;
+
+    for (b=0; b<(int) traceBuffs.size(); b++)
+      num+=traceBuffs[b]->num;
+
+    return num;
+  }
+
+  /*
+   * Events are recorded when they end, so the events of a thread are
+   * sorted by begin time (stable, so nested events with equal begin
+   * time keep their order) before being written. Names with
+   * 'flagTypeName' are demangled (GCC, Clang), each name only once.
+   */
+  int TraceServices::writeJSON(const char* fname)
+  {
+    FILE* fd;
+    int b,k,sz,nwrit=0,stat;
+    TraceBuffer* buf;
+    std::map<const char*,std::string> tnames;
+    std::map<const char*,std::string>::iterator it;
+    std::vector<TraceEvent> sorted;
+    const char* name;
+    char* dmg;
+
+    if ((fd=fopen(fname,"w"))==0)
+      return -1;
+    fprintf(fd,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+	    "\"args\":{\"name\":\"apbsint\"}}");
+    for (b=0; b<(int) traceBuffs.size(); b++) {
+      buf=traceBuffs[b];
+      if (buf->num==0) continue;
+      fprintf(fd,",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	      "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",b,b);
+      sz=buf->evts.size();
+      sorted.clear();
+      for (k=buf->pos-buf->num; k<buf->pos; k++)
+	sorted.push_back(buf->evts[(k+sz)%sz]);
+      std::stable_sort(sorted.begin(),sorted.end(),traceEventBefore);
+      for (k=0; k<(int) sorted.size(); k++) {
+	const TraceEvent& evt=sorted[k];
+	name=evt.name;
+	if ((evt.flags&flagTypeName)!=0) {
+	  if ((it=tnames.find(name))==tnames.end()) {
+	    std::string str(name);
+#ifdef __GNUC__
+	    if ((dmg=abi::__cxa_demangle(name,0,0,&stat))!=0) {
+	      str=dmg; free(dmg);
+	    }
+#endif
+	    it=tnames.insert(std::make_pair(name,str)).first;
+	  }
+	  name=it->second.c_str();
+	}
+	fprintf(fd,",\n{\"name\":\"");
+	traceWriteString(fd,name);
+	fprintf(fd,"\",\"cat\":\"");
+	traceWriteString(fd,evt.cat);
+	fprintf(fd,"\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+		"\"dur\":%.3f",b,evt.ts,evt.dur);
+	if (evt.arg>=0)
+	  fprintf(fd,",\"args\":{\"arg\":%d}",evt.arg);
+	fprintf(fd,"}");
+	nwrit++;
+      }
+    }
+    fprintf(fd,"\n]}\n");
+    fclose(fd);
+
+    return nwrit;
+  }
+//ENDNS
@@ -0,0 +1,189 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header classes TraceServices, TraceScope
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_TRACESERVICES_H
+#define EPTOOLS_TRACESERVICES_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+#include <typeinfo>
+
+//BEGINNS(eptools)
+  /**
+   * Timeline tracing (static methods only). Events are time intervals
+   * (begin, duration) with a name and a category, recorded by 'TraceScope'
+   * objects. They are written in the Chrome trace-event JSON format
+   * ('writeJSON'), which can be viewed with chrome://tracing or Perfetto.
+   * <p>
+   * Each thread records into its own ring buffer of size 'bufSize' (no
+   * locking), which overwrites the oldest events once full. A buffer is
+   * released when its thread terminates and is then reused by the next
+   * new thread (f.ex. after the thread pool is reconfigured). A buffer is
+   * shown as one thread in the timeline.
+   * <p>
+   * Sampling:
+   * Fine-grained scopes (single EP updates, quadrature calls) are created
+   * with 'sampled'==true. Per thread, only every 'period'-th of these is
+   * recorded (rate 1/'period'). Coarse scopes (wrapper calls, sweeps,
+   * batches) are always recorded.
+   * <p>
+   * Tracing is off by default. Then, a 'TraceScope' costs a single test
+   * of 'isEnabled'. If EPT_NO_TRACE is defined, 'isEnabled' is constant
+   * false, and scopes are removed by the compiler.
+   * NOTE: 'enable', 'disable', 'clear', 'writeJSON' must not be called
+   * while traced code is running in other threads.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class TraceServices
+  {
+  public:
+    // Constants
+
+    static const int defBufSize=65536;
+    static const int flagTypeName=1; // 'name' is 'typeid(..).name()'
+
+    // Public static methods
+
+    static bool isEnabled() {
+#ifndef EPT_NO_TRACE
+      return (enabled!=0);
+#else
+      return false;
+#endif
+    }
+
+    /**
+     * Enables tracing. Events recorded so far are removed.
+     *
+     * @param period  Sampling period (>=1)
+     * @param bufSize Ring buffer size per thread. Def.: 'defBufSize'
+     */
+    static void enable(int period,int bufSize=defBufSize);
+
+    /**
+     * Disables tracing. Recorded events are kept.
+     */
+    static void disable();
+
+    /**
+     * Removes all recorded events.
+     */
+    static void clear();
+
+    /**
+     * @return Current time (microseconds, monotonic clock)
+     */
+    static double now();
+
+    /**
+     * Sampling decision for the calling thread, see header comment.
+     *
+     * @return Record next sampled scope?
+     */
+    static bool sample();
+
+    /**
+     * Records an event for the calling thread. 'name', 'cat' are not
+     * copied, they must remain valid (string literals, or see 'intern').
+     *
+     * @param name  Event name
+     * @param cat   Category
+     * @param ts    Begin time ('now')
+     * @param dur   Duration (microseconds)
+     * @param arg   Argument shown with the event (if >=0)
+     * @param flags Flags ('flagTypeName')
+     */
+    static void record(const char* name,const char* cat,double ts,double dur,
+		       int arg=-1,int flags=0);
+
+    /**
+     * Returns a copy of 'str' which remains valid until the program ends.
+     * Equal strings are stored only once.
+     *
+     * @param str String
+     * @return    Copy
+     */
+    static const char* intern(const char* str);
+
+    /**
+     * @return Number of events currently stored (all threads)
+     */
+    static int numEvents();
+
+    /**
+     * Writes all stored events to file 'fname' (Chrome trace-event
+     * JSON), ordered by thread and begin time.
+     *
+     * @param fname File name
+     * @return      Number of events written, -1 if file cannot be opened
+     */
+    static int writeJSON(const char* fname);
+
+  protected:
+    static volatile int enabled;
+  };
+
+  /**
+   * Records the lifetime of the object as event (see 'TraceServices').
+   * Create as local variable at the beginning of the scope to be traced.
+   */
+  class TraceScope
+  {
+  protected:
+    const char* name,*cat;
+    double ts;
+    int arg,flags;
+    bool active;
+
+  public:
+    /**
+     * @param pname   Event name (not copied)
+     * @param pcat    Category (not copied)
+     * @param parg    Argument. Def.: -1 (none)
+     * @param sampled Subject to sampling? Def.: false
+     * @param pflags  Flags. Def.: 0
+     */
+    TraceScope(const char* pname,const char* pcat,int parg=-1,
+	       bool sampled=false,int pflags=0) : name(pname),cat(pcat),
+      ts(0.0),arg(parg),flags(pflags),active(false) {
+      if (TraceServices::isEnabled() &&
+	  (!sampled || TraceServices::sample())) {
+	ts=TraceServices::now(); active=true;
+      }
+    }
+
+    /**
+     * Same as above, but the event name is the (demangled) name of the
+     * dynamic type 'ptype' (f.ex., 'typeid(pot)' for a potential).
+     */
+    TraceScope(const std::type_info& ptype,const char* pcat,int parg=-1,
+	       bool sampled=false) : name(ptype.name()),cat(pcat),ts(0.0),
+      arg(parg),flags(TraceServices::flagTypeName),active(false) {
+      if (TraceServices::isEnabled() &&
+	  (!sampled || TraceServices::sample())) {
+	ts=TraceServices::now(); active=true;
+      }
+    }
+
+    ~TraceScope() {
+      if (active)
+	TraceServices::record(name,cat,ts,TraceServices::now()-ts,arg,flags);
+    }
+
+  private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+  };
+//ENDNS
+
+#endif
@@ -14,6 +14,7 @@
 #endif
 
 #include "src/eptools/potentials/PotentialManager.h"
+#include "src/eptools/EPMemoryTags.h"
 
 //BEGINNS(eptools)
   /**
@@ -82,6 +83,65 @@
       return pmArr[ic]->getPot(i);
     }
 
+    /**
+     * Maximal runs of lanes with potentials in the same child are passed
+     * to the child's 'compMomentsBatch'.
+     */
+    int compMomentsBatch(int n,const int* jind,const double* cmu,
+			 const double* crho,double* alpha,double* nu,
+			 bool* succ,double* logz=0) const {
+      int i,i0,ic,icrun,j,nfail=0;
+
+      if (n<=0) return 0;
+      MemTagScope mtag(EPMemoryTags::tagScratch);
+      ArrayHandle<int> rel(n);
+      for (i0=0; i0<n; i0=i) {
+	j=(jind==0)?i0:jind[i0];
+	if (j<0 || j>=size()) throw OutOfRangeException(EXCEPT_MSG(""));
+	rel[i0]=getRelPos(j,icrun);
+	for (i=i0+1; i<n; i++) {
+	  j=(jind==0)?i:jind[i];
+	  if (j<0 || j>=size()) throw OutOfRangeException(EXCEPT_MSG(""));
+	  rel[i]=getRelPos(j,ic);
+	  if (ic!=icrun) break;
+	}
+	nfail+=pmArr[icrun]->compMomentsBatch(i-i0,rel.p()+i0,cmu+i0,
+					      crho+i0,alpha+i0,nu+i0,
+					      succ+i0,(logz!=0)?(logz+i0):0);
+      }
+
+      return nfail;
+    }
+
+    bool isThreadSafe() const {
+      for (int i=0; i<pmArr.size(); i++)
+	if (!pmArr[i]->isThreadSafe()) return false;
+      return true;
+    }
+
+    int parVecSize() const {
+      int i,ret=0;
+
+      for (i=0; i<pmArr.size(); i++)
+	ret+=pmArr[i]->parVecSize();
+
+      return ret;
+    }
+
+    /**
+     * The flat parameter vector is the concatenation of those of the
+     * children.
+     */
+    void addParGradient(int j,const double* dpot,double* dpvec) const {
+      int i,ic,k,off=0;
+
+      if (j<0 || j>=size()) throw OutOfRangeException(EXCEPT_MSG(""));
+      i=getRelPos(j,ic);
+      for (k=0; k<ic; k++)
+	off+=pmArr[k]->parVecSize();
+      pmArr[ic]->addParGradient(i,dpot,dpvec+off);
+    }
+
   protected:
     // Internal methods
 
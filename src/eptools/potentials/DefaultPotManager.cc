@@ -7,6 +7,7 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/potentials/DefaultPotManager.h"
+#include "src/eptools/EPMemoryTags.h"
 
 //BEGINNS(eptools)
   DefaultPotManager::DefaultPotManager(const Handle<EPScalarPotential>& peppot,
@@ -36,4 +37,54 @@
       }
     }
   }
+
+  /*
+   * The lane parameters are gathered into 'pv' in the format of 'parVec',
+   * but with n instead of N values for individual parameters.
+   */
+  int DefaultPotManager::compMomentsBatch(int n,const int* jind,
+					  const double* cmu,
+					  const double* crho,double* alpha,
+					  double* nu,bool* succ,double* logz)
+    const
+  {
+    int i,k,j,np=parOff.size(),sz;
+    bool allShrd=true;
+
+    if (n<=0) return 0;
+    if (epPot->getArgumentGroup()!=EPScalarPotential::atypeUnivariate)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if (jind!=0)
+      for (i=0; i<n; i++)
+	if (jind[i]<0 || jind[i]>=num)
+	  throw OutOfRangeException(EXCEPT_MSG(""));
+    for (k=sz=0; k<np; k++) {
+      allShrd=allShrd && parShrd[k];
+      sz+=(parShrd[k]?1:n);
+    }
+    if (allShrd) {
+      if (np>0) {
+	getPotPars(0,tmpVec.p());
+	epPot->setPars(tmpVec.p());
+      }
+      return epPot->compMomentsBatch(n,cmu,crho,alpha,nu,succ,logz);
+    } else if (!epPot->suppBatchPars())
+      return PotentialManager::compMomentsBatch(n,jind,cmu,crho,alpha,nu,
+						succ,logz);
+    MemTagScope mtag(EPMemoryTags::tagScratch);
+    ArrayHandle<double> pv(sz);
+    double* pvp=pv.p();
+    for (k=0; k<np; k++) {
+      if (parShrd[k])
+	*(pvp++)=parVec[parOff[k]];
+      else
+	for (i=0; i<n; i++) {
+	  j=(jind==0)?i:jind[i];
+	  *(pvp++)=parVec[parOff[k]+j];
+	}
+    }
+
+    return epPot->compMomentsBatch(n,cmu,crho,alpha,nu,succ,logz,pv,
+				   parShrd);
+  }
 //ENDNS
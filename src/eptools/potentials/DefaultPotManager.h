@@ -33,7 +33,8 @@
    * <p>
    * ATTENTION: This implementation is not thread-safe. 'epPot' is
    * used by all 'getPot' calls, and the object is reconfigured
-   * accordingly.
+   * accordingly. 'compMomentsBatch' passes parameters of all lanes to
+   * 'epPot' at once (see 'EPScalarPotential::compMomentsBatch').
    * <p>
    * TODO: Currently, parameter values are fixed upon construction.
    * Should allow them to be modified later on.
@@ -88,6 +89,29 @@
       return *epPot;
     }
 
+    /**
+     * All lanes are passed to 'epPot->compMomentsBatch'. If some parameters
+     * are not shared, this requires 'epPot->suppBatchPars', otherwise the
+     * default implementation is used.
+     */
+    int compMomentsBatch(int n,const int* jind,const double* cmu,
+			 const double* crho,double* alpha,double* nu,
+			 bool* succ,double* logz=0) const;
+
+    int parVecSize() const {
+      return parVec.size();
+    }
+
+    void addParGradient(int j,const double* dpot,double* dpvec) const {
+      if (j<0 || j>=size()) throw OutOfRangeException(EXCEPT_MSG(""));
+      for (int i=0; i<parOff.size(); i++)
+	dpvec[parOff[i]+(parShrd[i]?0:j)]+=dpot[i];
+    }
+
+    bool isThreadSafe() const {
+      return epPot->isThreadSafe();
+    }
+
   protected:
     // Internal methods
 
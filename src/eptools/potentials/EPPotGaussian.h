@@ -80,6 +80,25 @@
 
       return true;
     }
+
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    /*
+     * d log Z / d y = -alpha, d log Z / d ssq = (alpha^2 - nu)/(2 eta).
+     */
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const {
+      if (!compMoments(inp,ret,logz,eta))
+	return false;
+      if (dlogz!=0) {
+	dlogz[0]=-ret[0];
+	dlogz[1]=0.5*(ret[0]*ret[0]-ret[1])/eta;
+      }
+
+      return true;
+    }
   };
 //ENDNS
 
@@ -105,6 +105,41 @@
       return rstat;
     }
 
+    int compMomentsBatch(int n,const double* cmu,const double* crho,
+			 double* alpha,double* nu,bool* succ,double* logz=0,
+			 const double* pv=0,const int* pshrd=0,
+			 double eta=1.0) const;
+
+    bool suppBatchPars() const {
+      return true;
+    }
+
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const {
+      double cmu=inp[0],crho=inp[1],dqr[3];
+
+      if (crho<1e-14 || eta<1e-10 || eta>1.0)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      bool rstat =
+	EPPotQuantileRegress::compMomentsInt(cmu,crho,2.0*eta*tau,yscal,0.5,
+					     ret[0],ret[1],logz,
+					     (dlogz!=0)?dqr:0);
+      if (rstat) {
+	if (logz!=0)
+	  (*logz) += eta*log(0.5*tau);
+	if (dlogz!=0) {
+	  dlogz[0]=dqr[0];
+	  dlogz[1]=eta*(2.0*dqr[1]+1.0/tau);
+	}
+      }
+
+      return rstat;
+    }
+
     // 'QuadPotProximal' methods
 
     bool hasFirstDerivatives() const {
@@ -161,6 +196,41 @@
       return true;
     }
   };
+
+  // Inline methods
+
+  /*
+   * Calls 'EPPotQuantileRegress::compMomentsIntBatch' with kappa = 1/2,
+   * xi = (2 eta) tau, see 'compMoments'.
+   */
+  inline int
+  EPPotLaplace::compMomentsBatch(int n,const double* cmu,const double* crho,
+				 double* alpha,double* nu,bool* succ,
+				 double* logz,const double* pv,
+				 const int* pshrd,double eta) const
+  {
+    int i,pinc[2];
+    double pown[2],kappa=0.5;
+    const double* pptr[2];
+
+    if (n<=0) return 0;
+    if (eta<1e-10 || eta>1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (i=0; i<n; i++)
+      if (crho[i]<1e-14)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+    batchParsAccess(n,pv,pshrd,pown,pptr,pinc);
+    EPPotQuantileRegress::compMomentsIntBatch(n,cmu,crho,2.0*eta,pptr[1],
+					      pinc[1],pptr[0],pinc[0],&kappa,
+					      0,alpha,nu,logz);
+    for (i=0; i<n; i++) {
+      if (logz!=0)
+	logz[i]+=eta*log(0.5*pptr[1][i*pinc[1]]);
+      succ[i]=true;
+    }
+
+    return 0;
+  }
 //ENDNS
 
 #endif
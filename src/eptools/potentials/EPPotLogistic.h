@@ -0,0 +1,472 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class EPPotLogistic
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_EPPOTLOGISTIC_H
+#define EPTOOLS_EPPOTLOGISTIC_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/potentials/EPScalarPotential.h"
+#include "src/eptools/potentials/SpecfunServices.h"
+#include "src/eptools/potentials/quad/QuadPotProximal.h"
+#include "src/eptools/potentials/quad/GaussHermiteRule.h"
+
+//BEGINNS(eptools)
+  /**
+   * Logistic (sigmoid) potential:
+   *   t(s) = sigma(y (s + soff)),  sigma(x) = 1/(1 + exp(-x))
+   * Here, y must be in {-1,+1}.
+   * Parameters: y, soff. 'exactQuad' is not a parameter.
+   * <p>
+   * If 'exactQuad'==false, sigma(x) is approximated by a fixed mixture of
+   * scaled probits:
+   *   sigma(x) approx sigt(x) = sum_k c_k Phi(lam_k x),
+   * c_k > 0, sum_k c_k = 1, K = 5 components. This is possible since the
+   * logistic distribution is a scale mixture of Gaussians. The moments of
+   * the tilted distribution are then sums of probit terms (see
+   * 'EPPotProbit'), they cost about K times a probit update. The
+   * coefficients have been fitted to minimize
+   *   sup_x |sigma(x) - sigt(x)|  <  1.1e-6.
+   * Since Z is an expectation of t(s), its error is bounded by the same
+   * value for all cavity moments. The relative errors in alpha, nu are
+   * below 1.6e-3 for |y (mu{-} + soff)| <= 'tailThres' sqrt(1 + rho{-})
+   * (measured; the largest errors are in nu, close to this threshold).
+   * Beyond, sigma(x) behaves like exp(-|x|) in its tails, while sigt(x)
+   * has Gaussian tails, so these cases are passed to quadrature.
+   * <p>
+   * If 'exactQuad'==true, all moments are computed by quadrature. We use
+   * Gauss-Hermite quadrature of order 'quadOrder' after a Laplace
+   * transformation (see 'EPPotQuadLaplaceApprox'): the mode s_* of the
+   * tilted distribution is found by 'proximal', and the integration
+   * variable is standardized by the curvature there. The result is
+   * checked against a rule of order 'checkOrder'. If they differ by more
+   * than 'quadTol' (strongly skewed tilted distributions, large rho{-}),
+   * we fall back to the trapezoidal rule on an interval around s_*
+   * covering all but exp(-'quadRange') of the mass. Relative errors are
+   * around 1e-10. Fractional updates are supported in this case only.
+   * <p>
+   * We implement 'QuadPotProximal' (with a safeguarded Newton method for
+   * 'proximal'), so the potential can also be used with generic
+   * quadrature code.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class EPPotLogistic : public EPScalarPotential,public QuadPotProximal
+  {
+  protected:
+    // Members
+
+    double yscal,soff;
+    bool exactQuad;
+    Handle<GaussHermiteRule> ghRule,ghCheck;
+
+  public:
+    // Constants
+
+    static const int numComp=5;
+    static const int quadOrder=32;
+    static const int checkOrder=20;
+    static const int maxTrapNodes=100000;
+    static const double quadTol=1e-10;
+    static const double quadRange=40.0;
+    static const double tailThres=3.0;
+
+    // Public methods
+
+    explicit EPPotLogistic(double py,double psoff=0.0,
+			   bool pexactQuad=false) :
+      soff(psoff),exactQuad(pexactQuad),
+      ghRule(new GaussHermiteRule(quadOrder)),
+      ghCheck(new GaussHermiteRule(checkOrder)) {
+      setTarget(py);
+    }
+
+    explicit EPPotLogistic(bool pexactQuad=false) :
+      soff(0.0),exactQuad(pexactQuad),
+      ghRule(new GaussHermiteRule(quadOrder)),
+      ghCheck(new GaussHermiteRule(checkOrder)) {
+      setTarget(1.0);
+    }
+
+    virtual double getTarget() const {
+      return yscal;
+    }
+
+    virtual void setTarget(double py) {
+      if (py!=-1.0 && py!=1.0)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      yscal=py;
+    }
+
+    virtual double getSOff() const {
+      return soff;
+    }
+
+    virtual void setSOff(double psoff) {
+      soff=psoff;
+    }
+
+    virtual bool getExactQuad() const {
+      return exactQuad;
+    }
+
+    int numPars() const {
+      return 2;
+    }
+
+    void getPars(double* pv) const {
+      pv[0]=yscal; pv[1]=soff;
+    }
+
+    void setPars(const double* pv) {
+      setTarget(pv[0]); setSOff(pv[1]);
+    }
+
+    bool isValidPars(const double* pv) const {
+      return (pv[0]==1.0 || pv[0]==-1.0);
+    }
+
+    bool suppFractional() const {
+      return exactQuad;
+    }
+
+    bool isLogConcave() const {
+      return true;
+    }
+
+    bool compMoments(const double* inp,double* ret,double* logz=0,
+		     double eta=1.0) const;
+
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    /*
+     * log Z depends on mu{-} + soff, so that d log Z / d soff = alpha. The
+     * derivative w.r.t. y (discrete) is 0.
+     */
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const {
+      if (!compMoments(inp,ret,logz,eta))
+	return false;
+      if (dlogz!=0) {
+	dlogz[0]=0.0; dlogz[1]=ret[0];
+      }
+
+      return true;
+    }
+
+    // 'QuadPotProximal' methods
+
+    bool hasFirstDerivatives() const {
+      return true;
+    }
+
+    bool hasSecondDerivatives() const {
+      return true;
+    }
+
+    bool hasWayPoints() const {
+      return false;
+    }
+
+    void getInterval(double&,bool& aInf,double&,bool& bInf,
+		     ArrayHandle<double>& wayPts) const {
+      aInf=bInf=true;
+      wayPts.changeRep(0);
+    }
+
+    /*
+     * With x = y (s + soff):
+     *   l(s) = log(1 + exp(-x)), l'(s) = -y sigma(-x),
+     *   l''(s) = sigma(x) sigma(-x)
+     */
+    double eval(double s,double* dl=0,double* ddl=0) const {
+      double x,sgp,sgm;
+
+      x=yscal*(s+soff);
+      sigmoids(x,sgp,sgm);
+      if (dl!=0) *dl=-yscal*sgm;
+      if (ddl!=0) *ddl=sgp*sgm;
+
+      return ((x<0.0)?(-x):0.0)+log1p(exp(-fabs(x)));
+    }
+
+    /**
+     * Newton's method on f(s) = rho l'(s) + s - h, safeguarded by the
+     * bracket 'initBracket'. Converges to full precision, which matters
+     * for small rho.
+     */
+    bool proximal(double h,double rho,double& sstar) const;
+
+    /**
+     * The root of f(s) = rho l'(s) + s - h lies between h and h + y rho.
+     */
+    void initBracket(double h,double rho,double& l,double& r) const {
+      if (yscal>0.0) {
+	l=h; r=h+rho;
+      } else {
+	l=h-rho; r=h;
+      }
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Moments under the probit mixture approximation. 'cmupbt' is
+     * mu{-} + soff.
+     */
+    void compMomentsMixture(double cmupbt,double crho,double& alpha,
+			    double& nu,double* logz) const;
+
+    /**
+     * Moments by quadrature after Laplace transformation.
+     */
+    bool compMomentsQuad(double cmu,double crho,double eta,double& alpha,
+			 double& nu,double* logz) const;
+
+    /**
+     * h(s) = eta l(s) + (s - mu{-})^2/(2 rho{-})
+     */
+    double evalH(double s,double cmu,double crho,double eta) const {
+      double temp=s-cmu;
+      return eta*eval(s)+0.5*temp*temp/crho;
+    }
+
+    /**
+     * If 'ntrap'==0, computes Gauss-Hermite sums for Z_til = int g(x) d x
+     * and E[D(s)], E[D(s)^2], E[l''(s)] (see 'compMomentsQuad'), where
+     * s = s_* + sigma x. Otherwise, the trapezoidal rule with 'ntrap'
+     * steps on ['sl','sr'] is used, and 'ztil' approximates
+     * int exp(h(s_*) - h(s)) d s.
+     * D(s) = sigma(-x) - sigma(-x_*) is computed as
+     * sigma(x_*) - sigma(x) if x_* < 0.
+     */
+    void quadSums(const GaussHermiteRule& rule,double sstar,double sigma,
+		  int ntrap,double sl,double sr,double cmu,double crho,
+		  double eta,double hsstar,double& ztil,double& ed1,
+		  double& ed2,double& eddl) const {
+      int k,nk;
+      const double* x=rule.getNodes(),* lwr=rule.getLogWeightRatios();
+      double s,sgp,sgm,sgpst,sgmst,dsg,term,step=0.0;
+
+      sigmoids(yscal*(sstar+soff),sgpst,sgmst);
+      if (ntrap==0)
+	nk=rule.getOrder();
+      else {
+	nk=ntrap+1; step=(sr-sl)/ntrap;
+      }
+      ztil=ed1=ed2=eddl=0.0;
+      for (k=0; k<nk; k++) {
+	if (ntrap==0) {
+	  s=sstar+sigma*x[k];
+	  term=exp(lwr[k]+hsstar-evalH(s,cmu,crho,eta));
+	} else {
+	  s=sl+k*step;
+	  term=exp(hsstar-evalH(s,cmu,crho,eta));
+	  if (k==0 || k==ntrap) term*=0.5;
+	}
+	sigmoids(yscal*(s+soff),sgp,sgm);
+	dsg=(sgmst>0.5)?(sgpst-sgp):(sgm-sgmst);
+	ztil+=term; eddl+=term*sgp*sgm;
+	term*=dsg;
+	ed1+=term; ed2+=term*dsg;
+      }
+      if (ztil>0.0) {
+	ed1/=ztil; ed2/=ztil; eddl/=ztil;
+      }
+      if (ntrap>0) ztil*=step;
+    }
+
+    /**
+     * sgp = sigma(x), sgm = sigma(-x)
+     */
+    static void sigmoids(double x,double& sgp,double& sgm) {
+      double temp=exp(-fabs(x));
+
+      if (x>=0.0) {
+	sgp=1.0/(1.0+temp); sgm=temp*sgp;
+      } else {
+	sgm=1.0/(1.0+temp); sgp=temp*sgm;
+      }
+    }
+  };
+
+  // Inline methods
+
+  inline bool
+  EPPotLogistic::compMoments(const double* inp,double* ret,double* logz,
+			     double eta) const
+  {
+    double cmu=inp[0],crho=inp[1];
+
+    if (crho<1e-14 || eta<1e-10 || eta>1.0 || (!exactQuad && eta!=1.0))
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    if (exactQuad || fabs(yscal*(cmu+soff))>tailThres*sqrt(1.0+crho))
+      return compMomentsQuad(cmu,crho,eta,ret[0],ret[1],logz);
+    compMomentsMixture(cmu+soff,crho,ret[0],ret[1],logz);
+
+    return true;
+  }
+
+  /*
+   * Component k corresponds to a probit potential Phi(lam_k y (s + soff)),
+   * with log Z_k = log Phi(u_k), u_k = a_k (mu{-} + soff),
+   * a_k = lam_k y / sqrt(1 + lam_k^2 rho{-}), alpha_k = a_k N(u_k)/Phi(u_k).
+   * With posterior weights w_k = c_k Z_k / Z:
+   *   alpha = sum_k w_k alpha_k,
+   *   nu    = alpha^2 - sum_k w_k Z_k''/Z_k,
+   * where Z_k''/Z_k = -alpha_k lam_k^2 (mu{-} + soff)/(1 + lam_k^2 rho{-})
+   * (derivatives w.r.t. mu{-}).
+   */
+  inline void
+  EPPotLogistic::compMomentsMixture(double cmupbt,double crho,double& alpha,
+				    double& nu,double* logz) const
+  {
+    int k;
+    double lsq,a,u,lmax,sumw,temp;
+    double lz[numComp],alk[numComp],d2k[numComp];
+    // log c_k, lam_k
+    double logc[] = {-3.531965633102069,  -1.4505098054013008,
+		     -0.8271443045521304, -1.3282011369929463,
+		     -3.3798618386784307};
+    double lam[]  = {0.29789600005296546, 0.42270673658882124,
+		     0.5946847848266646,  0.8286820763300928,
+		     1.1518268049960059};
+
+    for (k=0; k<numComp; k++) {
+      lsq=lam[k]*lam[k];
+      temp=1.0+lsq*crho;
+      a=yscal*lam[k]/sqrt(temp);
+      u=a*cmupbt;
+      lz[k]=logc[k]+SpecfunServices::logCdfNormal(u);
+      alk[k]=a*SpecfunServices::derivLogCdfNormal(u);
+      d2k[k]=-alk[k]*lsq*cmupbt/temp;
+    }
+    for (k=1,lmax=lz[0]; k<numComp; k++)
+      if (lz[k]>lmax) lmax=lz[k];
+    for (k=0,sumw=0.0; k<numComp; k++)
+      sumw+=(lz[k]=exp(lz[k]-lmax));
+    alpha=nu=0.0;
+    for (k=0; k<numComp; k++) {
+      temp=lz[k]/sumw;
+      alpha+=temp*alk[k]; nu-=temp*d2k[k];
+    }
+    nu+=alpha*alpha;
+    if (logz!=0) *logz=lmax+log(sumw);
+  }
+
+  /*
+   * Safeguarded Newton ('rtsafe' in Numerical Recipes):
+   * f(s) = rho l'(s) + s - h is increasing, f'(s) >= 1. We bisect instead
+   * if the Newton step leaves the current bracket or does not decrease
+   * fast enough.
+   */
+  inline bool EPPotLogistic::proximal(double h,double rho,double& sstar)
+    const
+  {
+    int it;
+    double l,r,s,f,df,dx,dxold;
+
+    if (rho<(1e-16))
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    initBracket(h,rho,l,r);
+    s=0.5*(l+r); dx=dxold=r-l;
+    for (it=0; it<100; it++) {
+      eval(s,&f,&df);
+      f=rho*f+s-h; df=rho*df+1.0;
+      if (f==0.0) break;
+      if (f<0.0) l=s; else r=s;
+      if (((s-r)*df-f)*((s-l)*df-f)>0.0 || fabs(2.0*f)>fabs(dxold*df)) {
+	dxold=dx; dx=0.5*(r-l); s=l+dx;
+      } else {
+	dxold=dx; dx=f/df; s-=dx;
+      }
+      if (fabs(dx)<=1e-15*(fabs(s)+sqrt(rho))) break;
+    }
+    sstar=s;
+
+    return (it<100);
+  }
+
+  /*
+   * h(s) = eta l(s) + (s - mu{-})^2/(2 rho{-}) has its minimum at s_*, the
+   * proximal map for (mu{-}, eta rho{-}). With sigma = h''(s_*)^{-1/2},
+   * x = (s - s_*)/sigma:
+   *   Z = sigma exp(-h(s_*)) (2 pi rho{-})^{-1/2} int g(x) d x,
+   *   g(x) = exp(h(s_*) - h(s_* + sigma x)).
+   * Since Z is a function of mu{-} via t(s)^eta only:
+   *   alpha = E[-eta l'(s)],  nu = E[eta l''(s)] - Var[eta l'(s)]
+   * w.r.t. the tilted distribution. This is accurate for small rho{-} as
+   * well, where (E[s] - mu{-})/rho{-} suffers from cancellation. We use
+   * differences D(s) = sigma(-x) - sigma(-x_*), computed without
+   * cancellation (see 'quadSums').
+   * <p>
+   * Gauss-Hermite sums are accepted if 'ghRule' and 'ghCheck' agree up to
+   * 'quadTol'. This fails if the tilted distribution is skewed (large
+   * rho{-}, mu{-} close to the soft step). We then use the trapezoidal
+   * rule on [s_L, s_R], where h(s) - h(s_*) > 'quadRange' outside. Since
+   * g(x) is analytic in a strip (poles of sigma(.) at +-i pi), the
+   * error decays exponentially in the inverse step size. The step size
+   * is bounded by 1/2 and by a quarter of 1/sqrt(max_s h''(s)).
+   */
+  inline bool
+  EPPotLogistic::compMomentsQuad(double cmu,double crho,double eta,
+				 double& alpha,double& nu,double* logz) const
+  {
+    int nk;
+    double sstar,dl,ddl,sigma,hsstar,temp,sl,sr,step;
+    double ztil,ed1,ed2,eddl,zchk,ec1,ec2,ecddl;
+
+    if (!proximal(cmu,eta*crho,sstar))
+      return false;
+    temp=sstar-cmu;
+    hsstar=eta*eval(sstar,&dl,&ddl)+0.5*temp*temp/crho;
+    sigma=sqrt(crho/(1.0+eta*crho*ddl));
+    quadSums(*ghRule,sstar,sigma,0,0.0,0.0,cmu,crho,eta,hsstar,ztil,ed1,
+	     ed2,eddl);
+    quadSums(*ghCheck,sstar,sigma,0,0.0,0.0,cmu,crho,eta,hsstar,zchk,ec1,
+	     ec2,ecddl);
+    temp=ed2-ed1*ed1;
+    if (!(ztil>0.0) || fabs(ztil-zchk)>quadTol*ztil ||
+	fabs(ed1-ec1)>quadTol*(fabs(dl)+fabs(ed1)) ||
+	fabs(eddl-ecddl)>quadTol*eddl ||
+	fabs(temp-ec2+ec1*ec1)>quadTol*eddl) {
+      // Trapezoidal rule
+      for (temp=1.0; temp<1e8; temp*=2.0)
+	if (evalH(sstar-temp*sigma,cmu,crho,eta)-hsstar>quadRange) break;
+      sl=sstar-temp*sigma;
+      for (temp=1.0; temp<1e8; temp*=2.0)
+	if (evalH(sstar+temp*sigma,cmu,crho,eta)-hsstar>quadRange) break;
+      sr=sstar+temp*sigma;
+      step=0.25/sqrt(0.25*eta+1.0/crho);
+      if (step>0.5) step=0.5;
+      if ((sr-sl)/step>maxTrapNodes)
+	return false;
+      nk=(int) ceil((sr-sl)/step);
+      quadSums(*ghRule,sstar,sigma,nk,sl,sr,cmu,crho,eta,hsstar,ztil,ed1,
+	       ed2,eddl);
+      if (!(ztil>0.0))
+	return false;
+      ztil/=sigma;
+    }
+    // NOTE: l'(s) = -y sigma(-x)
+    alpha=eta*(-dl+yscal*ed1);
+    nu=eta*(eddl-eta*(ed2-ed1*ed1));
+    if (logz!=0)
+      *logz=log(sigma*ztil)-hsstar-0.5*(SpecfunServices::m_ln2pi+log(crho));
+
+    return true;
+  }
+//ENDNS
+
+#endif
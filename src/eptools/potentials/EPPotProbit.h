@@ -16,8 +16,40 @@
 #include "src/eptools/potentials/EPScalarPotential.h"
 #include "src/eptools/potentials/SpecfunServices.h"
 #include "src/eptools/potentials/quad/QuadPotProximalNewton.h"
+#include "lhotse/optimize/BatchOneDimSolver.h"
 
 //BEGINNS(eptools)
+  /**
+   * Function object for 'BatchOneDimSolver', represents proximal map
+   * criteria
+   *   f_i(s) = rho_i l_i'(s) + s - h_i
+   * for probit potentials with parameters y_i, soff_i.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class EPPotProbit_BatchFunc
+  {
+  public:
+    // Members
+
+    const double* h,* rho;
+    const double* yp,* soffp; // Parameters y, soff
+    int yinc,soffinc;
+
+    // Public methods
+
+    void eval(int i,double x,double& f,double& df) const {
+      double y=yp[i*yinc],z,temp;
+
+      z=y*(x+soffp[i*soffinc]);
+      temp=SpecfunServices::derivLogCdfNormal(z);
+      // l'(s) = -y temp, l''(s) = temp (temp + z)
+      f=rho[i]*(-y*temp)+x-h[i];
+      df=rho[i]*temp*(temp+z)+1.0;
+    }
+  };
+
   /**
    * Probit (Gaussian c.d.f.) potential:
    *   t(s) = Phi(y (s + soff))       ['hardStep'==false]
@@ -99,6 +131,25 @@
     bool compMoments(const double* inp,double* ret,double* logz=0,
 		     double eta=1.0) const;
 
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    /*
+     * log Z depends on mu{-} + soff, so that d log Z / d soff = alpha. The
+     * derivative w.r.t. y (discrete) is 0.
+     */
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const {
+      if (!compMoments(inp,ret,logz,eta))
+	return false;
+      if (dlogz!=0) {
+	dlogz[0]=0.0; dlogz[1]=ret[0];
+      }
+
+      return true;
+    }
+
     // 'QuadPotProximalNewton' methods
 
     bool hasFirstDerivatives() const {
@@ -135,12 +186,34 @@
     }
 
     void initBracket(double h,double rho,double& l,double& r) const {
+      initBracketInt(yscal,soff,h,rho,l,r);
+    }
+
+    /**
+     * Batched proximal map, using 'BatchOneDimSolver'. The parameters are
+     * y, soff (see 'QuadPotProximal::proximalBatch').
+     */
+    int proximalBatch(int n,const double* h,const double* rho,double* sstar,
+		      bool* succ,const double* pv=0,const int* pshrd=0) const;
+
+    void evalBatch(int n,int m,const double* s,double* l,double* ddl=0,
+		   const double* pv=0,const int* pshrd=0) const;
+
+    bool hasBatchPars() const {
+      return true;
+    }
+
+    /**
+     * Implements 'initBracket' for parameters 'y', 'soff'.
+     */
+    static void initBracketInt(double y,double soff,double h,double rho,
+			       double& l,double& r) {
       double c=rho*SpecfunServices::m_sqrt2/SpecfunServices::m_sqrtpi,temp;
 
-      temp=yscal*(h+soff);
+      temp=y*(h+soff);
       l=(temp>=0.0)?h:((h-rho*soff)/(1+rho));
       temp+=c;
-      r=(temp>=0.0)?(h+yscal*c):((h-rho*soff+yscal*c)/(1+rho));
+      r=(temp>=0.0)?(h+y*c):((h-rho*soff+y*c)/(1+rho));
       if (r<l) {
 	temp=l; l=r; r=temp;
       }
@@ -180,6 +253,60 @@
 
     return true;
   }
+
+  inline int
+  EPPotProbit::proximalBatch(int n,const double* h,const double* rho,
+			     double* sstar,bool* succ,const double* pv,
+			     const int* pshrd) const
+  {
+    double pown[2];
+    const double* pptr[2];
+    int pinc[2],i;
+    EPPotProbit_BatchFunc func;
+
+    if (hardStep) throw NotImplemException(EXCEPT_MSG(""));
+    if (n<=0) return 0;
+    batchParsAccess(n,pv,pshrd,pown,pptr,pinc);
+    func.h=h; func.rho=rho;
+    func.yp=pptr[0]; func.yinc=pinc[0];
+    func.soffp=pptr[1]; func.soffinc=pinc[1];
+    // Initial brackets (written to 'sstar', 'bR')
+    ArrayHandle<double> bR(n);
+    for (i=0; i<n; i++) {
+      if (rho[i]<(1e-16))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      initBracketInt(func.yp[i*func.yinc],func.soffp[i*func.soffinc],h[i],
+		     rho[i],sstar[i],bR[i]);
+    }
+
+    return BatchOneDimSolver::newton(func,n,sstar,bR.p(),acc,facc,sstar,
+				     succ);
+  }
+
+  inline void
+  EPPotProbit::evalBatch(int n,int m,const double* s,double* l,double* ddl,
+			 const double* pv,const int* pshrd) const
+  {
+    double pown[2],y,so,z,temp;
+    const double* pptr[2];
+    int pinc[2],i,j;
+
+    if (hardStep) throw NotImplemException(EXCEPT_MSG(""));
+    if (n<=0 || m<=0) return;
+    batchParsAccess(n,pv,pshrd,pown,pptr,pinc);
+    for (i=0; i<n; i++,s+=m,l+=m) {
+      y=pptr[0][i*pinc[0]]; so=pptr[1][i*pinc[1]];
+      for (j=0; j<m; j++) {
+	z=y*(s[j]+so);
+	l[j]=-SpecfunServices::logCdfNormal(z);
+	if (ddl!=0) {
+	  temp=SpecfunServices::derivLogCdfNormal(z);
+	  ddl[j]=temp*(temp+z);
+	}
+      }
+      if (ddl!=0) ddl+=m;
+    }
+  }
 //ENDNS
 
 #endif
@@ -105,19 +105,75 @@
       return compMomentsInt(cmu,crho,xi*eta,yscal,kappa,ret[0],ret[1],logz);
     }
 
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const {
+      double cmu=inp[0],crho=inp[1];
+
+      if (crho<1e-14 || eta<1e-10 || eta>1.0)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      bool rstat=compMomentsInt(cmu,crho,xi*eta,yscal,kappa,ret[0],ret[1],
+				logz,dlogz);
+      if (rstat && dlogz!=0)
+	dlogz[1]*=eta; // Derivative w.r.t. xi, not xi*eta
+
+      return rstat;
+    }
+
+    int compMomentsBatch(int n,const double* cmu,const double* crho,
+			 double* alpha,double* nu,bool* succ,double* logz=0,
+			 const double* pv=0,const int* pshrd=0,
+			 double eta=1.0) const;
+
+    bool suppBatchPars() const {
+      return true;
+    }
+
     /**
      * Implements 'compMoments'. Called by 'EPPotLaplace' as well.
      * NOTE: No fractional parameter 'eta'. Multiply this parameter into xi.
+     * If 'dlogz' is given, the derivatives of log Z w.r.t. y, xi, kappa
+     * are returned there (see 'compMomentsDerivs').
      */
     static bool compMomentsInt(double cmu,double crho,double xi,double yscal,
 			       double kappa,double& alpha,double& nu,
-			       double* logz);
+			       double* logz,double* dlogz=0);
+
+    /**
+     * Batched version of 'compMomentsInt' (without 'dlogz'), implements
+     * 'compMomentsBatch'. Called by 'EPPotLaplace' as well. Lane i has
+     * cavity moments 'cmu[i]', 'crho[i]' and parameters
+     *   xi = 'xifct' * 'xip[i*xiinc]', y = 'yp[i*yinc]',
+     *   kappa = 'kapp[i*kapinc]'
+     * (increment 0 for shared parameters). Results are the same as for
+     * 'compMomentsInt', which always succeeds.
+     */
+    static void compMomentsIntBatch(int n,const double* cmu,
+				    const double* crho,double xifct,
+				    const double* xip,int xiinc,
+				    const double* yp,int yinc,
+				    const double* kapp,int kapinc,
+				    double* alpha,double* nu,double* logz);
   };
 
+  /*
+   * Derivatives: With r = xi (y - s), P_hat(r) is a mixture of two
+   * truncated Gaussians, q is the mass of r<0. log t(s) has derivatives
+   * -r (w.r.t. kappa), (r/xi) (kappa - I{r<0}) (w.r.t. xi), so that
+   *   d log Z / d kappa = -E_hat[r],
+   *   d log Z / d xi    = (-kappa E_hat[r] + E_hat[r I{r<0}])/xi,
+   * where E_hat[r] = xi (y - mu{-} - alpha rho{-}), and
+   *   E_hat[r I{r<0}] = q (m_2 - sqrt(rho_r) lambda),
+   * m_2 = h_r + (1-kappa) rho_r, lambda the inverse Mills ratio of the
+   * truncated component.
+   */
   inline bool
   EPPotQuantileRegress::compMomentsInt(double cmu,double crho,double xi,
 				       double yscal,double kappa,double& alpha,
-				       double& nu,double* logz)
+				       double& nu,double* logz,double* dlogz)
   {
     double temp,kapc,hh,hr,rhor,sqrhor,argf,li01,li02,logi0,q;
 
@@ -143,9 +199,110 @@
     alpha = xi*(kappa-q);
     nu = xi*xi*(exp(-0.5*(hh*hh/crho+SpecfunServices::m_ln2pi)-logi0)/sqrhor
 		- q*(1.0-q));
+    if (dlogz!=0) {
+      temp = hr-xi*alpha*crho; // E_hat[r]
+      dlogz[0] = -alpha;
+      dlogz[1] = (q*(hr+kapc*rhor-sqrhor*SpecfunServices::derivLogCdfNormal(
+		   argf-sqrhor))-kappa*temp)/xi;
+      dlogz[2] = -temp;
+    }
 
     return true;
   }
+
+  /*
+   * Lanes are processed in blocks. The arguments of both log c.d.f. terms
+   * are computed first for the whole block, then evaluated by the array
+   * version of 'SpecfunServices::logCdfNormal'. The dominant term is
+   * selected by masks rather than branches. Apart from that, expressions
+   * are the same as in 'compMomentsInt'.
+   */
+#define QUANTREGR_BLOCK 64
+  inline void
+  EPPotQuantileRegress::compMomentsIntBatch(int n,const double* cmu,
+					    const double* crho,double xifct,
+					    const double* xip,int xiinc,
+					    const double* yp,int yinc,
+					    const double* kapp,int kapinc,
+					    double* alpha,double* nu,
+					    double* logz)
+  {
+    int i,j,k,nb;
+    bool sel;
+    double xi,kappa,kapc,hh,hr,rhor,sqrhor,argf,li01,li02,logi0,q,temp;
+    double lc01[QUANTREGR_BLOCK],lc02[QUANTREGR_BLOCK];
+    double pf01[QUANTREGR_BLOCK],pf02[QUANTREGR_BLOCK];
+
+    for (j=0; j<n; j+=QUANTREGR_BLOCK) {
+      nb=(n-j<QUANTREGR_BLOCK)?(n-j):QUANTREGR_BLOCK;
+      for (k=0; k<nb; k++) {
+	i=j+k;
+	xi=xifct*xip[i*xiinc]; kappa=kapp[i*kapinc];
+	kapc=1.0-kappa;
+	hh=yp[i*yinc]-cmu[i];
+	hr=xi*hh; rhor=xi*xi*crho[i];
+	sqrhor=xi*sqrt(crho[i]);
+	argf=kappa*sqrhor-hr/sqrhor;
+	pf01[k]=0.5*kappa*(kappa*rhor-2*hr); lc01[k]=-argf;
+	pf02[k]=0.5*kapc*(kapc*rhor+2*hr);   lc02[k]=argf-sqrhor;
+      }
+      SpecfunServices::logCdfNormal(lc01,lc01,nb);
+      SpecfunServices::logCdfNormal(lc02,lc02,nb);
+      for (k=0; k<nb; k++) {
+	i=j+k;
+	xi=xifct*xip[i*xiinc]; kappa=kapp[i*kapinc];
+	hh=yp[i*yinc]-cmu[i];
+	sqrhor=xi*sqrt(crho[i]);
+	li01=pf01[k]+lc01[k]; li02=pf02[k]+lc02[k];
+	sel=(li01>=li02);
+	temp=exp(sel?(li02-li01):(li01-li02));
+	logi0=(sel?li01:li02)+log1p(temp);
+	q=(sel?temp:1.0)/(1.0+temp);
+	if (logz!=0) logz[i]=logi0;
+	alpha[i]=xi*(kappa-q);
+	nu[i]=xi*xi*(exp(-0.5*(hh*hh/crho[i]+SpecfunServices::m_ln2pi)-logi0)/
+		     sqrhor-q*(1.0-q));
+      }
+    }
+  }
+#undef QUANTREGR_BLOCK
+
+  inline int
+  EPPotQuantileRegress::compMomentsBatch(int n,const double* cmu,
+					 const double* crho,double* alpha,
+					 double* nu,bool* succ,double* logz,
+					 const double* pv,const int* pshrd,
+					 double eta) const
+  {
+    int i,k,pinc[3];
+    double pown[3];
+    const double* pptr[3];
+
+    if (n<=0) return 0;
+    if (eta<1e-10 || eta>1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (i=0; i<n; i++)
+      if (crho[i]<1e-14)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+    if (pv==0) {
+      getPars(pown);
+      for (k=0; k<3; k++) {
+	pptr[k]=pown+k; pinc[k]=0;
+      }
+    } else {
+      if (pshrd==0) throw InvalidParameterException(EXCEPT_MSG(""));
+      for (k=0; k<3; k++) {
+	pptr[k]=pv; pinc[k]=pshrd[k]?0:1;
+	pv+=(pshrd[k]?1:n);
+      }
+    }
+    compMomentsIntBatch(n,cmu,crho,eta,pptr[1],pinc[1],pptr[0],pinc[0],
+			pptr[2],pinc[2],alpha,nu,logz);
+    for (i=0; i<n; i++)
+      succ[i]=true;
+
+    return 0;
+  }
 //ENDNS
 
 #endif
@@ -94,6 +94,13 @@
     bool compMoments(const double* inp,double* ret,double* logz=0,
 		     double eta=1.0) const;
 
+    bool suppLogZDerivs() const {
+      return true;
+    }
+
+    bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+			   double* dlogz,double eta=1.0) const;
+
   protected:
     // Internal methods
 
@@ -138,6 +145,34 @@
     return rstat;
   }
 
+  /*
+   * Z = (1-p) N(0|mu{-},rho{-}) + p N(0|mu{-},rho{-}+v). If r_2 is the
+   * posterior probability of the slab:
+   *   d log Z / d c = r_2 - p,
+   *   d log Z / d v = (r_2/2) (mu{-}^2/(rho{-}+v)^2 - 1/(rho{-}+v)).
+   */
+  inline bool
+  EPPotSpikeSlab::compMomentsDerivs(const double* inp,double* ret,
+				    double* logz,double* dlogz,double eta) const
+  {
+    double cmu=inp[0],crho=inp[1],temp,r2,pp;
+
+    if (!compMoments(inp,ret,logz,eta))
+      return false;
+    if (dlogz!=0) {
+      // log(Z_2/Z_1) as in 'compMomentsInt', with rho2 = v/(1+v/rho{-})
+      temp=cmu/crho;
+      temp=lpscal+0.5*(vscal/(1.0+vscal/crho)*temp*temp-log1p(vscal/crho));
+      r2=1.0/(1.0+exp(-temp));
+      pp=1.0/(1.0+exp(-lpscal));
+      temp=1.0/(crho+vscal);
+      dlogz[0]=r2-pp;
+      dlogz[1]=0.5*r2*temp*(cmu*cmu*temp-1.0);
+    }
+
+    return true;
+  }
+
   /*
    * Adapted from 'EPPotSpikeSlab' in module 'epscal/potentials', but using
    * the simplification implemented in 'EPPotGaussMixture'.
@@ -13,6 +13,7 @@
 #include "src/eptools/potentials/EPPotLaplace.h"
 #include "src/eptools/potentials/EPPotGaussMixture.h"
 #include "src/eptools/potentials/EPPotSpikeSlab.h"
+#include "src/eptools/potentials/EPPotLogistic.h"
 
 //BEGINNS(eptools)
   const int EPPotentialFactory::potGaussian;
@@ -23,6 +24,8 @@
   const int EPPotentialFactory::potQuantRegress;
   const int EPPotentialFactory::potGaussMixture;
   const int EPPotentialFactory::potSpikeSlab;
+  const int EPPotentialFactory::potLogistic;
+  const int EPPotentialFactory::potLogisticQuad;
   const int EPPotentialFactory::potLast;
 #ifdef HAVE_WORKAROUND
 #include "src/eptools/potentials/EPPotentialFactory_workaround.cc"
@@ -60,6 +63,10 @@
     case potSpikeSlab:
       ret = EPPotSpikeSlab::getArgumentGroup_static();
       break;
+    case potLogistic:
+    case potLogisticQuad:
+      ret = EPPotLogistic::getArgumentGroup_static();
+      break;
 #ifdef HAVE_WORKAROUND
     default:
       ret = getArgumentGroup_workaround(pid);
@@ -106,9 +113,18 @@
     case potSpikeSlab:
       rpot = new EPPotSpikeSlab(pv[0],pv[1]);
       break;
+    case potLogistic:
+      rpot = new EPPotLogistic(pv[0],pv[1],false);
+      break;
+    case potLogisticQuad:
+      rpot = new EPPotLogistic(pv[0],pv[1],true);
+      break;
 #ifdef HAVE_WORKAROUND
     default:
       rpot = create_workaround(pid,pv,annot);
+#else
+    default:
+      (void) annot; // Only used by workaround
 #endif
     }
 
@@ -151,9 +167,18 @@
     case potSpikeSlab:
       rpot = new EPPotSpikeSlab();
       break;
+    case potLogistic:
+      rpot = new EPPotLogistic(false);
+      break;
+    case potLogisticQuad:
+      rpot = new EPPotLogistic(true);
+      break;
 #ifdef HAVE_WORKAROUND
     default:
       rpot = createDefault_workaround(pid,pv,annot);
+#else
+    default:
+      (void) annot; // Only used by workaround
 #endif
     }
 
@@ -51,7 +51,9 @@
     static const int potQuantRegress=5;
     static const int potGaussMixture=6;
     static const int potSpikeSlab   =7;
-    static const int potLast        =7;
+    static const int potLogistic    =8;
+    static const int potLogisticQuad=9;
+    static const int potLast        =9;
 #ifdef HAVE_WORKAROUND
 #include "src/eptools/potentials/EPPotentialFactory_workaround.h"
 #endif
@@ -31,6 +31,10 @@
       potIDs[potGaussMixture]  = "GaussMixture";
       potNames["SpikeSlab"]    = potSpikeSlab;
       potIDs[potSpikeSlab]     = "SpikeSlab";
+      potNames["Logistic"]     = potLogistic;
+      potIDs[potLogistic]      = "Logistic";
+      potNames["LogisticQuad"] = potLogisticQuad;
+      potIDs[potLogisticQuad]  = "LogisticQuad";
 #ifdef HAVE_WORKAROUND
       setup_workaround();
 #endif
@@ -13,4 +13,26 @@
 
   const int EPScalarPotential::atypeUnivariate;
   const int EPScalarPotential::atypeBivarPrec;
+
+  int EPScalarPotential::compMomentsBatch(int n,const double* cmu,
+					  const double* crho,double* alpha,
+					  double* nu,bool* succ,double* logz,
+					  const double* pv,const int*,
+					  double eta) const
+  {
+    int i,nfail=0;
+    double inp[2],ret[2];
+
+    if (getArgumentGroup()!=atypeUnivariate || pv!=0)
+      throw NotImplemException(EXCEPT_MSG(""));
+    for (i=0; i<n; i++) {
+      inp[0]=cmu[i]; inp[1]=crho[i];
+      if ((succ[i]=compMoments(inp,ret,(logz!=0)?(logz+i):0,eta))) {
+	alpha[i]=ret[0]; nu[i]=ret[1];
+      } else
+	nfail++;
+    }
+
+    return nfail;
+  }
 //ENDNS
@@ -144,6 +144,98 @@
      */
     virtual bool compMoments(const double* inp,double* ret,double* logz=0,
 			     double eta=1.0) const = 0;
+
+    /**
+     * Extension of 'compMoments', which also returns derivatives of log Z
+     * w.r.t. the potential parameters (see 'getPars') in 'dlogz' (size
+     * 'numPars'). Entries for parameters which log Z does not depend on
+     * smoothly (e.g., discrete targets, construction parameters) are 0.
+     * If 'dlogz'==0, this is the same as 'compMoments'.
+     * <p>
+     * For potentials in group 'atypeUnivariate', the derivatives are
+     * w.r.t. log Z of P_hat(s) for fixed cavity moments. At an EP fixed
+     * point, the gradient of the EP log marginal likelihood w.r.t. the
+     * parameters of t_j is the gradient of log Z_j (cavity fixed), see
+     * 'FactorizedEPDriver::compLogMarginal'.
+     * <p>
+     * The default implementation supports 'dlogz'==0 only. Subclasses
+     * for which 'suppLogZDerivs' returns true overwrite this method.
+     *
+     * @param inp   Input vector (cavity marginal)
+     * @param ret   Return vector
+     * @param logz  log Z ret. here. Optional
+     * @param dlogz Derivatives of log Z ret. here. Optional
+     * @param eta   S.a. Def.: 1
+     * @return      Success?
+     */
+    virtual bool compMomentsDerivs(const double* inp,double* ret,double* logz,
+				   double* dlogz,double eta=1.0) const {
+      if (dlogz!=0)
+	throw NotImplemException(EXCEPT_MSG(""));
+      return compMoments(inp,ret,logz,eta);
+    }
+
+    /**
+     * @return Does 'compMomentsDerivs' return derivatives?
+     */
+    virtual bool suppLogZDerivs() const {
+      return false;
+    }
+
+    /**
+     * Batched version of 'compMoments', for argument group
+     * 'atypeUnivariate' only. Lane i has cavity moments
+     * [mu{-},rho{-}] = ['cmu[i]','crho[i]'], and [alpha,nu] are returned
+     * in 'alpha[i]', 'nu[i]', log Z in 'logz[i]' (optional). 'succ[i]' is
+     * the return value of 'compMoments' for lane i. If it is false, the
+     * other return values for lane i are undefined.
+     * <p>
+     * By default, the potential parameters of this object are used for all
+     * lanes. If 'pv' is given, the parameters for lane i are taken from
+     * 'pv', 'pshrd' in the format used by 'DefaultPotManager' (see
+     * 'QuadPotProximal::proximalBatch'). This is supported iff
+     * 'suppBatchPars' returns true.
+     * <p>
+     * The default implementation calls 'compMoments' for each lane, it
+     * does not support 'pv'. Subclasses overwrite this if they can share
+     * work between lanes (e.g., 'EPPotQuadLaplaceApprox').
+     *
+     * @param n     Number of lanes
+     * @param cmu   Cavity means mu{-}
+     * @param crho  Cavity variances rho{-}
+     * @param alpha Values alpha ret. here
+     * @param nu    Values nu ret. here
+     * @param succ  Success flags ret. here
+     * @param logz  Values log Z ret. here. Optional
+     * @param pv    See above. Optional
+     * @param pshrd See above. Required iff 'pv' is given
+     * @param eta   See 'compMoments'. Def.: 1
+     * @return      Number of failed lanes
+     */
+    virtual int compMomentsBatch(int n,const double* cmu,const double* crho,
+				 double* alpha,double* nu,bool* succ,
+				 double* logz=0,const double* pv=0,
+				 const int* pshrd=0,double eta=1.0) const;
+
+    /**
+     * @return Does 'compMomentsBatch' support per-lane parameters?
+     */
+    virtual bool suppBatchPars() const {
+      return false;
+    }
+
+    /**
+     * Parallel code uses a separate potential object per thread (see
+     * 'PotentialManager::isThreadSafe'). This is safe unless objects
+     * created from the same arguments share state which they modify,
+     * such as quadrature services or accuracy schedules (see
+     * 'EPPotQuadLaplaceApprox'). The default implementation returns true.
+     *
+     * @return Can copies of this object be used concurrently?
+     */
+    virtual bool isThreadSafe() const {
+      return true;
+    }
   };
 //ENDNS
 
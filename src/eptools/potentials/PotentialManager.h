@@ -68,7 +68,159 @@
      * @return  Potential object t_j(.)
      */
     virtual const EPScalarPotential& getPot(int j) const = 0;
+
+    /**
+     * Local EP updates for potentials j = 'jind[i]', i=0,...,n-1, which
+     * must be in argument group 'EPScalarPotential::atypeUnivariate'. If
+     * 'jind'==0, j = i. Semantics of the other arguments as in
+     * 'EPScalarPotential::compMomentsBatch'.
+     * <p>
+     * The default implementation calls 'compMoments' on 'getPot(j)'.
+     * Subclasses overwrite this method in order to pass lanes with the same
+     * potential type to 'EPScalarPotential::compMomentsBatch' (e.g.,
+     * 'DefaultPotManager').
+     *
+     * @param n     Number of lanes
+     * @param jind  Potential indexes. Optional
+     * @param cmu   Cavity means mu{-}
+     * @param crho  Cavity variances rho{-}
+     * @param alpha Values alpha ret. here
+     * @param nu    Values nu ret. here
+     * @param succ  Success flags ret. here
+     * @param logz  Values log Z ret. here. Optional
+     * @return      Number of failed lanes
+     */
+    virtual int compMomentsBatch(int n,const int* jind,const double* cmu,
+				 const double* crho,double* alpha,double* nu,
+				 bool* succ,double* logz=0) const;
+
+    /**
+     * Potential parameters are represented by a flat vector (see
+     * 'PotManagerFactory', 'DefaultPotManager'). Returns its size.
+     * <p>
+     * The default implementation throws 'NotImplemException'.
+     *
+     * @return Size of flat parameter vector
+     */
+    virtual int parVecSize() const {
+      throw NotImplemException(EXCEPT_MSG(""));
+    }
+
+    /**
+     * Adds derivatives 'dpot' w.r.t. the parameters of t_j (size
+     * 'getPot(j).numPars()') to the corr. entries of 'dpvec', which is
+     * w.r.t. the flat parameter vector (size 'parVecSize'). Derivatives
+     * w.r.t. shared parameters are accumulated over all potentials.
+     * <p>
+     * The default implementation throws 'NotImplemException'.
+     *
+     * @param j     Potential index
+     * @param dpot  Derivatives w.r.t. parameters of t_j
+     * @param dpvec Derivatives w.r.t. flat parameter vector (I/O)
+     */
+    virtual void addParGradient(int,const double*,double*)
+      const {
+      throw NotImplemException(EXCEPT_MSG(""));
+    }
+
+    /**
+     * Variant of 'compMomentsBatch' which also accumulates derivatives of
+     * sum_i log Z_i w.r.t. the flat parameter vector into 'dpvec' (size
+     * 'parVecSize'; I/O), see 'EPScalarPotential::compMomentsDerivs'.
+     * Failed lanes do not contribute. If 'dpvec'==0, this is the same as
+     * 'compMomentsBatch'.
+     * <p>
+     * The default implementation calls 'compMomentsDerivs' on 'getPot(j)'
+     * and 'addParGradient'.
+     *
+     * @param n     Number of lanes
+     * @param jind  Potential indexes. Optional
+     * @param cmu   Cavity means mu{-}
+     * @param crho  Cavity variances rho{-}
+     * @param alpha Values alpha ret. here
+     * @param nu    Values nu ret. here
+     * @param succ  Success flags ret. here
+     * @param logz  Values log Z ret. here. Optional
+     * @param dpvec S.a. Optional
+     * @return      Number of failed lanes
+     */
+    virtual int compMomentsDerivsBatch(int n,const int* jind,
+				       const double* cmu,const double* crho,
+				       double* alpha,double* nu,bool* succ,
+				       double* logz=0,double* dpvec=0) const;
+
+    /**
+     * Parallel code creates one potential manager per thread, from the
+     * same arguments. This is safe iff all potentials are thread-safe
+     * (see 'EPScalarPotential::isThreadSafe'); otherwise, it has to run
+     * single-threaded.
+     * <p>
+     * The default implementation checks 'getPot(j)' for all j.
+     *
+     * @return Can managers created from the same arguments be used
+     *         concurrently?
+     */
+    virtual bool isThreadSafe() const {
+      for (int j=0; j<size(); j++)
+	if (!getPot(j).isThreadSafe()) return false;
+      return true;
+    }
   };
+
+  // Inline methods
+
+  inline int
+  PotentialManager::compMomentsBatch(int n,const int* jind,const double* cmu,
+				     const double* crho,double* alpha,
+				     double* nu,bool* succ,double* logz) const
+  {
+    int i,nfail=0;
+    double inp[2],ret[2];
+
+    for (i=0; i<n; i++) {
+      const EPScalarPotential& pot=getPot((jind==0)?i:jind[i]);
+      if (pot.getArgumentGroup()!=EPScalarPotential::atypeUnivariate)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      inp[0]=cmu[i]; inp[1]=crho[i];
+      if ((succ[i]=pot.compMoments(inp,ret,(logz!=0)?(logz+i):0))) {
+	alpha[i]=ret[0]; nu[i]=ret[1];
+      } else
+	nfail++;
+    }
+
+    return nfail;
+  }
+
+  inline int
+  PotentialManager::compMomentsDerivsBatch(int n,const int* jind,
+					   const double* cmu,
+					   const double* crho,double* alpha,
+					   double* nu,bool* succ,double* logz,
+					   double* dpvec) const
+  {
+    int i,j,nfail=0;
+    double inp[2],ret[2];
+    ArrayHandle<double> dpot;
+
+    if (dpvec==0)
+      return compMomentsBatch(n,jind,cmu,crho,alpha,nu,succ,logz);
+    for (i=0; i<n; i++) {
+      const EPScalarPotential& pot=getPot(j=(jind==0)?i:jind[i]);
+      if (pot.getArgumentGroup()!=EPScalarPotential::atypeUnivariate)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      if (dpot.size()<pot.numPars())
+	dpot.changeRep(pot.numPars());
+      inp[0]=cmu[i]; inp[1]=crho[i];
+      if ((succ[i]=pot.compMomentsDerivs(inp,ret,(logz!=0)?(logz+i):0,
+					 dpot.p()))) {
+	alpha[i]=ret[0]; nu[i]=ret[1];
+	addParGradient(j,dpot.p(),dpvec);
+      } else
+	nfail++;
+    }
+
+    return nfail;
+  }
 //ENDNS
 
 #endif
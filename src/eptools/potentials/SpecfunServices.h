@@ -60,6 +60,18 @@
      */
     static double logCdfNormal(double z);
 
+    /**
+     * Array version of 'logCdfNormal': res[i] = log Phi(z[i]). Lanes are
+     * partitioned by approximation region first (without branches), then
+     * each region is evaluated in a loop of its own. Results are the same
+     * as for 'logCdfNormal'.
+     *
+     * @param z   Arguments
+     * @param res Results ret. here (may coincide with 'z')
+     * @param n   Size of 'z', 'res'
+     */
+    static void logCdfNormal(const double* z,double* res,int n);
+
     /**
      * If Phi(z) denotes the c.d.f. of N(0,1), this method computes
      *   f(z) = (d/dz) log Phi(z) = N(z)/Phi(z).
@@ -99,6 +111,40 @@
     static int rootsCubicPolynomial(double a,double b,double c,double& x0,
 				    double& x1,double& x2);
 
+    /**
+     * Principal branch W_0(x) of the Lambert W function, defined by
+     *   W(x) e^{W(x)} = x,  W(x) >= -1,  x >= -1/e.
+     * We run a fixed number of Halley iterations from an initial guess
+     * (series at the branch point, Winitzki's approximation, or the
+     * asymptotic expansion for large x). Except at the branch point
+     * (w = -1, where the Halley step is undefined and we stop), there are
+     * no data-dependent loop exits.
+     *
+     * @param x Argument (>= -1/e)
+     * @return  W_0(x)
+     */
+    static double lambertW0(double x);
+
+    /**
+     * Computes W_0(e^a), without overflow for large a. For a above a
+     * threshold, we solve w + log w = a by Halley iterations, starting
+     * from the asymptotic expansion.
+     * NOTE: x = a - W_0(e^a) is the root of e^x + x = a.
+     *
+     * @param a Argument
+     * @return  W_0(e^a)
+     */
+    static double lambertWExp(double a);
+
+    /**
+     * Array version of 'lambertWExp': w[i] = W_0(e^{a[i]}).
+     *
+     * @param a Arguments
+     * @param w Results ret. here (may coincide with 'a')
+     * @param n Size of 'a', 'w'
+     */
+    static void lambertWExp(const double* a,double* w,int n);
+
   protected:
     // Internal static methods
 
@@ -176,6 +222,40 @@
     return res;
   }
 
+#define LOGCDF_BLOCK 64
+  /*
+   * Within a block, central lanes are collected at the front of 'ind', tail
+   * lanes at the back. Both slots are written for each lane, one of the
+   * counters is advanced.
+   */
+  inline void SpecfunServices::logCdfNormal(const double* z,double* res,
+					    int n)
+  {
+    int i,j,k,nb,nc,nt,isc,ind[LOGCDF_BLOCK];
+    double x;
+
+    for (j=0; j<n; j+=LOGCDF_BLOCK) {
+      nb=(n-j<LOGCDF_BLOCK)?(n-j):LOGCDF_BLOCK;
+      for (i=nc=0,nt=nb; i<nb; i++) {
+	isc=(fabs(z[j+i])<ERF_CODY_LIMIT1);
+	ind[nc]=ind[nt-1]=j+i;
+	nc+=isc; nt-=1-isc;
+      }
+      // Part 3 approximation (central region)
+      for (k=0; k<nc; k++) {
+	i=ind[k]; x=z[i];
+	res[i]=log1p((x/m_sqrt2)*erfRationalHelperR3(0.5*x*x))-m_ln2;
+      }
+      // Part 1 or 2 approximation (tails)
+      for (k=nt; k<nb; k++) {
+	i=ind[k]; x=z[i];
+	res[i]=(x<0.0)?(logPdfNormal(x)-log(-x)+log(erfRationalHelper(-x))):
+	  log1p(-exp(logPdfNormal(x))*erfRationalHelper(x)/x);
+      }
+    }
+  }
+#undef LOGCDF_BLOCK
+
   inline double SpecfunServices::derivLogCdfNormal(double z)
   {
     double res;
@@ -272,6 +352,71 @@
     return (nom+p[3])/(den+q[3]);
   }
 
+#define LAMBERTW_NUMITER 3
+  /*
+   * The initial guess is accurate to about 1e-2 relative error (or better),
+   * so that 3 Halley iterations (cubic convergence) attain double precision.
+   */
+  inline double SpecfunServices::lambertW0(double x)
+  {
+    int i;
+    double w,p,ew,wp1,f;
+
+    if (x<-1.0/M_E) {
+      if (x<-1.0/M_E-1e-15)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      return -1.0;
+    }
+    if (x<-0.32) {
+      // Series around branch point x = -1/e
+      p=sqrt(2.0*(M_E*x+1.0));
+      w=-1.0+p*(1.0+p*(-1.0/3.0+p*(11.0/72.0)));
+    } else if (x<3.0) {
+      // Winitzki's approximation
+      p=log1p(x);
+      w=p*(1.0-log1p(p)/(2.0+p));
+    } else {
+      // Asymptotic expansion
+      p=log(x); f=log(p);
+      w=p-f+f/p;
+    }
+    for (i=0; i<LAMBERTW_NUMITER; i++) {
+      ew=exp(w); f=w*ew-x; wp1=w+1.0;
+      if (wp1==0.0) break; // Branch point
+      w-=f/(ew*wp1-0.5*(w+2.0)*f/wp1);
+    }
+
+    return w;
+  }
+
+  /*
+   * For a >= log(3), the initial guess w = a - log(a) + log(a)/a is
+   * accurate enough for 3 Halley iterations on g(w) = w + log w - a, with
+   *   g'(w) = 1 + 1/w,  g''(w) = -1/w^2.
+   */
+  inline double SpecfunServices::lambertWExp(double a)
+  {
+    int i;
+    double w,g,dg,ddg;
+
+    if (a<1.0986) return lambertW0(exp(a));
+    g=log(a);
+    w=a-g+g/a;
+    for (i=0; i<LAMBERTW_NUMITER; i++) {
+      g=w+log(w)-a; dg=1.0+1.0/w; ddg=-1.0/(w*w);
+      w-=2.0*g*dg/(2.0*dg*dg-g*ddg);
+    }
+
+    return w;
+  }
+
+  inline void SpecfunServices::lambertWExp(const double* a,double* w,int n)
+  {
+    for (int i=0; i<n; i++)
+      w[i]=lambertWExp(a[i]);
+  }
+#undef LAMBERTW_NUMITER
+
 #ifndef HAVE_LIBGSL
 #include "src/eptools/potentials/SpecfunServices_basic.h"
 #else
@@ -15,6 +15,8 @@
     int verbose=quadServ->getVerbose();
     double temp,vstar,sigma;
     double cmu=inp[0],crho=inp[1],ca=inp[2],cc=inp[3];
+    EPPotGaussianPrecision_intFuncParams intFuncPars;
+    QuadAccuracySchedule* sched;
 
     if (eta!=1.0)
       throw NotImplemException(EXCEPT_MSG(""));
@@ -23,6 +25,14 @@
     if (verbose>0)
       cout << "EPPotGaussianPrecision::compMoments: cmu=" << cmu << ",crho="
 	   << crho << ",ca=" << ca << ",cc=" << cc << endl;
+    // Fixed-node quadrature first (if configured)
+    if (glOrder>0 && compMomentsFixedNode(cmu,crho,ca,cc,ret,logz)) {
+      if (verbose>0)
+	cout << "  Fixed-node quadrature accepted" << endl;
+      return true;
+    }
+    if ((sched=currAccSchedule())!=0)
+      sched->apply(*quadServ); // Accuracy for this sweep
     // Prepare integrand function
     intFuncPars.a=ca;
     intFuncPars.cdrho=cc/crho;
@@ -82,7 +92,7 @@
     hvstar=doLaplace?intFuncPars.getH(vstar):0.0;
     intFuncPars.off=hvstar;
     limA=-vstar/sigma;
-    if (quadServ->quad(intFunc,limA,false,limA,true,lztil,true)!=0) {
+    if (runQuad(intFuncPars,limA,lztil)!=0) {
       if (verbose>0)
 	cout << "  Quad(lztil, l=0) fails" << endl;
       return false; // Quadrature failure
@@ -94,16 +104,16 @@
     }
     lztil=log(lztil)-hvstar; // log Z_til
     if (logz!=0)
-      *logz = lztil-0.5*(log(crho)+SpecfunServices::m_ln2pi);
+      *logz = lztil+log(sigma)-0.5*(log(crho)+SpecfunServices::m_ln2pi);
     intFuncPars.off=-lztil; // New offset is -log Z_til
     intFuncPars.l=1;
-    if (quadServ->quad(intFunc,limA,false,limA,true,ex1,true)!=0) {
+    if (runQuad(intFuncPars,limA,ex1)!=0) {
       if (verbose>0)
 	cout << "  Quad(ex1, l=1) fails" << endl;
       return false; // Quadrature failure
     }
     intFuncPars.l=2;
-    if (quadServ->quad(intFunc,limA,false,limA,true,ex2,true)!=0) {
+    if (runQuad(intFuncPars,limA,ex2)!=0) {
       if (verbose>0)
 	cout << "  Quad(ex2, l=2) fails" << endl;
       return false; // Quadrature failure
@@ -115,7 +125,7 @@
     intFuncPars.off=-lztil;
     intFuncPars.a=ca+1.0;
     intFuncPars.init();
-    if (quadServ->quad(intFunc,limA,false,limA,true,ex1,true)!=0) {
+    if (runQuad(intFuncPars,limA,ex1)!=0) {
       if (verbose>0)
 	cout << "  Quad(ex_tau1) fails" << endl;
       return false; // Quadrature failure
@@ -126,10 +136,10 @@
 	cout << "  E[tau] too small (" << ex1 << ")" << endl;
       return false;
     }
-    intFuncPars.off=-log(ex1);
+    intFuncPars.off=-lztil-log(ex1*cc/ca); // Unscaled E[tau] integral
     intFuncPars.a=ca+2.0;
     intFuncPars.init();
-    if (quadServ->quad(intFunc,limA,false,limA,true,ex2,true)!=0) {
+    if (runQuad(intFuncPars,limA,ex2)!=0) {
       if (verbose>0)
 	cout << "  Quad(ex_tau2) fails" << endl;
       return false; // Quadrature failure
@@ -145,4 +155,71 @@
 
     return true;
   }
+
+  /*
+   * Z = (2 pi crho)^{-1/2} int f_0(kappa) G(v|ca,cc/crho) dv, where
+   * f_0 = kappa^{1/2} exp(-xi kappa/2). Since
+   *   v^{1/2} G(v|a,b) = Gamma(a+1/2)/(Gamma(a) b^{1/2}) G(v|a+1/2,b),
+   * we have Z = C E[q(v)] under G(v|ca+1/2,cc/crho), and x = (cc/crho) v
+   * is Gamma(x|ca+1/2,1). Moments are ratios of sums (see
+   * 'fixedNodeSums'), with E[tau^j] = E[v^j]/crho^j.
+   */
+  bool EPPotGaussianPrecision::compMomentsFixedNode(double cmu,double crho,
+						    double ca,double cc,
+						    double* ret,double* logz)
+    const
+  {
+    int i,nk=glOrder,nnode=glOrder+glCheckOrder;
+    double cdrho=cc/crho,xi,temp,sums[2][5],mom[2][5];
+    bool accept=false;
+    QuadAccuracySchedule* sched;
+
+    temp=cmu-yscal;
+    xi=temp*temp/crho;
+    try {
+      fixedNodeSums(GaussLaguerreRule(glOrder,ca-0.5),cdrho,xi,sums[0]);
+      fixedNodeSums(GaussLaguerreRule(glCheckOrder,ca-0.5),cdrho,xi,
+		    sums[1]);
+      for (;;) {
+	// mom[i] = [Z_q, E[v], Var[v], E[kappa], E[kappa^2]]
+	for (i=0; i<2; i++) {
+	  mom[i][0]=sums[i][0];
+	  mom[i][1]=sums[i][1]/sums[i][0];
+	  mom[i][2]=sums[i][2]/sums[i][0]-mom[i][1]*mom[i][1];
+	  mom[i][3]=sums[i][3]/sums[i][0];
+	  mom[i][4]=sums[i][4]/sums[i][0];
+	}
+	accept=(mom[0][0]>=(1e-300) && mom[0][2]>0.0 &&
+		fabs(mom[0][0]-mom[1][0])<=glTol*mom[0][0] &&
+		fabs(mom[0][1]-mom[1][1])<=glTol*mom[0][1] &&
+		fabs(mom[0][2]-mom[1][2])<=glTol*mom[0][2] &&
+		fabs(mom[0][3]-mom[1][3])<=glTol &&
+		fabs(mom[0][4]-mom[1][4])<=glTol);
+	if (accept || 2*nk>GaussLaguerreRule::maxOrder) break;
+	// Double the order, previous rule becomes check rule
+	for (i=0; i<5; i++) sums[1][i]=sums[0][i];
+	nk*=2; nnode+=nk;
+	fixedNodeSums(GaussLaguerreRule(nk,ca-0.5),cdrho,xi,sums[0]);
+      }
+    } catch (const NumericalException&) {
+      accept=false;
+    }
+    if ((sched=currAccSchedule())!=0)
+      sched->record(1,nnode);
+    if (!accept) return false;
+    // hat_c = E[tau]/Var[tau], hat_a = E[tau] hat_c
+    temp=mom[0][2]/(crho*mom[0][1]); // Var[tau]/E[tau]
+    if (temp<(1e-12))
+      return false;
+    if (logz!=0)
+      *logz = SpecfunServices::logGamma(ca+0.5)-SpecfunServices::logGamma(ca)-
+	0.5*log(cdrho)+log(mom[0][0])-
+	0.5*(log(crho)+SpecfunServices::m_ln2pi);
+    ret[0]=mom[0][3]*(yscal-cmu)/crho; // alpha
+    ret[1]=(mom[0][3]-xi*(mom[0][4]-mom[0][3]*mom[0][3]))/crho; // nu
+    ret[3]=1.0/temp; // hat_c
+    ret[2]=mom[0][1]/crho*ret[3]; // hat_a
+
+    return true;
+  }
 //ENDNS
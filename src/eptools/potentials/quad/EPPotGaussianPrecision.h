@@ -16,6 +16,8 @@
 #include "src/eptools/potentials/EPScalarPotential.h"
 #include "src/eptools/potentials/SpecfunServices.h"
 #include "src/eptools/potentials/quad/QuadratureServices.h"
+#include "src/eptools/potentials/quad/QuadAccuracySchedule.h"
+#include "src/eptools/potentials/quad/GaussLaguerreRule.h"
 
 //BEGINNS(eptools)
   /**
@@ -24,6 +26,8 @@
    * where h_l(v) depends on a, c/rho, xi and l:
    *   h_l(v) = -log f_l(kappa,xi) - log G(v|a,c/rho),
    *   kappa = v/(1+v)
+   * An object is created on the stack for each 'compMoments' call, so that
+   * 'EPPotGaussianPrecision' is reentrant.
    */
   class EPPotGaussianPrecision_intFuncParams
   {
@@ -32,6 +36,7 @@
     int l;
     double vstar,sigma;
     double off,cnst;
+    mutable int numEval; // Counts 'getG' calls
 
     /**
      * Must be called whenever parameters a, c/rho or xi are changed.
@@ -49,6 +54,7 @@
     }
 
     double getG(double x) const {
+      numEval++;
       return exp(off-getH(vstar+sigma*x));
     }
 
@@ -81,6 +87,10 @@
    * If bounded above, the integrand is transformed by a Laplace
    * approximation (see also 'EPPotQuadLaplaceApprox'), the corr. mode can
    * be solved for analytically (requires roots of cubic equation).
+   * <p>
+   * Before that, we try fixed-node quadrature (see 'compMoments'), which
+   * obtains all quantities from a single set of node evaluations. Only
+   * if this fails its error check, 'quadServ' is used.
    *
    * @author  Matthias Seeger
    * @version %I% %G%
@@ -92,8 +102,9 @@
 
     double yscal;
     Handle<QuadratureServices> quadServ; // Quadrature services
-    quad_function intFunc;               // Represents integrand g(x)
-    mutable EPPotGaussianPrecision_intFuncParams intFuncPars;
+    Handle<QuadAccuracySchedule> accSched; // Optional
+    int glOrder,glCheckOrder;              // Fixed-node quadrature
+    double glTol;
 
   public:
     // Public methods
@@ -105,12 +116,9 @@
      * @param py    Init. value for y. Def.: 0
      */
     EPPotGaussianPrecision(const Handle<QuadratureServices>& qserv,
-			   double py=0.0) : quadServ(qserv) {
+			   double py=0.0) : quadServ(qserv),glOrder(0),
+      glCheckOrder(0),glTol(1e-6) {
       setY(py);
-      // Integrand function
-      intFuncPars.l=0;
-      intFunc.function=&EPPotGaussianPrecision_intFunc;
-      intFunc.params=(void*) &intFuncPars;
     }
 
     virtual double getY() const {
@@ -163,9 +171,128 @@
      * If 'ca'<=1/2, the integrand's mode is at 0 (left boundary), a
      * singularity if 'ca'<1/2. In this case, we do not apply a
      * transformation.
+     * <p>
+     * Fixed-node quadrature (off by default, see 'setFixedNodeQuad'):
+     * With v = crho*tau, the integrand over v is
+     *   q(v) Gamma(v|ca+1/2,cc/crho),
+     *   q(v) = (1+v)^{-1/2} exp(-xi kappa/2),  kappa = v/(1+v),
+     * xi = (cmu-y)^2/crho. Since 0 < q(v) <= 1 is smooth, and the Gamma
+     * factor captures the behaviour at 0 and infty exactly, a generalized
+     * Gauss-Laguerre rule (alpha = ca-1/2) gives log Z, E[kappa],
+     * E[kappa^2], E[tau], E[tau^2] from the same K evaluations of q(v).
+     * The results are checked against a rule of lower order, and accepted
+     * if they differ by less than 'glTol' (see 'setFixedNodeQuad').
+     * Otherwise, the order is doubled (the previous rule becoming the check
+     * rule), as long as it does not exceed 'GaussLaguerreRule::maxOrder'.
+     * Convergence is slow if cc/crho is small (q(v) has a branch point at
+     * v=-1). If all checks fail, we run the quadrature code below.
+     * <p>
+     * This method is reentrant (all per-call state is on the stack), if
+     * 'quadServ' is thread-safe (see 'QuadratureServices::isThreadSafe').
+     * An accuracy schedule must have been applied for the current sweep
+     * (see 'QuadAccuracySchedule').
      */
     bool compMoments(const double* inp,double* ret,double* logz=0,
 		     double eta=1.0) const;
+
+    /**
+     * Sets accuracy schedule, which controls the accuracy of 'quadServ'
+     * and records node counts. Pass 0 handle to remove. If not set, the
+     * schedule attached to 'quadServ' is used (if any).
+     *
+     * @param sched Accuracy schedule
+     */
+    void setAccuracySchedule(const Handle<QuadAccuracySchedule>& sched) {
+      accSched=sched;
+    }
+
+    const Handle<QuadAccuracySchedule>& getAccuracySchedule() const {
+      return accSched;
+    }
+
+    /**
+     * False if 'quadServ' is not thread-safe, or if an accuracy schedule
+     * is in use (schedules are single-threaded, see
+     * 'QuadAccuracySchedule').
+     */
+    bool isThreadSafe() const {
+      return (quadServ->isThreadSafe() && currAccSchedule()==0);
+    }
+
+    /**
+     * Configures fixed-node quadrature (see 'compMoments'). Pass 'order'=0
+     * to switch off (default). 'order'=24, 'checkOrder'=16, 'tol'=1e-6
+     * accepts most updates with moderate cavity variances.
+     *
+     * @param order      Order of Gauss-Laguerre rule (initial)
+     * @param checkOrder Order of rule for check (< 'order')
+     * @param tol        Tolerance for check (positive)
+     */
+    void setFixedNodeQuad(int order,int checkOrder,double tol) {
+      if (order<0 || order>GaussLaguerreRule::maxOrder ||
+	  (order>0 && (checkOrder<1 || checkOrder>=order || tol<=0.0)))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      glOrder=order; glCheckOrder=checkOrder; glTol=tol;
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Fixed-node quadrature part of 'compMoments'. Returns false if the
+     * error check fails (or the rules cannot be computed).
+     */
+    bool compMomentsFixedNode(double cmu,double crho,double ca,double cc,
+			      double* ret,double* logz) const;
+
+    /**
+     * Sums for fixed-node quadrature. Returns sum_k w_k q(v_k) v_k^j in
+     * 'sums[j]', j=0,1,2, and sum_k w_k q(v_k) kappa_k^j in 'sums[2+j]',
+     * j=1,2, where v_k = x_k/cdrho.
+     */
+    static void fixedNodeSums(const GaussLaguerreRule& rule,double cdrho,
+			      double xi,double* sums) {
+      int k,nk=rule.getOrder();
+      const double* x=rule.getNodes(),* w=rule.getWeights();
+      double v,kappa,term;
+
+      sums[0]=sums[1]=sums[2]=sums[3]=sums[4]=0.0;
+      for (k=0; k<nk; k++) {
+	v=x[k]/cdrho; kappa=v/(1.0+v);
+	term=w[k]*exp(-0.5*(log1p(v)+xi*kappa));
+	sums[0]+=term;
+	sums[1]+=term*v; sums[2]+=term*v*v;
+	sums[3]+=term*kappa; sums[4]+=term*kappa*kappa;
+      }
+    }
+
+    /**
+     * @return Schedule in use: 'accSched' if set, otherwise the one attached
+     *         to 'quadServ' (0 if none)
+     */
+    QuadAccuracySchedule* currAccSchedule() const {
+      return (accSched==0)?quadServ->getAccuracySchedule():accSched.p();
+    }
+
+    /**
+     * Calls 'quadServ->quad' for the integrand given by 'pars' over
+     * [limA,infty), records the number of nodes in the schedule (if any).
+     */
+    int runQuad(const EPPotGaussianPrecision_intFuncParams& pars,double limA,
+		double& ival) const {
+      int stat;
+      quad_function intFunc;
+
+      intFunc.function=&EPPotGaussianPrecision_intFunc;
+      intFunc.params=(void*) &pars;
+      pars.numEval=0;
+      stat=quadServ->quad(intFunc,limA,false,limA,true,ival,true);
+      QuadAccuracySchedule* sched=currAccSchedule();
+      if (sched!=0)
+	sched->record(1,pars.numEval);
+
+      return stat;
+    }
   };
 //ENDNS
 
@@ -15,8 +15,40 @@
 
 #include "src/eptools/potentials/quad/QuadPotProximalNewton.h"
 #include "src/eptools/potentials/quad/EPPotNegBinomialCommon.h"
+#include "lhotse/optimize/BatchOneDimSolver.h"
 
 //BEGINNS(eptools)
+  /**
+   * Function object for 'BatchOneDimSolver', represents proximal map
+   * criteria
+   *   f_i(s) = rho_i l_i'(s) + s - h_i,
+   *   l_i'(s) = (y_i + r_i) sigma(s - log r_i) - y_i
+   * for negative binomial potentials with parameters y_i, r_i.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class EPPotNegBinomialExpRate_BatchFunc
+  {
+  public:
+    // Members
+
+    const double* h,* rho;
+    const double* yp,* rp; // Parameters y, r
+    int yinc,rinc;
+
+    // Public methods
+
+    void eval(int i,double x,double& f,double& df) const {
+      double y=yp[i*yinc],r=rp[i*rinc],sig,temp;
+
+      temp=x-log(r);
+      sig=(temp>=0.0)?(1.0/(1.0+exp(-temp))):(1.0-1.0/(1.0+exp(temp)));
+      f=rho[i]*((y+r)*sig-y)+x-h[i];
+      df=rho[i]*(y+r)*sig*(1.0-sig)+1.0;
+    }
+  };
+
   /**
    * Negative binomial potential with exponential rate function:
    * lam(s) = exp(s).
@@ -67,28 +99,102 @@
 	throw InvalidParameterException(EXCEPT_MSG(""));
       l=h-rscal*rho; r=h+yscal*rho;
     }
+
+    /**
+     * Batched proximal map, using 'BatchOneDimSolver'. The parameters are
+     * y, r (see 'QuadPotProximal::proximalBatch').
+     */
+    int proximalBatch(int n,const double* h,const double* rho,double* sstar,
+		      bool* succ,const double* pv=0,const int* pshrd=0) const;
+
+    void evalBatch(int n,int m,const double* s,double* l,double* ddl=0,
+		   const double* pv=0,const int* pshrd=0) const;
+
+    bool hasBatchPars() const {
+      return true;
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Implements 'eval' for parameters y, r, lgr = log(r).
+     */
+    static double evalInt(double y,double r,double lgr,double s,double* dl,
+			  double* ddl) {
+      double sig,temp,ret;
+
+      if (s>=lgr) {
+	temp=exp(lgr-s);
+	sig=1.0/(1.0+temp);
+	ret=r*s+(r+y)*log1p(temp);
+      } else {
+	temp=exp(s-lgr);
+	sig=temp/(1.0+temp);
+	ret=-y*s+(r+y)*(lgr+log1p(temp));
+      }
+      if (dl!=0)
+	(*dl) = (y+r)*sig-y;
+      if (ddl!=0)
+	(*ddl) = (y+r)*sig*(1.0-sig);
+
+      return ret;
+    }
   };
 
   inline double EPPotNegBinomialExpRate::eval(double s,double* dl,
 					      double* ddl) const
   {
-    double lgr=log(rscal),sig,temp,ret;
-
-    if (s>=lgr) {
-      temp=exp(lgr-s);
-      sig=1.0/(1.0+temp);
-      ret=rscal*s+(rscal+yscal)*log1p(temp);
-    } else {
-      temp=exp(s-lgr);
-      sig=temp/(1.0+temp);
-      ret=-yscal*s+(rscal+yscal)*(lgr+log1p(temp));
+    return evalInt(yscal,rscal,log(rscal),s,dl,ddl);
+  }
+
+  inline void
+  EPPotNegBinomialExpRate::evalBatch(int n,int m,const double* s,double* l,
+				     double* ddl,const double* pv,
+				     const int* pshrd) const
+  {
+    double pown[2],y,r,lgr;
+    const double* pptr[2];
+    int pinc[2],i,j;
+
+    if (n<=0 || m<=0) return;
+    batchParsAccess(n,pv,pshrd,pown,pptr,pinc);
+    for (i=0; i<n; i++,s+=m,l+=m) {
+      y=pptr[0][i*pinc[0]]; r=pptr[1][i*pinc[1]];
+      lgr=log(r);
+      for (j=0; j<m; j++)
+	l[j]=evalInt(y,r,lgr,s[j],0,(ddl!=0)?(ddl+j):0);
+      if (ddl!=0) ddl+=m;
+    }
+  }
+
+  inline int
+  EPPotNegBinomialExpRate::proximalBatch(int n,const double* h,
+					 const double* rho,double* sstar,
+					 bool* succ,const double* pv,
+					 const int* pshrd) const
+  {
+    double pown[2];
+    const double* pptr[2];
+    int pinc[2],i;
+    EPPotNegBinomialExpRate_BatchFunc func;
+
+    if (n<=0) return 0;
+    batchParsAccess(n,pv,pshrd,pown,pptr,pinc);
+    func.h=h; func.rho=rho;
+    func.yp=pptr[0]; func.yinc=pinc[0];
+    func.rp=pptr[1]; func.rinc=pinc[1];
+    // Initial brackets (see 'initBracket')
+    ArrayHandle<double> bR(n);
+    for (i=0; i<n; i++) {
+      if (rho[i]<(1e-16))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      sstar[i]=h[i]-func.rp[i*func.rinc]*rho[i];
+      bR[i]=h[i]+func.yp[i*func.yinc]*rho[i];
     }
-    if (dl!=0)
-      (*dl) = (yscal+rscal)*sig;
-    if (ddl!=0)
-      (*ddl) = (yscal+rscal)*sig*(1.0-sig);
 
-    return ret;
+    return BatchOneDimSolver::newton(func,n,sstar,bR.p(),acc,facc,sstar,
+				     succ);
   }
 //ENDNS
 
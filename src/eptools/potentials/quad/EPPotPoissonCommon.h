@@ -97,10 +97,17 @@
      * set 'logYFact' to 0.
      */
     void setLogYFact() {
+      logYFact=logFactorial(yscal);
+    }
+
+    /**
+     * @return log(y!). 0 if 'SpecfunServices::logGamma' is not implemented
+     */
+    static double logFactorial(double y) {
       try {
-	logYFact=SpecfunServices::logGamma(yscal+1.0);
+	return SpecfunServices::logGamma(y+1.0);
       } catch (NotImplemException ex) {
-	logYFact=0.0;
+	return 0.0;
       }
     }
   };
@@ -7,43 +7,73 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/potentials/quad/EPPotPoissonExpRate.h"
-#include "lhotse/optimize/OneDimSolver.h"
 
 //BEGINNS(eptools)
   /*
-   * Bracket [L,R]
-   *   f(s) = exp(s) + s - a
-   * (1) If a<=1: L = a-exp(a), R = a
-   * (2) If a>1: R = log(a) gives f(R) = log(a) > 0. We choose
-   * L = (1-u) log(a), which gives
-   * f(L) = a (a^{-u} - 1) + (1-u) log(a). Setting
-   * a (a^{-u} - 1) + log(a) equal to 0 gives
-   * u = -log(1 - (log a)/a)/log(a) and
-   * f(L) = -u log(a) < 0. Here, u is roughly 1/a as a gets large, so the
-   * bracket size behaves as log(a)/a.
+   * The proximal map criterion is minimized at s_* with
+   *   rho (e^s - y) + s - h = 0.
+   * Substituting x = s + log(rho), this is f(x) = e^x + x - a = 0,
+   * a = h + y rho + log(rho), whose solution is x = a - W_0(e^a). We
+   * used to solve this by 'OneDimSolver::newton'.
    */
   bool EPPotPoissonExpRate::proximal(double h,double rho,double& sstar) const
   {
-    double ascal,bL,bR;
+    double lrho;
 
     if (rho<(1e-16))
       throw InvalidParameterException(EXCEPT_MSG(""));
-    proxFun->setA(ascal=h+yscal*rho+log(rho));
-    if (ascal<=1.001) {
-      bL=ascal-exp(ascal); bR=ascal;
-    } else {
-      bR=log(ascal);
-      bL=bR+log1p(-bR/ascal);
-    }
-    try {
-      // Run Newton solver
-      sstar = OneDimSolver::newton(proxFun.p(),bL,bR,acc,facc,
-				   OneDimSolver::brackRightRegular,0.0,
-				   "EPPotPoissonExpRate") - log(rho);
-    } catch (...) {
-      return false; // Exception thrown in 'OneDimSolver::newton'
-    }
+    lrho=log(rho);
+    sstar=rootExpLinear(h+yscal*rho+lrho)-lrho;
 
     return true;
   }
+
+  int EPPotPoissonExpRate::proximalBatch(int n,const double* h,
+					 const double* rho,double* sstar,
+					 bool* succ,const double* pv,
+					 const int* pshrd) const
+  {
+    int i,yinc;
+    double pown,lrho;
+    const double* yp;
+
+    if (n<=0) return 0;
+    batchParsAccess(n,pv,pshrd,&pown,&yp,&yinc);
+    for (i=0; i<n; i++) {
+      if (rho[i]<(1e-16))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      lrho=log(rho[i]);
+      sstar[i]=rootExpLinear(h[i]+yp[i*yinc]*rho[i]+lrho)-lrho;
+      succ[i]=true;
+    }
+
+    return 0;
+  }
+
+  /*
+   * log(y!) is recomputed only if y changes between lanes.
+   */
+  void EPPotPoissonExpRate::evalBatch(int n,int m,const double* s,double* l,
+				      double* ddl,const double* pv,
+				      const int* pshrd) const
+  {
+    int i,j,yinc;
+    double pown,y,lyf,yprev,temp;
+    const double* yp;
+
+    if (n<=0 || m<=0) return;
+    batchParsAccess(n,pv,pshrd,&pown,&yp,&yinc);
+    yprev=yscal; lyf=logYFact;
+    for (i=0; i<n; i++,s+=m,l+=m) {
+      if ((y=yp[i*yinc])!=yprev) {
+	lyf=logFactorial(y); yprev=y;
+      }
+      for (j=0; j<m; j++) {
+	temp=exp(s[j]);
+	l[j]=temp-s[j]*y+lyf;
+	if (ddl!=0) ddl[j]=temp;
+      }
+      if (ddl!=0) ddl+=m;
+    }
+  }
 //ENDNS
@@ -15,53 +15,17 @@
 
 #include "src/eptools/potentials/quad/QuadPotProximal.h"
 #include "src/eptools/potentials/quad/EPPotPoissonCommon.h"
-#include "lhotse/optimize/FuncOneDim.h"
 
 //BEGINNS(eptools)
-  /**
-   * Represents
-   *   f(s) = e^s + s - a
-   * Used to drive 'OneDimSolver'.
-   *
-   * @author  Matthias Seeger
-   * @version %I% %G%
-   */
-  class EPPotPoissonExpRate_Func1D : public FuncOneDim
-  {
-  protected:
-    // Members
-
-    double ascal;
-
-  public:
-    // Public methods
-
-    EPPotPoissonExpRate_Func1D() : ascal(1.0) {}
-
-    void setA(double pa) {
-      ascal=pa;
-    }
-
-    bool hasDerivative() const {
-      return true;
-    }
-
-    void eval(double x,double* f,double* df) {
-      double temp=exp(x);
-      *f=temp+x-ascal;
-      *df=temp+1.0;
-    }
-  };
-
   /**
    * Poisson potential with exponential rate function:
    *   t(s) = (y!)^-1 lam(s)^y exp(-lam(s)),  y in N,
    *   lam(s) = exp(s)
    * Parameters: y (nonneg. int.)
    * <p>
-   * We need numerical quadrature for this potential. 'proximal' requires a
-   * very simple 1D Newton optimization, which is implemented here (we use
-   * 'OneDimSolver').
+   * We need numerical quadrature for this potential. 'proximal' is
+   * computed in closed form via the Lambert W function (see
+   * 'SpecfunServices::lambertWExp').
    *
    * NOTE: As derived in the TR, the results for any y can be expressed in
    * terms of results for y=0 (changing 'h'). If lookup tables are to be used,
@@ -75,25 +39,21 @@
    */
   class EPPotPoissonExpRate : public QuadPotProximal,public EPPotPoissonCommon
   {
-  protected:
-    // Members
-
-    double acc,facc;
-    mutable Handle<EPPotPoissonExpRate_Func1D> proxFun;
-
   public:
     // Public methods
 
     /**
+     * NOTE: 'pacc', 'pfacc' were used for the Newton solver in 'proximal'.
+     * They are not needed anymore, but still checked for compatibility.
+     *
      * @param py    Value for y
-     * @param pacc  See 'OneDimSolver::newton'. >0
-     * @param pfacc "
+     * @param pacc  Not used. >0
+     * @param pfacc Not used. >0
      */
-    EPPotPoissonExpRate(double py,double pacc,double pfacc) :
-      EPPotPoissonCommon(py),acc(pacc),facc(pfacc) {
+    EPPotPoissonExpRate(double py,double pacc=1e-9,double pfacc=1e-9) :
+      EPPotPoissonCommon(py) {
       if (pacc<=0.0 || pfacc<=0.0)
 	throw InvalidParameterException(EXCEPT_MSG(""));
-      proxFun.changeRep(new EPPotPoissonExpRate_Func1D());
     }
 
     bool isLogConcave() const {
@@ -117,6 +77,37 @@
     }
 
     bool proximal(double h,double rho,double& sstar) const;
+
+    /**
+     * Batched proximal map, using 'SpecfunServices::lambertWExp'. The
+     * parameter is y (see 'QuadPotProximal::proximalBatch'). All lanes
+     * are successful.
+     */
+    int proximalBatch(int n,const double* h,const double* rho,double* sstar,
+		      bool* succ,const double* pv=0,const int* pshrd=0) const;
+
+    void evalBatch(int n,int m,const double* s,double* l,double* ddl=0,
+		   const double* pv=0,const int* pshrd=0) const;
+
+    bool hasBatchPars() const {
+      return true;
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Root of f(x) = e^x + x - a, which is x = a - W_0(e^a). For larger
+     * a, we use x = log W_0(e^a) instead, avoiding cancellation.
+     *
+     * @param ascal Value a
+     * @return      Root x
+     */
+    static double rootExpLinear(double ascal) {
+      double w=SpecfunServices::lambertWExp(ascal);
+
+      return (ascal<1.0)?(ascal-w):log(w);
+    }
   };
 //ENDNS
 
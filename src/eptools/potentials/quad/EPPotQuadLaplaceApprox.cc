@@ -11,7 +11,7 @@
 
 //BEGINNS(eptools)
 EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qpot,const Handle<QuadratureServices>& qserv) :
-  EPPotQuadrature(qpot),qpotProx(qpot.p()),quadServ(qserv)
+  EPPotQuadrature(qpot),qpotProx(qpot.p()),quadServ(qserv),ghTol(1e-6)
   {
     if (!qpot->hasSecondDerivatives())
       throw InvalidParameterException(EXCEPT_MSG("Need 2nd derivatives"));
@@ -31,11 +31,6 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
       if ((!aInf && a>=wayPts[0]) || (!bInf && b<=wayPts[wsz-1]))
 	throw InvalidParameterException(EXCEPT_MSG("Waypoints must lie in (a,b)"));
     }
-    // Integrand function
-    intFuncPars.qpot=qpot.p();
-    intFuncPars.k=0;
-    intFunc.function=&EPPotQuadLaplaceApprox_intFunc;
-    intFunc.params=(void*) &intFuncPars;
   }
 
   /*
@@ -44,11 +39,21 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
    */
   bool EPPotQuadLaplaceApprox::compMoments(const double* inp,double* ret,
 					   double* logz,double eta) const
+  {
+    return compMomentsInt(inp,ret,logz,eta,0,0);
+  }
+
+  bool EPPotQuadLaplaceApprox::compMomentsInt(const double* inp,double* ret,
+					      double* logz,double eta,
+					      const double* pv,
+					      const int* pshrd) const
   {
     int i,wsz,verbose=quadServ->getVerbose();
-    double a,b,sstar,sigma,cmu=inp[0],crho=inp[1];
-    bool aInf,bInf,isCritical;
+    double a,b,sstar,sigma,cmu=inp[0],crho=inp[1],hrho;
+    bool aInf,bInf,isCritical,psucc;
     ArrayHandle<double> wayPts;
+    EPPotQuadLaplaceApprox_intFuncParams intFuncPars;
+    QuadAccuracySchedule* sched;
 
     if (crho<1e-14 || eta<1e-10 || eta>1.0)
       throw InvalidParameterException(EXCEPT_MSG(""));
@@ -60,8 +65,15 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
       else
 	cout << ", eta=" << eta << endl;
     }
+    if ((sched=currAccSchedule())!=0)
+      sched->apply(*quadServ); // Accuracy for this sweep
     // Determine mode of integrand
-    if (!qpotProx->proximal(cmu,eta*crho,sstar)) {
+    hrho=eta*crho;
+    if (pv==0)
+      psucc=qpotProx->proximal(cmu,hrho,sstar);
+    else
+      qpotProx->proximalBatch(1,&cmu,&hrho,&sstar,&psucc,pv,pshrd);
+    if (!psucc) {
       if (verbose>0)
 	cout << "  Proximal map computation failed"
 	     << endl;
@@ -87,6 +99,9 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
       cout << "  s_star falls on critical point" << endl;
     // Configure integrand function (except for sigma). Have to do this here,
     // so can use 'getD2H' (does not depend on sigma)
+    intFuncPars.qpot=qpotProx;
+    intFuncPars.pv=pv;
+    intFuncPars.pshrd=pshrd;
     intFuncPars.h=cmu;
     intFuncPars.rho=crho;
     intFuncPars.eta=eta;
@@ -115,8 +130,7 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
     // Z_til after mode normalization, then 1st and 2nd moment
     // TODO: Verbosity! React to errors appropriately.
     double ztil,ex1,ex2;
-    if (quadServ->quad(intFunc,a,aInf,b,bInf,ztil,qpotProx->hasWayPoints(),
-		       wayPts)!=0) {
+    if (runQuad(intFuncPars,a,aInf,b,bInf,ztil,wayPts)!=0) {
       if (verbose>0)
 	cout << "  Quad(k=0) fails" << endl;
       return false; // Quadrature failure
@@ -134,15 +148,13 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
     // NOTE: Do not call 'intFuncPars.init()', would overwrite 'hsstar'!
     intFuncPars.hsstar-=log(ztil);
     intFuncPars.k=1;
-    if (quadServ->quad(intFunc,a,aInf,b,bInf,ex1,qpotProx->hasWayPoints(),
-		       wayPts)!=0) {
+    if (runQuad(intFuncPars,a,aInf,b,bInf,ex1,wayPts)!=0) {
       if (verbose>0)
 	cout << "  Quad(k=1) fails" << endl;
       return false; // Quadrature failure
     }
     intFuncPars.k=2;
-    if (quadServ->quad(intFunc,a,aInf,b,bInf,ex2,qpotProx->hasWayPoints(),
-		       wayPts)!=0) {
+    if (runQuad(intFuncPars,a,aInf,b,bInf,ex2,wayPts)!=0) {
       if (verbose>0)
 	cout << "  Quad(k=2) fails" << endl;
       return false; // Quadrature failure
@@ -155,4 +167,151 @@ EPPotQuadLaplaceApprox::EPPotQuadLaplaceApprox(const Handle<QuadPotProximal>& qp
 
     return true;
   }
+
+  void
+  EPPotQuadLaplaceApprox::setFixedNodeQuad(const Handle<GaussHermiteRule>& rule,
+					   const Handle<GaussHermiteRule>& check,
+					   double tol)
+  {
+    if (!(rule==0) && (check==0 || check->getOrder()==rule->getOrder() ||
+		       tol<=0.0))
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    ghRule=rule;
+    ghCheck=(rule==0)?Handle<GaussHermiteRule>():check;
+    if (!(rule==0)) ghTol=tol;
+  }
+
+  /*
+   * Z_til, E[x], E[x^2] are computed as in 'compMoments' (see
+   * 'EPPotQuadLaplaceApprox_intFuncParams'), but with Gauss-Hermite rules,
+   * so that l(s) is evaluated at K+Kc nodes per lane, all in one
+   * 'evalBatch' call (K, Kc the orders of 'rule', 'check', see
+   * 'currFixedNodeQuad'). The
+   * buffer 'lv' is used for l(s_*), 'sv' for l''(s_*) first.
+   */
+  int EPPotQuadLaplaceApprox::compMomentsBatch(int n,const double* cmu,
+					       const double* crho,
+					       double* alpha,double* nu,
+					       bool* succ,double* logz,
+					       const double* pv,
+					       const int* pshrd,double eta)
+    const
+  {
+    int i,k,nk,nkc,m,nfail=0,nfback=0;
+    double a,b,temp,ztil,ex1,ex2,ztc,ex1c,ex2c,var,varc,tol;
+    bool aInf,bInf;
+    ArrayHandle<double> wayPts;
+    QuadAccuracySchedule* sched;
+    const GaussHermiteRule* rule,*check;
+
+    if (n<=0) return 0;
+    TraceScope trace("quadBatch","quad",n);
+    if (pv!=0 && !qpotProx->hasBatchPars())
+      throw NotImplemException(EXCEPT_MSG(""));
+    if (eta<1e-10 || eta>1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    qpotProx->getInterval(a,aInf,b,bInf,wayPts);
+    currFixedNodeQuad(rule,check,tol);
+    if (rule==0 || !aInf || !bInf ||
+	(qpotProx->hasWayPoints() && wayPts.size()>0)) {
+      // No fixed-node quadrature: Lane by lane
+      for (i=0; i<n; i++)
+	if (!(succ[i]=compMomentsLane(i,n,cmu[i],crho[i],alpha[i],nu[i],
+				      (logz!=0)?(logz+i):0,pv,pshrd,eta)))
+	  nfail++;
+      return nfail;
+    }
+    nk=rule->getOrder(); nkc=check->getOrder(); m=nk+nkc;
+    const double* x=rule->getNodes(),* xc=check->getNodes();
+    ArrayHandle<double> hrho(n),sstar(n),sigma(n),hsstar(n),sv(n*m),
+      lv(n*m);
+    // Modes s_*
+    for (i=0; i<n; i++) {
+      if (crho[i]<1e-14)
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      hrho[i]=eta*crho[i];
+    }
+    qpotProx->proximalBatch(n,cmu,hrho,sstar,succ,pv,pshrd);
+    // h(s_*), sigma from h''(s_*)
+    qpotProx->evalBatch(n,1,sstar,lv,sv,pv,pshrd);
+    for (i=0; i<n; i++) {
+      temp=sstar[i]-cmu[i];
+      hsstar[i]=eta*lv[i]+0.5*temp*temp/crho[i];
+      temp=eta*sv[i]+1.0/crho[i];
+      sigma[i]=(temp<-(1e-10))?sqrt(crho[i]):(1.0/sqrt(temp+(1e-8)));
+    }
+    // Nodes for all lanes, single evaluation call
+    for (i=0; i<n; i++) {
+      double* sp=sv.p()+i*m;
+      for (k=0; k<nk; k++)
+	sp[k]=sstar[i]+sigma[i]*x[k];
+      for (k=0; k<nkc; k++)
+	sp[nk+k]=sstar[i]+sigma[i]*xc[k];
+    }
+    qpotProx->evalBatch(n,m,sv,lv,0,pv,pshrd);
+    // Moments, check, fallback
+    for (i=0; i<n; i++) {
+      if (!succ[i]) {
+	nfail++; continue; // Proximal map failed ('compMoments' would fail)
+      }
+      fixedNodeSums(*rule,sv.p()+i*m,lv.p()+i*m,cmu[i],crho[i],eta,
+		    hsstar[i],ztil,ex1,ex2);
+      fixedNodeSums(*check,sv.p()+i*m+nk,lv.p()+i*m+nk,cmu[i],crho[i],
+		    eta,hsstar[i],ztc,ex1c,ex2c);
+      var=ex2-ex1*ex1; varc=ex2c-ex1c*ex1c;
+      if (ztil>=(1e-12) && fabs(ztil-ztc)<=tol*ztil &&
+	  fabs(ex1-ex1c)<=tol && var>0.0 && fabs(var-varc)<=tol*var) {
+	if (logz!=0)
+	  logz[i]=log(ztil)-hsstar[i]+log(sigma[i])-
+	    0.5*(log(crho[i])+SpecfunServices::m_ln2pi);
+	alpha[i]=(sigma[i]*ex1+sstar[i]-cmu[i])/crho[i];
+	nu[i]=(1.0-var*sigma[i]*sigma[i]/crho[i])/crho[i];
+      } else {
+	nfback++;
+	if (!(succ[i]=compMomentsLane(i,n,cmu[i],crho[i],alpha[i],nu[i],
+				      (logz!=0)?(logz+i):0,pv,pshrd,eta)))
+	  nfail++;
+      }
+    }
+    // Lanes which fell back have been recorded by 'runQuad'
+    if ((sched=currAccSchedule())!=0)
+      sched->record(n-nfback,(n-nfback)*(m+1));
+    if (quadServ->getVerbose()>0)
+      cout << "EPPotQuadLaplaceApprox::compMomentsBatch: n=" << n
+	   << ", fallbacks=" << nfback << ", failures=" << nfail << endl;
+
+    return nfail;
+  }
+
+  bool EPPotQuadLaplaceApprox::compMomentsLane(int i,int n,double cmu,
+					       double crho,double& alpha,
+					       double& nu,double* logz,
+					       const double* pv,
+					       const int* pshrd,double eta)
+    const
+  {
+    int k,np;
+    double inp[2],ret[2];
+    bool succ;
+
+    inp[0]=cmu; inp[1]=crho;
+    if (pv==0)
+      succ=compMomentsInt(inp,ret,logz,eta,0,0);
+    else {
+      // Parameters of lane i, a single lane has one value per parameter
+      // whether shared or not
+      np=numPars();
+      ArrayHandle<double> plane(np);
+      for (k=0; k<np; k++) {
+	plane[k]=pshrd[k]?pv[0]:pv[i];
+	pv+=(pshrd[k]?1:n);
+      }
+      succ=compMomentsInt(inp,ret,logz,eta,plane.p(),pshrd);
+    }
+    if (succ) {
+      alpha=ret[0]; nu=ret[1];
+    }
+
+    return succ;
+  }
 //ENDNS
@@ -16,6 +16,9 @@
 #include "src/eptools/potentials/quad/EPPotQuadrature.h"
 #include "src/eptools/potentials/quad/QuadPotProximal.h"
 #include "src/eptools/potentials/quad/QuadratureServices.h"
+#include "src/eptools/potentials/quad/QuadAccuracySchedule.h"
+#include "src/eptools/potentials/quad/GaussHermiteRule.h"
+#include "src/eptools/TraceServices.h"
 
 //BEGINNS(eptools)
   /**
@@ -28,15 +31,21 @@
    * <p>
    * NOTE: h(s) here lacks the additive constant 0.5*log(2*pi*rho) in
    * the TR.
+   * <p>
+   * An object is created on the stack for each 'compMoments' call, so that
+   * 'EPPotQuadLaplaceApprox' is reentrant.
    */
   class EPPotQuadLaplaceApprox_intFuncParams
   {
   public:
-    QuadraturePotential* qpot;
+    const QuadraturePotential* qpot;
+    const double* pv;   // Parameters for 'qpot' (one lane). Optional
+    const int* pshrd;   // See 'QuadraturePotential::evalBatch'
     double h,rho,eta;
     double sstar,sigma;
     double hsstar;
     int k;
+    mutable int numEval; // Counts 'getG' calls
 
     /**
      * Must be called whenever parameters have been changed. Throws exception
@@ -50,13 +59,19 @@
     }
 
     double getH(double s) const {
-      double temp=s-h;
-      return eta*qpot->eval(s)+0.5*temp*temp/rho;
+      double temp=s-h,l;
+
+      if (pv==0)
+	l=qpot->eval(s);
+      else
+	qpot->evalBatch(1,1,&s,&l,0,pv,pshrd);
+      return eta*l+0.5*temp*temp/rho;
     }
 
     double getG(double x) const {
       double ret=exp(hsstar-getH(sstar+sigma*x));
 
+      numEval++;
       switch (k) {
       case 1:
 	ret*=x;
@@ -73,8 +88,12 @@
      * Second derivative h''(s). This does not depend on 'sstar', 'sigma'.
      */
     double getD2H(double s) const {
-      double temp;
-      qpot->eval(s,0,&temp);
+      double temp,l;
+
+      if (pv==0)
+	qpot->eval(s,0,&temp);
+      else
+	qpot->evalBatch(1,1,&s,&l,&temp,pv,pshrd);
       return eta*temp+1.0/rho;
     }
   };
@@ -119,6 +138,15 @@
    *   int_a^b [g(x)/N(x|0,1)] N(x|0,1) d x,
    * where N(x|0,1) is the standardized weight function, and g(x)/N(x|0,1)
    * is (hopefully) well-approximated by a low-order polynomial.
+   * <p>
+   * This is done in 'compMomentsBatch', if fixed-node rules are configured
+   * by 'setFixedNodeQuad' (or on 'quadServ', see
+   * 'QuadratureServices::setFixedNodeQuad'). Many lanes (potentials) are processed at once:
+   * 'QuadPotProximal::proximalBatch' for the modes, then a single
+   * 'QuadraturePotential::evalBatch' call for all nodes of all lanes. Z_til,
+   * E[x], E[x^2] are computed from the same evaluations. Each lane is
+   * checked against a second rule of different order, and lanes failing
+   * the check are passed to 'compMoments' (adaptive quadrature).
    *
    * @author  Matthias Seeger
    * @version %I% %G%
@@ -130,8 +158,10 @@
 
     QuadPotProximal* qpotProx;            // 'quadPot' with correct type
     Handle<QuadratureServices> quadServ;  // Quadrature services
-    quad_function intFunc;                // Represents integrand g(x)
-    mutable EPPotQuadLaplaceApprox_intFuncParams intFuncPars;
+    Handle<QuadAccuracySchedule> accSched; // Optional
+    Handle<GaussHermiteRule> ghRule;      // Fixed-node rule (optional)
+    Handle<GaussHermiteRule> ghCheck;     // Check rule for 'ghRule'
+    double ghTol;                         // Tolerance for check
 
   public:
     // Public methods
@@ -157,9 +187,173 @@
      * <p>
      * We also return with failure if any of the quadrature service calls
      * returns with status !=0. Again, this may be too stringent.
+     * <p>
+     * This method is reentrant (all per-call state is on the stack), if
+     * 'quadServ' is thread-safe (see 'QuadratureServices::isThreadSafe').
+     * An accuracy schedule must have been applied for the current sweep
+     * (see 'QuadAccuracySchedule').
      */
     bool compMoments(const double* inp,double* ret,double* logz=0,
 		     double eta=1.0) const;
+
+    /**
+     * Sets accuracy schedule, which controls the accuracy of 'quadServ'
+     * and records node counts. Pass 0 handle to remove. If not set, the
+     * schedule attached to 'quadServ' is used (if any).
+     *
+     * @param sched Accuracy schedule
+     */
+    void setAccuracySchedule(const Handle<QuadAccuracySchedule>& sched) {
+      accSched=sched;
+    }
+
+    const Handle<QuadAccuracySchedule>& getAccuracySchedule() const {
+      return accSched;
+    }
+
+    /**
+     * False if 'quadServ' is not thread-safe, or if an accuracy schedule
+     * is in use (schedules are single-threaded, see
+     * 'QuadAccuracySchedule').
+     */
+    bool isThreadSafe() const {
+      return (quadServ->isThreadSafe() && currAccSchedule()==0);
+    }
+
+    /**
+     * Batched version of 'compMoments' (see 'EPScalarPotential'). If
+     * fixed-node rules are configured (see 'currFixedNodeQuad'), and the
+     * integration interval is R without waypoints, all lanes are first
+     * processed by Gauss-Hermite quadrature (see header comment). Results
+     * for lane i are accepted if Z_til, E[x], Var[x] under the rule and
+     * the check rule differ by less than the tolerance (relative for
+     * Z_til, Var[x]).
+     * Other lanes (or all lanes, if fixed-node rules are not configured)
+     * are processed by 'compMoments'.
+     * <p>
+     * 'pv' requires 'quadPot->hasBatchPars'. Lanes which fall back to
+     * adaptive quadrature pass their parameters down (see
+     * 'compMomentsLane'), 'quadPot' is not changed.
+     */
+    int compMomentsBatch(int n,const double* cmu,const double* crho,
+			 double* alpha,double* nu,bool* succ,double* logz=0,
+			 const double* pv=0,const int* pshrd=0,
+			 double eta=1.0) const;
+
+    bool suppBatchPars() const {
+      return qpotProx->hasBatchPars();
+    }
+
+    /**
+     * Configures fixed-node quadrature for 'compMomentsBatch'. 'rule' is
+     * used for the moments, 'check' (of different order) for the error
+     * check. Pass 0 for 'rule' to switch off (the rules configured on
+     * 'quadServ' are used then, if any).
+     * NOTE: For log-concave potentials and moderate cavity variances, K=30
+     * with a check rule of K=20 and 'tol'=1e-5 accepts most lanes. Lanes
+     * with skewed tilted distributions fall back to 'compMoments'.
+     *
+     * @param rule  Gauss-Hermite rule
+     * @param check Gauss-Hermite rule for check
+     * @param tol   Tolerance for check (positive)
+     */
+    void setFixedNodeQuad(const Handle<GaussHermiteRule>& rule,
+			  const Handle<GaussHermiteRule>& check,double tol);
+
+    const Handle<GaussHermiteRule>& getFixedNodeRule() const {
+      return ghRule;
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Does the work for 'compMoments'. If 'pv' is given, the parameters
+     * for l(s) are taken from there (single lane, see
+     * 'QuadraturePotential::evalBatch') instead of 'quadPot'.
+     */
+    bool compMomentsInt(const double* inp,double* ret,double* logz,
+			double eta,const double* pv,const int* pshrd) const;
+
+    /**
+     * Calls 'compMomentsInt' for lane i of a 'compMomentsBatch' call,
+     * passing the parameters of lane i if 'pv' is given.
+     */
+    bool compMomentsLane(int i,int n,double cmu,double crho,double& alpha,
+			 double& nu,double* logz,const double* pv,
+			 const int* pshrd,double eta) const;
+
+    /**
+     * Fixed-node quadrature for a single lane. 's', 'lv' contain nodes
+     * s_* + sigma*x_k and l(s) there. Returns Z_til, E[x], E[x^2] (the
+     * latter two w.r.t. the normalized integrand).
+     */
+    static void fixedNodeSums(const GaussHermiteRule& rule,const double* s,
+			      const double* lv,double cmu,double crho,
+			      double eta,double hsstar,double& ztil,
+			      double& ex1,double& ex2) {
+      int k,nk=rule.getOrder();
+      const double* x=rule.getNodes(),* lwr=rule.getLogWeightRatios();
+      double temp,term;
+
+      ztil=ex1=ex2=0.0;
+      for (k=0; k<nk; k++) {
+	temp=s[k]-cmu;
+	term=exp(lwr[k]+hsstar-eta*lv[k]-0.5*temp*temp/crho);
+	ztil+=term; term*=x[k];
+	ex1+=term; ex2+=term*x[k];
+      }
+      if (ztil>0.0) {
+	ex1/=ztil; ex2/=ztil;
+      }
+    }
+
+    /**
+     * @return Schedule in use: 'accSched' if set, otherwise the one attached
+     *         to 'quadServ' (0 if none)
+     */
+    QuadAccuracySchedule* currAccSchedule() const {
+      return (accSched==0)?quadServ->getAccuracySchedule():accSched.p();
+    }
+
+    /**
+     * Fixed-node rules for 'compMomentsBatch': those set by
+     * 'setFixedNodeQuad', otherwise those configured on 'quadServ'.
+     * 'rule' is 0 if there are none.
+     */
+    void currFixedNodeQuad(const GaussHermiteRule*& rule,
+			   const GaussHermiteRule*& check,double& tol) const {
+      if (!(ghRule==0)) {
+	rule=ghRule.p(); check=ghCheck.p(); tol=ghTol;
+      } else {
+	rule=quadServ->getFixedNodeRule().p();
+	check=quadServ->getFixedNodeCheck().p();
+	tol=quadServ->getFixedNodeTol();
+      }
+    }
+
+    /**
+     * Calls 'quadServ->quad' for the integrand given by 'pars', records the
+     * number of nodes in the schedule (if any, see 'currAccSchedule').
+     */
+    int runQuad(const EPPotQuadLaplaceApprox_intFuncParams& pars,double a,
+		bool aInf,double b,bool bInf,double& ival,
+		const ArrayHandle<double>& wayPts) const {
+      int stat;
+      quad_function intFunc;
+
+      intFunc.function=&EPPotQuadLaplaceApprox_intFunc;
+      intFunc.params=(void*) &pars;
+      pars.numEval=0;
+      TraceScope trace("quad","quad",pars.k,true);
+      stat=quadServ->quad(intFunc,a,aInf,b,bInf,ival,
+			  qpotProx->hasWayPoints(),wayPts);
+      QuadAccuracySchedule* sched=currAccSchedule();
+      if (sched!=0)
+	sched->record(1,pars.numEval);
+
+      return stat;
+    }
   };
 //ENDNS
 
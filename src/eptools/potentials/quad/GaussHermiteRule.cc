@@ -0,0 +1,76 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class GaussHermiteRule
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/potentials/quad/GaussHermiteRule.h"
+#include "src/eptools/potentials/SpecfunServices.h"
+
+//BEGINNS(eptools)
+  const int GaussHermiteRule::maxOrder;
+
+  /*
+   * We compute the rule for weight function exp(-z^2) first (Numerical
+   * Recipes 'gauher'), then transform by x = sqrt(2) z, w = w_z/sqrt(pi).
+   * Nodes are symmetric about 0, we only compute the nonnegative ones.
+   * Initial guesses are those of 'gauher'.
+   */
+#define GAUHER_EPS   3e-14
+#define GAUHER_MAXIT 20
+#define GAUHER_PIM4  0.7511255444649425 // pi^{-1/4}
+  GaussHermiteRule::GaussHermiteRule(int order)
+  {
+    int i,j,its,m=(order+1)/2;
+    double z=0.0,z1,p1,p2,p3,pp=0.0,temp;
+
+    if (order<1 || order>maxOrder)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    nodes.changeRep(order); weights.changeRep(order);
+    logWRatio.changeRep(order);
+    ArrayHandle<double> zs(m),ws(m); // Nonneg. nodes, decreasing
+    for (i=0; i<m; i++) {
+      if (i==0)
+	z=sqrt((double) (2*order+1))-1.85575*pow((double) (2*order+1),
+						 -0.16667);
+      else if (i==1)
+	z-=1.14*pow((double) order,0.426)/z;
+      else if (i==2)
+	z=1.86*z-0.86*zs[0];
+      else if (i==3)
+	z=1.91*z-0.91*zs[1];
+      else
+	z=2.0*z-zs[i-2];
+      for (its=0; its<GAUHER_MAXIT; its++) {
+	// Orthonormal Hermite polynomials by recurrence. p1 is of degree
+	// 'order', p2 of degree 'order'-1
+	p1=GAUHER_PIM4; p2=0.0;
+	for (j=0; j<order; j++) {
+	  p3=p2; p2=p1;
+	  p1=z*sqrt(2.0/(j+1))*p2-sqrt(((double) j)/(j+1))*p3;
+	}
+	pp=sqrt(2.0*order)*p2;
+	z1=z; z=z1-p1/pp;
+	if (fabs(z-z1)<=GAUHER_EPS) break;
+      }
+      if (its==GAUHER_MAXIT)
+	throw NumericalException(EXCEPT_MSG(""));
+      zs[i]=z; ws[i]=2.0/(pp*pp);
+    }
+    // Transform, sort increasingly
+    for (i=0; i<m; i++) {
+      temp=SpecfunServices::m_sqrt2*zs[i];
+      nodes[order-1-i]=temp; nodes[i]=-temp;
+      temp=ws[i]/SpecfunServices::m_sqrtpi;
+      weights[order-1-i]=weights[i]=temp;
+    }
+    if (order%2==1) nodes[m-1]=0.0;
+    for (i=0; i<order; i++)
+      logWRatio[i]=log(weights[i])-SpecfunServices::logPdfNormal(nodes[i]);
+  }
+#undef GAUHER_PIM4
+#undef GAUHER_MAXIT
+#undef GAUHER_EPS
+//ENDNS
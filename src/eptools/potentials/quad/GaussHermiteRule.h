@@ -0,0 +1,80 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class GaussHermiteRule
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_GAUSSHERMITERULE_H
+#define EPTOOLS_GAUSSHERMITERULE_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+
+//BEGINNS(eptools)
+  /**
+   * Gauss-Hermite quadrature rule of order K w.r.t. the standard normal
+   * weight function:
+   *   int f(x) N(x|0,1) d x  approx  sum_k w_k f(x_k).
+   * The rule is exact if f(x) is a polynomial of degree <= 2K-1. Nodes
+   * x_k are increasing.
+   * <p>
+   * For integrals int g(x) d x, where g(x) is close to a multiple of
+   * N(x|0,1) (e.g., after Laplace transformation, see
+   * 'EPPotQuadLaplaceApprox'), we also store
+   *   lwr_k = log w_k - log N(x_k|0,1),
+   * so that
+   *   int g(x) d x  approx  sum_k exp(lwr_k + log g(x_k)).
+   * <p>
+   * Nodes and weights are computed upon construction, by Newton's method
+   * applied to the orthonormal Hermite polynomials (see Numerical Recipes,
+   * 'gauher'). Objects are immutable and can be shared.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class GaussHermiteRule
+  {
+  protected:
+    // Members
+
+    ArrayHandle<double> nodes,weights; // x_k, w_k
+    ArrayHandle<double> logWRatio;     // lwr_k
+
+  public:
+    // Constants
+
+    static const int maxOrder=128;
+
+    // Public methods
+
+    /**
+     * Constructor
+     *
+     * @param order Order K (1 <= K <= 'maxOrder')
+     */
+    explicit GaussHermiteRule(int order);
+
+    int getOrder() const {
+      return nodes.size();
+    }
+
+    const double* getNodes() const {
+      return nodes.p();
+    }
+
+    const double* getWeights() const {
+      return weights.p();
+    }
+
+    const double* getLogWeightRatios() const {
+      return logWRatio.p();
+    }
+  };
+//ENDNS
+
+#endif
@@ -0,0 +1,95 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class GaussLaguerreRule
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/potentials/quad/GaussLaguerreRule.h"
+
+//BEGINNS(eptools)
+  const int GaussLaguerreRule::maxOrder;
+
+  /*
+   * Golub-Welsch: The nodes are the eigenvalues of the symmetric
+   * tridiagonal Jacobi matrix of the monic Laguerre polynomials, with
+   *   diagonal      2j+alpha+1,          j=0,...,K-1,
+   *   off-diagonal  sqrt((j+1)(j+1+alpha)), j=0,...,K-2,
+   * the weights are the squared first components of the normalized
+   * eigenvectors. Eigenvalues are computed by the QL algorithm with
+   * implicit shifts (Numerical Recipes, 'tqli'), where only the first
+   * row of the eigenvector matrix is maintained.
+   */
+#define GAULAG_EPS   1e-15
+#define GAULAG_MAXIT 30
+  GaussLaguerreRule::GaussLaguerreRule(int order,double palpha) :
+    alpha(palpha)
+  {
+    int i,j,l,m,iter,n=order;
+    double b,c,f,g,p,r,s,dd;
+
+    if (order<1 || order>maxOrder || palpha<=-1.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    nodes.changeRep(n); weights.changeRep(n);
+    logWeights.changeRep(n);
+    ArrayHandle<double> e(n),z(n);
+    double* d=nodes.p();
+    for (j=0; j<n; j++) {
+      d[j]=2.0*j+alpha+1.0;
+      e[j]=(j<n-1)?sqrt((j+1.0)*(j+1.0+alpha)):0.0;
+      z[j]=0.0;
+    }
+    z[0]=1.0;
+    for (l=0; l<n; l++) {
+      iter=0;
+      do {
+	for (m=l; m<n-1; m++) {
+	  dd=fabs(d[m])+fabs(d[m+1]);
+	  if (fabs(e[m])<=GAULAG_EPS*dd) break;
+	}
+	if (m!=l) {
+	  if (iter++==GAULAG_MAXIT)
+	    throw NumericalException(EXCEPT_MSG(""));
+	  g=(d[l+1]-d[l])/(2.0*e[l]);
+	  r=sqrt(g*g+1.0);
+	  g=d[m]-d[l]+e[l]/(g+((g>=0.0)?r:-r));
+	  s=c=1.0; p=0.0;
+	  for (i=m-1; i>=l; i--) {
+	    f=s*e[i]; b=c*e[i];
+	    e[i+1]=(r=sqrt(f*f+g*g));
+	    if (r==0.0) {
+	      d[i+1]-=p; e[m]=0.0;
+	      break;
+	    }
+	    s=f/r; c=g/r;
+	    g=d[i+1]-p;
+	    r=(d[i]-g)*s+2.0*c*b;
+	    d[i+1]=g+(p=s*r);
+	    g=c*r-b;
+	    f=z[i+1];
+	    z[i+1]=s*z[i]+c*f;
+	    z[i]=c*z[i]-s*f;
+	  }
+	  if (r==0.0 && i>=l) continue;
+	  d[l]-=p; e[l]=g; e[m]=0.0;
+	}
+      } while (m!=l);
+    }
+    // Sort nodes increasingly (insertion sort, K is small)
+    for (i=1; i<n; i++) {
+      p=d[i]; s=z[i];
+      for (j=i; j>0 && d[j-1]>p; j--) {
+	d[j]=d[j-1]; z[j]=z[j-1];
+      }
+      d[j]=p; z[j]=s;
+    }
+    for (i=0; i<n; i++) {
+      if (!(d[i]>0.0)) throw NumericalException(EXCEPT_MSG(""));
+      weights[i]=z[i]*z[i];
+      logWeights[i]=2.0*log(fabs(z[i]));
+    }
+  }
+#undef GAULAG_MAXIT
+#undef GAULAG_EPS
+//ENDNS
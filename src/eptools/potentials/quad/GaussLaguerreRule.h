@@ -0,0 +1,82 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class GaussLaguerreRule
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_GAUSSLAGUERRERULE_H
+#define EPTOOLS_GAUSSLAGUERRERULE_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/default.h"
+
+//BEGINNS(eptools)
+  /**
+   * Generalized Gauss-Laguerre quadrature rule of order K w.r.t. the
+   * Gamma weight function with shape alpha+1 and scale 1:
+   *   int_0^infty f(x) Gamma(x|alpha+1,1) d x  approx  sum_k w_k f(x_k),
+   *   Gamma(x|alpha+1,1) = x^alpha e^{-x} / Gamma(alpha+1),
+   * where alpha > -1. The rule is exact if f(x) is a polynomial of degree
+   * <= 2K-1. Nodes x_k are positive and increasing, weights w_k sum to 1.
+   * <p>
+   * Nodes and weights are computed upon construction, as eigenvalues and
+   * eigenvector components of the Jacobi matrix (Golub-Welsch), which
+   * costs O(K^2). This is robust for large alpha as well. The weights are
+   * also available as log w_k. Objects are immutable.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class GaussLaguerreRule
+  {
+  protected:
+    // Members
+
+    double alpha;
+    ArrayHandle<double> nodes,weights; // x_k, w_k
+    ArrayHandle<double> logWeights;    // log w_k
+
+  public:
+    // Constants
+
+    static const int maxOrder=128;
+
+    // Public methods
+
+    /**
+     * Constructor. Throws 'NumericalException' if the eigenvalue
+     * iteration fails to converge.
+     *
+     * @param order  Order K (1 <= K <= 'maxOrder')
+     * @param palpha Value for alpha (> -1)
+     */
+    GaussLaguerreRule(int order,double palpha);
+
+    int getOrder() const {
+      return nodes.size();
+    }
+
+    double getAlpha() const {
+      return alpha;
+    }
+
+    const double* getNodes() const {
+      return nodes.p();
+    }
+
+    const double* getWeights() const {
+      return weights.p();
+    }
+
+    const double* getLogWeights() const {
+      return logWeights.p();
+    }
+  };
+//ENDNS
+
+#endif
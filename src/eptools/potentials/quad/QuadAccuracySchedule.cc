@@ -0,0 +1,38 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Definition of class QuadAccuracySchedule
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/potentials/quad/QuadAccuracySchedule.h"
+
+//BEGINNS(eptools)
+  QuadAccuracySchedule::QuadAccuracySchedule(double paccMin,double paccMax,
+					     double paccFact) :
+    accMin(paccMin),accMax(paccMax),accFact(paccFact)
+  {
+    if (paccMin<=0.0 || paccMax<paccMin || paccFact<=0.0)
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    pthread_mutex_init(&mutex,0);
+    reset();
+  }
+
+  void QuadAccuracySchedule::startSweep(double delta)
+  {
+    if (delta<0.0)
+      currAcc=accMax;
+    else
+      currAcc=std::max(accMin,std::min(accMax,accFact*delta));
+    swAcc.push_back(currAcc);
+    swNumQuad.push_back(0);
+    swNumNode.push_back(0);
+  }
+
+  void QuadAccuracySchedule::reset()
+  {
+    swAcc.clear(); swNumQuad.clear(); swNumNode.clear();
+    startSweep();
+  }
+//ENDNS
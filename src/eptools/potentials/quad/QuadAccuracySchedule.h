@@ -0,0 +1,144 @@
+/* -------------------------------------------------------------------
+ * LHOTSE: Toolbox for adaptive statistical models
+ * -------------------------------------------------------------------
+ * Project source file
+ * Module: eptools
+ * Desc.:  Header class QuadAccuracySchedule
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTOOLS_QUADACCURACYSCHEDULE_H
+#define EPTOOLS_QUADACCURACYSCHEDULE_H
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "src/eptools/potentials/quad/QuadratureServices.h"
+#include <pthread.h>
+
+//BEGINNS(eptools)
+  /**
+   * Accuracy schedule for quadrature potentials ('EPPotQuadLaplaceApprox',
+   * 'EPPotGaussianPrecision'). Early EP sweeps, when cavity distributions
+   * are far from converged, do not need high quadrature accuracy. The
+   * accuracy is tied to the convergence criterion delta of the last
+   * recent sweep:
+   *   acc = max(accMin, min(accMax, accFact*delta)).
+   * The driver has to call 'startSweep' before each sweep, passing the
+   * delta value of the previous one (none for the first sweep, where
+   * 'accMax' is used).
+   * <p>
+   * A schedule is either set for a potential ('setAccuracySchedule'), or
+   * attached to the 'QuadratureServices' object, in which case it is used
+   * by all potentials sharing this object. The latter is done by the
+   * wrapper 'eptwrap_quad_accsched', called by the Python drivers.
+   * <p>
+   * Potentials using the schedule call 'apply' before their quadrature
+   * calls, which passes the accuracy to the 'QuadratureServices' object (if
+   * 'hasAccuracyControl' returns true, otherwise the schedule only records
+   * statistics). After each quadrature call, they call 'record' with the
+   * number of integrand evaluations (nodes). For each sweep, we record the
+   * accuracy, number of quadrature calls and total number of nodes.
+   * <p>
+   * An object can be shared by several potentials. 'record' can be called
+   * concurrently. 'apply' changes the accuracy of 'QuadratureServices'
+   * only for the first call after 'startSweep', so potentials can be
+   * updated concurrently if 'apply' is called once after 'startSweep',
+   * before the updates (as done by 'eptwrap_quad_accsched'). 'startSweep'
+   * must not be called concurrently with other methods.
+   *
+   * @author  Matthias Seeger
+   * @version %I% %G%
+   */
+  class QuadAccuracySchedule
+  {
+  protected:
+    // Members
+
+    double accMin,accMax,accFact;
+    double currAcc;
+    VEC_TYPE(double) swAcc;  // Accuracy per sweep
+    VEC_TYPE(int) swNumQuad; // Number of 'quad' calls per sweep
+    VEC_TYPE(int) swNumNode; // Number of integrand evaluations per sweep
+    pthread_mutex_t mutex;   // Protects counts in 'record'
+
+  public:
+    // Public methods
+
+    /**
+     * Constructor. Before 'startSweep' is called, the accuracy is
+     * 'paccMax', and statistics are recorded for sweep 0.
+     *
+     * @param paccMin  Value for 'accMin' (positive)
+     * @param paccMax  Value for 'accMax' (>= 'paccMin')
+     * @param paccFact Value for 'accFact'. Def.: 0.1
+     */
+    QuadAccuracySchedule(double paccMin,double paccMax,double paccFact=0.1);
+
+    ~QuadAccuracySchedule() {
+      pthread_mutex_destroy(&mutex);
+    }
+
+    /**
+     * Starts a new sweep. The accuracy is determined from 'delta' (see
+     * header comment). If 'delta'<0, 'accMax' is used.
+     *
+     * @param delta Convergence criterion of previous sweep. Def.: -1
+     */
+    void startSweep(double delta=-1.0);
+
+    double getAccuracy() const {
+      return currAcc;
+    }
+
+    /**
+     * Passes current accuracy to 'qserv', if it supports accuracy control.
+     *
+     * @param qserv Quadrature services
+     */
+    void apply(QuadratureServices& qserv) const {
+      if (qserv.hasAccuracyControl() && qserv.getAccuracy()!=currAcc)
+	qserv.setAccuracy(currAcc);
+    }
+
+    /**
+     * Records quadrature call(s) for the current sweep.
+     *
+     * @param nquad Number of 'quad' calls
+     * @param nnode Number of integrand evaluations
+     */
+    void record(int nquad,int nnode) {
+      pthread_mutex_lock(&mutex);
+      swNumQuad.back()+=nquad; swNumNode.back()+=nnode;
+      pthread_mutex_unlock(&mutex);
+    }
+
+    /**
+     * @return Number of sweeps recorded so far (including the current one)
+     */
+    int numSweeps() const {
+      return swAcc.size();
+    }
+
+    /**
+     * Statistics for sweep 'sw' (0 is the first).
+     *
+     * @param sw    Sweep number
+     * @param acc   Accuracy ret. here
+     * @param nquad Number of 'quad' calls ret. here
+     * @param nnode Number of integrand evaluations ret. here
+     */
+    void getSweepStats(int sw,double& acc,int& nquad,int& nnode) const {
+      if (sw<0 || sw>=numSweeps()) throw OutOfRangeException(EXCEPT_MSG(""));
+      acc=swAcc[sw]; nquad=swNumQuad[sw]; nnode=swNumNode[sw];
+    }
+
+    /**
+     * Clears statistics, and sets accuracy to 'accMax' (as after
+     * construction).
+     */
+    void reset();
+  };
+//ENDNS
+
+#endif
@@ -43,7 +43,54 @@
      * @return      Successful?
      */
     virtual bool proximal(double h,double rho,double& sstar) const = 0;
+
+    /**
+     * Batched version of 'proximal'. Computes s_*[i] for (h[i],rho[i]),
+     * i=0,...,n-1. 'succ[i]' is set to the success flag for lane i.
+     * <p>
+     * By default, the potential parameters of this object are used for all
+     * lanes. If 'pv' is given, the parameters for lane i are taken from
+     * 'pv', 'pshrd' in the format used by 'DefaultPotManager': the values
+     * of the k-th parameter start at 'pv[off_k]', off_0=0. If 'pshrd[k]'
+     * is true, there is a single value shared by all lanes, otherwise there
+     * are n values (off_{k+1}-off_k == n). These values are not checked for
+     * validity.
+     * <p>
+     * 'pv' is supported iff 'hasBatchPars' returns true. The default
+     * implementation calls 'proximal' for each lane, it does not support
+     * 'pv'. Subclasses should overwrite this method if they can do better
+     * (e.g., 'BatchOneDimSolver'). See also
+     * 'QuadraturePotential::batchParsAccess'.
+     *
+     * @param n     Number of lanes
+     * @param h     Parameters h
+     * @param rho   Parameters rho (positive)
+     * @param sstar Results s_* ret. here
+     * @param succ  Success flags ret. here
+     * @param pv    See above. Optional
+     * @param pshrd See above. Required iff 'pv' is given
+     * @return      Number of failed lanes
+     */
+    virtual int proximalBatch(int n,const double* h,const double* rho,
+			      double* sstar,bool* succ,const double* pv=0,
+			      const int* pshrd=0) const;
   };
+
+  // Inline methods
+
+  inline int
+  QuadPotProximal::proximalBatch(int n,const double* h,const double* rho,
+				 double* sstar,bool* succ,const double* pv,
+				 const int*) const
+  {
+    int i,nfail=0;
+
+    if (pv!=0) throw NotImplemException(EXCEPT_MSG(""));
+    for (i=0; i<n; i++)
+      if (!(succ[i]=proximal(h[i],rho[i],sstar[i]))) nfail++;
+
+    return nfail;
+  }
 //ENDNS
 
 #endif
@@ -20,9 +20,8 @@
 
   bool QuadPotProximalNewton::proximal(double h,double rho,double& sstar) const
   {
-    if (proxFun==0)
-      proxFun.changeRep(new QuadPotProximalNewton_Func1D(this));
-    proxFun->setPars(h,rho);
+    QuadPotProximalNewton_Func1D proxFun(this,h,rho);
+
     try {
       // Initial bracket
       double bL,bR;
@@ -37,7 +36,7 @@
 	  cout << "infty)" << endl;
       }
       // Run Newton solver
-      sstar = OneDimSolver::newton(proxFun.p(),bL,bR,acc,facc,brRight,0.0,
+      sstar = OneDimSolver::newton(&proxFun,bL,bR,acc,facc,brRight,0.0,
 				   "QuadPotProximalNewton");
     } catch (...) {
       return false; // Exception thrown in 'OneDimSolver::newton'
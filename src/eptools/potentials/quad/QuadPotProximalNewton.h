@@ -9,7 +9,7 @@
 /*
  * TODO:
  * - Mechanism to store the last recent proximal map solution and to use
- *   it in order to initialize the bracket
+ *   it in order to initialize the bracket (must not break reentrancy)
  */
 
 #ifndef EPTOOLS_QUADPOTPROXIMALNEWTON_H
@@ -81,6 +81,9 @@
    *   f(L) < 0,  f(R) > 0
    * L must be supplied. If R is not supplied, it is determined
    * automatically. This may fail for non-convex l(s).
+   * <p>
+   * 'proximal' is reentrant: the function object f(s) is created on the
+   * stack for each call.
    *
    * @author  Matthias Seeger
    * @version %I% %G%
@@ -90,7 +93,6 @@
   protected:
     // Members
 
-    mutable Handle<QuadPotProximalNewton_Func1D> proxFun; // Function f(s)
     double acc,facc; // See 'OneDimSolver'
     int verbose;     // Verbosity level
 
@@ -99,9 +101,6 @@
 
     /**
      * Constructor.
-     * Note that 'proxFun' is created only once first used, not here. This
-     * avoids trouble by passing the 'this' pointer for ourselves, while not
-     * fully constructed.
      *
      * @param pacc  See 'OneDimSolver::newton'. >0
      * @param pfacc "
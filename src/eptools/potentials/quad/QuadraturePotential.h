@@ -96,7 +96,98 @@
      */
     virtual void getInterval(double& a,bool& aInf,double& b,bool& bInf,
 			     ArrayHandle<double>& wayPts) const = 0;
+
+    /**
+     * Batched version of 'eval', used by fixed-node quadrature (see
+     * 'EPPotQuadLaplaceApprox::compMomentsBatch'). There are n lanes with
+     * m arguments each: l(s) is evaluated at 's[i*m+j]', the result is
+     * written to 'l[i*m+j]', and l''(s) to 'ddl[i*m+j]' if 'ddl' is given
+     * (requires 'hasSecondDerivatives').
+     * <p>
+     * By default, the potential parameters of this object are used for all
+     * lanes. If 'pv' is given, the parameters for lane i are taken from
+     * 'pv', 'pshrd' in the format used by 'DefaultPotManager' (see
+     * 'QuadPotProximal::proximalBatch'). This is supported iff
+     * 'hasBatchPars' returns true.
+     * <p>
+     * The default implementation calls 'eval', it does not support 'pv'.
+     *
+     * @param n     Number of lanes
+     * @param m     Number of arguments per lane
+     * @param s     Arguments (size n*m)
+     * @param l     Values l(s) ret. here (size n*m)
+     * @param ddl   Values l''(s) ret. here (size n*m). Optional
+     * @param pv    See above. Optional
+     * @param pshrd See above. Required iff 'pv' is given
+     */
+    virtual void evalBatch(int n,int m,const double* s,double* l,
+			   double* ddl=0,const double* pv=0,
+			   const int* pshrd=0) const;
+
+    /**
+     * @return Do 'evalBatch' (and 'QuadPotProximal::proximalBatch') support
+     *         per-lane parameters?
+     */
+    virtual bool hasBatchPars() const {
+      return false;
+    }
+
+  protected:
+    // Internal methods
+
+    /**
+     * Helper for 'evalBatch', 'proximalBatch' implementations. For each
+     * parameter k, the value for lane i is 'pptr[k][i*pinc[k]]' afterwards.
+     * If 'pv'==0, the parameters of this object are written to 'pown' (size
+     * 'numPars'), and all lanes access them.
+     *
+     * @param n     Number of lanes
+     * @param pv    See 'evalBatch'
+     * @param pshrd "
+     * @param pown  Buffer, size 'numPars'
+     * @param pptr  Pointers ret. here, size 'numPars'
+     * @param pinc  Increments ret. here (0 or 1), size 'numPars'
+     */
+    void batchParsAccess(int n,const double* pv,const int* pshrd,
+			 double* pown,const double** pptr,int* pinc) const;
   };
+
+  // Inline methods
+
+  inline void
+  QuadraturePotential::evalBatch(int n,int m,const double* s,double* l,
+				 double* ddl,const double* pv,
+				 const int*) const
+  {
+    int i,sz=n*m;
+
+    if (pv!=0) throw NotImplemException(EXCEPT_MSG(""));
+    if (ddl!=0 && !hasSecondDerivatives())
+      throw InvalidParameterException(EXCEPT_MSG(""));
+    for (i=0; i<sz; i++)
+      l[i]=eval(s[i],0,(ddl!=0)?(ddl+i):0);
+  }
+
+  inline void
+  QuadraturePotential::batchParsAccess(int n,const double* pv,
+				       const int* pshrd,double* pown,
+				       const double** pptr,int* pinc) const
+  {
+    int k,np=numPars();
+
+    if (pv==0) {
+      getPars(pown);
+      for (k=0; k<np; k++) {
+	pptr[k]=pown+k; pinc[k]=0;
+      }
+    } else {
+      if (pshrd==0) throw InvalidParameterException(EXCEPT_MSG(""));
+      for (k=0; k<np; k++) {
+	pptr[k]=pv; pinc[k]=pshrd[k]?0:1;
+	pv+=(pshrd[k]?1:n);
+      }
+    }
+  }
 //ENDNS
 
 #endif
@@ -14,6 +14,7 @@
 #endif
 
 #include "src/eptools/default.h"
+#include "src/eptools/potentials/quad/GaussHermiteRule.h"
 
 //BEGINNS(eptools)
   /**
@@ -32,17 +33,43 @@
    * Base class for numerical quadrature services required by subclasses of
    * 'EPPotQuadrature'.
    * <p>
-   * An instance of this class can be shared by several potential objects,
-   * as long as the corresponding quadrature calls do not happen in parallel.
+   * An instance of this class can be shared by several potential objects.
+   * If 'isThreadSafe' returns true, 'quad' can be called concurrently from
+   * several threads: all per-call state (work arrays, interval lists, error
+   * messages) must then be allocated per call (or per thread), and not be
+   * kept in members. The integrand parameters are owned by the caller.
+   * Otherwise, quadrature calls must not happen in parallel.
+   * <p>
+   * 'setAccuracy' must not be called concurrently with 'quad'.
+   * <p>
+   * An accuracy schedule can be attached ('setAccuracySchedule'). It is
+   * used by all quadrature potentials sharing this object, unless they
+   * have their own schedule (see 'QuadAccuracySchedule'). This allows
+   * the driver to control the accuracy, even though the potentials are
+   * created in the wrapper functions.
+   * Fixed-node quadrature rules for batched updates can be configured in
+   * the same way ('setFixedNodeQuad', see
+   * 'EPPotQuadLaplaceApprox::compMomentsBatch'). Neither must be changed
+   * concurrently with 'quad'.
    *
    * @author  Matthias Seeger
    * @version %I% %G%
    */
   class QuadratureServices
   {
+  protected:
+    // Members
+
+    QuadAccuracySchedule* accSched; // Attached schedule (not owned)
+    Handle<GaussHermiteRule> fnRule;  // Fixed-node rule (optional)
+    Handle<GaussHermiteRule> fnCheck; // Check rule for 'fnRule'
+    double fnTol;                     // Tolerance for check
+
   public:
     // Public methods
 
+    QuadratureServices() : accSched(0),fnTol(1e-6) {}
+
     virtual ~QuadratureServices() {}
 
     /**
@@ -50,6 +77,15 @@
      */
     virtual bool hasAbsErrorEstimate() const = 0;
 
+    /**
+     * See header comment. The default implementation returns false.
+     *
+     * @return Can 'quad' be called concurrently?
+     */
+    virtual bool isThreadSafe() const {
+      return false;
+    }
+
     /**
      * Messages are printed for a positive verbosity level.
      *
@@ -97,6 +133,84 @@
 		     ArrayHandleZero<double>::get(),double* abserr=0,
 		     string* errmsg=0) = 0;
 
+    /**
+     * If this returns true, the accuracy of 'quad' can be controlled by
+     * 'setAccuracy'. This is used by 'QuadAccuracySchedule'.
+     *
+     * @return Is accuracy control supported?
+     */
+    virtual bool hasAccuracyControl() const {
+      return false;
+    }
+
+    /**
+     * Only if 'hasAccuracyControl' returns true.
+     *
+     * @return Current accuracy (see 'setAccuracy')
+     */
+    virtual double getAccuracy() const {
+      throw NotImplemException(EXCEPT_MSG(""));
+    }
+
+    /**
+     * Sets accuracy used by subsequent 'quad' calls. Smaller values mean
+     * more accurate (and more expensive) quadrature. Adaptive
+     * implementations should use 'acc' as relative error tolerance,
+     * implementations with fixed rules should map it to a rule order.
+     * Only if 'hasAccuracyControl' returns true.
+     *
+     * @param acc New accuracy (positive)
+     */
+    virtual void setAccuracy(double) {
+      throw NotImplemException(EXCEPT_MSG(""));
+    }
+
+    /**
+     * Attaches accuracy schedule (see header comment). The object is not
+     * owned here. Pass 0 to detach.
+     *
+     * @param sched Accuracy schedule
+     */
+    void setAccuracySchedule(QuadAccuracySchedule* sched) {
+      accSched=sched;
+    }
+
+    QuadAccuracySchedule* getAccuracySchedule() const {
+      return accSched;
+    }
+
+    /**
+     * Configures fixed-node quadrature for the potentials sharing this
+     * object, unless they have their own rules (see
+     * 'EPPotQuadLaplaceApprox::setFixedNodeQuad' for the arguments). Pass
+     * 0 for 'rule' to switch off.
+     *
+     * @param rule  Gauss-Hermite rule
+     * @param check Gauss-Hermite rule for check
+     * @param tol   Tolerance for check (positive)
+     */
+    void setFixedNodeQuad(const Handle<GaussHermiteRule>& rule,
+			  const Handle<GaussHermiteRule>& check,double tol) {
+      if (!(rule==0) && (check==0 || check->getOrder()==rule->getOrder() ||
+			 tol<=0.0))
+	throw InvalidParameterException(EXCEPT_MSG(""));
+      fnRule=rule;
+      fnCheck=(rule==0)?Handle<GaussHermiteRule>():check;
+      if (!(rule==0)) fnTol=tol;
+    }
+
+    const Handle<GaussHermiteRule>& getFixedNodeRule() const {
+      return fnRule;
+    }
+
+    const Handle<GaussHermiteRule>& getFixedNodeCheck() const {
+      return fnCheck;
+    }
+
+    double getFixedNodeTol() const {
+      return fnTol;
+    }
+
     virtual void debug_method() const {}; // DEBUG!
   };
 //ENDNS
@@ -25,6 +25,7 @@
   class PotManagerFactory;
   class EPPotLaplace;
   class EPPotProbit;
+  class EPPotLogistic;
   class EPPotQuantileRegress;
   class EPPotSpikeSlab;
   class EPPotGaussian;
@@ -34,6 +35,9 @@
   class QuadPotProximalNewton;
   class EPPotQuadrature;
   class QuadratureServices;
+  class QuadAccuracySchedule;
+  class GaussHermiteRule;
+  class GaussLaguerreRule;
   class EPPotQuadLaplaceApprox;
   class EPPotPoissonCommon;
   class EPPotPoissonExpRate;
@@ -45,6 +49,13 @@
   class FactEPMaximumPiValues;
   class FactorizedEPRepresentation;
   class FactorizedEPDriver;
+  class ParallelFactEPDriver;
+  class FactEPTestMonitor;
+  class NumaServices;
+  class TraceServices;
+  class TraceScope;
+  class CheckpointServices;
+  class EPMemoryTags;
 //ENDNS
 
 #endif
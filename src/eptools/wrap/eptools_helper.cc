@@ -33,6 +33,7 @@ void createPotentialManager(W_IARRAY(potids),W_IARRAY(numpot),W_DARRAY(parvec),
   //  annobjA.size());
   //printMsgStdout(W_ERRSTR);
   try {
+    MemTagScope mtag(EPMemoryTags::tagPotMan);
     potMan.changeRep(PotManagerFactory::create(potidsA,numpotA,parvecA,
 					       parshrdA,annobjA));
   } catch (StandardException ex) {
@@ -62,6 +63,7 @@ void createFactEPRepres(int numN,int numM,W_IARRAY(rp_rowind),
   W_MASKARRAY(rp_pi);
   W_MASKARRAY(rp_beta);
   try {
+    MemTagScope mtag(EPMemoryTags::tagRepres);
     epRepr.changeRep(new FactorizedEPRepresentation(numN,numM,rp_rowindA,
 						    rp_colindA,rp_bvalsA,
 						    rp_betaA,rp_piA));
@@ -99,6 +101,7 @@ void createFactEPRepres_bvprec(int numN,int numM,W_IARRAY(rp_rowind),
   W_MASKARRAY(rp_a);
   W_MASKARRAY(rp_c);
   try {
+    MemTagScope mtag(EPMemoryTags::tagRepres);
     epRepr.changeRep(new FactorizedEPRepresentation(numN,numM,rp_rowindA,
 						    rp_colindA,rp_bvalsA,
 						    rp_betaA,rp_piA,rp_aA,
@@ -12,6 +12,8 @@
 #include "src/main.h"
 #include "src/eptools/wrap/eptools_helper_macros.h"
 #include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
+#include "src/eptools/EPMemoryTags.h"
 
 // Helper functions
 
@@ -6,6 +6,7 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/wrap/eptools_helper_basic.h"
+#include <math.h>
 
 void fillVec(double* vec,int n,double val)
 {
@@ -18,3 +19,76 @@ void fillVecStep(double* vec,int n,int incv,double val)
   int i;
   for (i=0; i<n; i++,vec+=incv) *vec=val;
 }
+
+void trsvLower(fst_matrix* lmat,bool trans,double* x,ddot_type f_ddot,
+	       daxpy_type f_daxpy)
+{
+  blasint_t i,n=lmat->n,sz,ione=1;
+  double temp;
+  double* col;
+  bool ispacked=(PACKED(lmat->strcode)=='P');
+
+  if (!trans) {
+    for (i=0,col=lmat->buff; i<n; i++) {
+      x[i]/=*col;
+      if ((sz=n-i-1)>0) {
+	temp=-x[i];
+	f_daxpy(&sz,&temp,col+1,&ione,x+(i+1),&ione);
+      }
+      col+=(ispacked?(n-i):(lmat->stride+1));
+    }
+  } else {
+    col=lmat->buff+(ispacked?PACKEDL_DIAG(n,n-1):(n-1)*(lmat->stride+1));
+    for (i=n-1; i>=0; i--) {
+      if ((sz=n-i-1)>0)
+	x[i]-=f_ddot(&sz,col+1,&ione,x+(i+1),&ione);
+      x[i]/=*col;
+      if (i>0)
+	col-=(ispacked?(n-i+1):(lmat->stride+1));
+    }
+  }
+}
+
+void givensRotg(double* a,double* b,double* c,double* s)
+{
+  double roe,scale,r,z;
+
+  roe=(fabs(*a)>fabs(*b))?*a:*b;
+  scale=fabs(*a)+fabs(*b);
+  if (scale==0.0) {
+    *c=1.0; *s=0.0; r=z=0.0;
+  } else {
+    r=scale*sqrt((*a/scale)*(*a/scale)+(*b/scale)*(*b/scale));
+    if (roe<0.0) r=-r;
+    *c=*a/r; *s=*b/r;
+    z=1.0;
+    if (fabs(*a)>fabs(*b))
+      z=*s;
+    else if (*c!=0.0)
+      z=1.0/(*c);
+  }
+  *a=r; *b=z;
+}
+
+void trsvLowerSingle(fst_smatrix* lmat,bool trans,double* x)
+{
+  int i,k,n=lmat->n,ldl=lmat->stride;
+  double temp;
+  const float* col;
+
+  if (!trans) {
+    for (i=0; i<n; i++) {
+      col=lmat->buff+(i*ldl);
+      temp=(x[i]/=col[i]);
+      for (k=i+1; k<n; k++)
+	x[k]-=temp*col[k];
+    }
+  } else {
+    for (i=n-1; i>=0; i--) {
+      col=lmat->buff+(i*ldl);
+      for (k=i+1,temp=x[i]; k<n; k++)
+	temp-=col[k]*x[k];
+      x[i]=temp/col[i];
+    }
+  }
+}
@@ -8,10 +8,34 @@
 #ifndef EPTOOLS_HELPER_BASIC_H
 #define EPTOOLS_HELPER_BASIC_H
 
+#include "src/eptools/wrap/matrix_types.h"
+
 // Helper functions
 
 void fillVec(double* vec,int n,double val); 
 
 void fillVecStep(double* vec,int n,int incv,double val);
 
+/*
+ * Triangular solve with n-by-n lower triangular L in 'lmat' (full or
+ * packed storage, see matrix_types.h): 'x' overwritten by L\x
+ * (trans==false) or L'\x (trans==true). Uses BLAS level 1 only (column
+ * oriented), since dtrsv/dtpsv are not always available.
+ */
+void trsvLower(fst_matrix* lmat,bool trans,double* x,ddot_type f_ddot,
+	       daxpy_type f_daxpy);
+
+/*
+ * Givens rotation, same as BLAS drotg: J = [c s; -s c], s.t.
+ * J [a; b] = [r; 0]. 'a' overwritten by r, 'b' by z (see BLAS).
+ */
+void givensRotg(double* a,double* b,double* c,double* s);
+
+/*
+ * Triangular solve as 'trsvLower', but for single precision L in 'lmat'
+ * (full storage). 'x' is double, inner products are accumulated in
+ * double.
+ */
+void trsvLowerSingle(fst_smatrix* lmat,bool trans,double* x);
+
 #endif
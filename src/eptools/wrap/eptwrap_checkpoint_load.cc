@@ -0,0 +1,61 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHECKPOINT_LOAD
+ *
+ * Reads array NAME from checkpoint file FNAME (see
+ * 'CheckpointServices'), checking the checksums. If only FNAME, NAME
+ * are given, SIZE, TYPE of the array and the sweep number SWEEP of the
+ * snapshot are returned (SIZE==-1 if NAME is not in the file). If DVEC,
+ * IVEC are given as well, the array is read into DVEC (TYPE 0, double)
+ * or IVEC (TYPE 1, int32), which must have the correct size (the other
+ * one is not used).
+ *
+ * Input:
+ * - FNAME: File name
+ * - NAME:  Array name
+ * - DVEC:  Array (TYPE 0). Optional [double array]
+ * - IVEC:  Array (TYPE 1). Optional [int32 array]
+ *
+ * Return:
+ * - SIZE:  Size of array
+ * - TYPE:  Type of array (0: double, 1: int32)
+ * - SWEEP: Sweep number of snapshot
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_checkpoint_load.h"
+#include "src/eptools/CheckpointServices.h"
+
+void eptwrap_checkpoint_load(int ain,int aout,char* fname,char* name,
+			     W_DARRAY(dvec),W_IARRAY(ivec),int* size,
+			     int* type,int* sweep,W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_checkpoint_load","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=2 && ain!=4)
+      W_RETERROR(2,"Need 2 or 4 input arguments");
+    if (aout!=3)
+      W_RETERROR(2,"Need 3 return arguments");
+    if ((*size=CheckpointServices::find(fname,name,*type,*sweep))<0) {
+      if (ain==4)
+	W_RETERROR_ARGS(1,"NAME: Array %s not in file",name);
+    } else if (ain==4) {
+      if (*type==CheckpointServices::typeDouble) {
+	W_CHKSIZE(dvec,*size,"DVEC");
+	CheckpointServices::read(fname,name,dvec,ndvec);
+      } else {
+	W_CHKSIZE(ivec,*size,"IVEC");
+	CheckpointServices::read(fname,name,ivec,nivec);
+      }
+    }
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
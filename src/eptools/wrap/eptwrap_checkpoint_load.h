@@ -0,0 +1,25 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHECKPOINT_LOAD
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_CHECKPOINT_LOAD_H
+#define EPTWRAP_CHECKPOINT_LOAD_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_checkpoint_load(int ain,int aout,char* fname,char* name,
+			       W_DARRAY(dvec),W_IARRAY(ivec),int* size,
+			       int* type,int* sweep,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
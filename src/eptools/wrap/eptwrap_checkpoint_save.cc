@@ -0,0 +1,68 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHECKPOINT_SAVE
+ *
+ * Writes checkpoints of EP state in the background, see
+ * 'CheckpointServices'. A snapshot is taken by a sequence of calls:
+ * MODE 0, then MODE 1 or 2 for each array, then MODE 3. The arrays are
+ * copied in MODE 1, 2, and written to file by a background thread
+ * started in MODE 3. Depending on MODE:
+ * - 0: Start snapshot for sweep number SWEEP. Waits for the previous
+ *      write to finish, and reports its error
+ * - 1: Copy DVEC into snapshot, under name STR
+ * - 2: Copy IVEC into snapshot, under name STR
+ * - 3: Start writing snapshot to file STR
+ * - 4: Wait for the write to finish, and report its error
+ *
+ * Input:
+ * - MODE:  See above
+ * - STR:   Array name (MODE 1, 2), file name (MODE 3)
+ * - DVEC:  Array (MODE 1) [double array]
+ * - IVEC:  Array (MODE 2) [int32 array]
+ * - SWEEP: Sweep number (MODE 0)
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_checkpoint_save.h"
+#include "src/eptools/CheckpointServices.h"
+
+void eptwrap_checkpoint_save(int ain,int aout,int mode,char* str,
+			     W_DARRAY(dvec),W_IARRAY(ivec),int sweep,
+			     W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_checkpoint_save","wrap",mode);
+
+  try {
+    /* Read arguments */
+    if (ain!=5)
+      W_RETERROR(2,"Need 5 input arguments");
+    if (aout!=0)
+      W_RETERROR(2,"No return arguments");
+    switch (mode) {
+    case 0:
+      CheckpointServices::begin(sweep);
+      break;
+    case 1:
+      CheckpointServices::add(str,dvec,ndvec);
+      break;
+    case 2:
+      CheckpointServices::add(str,ivec,nivec);
+      break;
+    case 3:
+      CheckpointServices::commit(str);
+      break;
+    case 4:
+      CheckpointServices::wait();
+      break;
+    default:
+      W_RETERROR(2,"MODE: Invalid value");
+    }
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
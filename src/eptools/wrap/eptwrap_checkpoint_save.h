@@ -0,0 +1,25 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHECKPOINT_SAVE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_CHECKPOINT_SAVE_H
+#define EPTWRAP_CHECKPOINT_SAVE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_checkpoint_save(int ain,int aout,int mode,char* str,
+			       W_DARRAY(dvec),W_IARRAY(ivec),int sweep,
+			       W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,6 +16,9 @@
  * Otherwise, p is computed locally, stored in WORKV.
  * NOTE: For the present implementation, the method is more efficient
  * when a lower triangular matrix is used.
+ * L can also be given in packed storage (PACKED(strcode)=='P', see
+ * matrix_types.h), which needs about half the memory. This is supported
+ * for lower triangular L only.
  *
  * Dragging along:
  * If Z (r-by-n) is given, so must be the r-vector y. In this case,
@@ -38,7 +41,8 @@
  *
  * Input:
  * - L:     Factor L (or L'), overwritten by L_ (or L_'). Must be
- *          lower (upper) triangular, str. code UPLO
+ *          lower (upper) triangular, str. code UPLO. Lower triangular
+ *          can be packed
  * - VEC:   Vector v. Can have size >n, only first n elem. are used
  * - CVEC:  Vector [n]. c_k ret. here
  * - SVEC:  Vector [n]. s_k ret. here
@@ -55,6 +59,7 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
 #include "src/eptools/wrap/eptwrap_choldnrk1.h"
 #include <stdlib.h>
 #include <math.h>
@@ -80,11 +85,12 @@ void eptwrap_choldnrk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
 {
   blasint_t i,n,r=0,stp,sz,ione=1,nxi,npos=0;
   double qs,cval,sval,c1,c2;
-  bool islower;
+  bool islower,ispacked;
   double* tbuff,*zcol;
   const char* diag="N";
   char trans[2];
   int* flind=0;
+  TraceScope trace("eptwrap_choldnrk1","wrap");
 
   /* Read arguments */
   if (ain<5 || ain>8)
@@ -94,6 +100,8 @@ void eptwrap_choldnrk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
   if ((n=lmat->n)!=lmat->m || lmat->n==0 ||
       (!(islower=(UPLO(lmat->strcode)=='L')) && UPLO(lmat->strcode)!='U'))
     W_RETERROR(1,"L: Wrong size or structure code");
+  if ((ispacked=(PACKED(lmat->strcode)=='P')) && !islower)
+    W_RETERROR(1,"L: Packed storage only for lower triangular");
   if (nvvec!=n)
     W_RETERROR(1,"VEC: Wrong size");
   if (ncvec!=n || nsvec!=n)
@@ -116,10 +124,13 @@ void eptwrap_choldnrk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
   *stat=0; /* OK so far */
 
   /* Compute p (if not given)
-   * NOTE: This requires dtrsv, which may not be given
+   * NOTE: This requires dtrsv, which may not be given. For lower
+   * triangular L (and always for packed L), we can do without.
    */
   f_dcopy(&n,vvec,&ione,wkvec,&ione);
-  if (!isp) {
+  if (!isp && (ispacked || (islower && f_dtrsv==0)))
+    trsvLower(lmat,false,wkvec,f_ddot,f_daxpy);
+  else if (!isp) {
     if (f_dtrsv==0)
       W_RETERROR(2,"Internal error: Need BLAS dtrsv");
     trans[1]=0;
@@ -147,7 +158,9 @@ void eptwrap_choldnrk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
        store their pos. there */
     fillVec(wkvec,n,0.0);
     stp = islower?1:lmat->stride;
-    for (i=n-1,sz=0,tbuff=lmat->buff+((n-1)*(lmat->stride+1)); i>=0; i--) {
+    tbuff=lmat->buff+(ispacked?PACKEDL_DIAG(n,n-1):
+		      (n-1)*(lmat->stride+1));
+    for (i=n-1,sz=0; i>=0; i--) {
       /* BAD: Slower for upper triangular! */
       sz++;
       if (*tbuff<=0.0) {
@@ -168,7 +181,8 @@ void eptwrap_choldnrk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
       } else if (*tbuff==0.0) {
 	*stat=1; break;
       }
-      tbuff-=(lmat->stride+1);
+      if (i>0)
+	tbuff-=(ispacked?(n-i+1):(lmat->stride+1));
     }
     /* NOTE: Should have v in 'wkvec' now */
 
@@ -0,0 +1,156 @@
+/* -------------------------------------------------------------------
+ * EPTOOLS_CHOLDNRK1_SINGLE
+ *
+ * Same as EPTOOLS_CHOLDNRK1, but the factor L is stored in single
+ * precision (which halves memory and bandwidth for the O(n^2) factor).
+ * L must be lower triangular, full storage. All other arguments are
+ * double precision, and rotations are computed in double precision, so
+ * that only the storage of L is rounded.
+ * If ISP==false, p = L\v is computed by forward substitution in
+ * double precision.
+ * Does not require BLAS functions.
+ *
+ * Input:
+ * - L:     Factor L [single], overwritten by L_. Lower triangular
+ * - VEC:   Vector v. Can have size >n, only first n elem. are used
+ * - CVEC:  Vector [n]. c_k ret. here
+ * - SVEC:  Vector [n]. s_k ret. here
+ * - WORKV: Working vector of size max(n,r). Can be same as VEC
+ * - ISP:   S.a. Def.: false
+ * - Z:     Dragging along matrix [r-by-n]. Optional
+ * - Y:     Dragging along vector [r]. Iff Z is given
+ *
+ * Return:
+ * - STAT:  0 (OK), 1 (Numerical error)
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
+#include "src/eptools/wrap/eptwrap_choldnrk1_single.h"
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * See EPTOOLS_CHOLDNRK1 for the algorithm. drot, dscal, daxpy are done by
+ * explicit loops, since L is single precision.
+ */
+
+void eptwrap_choldnrk1_single(int ain,int aout,fst_smatrix* lmat,
+			      W_DARRAY(vvec),W_DARRAY(cvec),W_DARRAY(svec),
+			      W_DARRAY(wkvec),int isp,fst_matrix* zmat,
+			      W_DARRAY(yvec),int* stat,W_ERRORARGS)
+{
+  int i,k,n,r=0,sz,nxi,npos=0;
+  double qs,cval,sval,c1,c2,xval,yval;
+  float* tbuff;
+  double* zcol;
+  int* flind=0;
+  TraceScope trace("eptwrap_choldnrk1_single","wrap");
+
+  /* Read arguments */
+  if (ain<5 || ain>8)
+    W_RETERROR(2,"Wrong number of input arguments");
+  if (aout!=1)
+    W_RETERROR(2,"Need one return argument");
+  if ((n=lmat->n)!=lmat->m || lmat->n==0 || UPLO(lmat->strcode)!='L' ||
+      PACKED(lmat->strcode)=='P')
+    W_RETERROR(1,"L: Wrong size or structure code");
+  if (nvvec!=n)
+    W_RETERROR(1,"VEC: Wrong size");
+  if (ncvec!=n || nsvec!=n)
+    W_RETERROR(1,"CVEC, SVEC: Wrong size");
+  if (ain<7) {
+    zmat=0; yvec=0; nyvec=0;
+    if (ain<6)
+      isp=0;
+  }
+  if (ain>6) {
+    if (ain<8)
+      W_RETERROR(1,"Need both Z, Y or none");
+    r=zmat->m;
+    if (zmat->n!=n || r==0)
+      W_RETERROR(1,"Z: Wrong size");
+    W_CHKSIZE(yvec,r,"Y");
+  }
+  if (nwkvec<n || nwkvec<r)
+    W_RETERROR(1,"WORKV: Wrong size");
+  *stat=0; /* OK so far */
+
+  /* Compute p (if not given) */
+  for (i=0; i<n; i++)
+    wkvec[i]=vvec[i];
+  if (!isp)
+    trsvLowerSingle(lmat,false,wkvec);
+  /* Generate Givens rotations */
+  for (i=0,qs=1.0; i<n; i++)
+    qs-=wkvec[i]*wkvec[i];
+  if (qs<=0.0)
+    *stat=1;
+  else {
+    qs = sqrt(qs);
+    for (i=n-1; i>=0; i--) {
+      givensRotg(&qs,wkvec+i,cvec+i,svec+i);
+      /* 'qs' must remain positive */
+      if (qs<0.0) {
+	qs=-qs; cvec[i]=-cvec[i]; svec[i]=-svec[i];
+      }
+    }
+
+    /* Update L. If there are any flips of L_ cols, we alloc. 'flind' are
+       store their pos. there */
+    fillVec(wkvec,n,0.0);
+    for (i=n-1,sz=0; i>=0; i--) {
+      sz++;
+      tbuff=lmat->buff+(i*(lmat->stride+1));
+      if (*tbuff<=0.0) {
+	*stat=1; break;
+      }
+      cval=cvec[i]; sval=svec[i];
+      for (k=0; k<sz; k++) {
+	xval=wkvec[i+k]; yval=tbuff[k];
+	wkvec[i+k]=cval*xval+sval*yval;
+	tbuff[k]=(float) (cval*yval-sval*xval);
+      }
+      /* Do not want negative elements on diagonal */
+      if (*tbuff<0.0) {
+	if (flind==0) {
+	  flind = (int*) malloc(n*sizeof(int));
+	  npos = n;
+	}
+	flind[--npos]=i;
+	for (k=0; k<sz; k++)
+	  tbuff[k]=-tbuff[k];
+      } else if (*tbuff==0.0) {
+	*stat=1; break;
+      }
+    }
+
+    /* Dragging along */
+    if (r>0 && *stat==0) {
+      for (k=0; k<r; k++)
+	wkvec[k]=yvec[k];
+      nxi=(flind!=0)?flind[npos]:-1;
+      for (i=0; i<n; i++) {
+	zcol=zmat->buff+(i*zmat->stride);
+	cval=cvec[i]; sval=svec[i];
+	if (nxi==i) {
+	  if (++npos<n) nxi=flind[npos];
+	  c1=-1.0/cval; c2=sval;
+	} else {
+	  c1=1.0/cval; c2=-sval;
+	}
+	for (k=0; k<r; k++) {
+	  zcol[k]=c1*(zcol[k]-sval*wkvec[k]);
+	  if (i<n-1)
+	    wkvec[k]=cval*wkvec[k]+c2*zcol[k];
+	}
+      }
+    }
+  }
+
+  if (flind!=0)
+    free((void*) flind);
+  W_RETOK;
+}
@@ -0,0 +1,27 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHOLDNRK1_SINGLE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_CHOLDNRK1_SINGLE_H
+#define EPTWRAP_CHOLDNRK1_SINGLE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+#include "src/eptools/wrap/matrix_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_choldnrk1_single(int ain,int aout,fst_smatrix* lmat,
+				W_DARRAY(vvec),W_DARRAY(cvec),W_DARRAY(svec),
+				W_DARRAY(wkvec),int isp,fst_matrix* zmat,
+				W_DARRAY(yvec),int* stat,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
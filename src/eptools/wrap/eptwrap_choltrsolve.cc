@@ -0,0 +1,76 @@
+/* -------------------------------------------------------------------
+ * EPTOOLS_CHOLTRSOLVE
+ *
+ * Triangular solves with a Cholesky factor L, A = L*L', A, L n-by-n,
+ * where L is lower triangular, given in full or packed storage (see
+ * matrix_types.h). These complement EPTOOLS_CHOLUPRK1, EPTOOLS_CHOLDNRK1
+ * for packed factors, for which LAPACK routines are not always
+ * available.
+ * The columns of B (n-by-r) are overwritten by:
+ * - MODE==0: L\B
+ * - MODE==1: L'\B
+ * - MODE==2: A\B = L'\(L\B)
+ *
+ * Marginal queries:
+ * If SQNRM is given (MODE 0 or 2), SQNRM(j) is the squared norm of
+ * column j of L\B. For B = [b_j], this is b_j'*inv(A)*b_j, the marginal
+ * variance for b_j if A is a posterior precision matrix. Columns of B can
+ * be processed in blocks, so inv(A) is never formed.
+ *
+ * Input:
+ * - L:     Factor L, lower triangular, full or packed
+ * - B:     Matrix B [n-by-r], overwritten by result
+ * - MODE:  S.a. Def.: 0
+ *
+ * Return:
+ * - SQNRM: Squared column norms [r]. Optional
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
+#include "src/eptools/wrap/eptwrap_choltrsolve.h"
+
+void eptwrap_choltrsolve(int ain,int aout,fst_matrix* lmat,fst_matrix* bmat,
+			 int mode,W_DARRAY(sqnrm),ddot_type f_ddot,
+			 daxpy_type f_daxpy,W_ERRORARGS)
+{
+  blasint_t j,n,r,ione=1;
+  double* bcol;
+  TraceScope trace("eptwrap_choltrsolve","wrap");
+
+  /* Read arguments */
+  if (ain<2 || ain>3)
+    W_RETERROR(2,"Wrong number of input arguments");
+  if (aout>1)
+    W_RETERROR(2,"Too many return arguments");
+  if ((n=lmat->n)!=lmat->m || lmat->n==0 || UPLO(lmat->strcode)!='L')
+    W_RETERROR(1,"L: Wrong size or structure code");
+  if (bmat->m!=n || (r=bmat->n)==0)
+    W_RETERROR(1,"B: Wrong size");
+  if (ain<3)
+    mode=0;
+  if (mode<0 || mode>2)
+    W_RETERROR(1,"MODE: Wrong value");
+  if (aout>0) {
+    if (mode==1)
+      W_RETERROR(1,"SQNRM: Not for MODE==1");
+    W_CHKSIZE(sqnrm,r,"SQNRM");
+  } else {
+    sqnrm=0; nsqnrm=0;
+  }
+
+  for (j=0; j<r; j++) {
+    bcol=bmat->buff+(j*bmat->stride);
+    if (mode!=1) {
+      trsvLower(lmat,false,bcol,f_ddot,f_daxpy);
+      if (aout>0)
+	sqnrm[j]=f_ddot(&n,bcol,&ione,bcol,&ione);
+    }
+    if (mode!=0)
+      trsvLower(lmat,true,bcol,f_ddot,f_daxpy);
+  }
+
+  W_RETOK;
+}
@@ -0,0 +1,26 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHOLTRSOLVE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_CHOLTRSOLVE_H
+#define EPTWRAP_CHOLTRSOLVE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+#include "src/eptools/wrap/matrix_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_choltrsolve(int ain,int aout,fst_matrix* lmat,fst_matrix* bmat,
+			   int mode,W_DARRAY(sqnrm),ddot_type f_ddot,
+			   daxpy_type f_daxpy,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
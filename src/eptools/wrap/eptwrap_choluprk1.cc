@@ -14,6 +14,9 @@
  * passed in L, v in VEC.
  * NOTE: For the present implementation, the method is more efficient
  * when a lower triangular matrix is used.
+ * L can also be given in packed storage (PACKED(strcode)=='P', see
+ * matrix_types.h), which needs about half the memory. This is supported
+ * for lower triangular L only.
  *
  * Dragging along:
  * If Z (r-by-n) is given, so must be the r-vector y. In this case,
@@ -31,7 +34,8 @@
  *
  * Input:
  * - L:     Factor L (or L'), overwritten by L_ (or L_'). Must be
- *          lower (upper) triangular, str. code UPLO
+ *          lower (upper) triangular, str. code UPLO. Lower triangular
+ *          can be packed
  * - VEC:   Vector v. Can have size >n, only first n elem. are used
  * - CVEC:  Vector [n]. c_k ret. here
  * - SVEC:  Vector [n]. s_k ret. here
@@ -47,6 +51,7 @@
  * ------------------------------------------------------------------- */
 
 #include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
 #include "src/eptools/wrap/eptwrap_choluprk1.h"
 
 /*
@@ -69,8 +74,9 @@ void eptwrap_choluprk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
 {
   blasint_t i,n,r=0,stp,sz,ione=1;
   double temp;
-  bool islower;
+  bool islower,ispacked;
   double* tbuff;
+  TraceScope trace("eptwrap_choluprk1","wrap");
 
   /* Read arguments */
   if (ain<5 || ain>7)
@@ -80,6 +86,8 @@ void eptwrap_choluprk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
   if ((n=lmat->n)!=lmat->m || lmat->n==0 ||
       (!(islower=(UPLO(lmat->strcode)=='L')) && UPLO(lmat->strcode)!='U'))
     W_RETERROR(1,"L: Wrong size or structure code");
+  if ((ispacked=(PACKED(lmat->strcode)=='P')) && !islower)
+    W_RETERROR(1,"L: Packed storage only for lower triangular");
   if (nvvec!=n)
     W_RETERROR(1,"VEC: Wrong size");
   if (ncvec!=n || nsvec!=n)
@@ -119,7 +127,7 @@ void eptwrap_choluprk1(int ain,int aout,fst_matrix* lmat,W_DARRAY(vvec),
        BAD: Slower for upper triangular! */
     sz--;
     f_drot(&sz,tbuff+stp,&stp,wkvec+(i+1),&ione,cvec+i,svec+i);
-    tbuff+=(lmat->stride+1);
+    tbuff+=(ispacked?(n-i):(lmat->stride+1));
   }
   if (*stat==0 && (*tbuff!=0.0 || wkvec[n-1]!=0.0)) {
     f_drotg(tbuff,wkvec+(n-1),cvec+i,svec+i);
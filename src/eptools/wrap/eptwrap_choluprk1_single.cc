@@ -0,0 +1,112 @@
+/* -------------------------------------------------------------------
+ * EPTOOLS_CHOLUPRK1_SINGLE
+ *
+ * Same as EPTOOLS_CHOLUPRK1, but the factor L is stored in single
+ * precision (which halves memory and bandwidth for the O(n^2) factor).
+ * L must be lower triangular, full storage. All other arguments are
+ * double precision, and rotations are computed in double precision, so
+ * that only the storage of L is rounded.
+ * Does not require BLAS functions.
+ *
+ * Input:
+ * - L:     Factor L [single], overwritten by L_. Lower triangular
+ * - VEC:   Vector v. Can have size >n, only first n elem. are used
+ * - CVEC:  Vector [n]. c_k ret. here
+ * - SVEC:  Vector [n]. s_k ret. here
+ * - WORKV: Working vector of size max(n,r). Can be same as VEC
+ * - Z:     Dragging along matrix [r-by-n]. Optional
+ * - Y:     Dragging along vector [r]. Iff Z is given
+ *
+ * Return:
+ * - STAT:  0 (OK), 1 (Numerical error)
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/eptools/wrap/eptools_helper_basic.h"
+#include "src/eptools/TraceServices.h"
+#include "src/eptools/wrap/eptwrap_choluprk1_single.h"
+
+/*
+ * See EPTOOLS_CHOLUPRK1 for the algorithm. drot is done by explicit
+ * loops, since one of the vectors is single precision.
+ */
+
+void eptwrap_choluprk1_single(int ain,int aout,fst_smatrix* lmat,
+			      W_DARRAY(vvec),W_DARRAY(cvec),W_DARRAY(svec),
+			      W_DARRAY(wkvec),fst_matrix* zmat,W_DARRAY(yvec),
+			      int* stat,W_ERRORARGS)
+{
+  int i,k,n,r=0;
+  double temp,cval,sval,xval,yval;
+  float* tbuff;
+  double* zcol;
+  TraceScope trace("eptwrap_choluprk1_single","wrap");
+
+  /* Read arguments */
+  if (ain<5 || ain>7)
+    W_RETERROR(2,"Wrong number of input arguments");
+  if (aout!=1)
+    W_RETERROR(2,"Need one return argument");
+  if ((n=lmat->n)!=lmat->m || lmat->n==0 || UPLO(lmat->strcode)!='L' ||
+      PACKED(lmat->strcode)=='P')
+    W_RETERROR(1,"L: Wrong size or structure code");
+  if (nvvec!=n)
+    W_RETERROR(1,"VEC: Wrong size");
+  if (ncvec!=n || nsvec!=n)
+    W_RETERROR(1,"CVEC, SVEC: Wrong size");
+  if (ain>5) {
+    if (ain<7)
+      W_RETERROR(1,"Need both Z, Y or none");
+    r=zmat->m;
+    if (zmat->n!=n || r==0)
+      W_RETERROR(1,"Z: Wrong size");
+    W_CHKSIZE(yvec,r,"Y");
+  } else {
+    zmat=0; yvec=0; nyvec=0;
+  }
+  if (nwkvec<n || nwkvec<r)
+    W_RETERROR(1,"WORKV: Wrong size");
+  *stat=0; /* OK so far */
+
+  /* Generate Givens rotations, update L */
+  for (i=0; i<n; i++)
+    wkvec[i]=vvec[i];
+  for (i=0; i<n; i++) {
+    tbuff=lmat->buff+(i*(lmat->stride+1));
+    if ((temp=*tbuff)==0.0 && wkvec[i]==0.0) {
+      *stat=1; break;
+    }
+    givensRotg(&temp,wkvec+i,cvec+i,svec+i);
+    /* Do not want negative elements on factor diagonal */
+    if (temp<0.0) {
+      temp=-temp; cvec[i]=-cvec[i]; svec[i]=-svec[i];
+    } else if (temp==0.0) {
+      *stat=1; break;
+    }
+    *tbuff=(float) temp;
+    cval=cvec[i]; sval=svec[i];
+    for (k=i+1; k<n; k++) {
+      xval=tbuff[k-i]; yval=wkvec[k];
+      tbuff[k-i]=(float) (cval*xval+sval*yval);
+      wkvec[k]=cval*yval-sval*xval;
+    }
+  }
+
+  /* Dragging along */
+  if (r>0 && *stat==0) {
+    for (k=0; k<r; k++)
+      wkvec[k]=yvec[k];
+    for (i=0; i<n; i++) {
+      zcol=zmat->buff+(i*zmat->stride);
+      cval=cvec[i]; sval=svec[i];
+      for (k=0; k<r; k++) {
+	xval=zcol[k]; yval=wkvec[k];
+	zcol[k]=cval*xval+sval*yval;
+	wkvec[k]=cval*yval-sval*xval;
+      }
+    }
+  }
+
+  W_RETOK;
+}
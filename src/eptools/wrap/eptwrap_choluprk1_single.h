@@ -0,0 +1,27 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_CHOLUPRK1_SINGLE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_CHOLUPRK1_SINGLE_H
+#define EPTWRAP_CHOLUPRK1_SINGLE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+#include "src/eptools/wrap/matrix_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_choluprk1_single(int ain,int aout,fst_smatrix* lmat,
+				W_DARRAY(vvec),W_DARRAY(cvec),W_DARRAY(svec),
+				W_DARRAY(wkvec),fst_matrix* zmat,
+				W_DARRAY(yvec),int* stat,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
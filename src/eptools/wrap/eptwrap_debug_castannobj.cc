@@ -18,6 +18,8 @@
 
 void eptwrap_debug_castannobj(void* annobj,W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_debug_castannobj","wrap");
+
   try {
     if (annobj==0)
       W_RETERROR(1,"ANNOBJ is NULL");
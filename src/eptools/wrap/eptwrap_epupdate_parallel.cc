@@ -12,6 +12,21 @@
  * this case, CMU, CRHO, RSTAT, ALPHA, NU, LOGZ are of the same
  * length as UPDIND.
  * All potentials must be in the argument group 'atypeUnivariate'.
+ * If DPARVEC is requested, the gradient of sum_j log Z_j (over updated
+ * potentials, successful ones only) w.r.t. PARVEC is returned there,
+ * for fixed cavity moments. At an EP fixed point, this is the gradient
+ * of the EP log marginal likelihood w.r.t. PARVEC. Potentials with
+ * parameters must support these derivatives (see
+ * 'EPScalarPotential::compMomentsDerivs').
+ * Updates are run in parallel by the eptools thread pool (see
+ * EPTWRAP_THREADPOOL_CONFIG), in chunks of consecutive entries. Each
+ * thread uses its own potential manager, created from the same
+ * arguments. If some potential is not thread-safe (see
+ * 'EPScalarPotential::isThreadSafe'; f.ex., its quadrature services are
+ * not, or it uses an accuracy schedule), all updates are done by a
+ * single thread.
+ * DPARVEC is accumulated over chunks in order, so results do not depend
+ * on the number of threads.
  *
  * Input:
  * - POTIDS:  Potential manager representation [int32 array]
@@ -29,6 +44,7 @@
  * - ALPHA:   Vector of alpha values
  * - NU:      Vector of nu values
  * - LOGZ:    Vector of log Z values (optional)
+ * - DPARVEC: Gradient w.r.t. PARVEC, see above (optional)
  * -------------------------------------------------------------------
  * Matlab MEX Function
  * Author: Matthias Seeger
@@ -38,24 +54,106 @@
 #include "src/eptools/wrap/eptools_helper.h"
 #include "src/eptools/wrap/eptwrap_epupdate_parallel.h"
 #include "src/eptools/potentials/PotentialManager.h"
+#include "src/eptools/ThreadPool.h"
+#include <pthread.h>
+#include <vector>
+
+/*
+ * Reduction body for parallel updates. A chunk uses one of the potential
+ * managers 'pots' (free ones on stack 'freePots') and, if 'dparvec' is
+ * given, writes its gradient contribution to its own part of 'dpart',
+ * which is added to 'dparvec' by 'join'.
+ */
+class EPUpdateParallelBody : public ReduceBody
+{
+public:
+  // Maximum number of chunks if DPARVEC is computed
+  static const int maxDerivChunks=64;
+
+  ArrayHandle<Handle<PotentialManager> > pots;
+  std::vector<int> freePots;
+  pthread_mutex_t mutex;
+  const int* jind;
+  const double* cmu,*crho;
+  double* alpha,*nu,*logz,*dparvec;
+  bool* succ;
+  int npar;
+  ArrayHandle<double> dpart;
+
+  EPUpdateParallelBody(const ArrayHandle<Handle<PotentialManager> >& ppots) :
+    pots(ppots) {
+    pthread_mutex_init(&mutex,0);
+    for (int t=pots.size()-1; t>=0; t--)
+      freePots.push_back(t);
+  }
+
+  ~EPUpdateParallelBody() {
+    pthread_mutex_destroy(&mutex);
+  }
+
+  virtual void prepare(int nchunk) {
+    if (dparvec!=0) {
+      dpart.changeRep(nchunk*npar);
+      std::fill(dpart.p(),dpart.p()+dpart.size(),0.0);
+    }
+  }
+
+  virtual void run(int chunk,int beg,int end) {
+    int t;
+
+    pthread_mutex_lock(&mutex);
+    if (freePots.empty()) {
+      pthread_mutex_unlock(&mutex);
+      throw InternalException(EXCEPT_MSG("No free potential manager"));
+    }
+    t=freePots.back(); freePots.pop_back();
+    pthread_mutex_unlock(&mutex);
+    try {
+      if (dparvec==0)
+	pots[t]->compMomentsBatch(end-beg,jind+beg,cmu+beg,crho+beg,
+				  alpha+beg,nu+beg,succ+beg,
+				  (logz!=0)?(logz+beg):0);
+      else
+	pots[t]->compMomentsDerivsBatch(end-beg,jind+beg,cmu+beg,crho+beg,
+					alpha+beg,nu+beg,succ+beg,
+					(logz!=0)?(logz+beg):0,
+					dpart.p()+chunk*npar);
+    } catch (...) {
+      pthread_mutex_lock(&mutex);
+      freePots.push_back(t);
+      pthread_mutex_unlock(&mutex);
+      throw;
+    }
+    pthread_mutex_lock(&mutex);
+    freePots.push_back(t);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  virtual void join(int chunk) {
+    if (dparvec!=0) {
+      const double* dP=dpart.p()+chunk*npar;
+      for (int i=0; i<npar; i++)
+	dparvec[i]+=dP[i];
+    }
+  }
+};
 
 void eptwrap_epupdate_parallel(int ain,int aout,W_IARRAY(potids),
 			       W_IARRAY(numpot),W_DARRAY(parvec),
 			       W_IARRAY(parshrd),W_ARRAY(annobj,void*),
 			       W_DARRAY(cmu),W_DARRAY(crho),W_IARRAY(updind),
 			       W_IARRAY(rstat),W_DARRAY(alpha),W_DARRAY(nu),
-			       W_DARRAY(logz),W_ERRORARGS)
+			       W_DARRAY(logz),W_DARRAY(dparvec),W_ERRORARGS)
 {
-  int i,j,totsz;
-  double temp;
+  int i,c,totsz,grain,nthr,nchunk;
   Handle<PotentialManager> potMan;
-  double inp[2],ret[2];
+  TraceScope trace("eptwrap_epupdate_parallel","wrap");
 
   try {
     /* Read arguments */
     if (ain<7 || ain>8)
       W_RETERROR(2,"Wrong number of input arguments");
-    if (aout<3 || aout>4)
+    if (aout<3 || aout>5)
       W_RETERROR(2,"Wrong number of return arguments");
     /* Create potential manager */
     createPotentialManager(W_ARR(potids),W_ARR(numpot),W_ARR(parvec),
@@ -86,17 +184,53 @@ void eptwrap_epupdate_parallel(int ain,int aout,W_IARRAY(potids),
       W_CHKSIZE(logz,totsz,"LOGZ");
     else
       logz=0;
+    if (aout>4) {
+      W_CHKSIZE(dparvec,nparvec,"DPARVEC");
+      for (i=0; i<ndparvec; i++)
+	dparvec[i]=0.0;
+    } else
+      dparvec=0;
 
-    /* Main loop over all potentials */
-    for (i=0; i<totsz; i++) {
-      j=(updind==0)?i:updind[i];
-      //cout << "i=" << i << endl;
-      inp[0]=cmu[i]; inp[1]=crho[i];
-      rstat[i] = potMan->getPot(j).compMoments(inp,ret,&temp);
-      alpha[i]=ret[0]; nu[i]=ret[1];
-      if (rstat[i] && aout>3)
-	logz[i]=temp;
+    /* Batched updates over chunks of potentials, in parallel. Potential
+       managers pass runs of potentials of the same type to
+       'EPScalarPotential::compMomentsBatch', which may share work between
+       them (e.g., fixed-node quadrature) */
+    ArrayHandle<bool> succ(totsz);
+    ArrayHandle<int> jindA;
+    nthr=potMan->isThreadSafe()?ThreadPool::numThreads():1;
+    ArrayHandle<Handle<PotentialManager> > thrPots(nthr);
+    thrPots[0]=potMan;
+    for (i=1; i<thrPots.size(); i++)
+      createPotentialManager(W_ARR(potids),W_ARR(numpot),W_ARR(parvec),
+			     W_ARR(parshrd),W_ARR(annobj),thrPots[i],
+			     W_ERRARGS);
+    if (updind==0) {
+      jindA.changeRep(totsz);
+      for (i=0; i<totsz; i++)
+	jindA[i]=i;
+    }
+    EPUpdateParallelBody body(thrPots);
+    body.jind=(updind==0)?jindA.p():updind;
+    body.cmu=cmu; body.crho=crho; body.alpha=alpha; body.nu=nu;
+    body.logz=logz; body.dparvec=dparvec; body.succ=succ.p();
+    body.npar=nparvec;
+    grain=ThreadPool::grainSize(totsz);
+    if (dparvec!=0)
+      grain=std::max(grain,(totsz+EPUpdateParallelBody::maxDerivChunks-1)/
+		     EPUpdateParallelBody::maxDerivChunks);
+    if (nthr>1)
+      ThreadPool::parallelReduce(totsz,body,grain);
+    else {
+      // Same chunks, run by the calling thread
+      nchunk=(totsz+grain-1)/grain;
+      body.prepare(nchunk);
+      for (c=0; c<nchunk; c++)
+	body.run(c,c*grain,std::min((c+1)*grain,totsz));
+      for (c=0; c<nchunk; c++)
+	body.join(c);
     }
+    for (i=0; i<totsz; i++)
+      rstat[i]=succ[i]?1:0;
     W_RETOK;
   } catch (StandardException ex) {
     W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
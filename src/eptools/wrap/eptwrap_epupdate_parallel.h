@@ -19,7 +19,7 @@ extern "C" {
 				 W_IARRAY(parshrd),W_ARRAY(annobj,void*),
 				 W_DARRAY(cmu),W_DARRAY(crho),W_IARRAY(updind),
 				 W_IARRAY(rstat),W_DARRAY(alpha),W_DARRAY(nu),
-				 W_DARRAY(logz),W_ERRORARGS);
+				 W_DARRAY(logz),W_DARRAY(dparvec),W_ERRORARGS);
 
 #ifdef __cplusplus
 }
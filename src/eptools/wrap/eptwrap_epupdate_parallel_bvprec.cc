@@ -69,6 +69,7 @@ void eptwrap_epupdate_parallel_bvprec(int ain,int aout,W_IARRAY(potids),
   double temp;
   Handle<PotentialManager> potMan;
   double inp[4],ret[4];
+  TraceScope trace("eptwrap_epupdate_parallel_bvprec","wrap");
 
   try {
     /* Read arguments */
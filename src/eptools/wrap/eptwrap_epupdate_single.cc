@@ -46,6 +46,7 @@ void eptwrap_epupdate_single1(int ain,int aout,int pid,W_DARRAY(pars),
 {
   Handle<EPScalarPotential> epPot;
   double inp[2],ret[2];
+  TraceScope trace("eptwrap_epupdate_single1","wrap");
 
   try {
     /* Read arguments */
@@ -97,6 +98,7 @@ void eptwrap_epupdate_single3(int ain,int aout,W_IARRAY(potids),
 {
   Handle<PotentialManager> potMan;
   double inp[2],ret[2];
+  TraceScope trace("eptwrap_epupdate_single3","wrap");
 
   try {
     /* Read arguments */
@@ -49,6 +49,7 @@ void eptwrap_epupdate_single_bvprec1(int ain,int aout,int pid,W_DARRAY(pars),
 {
   Handle<EPScalarPotential> epPot;
   double inp[4],ret[4];
+  TraceScope trace("eptwrap_epupdate_single_bvprec1","wrap");
 
   try {
     /* Read arguments */
@@ -104,6 +105,7 @@ void eptwrap_epupdate_single_bvprec3(int ain,int aout,W_IARRAY(potids),
 {
   Handle<PotentialManager> potMan;
   double inp[4],ret[4];
+  TraceScope trace("eptwrap_epupdate_single_bvprec3","wrap");
 
   try {
     /* Read arguments */
@@ -8,7 +8,8 @@
  *
  * EP with factorized Gaussian backbone.
  * Compute marginals on variables from EP (message) parameters, overwrite
- * MARGPI, MARGBETA.
+ * MARGPI, MARGBETA. Variables are processed in parallel by the eptools
+ * thread pool (see EPTWRAP_THREADPOOL_CONFIG).
  *
  * Input:
  * - N:           Number of variables
@@ -37,6 +38,7 @@ void eptwrap_fact_compmarginals(int ain,int aout,int n,int m,
 				W_DARRAY(margbeta),W_ERRORARGS)
 {
   Handle<FactorizedEPRepresentation> epRepr;
+  TraceScope trace("eptwrap_fact_compmarginals","wrap");
 
   try {
     /* Read arguments */
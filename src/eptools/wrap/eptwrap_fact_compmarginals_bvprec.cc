@@ -40,6 +40,7 @@ void eptwrap_fact_compmarginals_bvprec(int ain,int aout,int n,int m,
 				       W_ERRORARGS)
 {
   Handle<FactorizedEPRepresentation> epRepr;
+  TraceScope trace("eptwrap_fact_compmarginals_bvprec","wrap");
 
   try {
     /* Read arguments */
@@ -59,6 +59,7 @@ void eptwrap_fact_compmaxac(int ain,int aout,int n,int m,W_IARRAY(rp_rowind),
   ArrayHandle<double> sda_topvalA,sdc_topvalA;
   Handle<FactEPMaximumAValues> epMaxA;
   Handle<FactEPMaximumCValues> epMaxC;
+  TraceScope trace("eptwrap_fact_compmaxac","wrap");
 
   try {
     /* Read arguments */
@@ -94,6 +95,7 @@ void eptwrap_fact_compmaxac(int ain,int aout,int n,int m,W_IARRAY(rp_rowind),
     for (i=0; i<numk; i++)
       sda_numvalid[i]=sdc_numvalid[i]=1;
     try {
+      MemTagScope mtag(EPMemoryTags::tagSelDamp);
       epMaxA.changeRep(new FactEPMaximumAValues(epRepr,sda_k,sda_numvalidA,
 						sda_topindA,sda_topvalA));
       epMaxA->recompute(); // Recompute from scratch
@@ -101,6 +103,7 @@ void eptwrap_fact_compmaxac(int ain,int aout,int n,int m,W_IARRAY(rp_rowind),
       W_RETERROR_ARGS(1,"Cannot create FactEPMaximumAValues (selective damping):\n%s",ex.msg());
     }
     try {
+      MemTagScope mtag(EPMemoryTags::tagSelDamp);
       epMaxC.changeRep(new FactEPMaximumCValues(epRepr,sdc_k,sdc_numvalidA,
 						sdc_topindA,sdc_topvalA));
       epMaxC->recompute(); // Recompute from scratch
@@ -6,6 +6,8 @@
  * scratch ('FactEPMaximumPiValues::recompute').
  * This data structure is used for selective damping, see
  * EPTOOLS_FACT_SEQUPDATES.
+ * Top-K lists are computed in parallel by the eptools thread pool (see
+ * EPTWRAP_THREADPOOL_CONFIG).
  *
  * If SD_SUBIND is given, it is a subset of 0:(M-1), sorted in
  * ascending order. See 'FactEPMaximumPiValues', fields 'subInd' and
@@ -50,6 +52,7 @@ void eptwrap_fact_compmaxpi(int ain,int aout,int n,int m,W_IARRAY(rp_rowind),
   ArrayHandle<int> sd_numvalidA,sd_topindA,sd_subindA;
   ArrayHandle<double> sd_topvalA;
   Handle<FactEPMaximumPiValues> epMaxPi;
+  TraceScope trace("eptwrap_fact_compmaxpi","wrap");
 
   try {
     /* Read arguments */
@@ -83,6 +86,7 @@ void eptwrap_fact_compmaxpi(int ain,int aout,int n,int m,W_IARRAY(rp_rowind),
     for (i=0; i<n; i++)
       sd_numvalid[i]=1; // Just to make constructor happy
     try {
+      MemTagScope mtag(EPMemoryTags::tagSelDamp);
       epMaxPi.changeRep(new FactEPMaximumPiValues(epRepr,sd_k,sd_numvalidA,
 						  sd_topindA,sd_topvalA,
 						  sd_subindA,sd_subexcl!=0));
@@ -0,0 +1,108 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_FACT_LOGMARGLIK
+ *
+ * EP with factorized Gaussian backbone. Computes the EP approximation
+ * LOGZ to the log marginal likelihood, and (optionally) its gradient
+ * DPARVEC w.r.t. the potential parameters PM_PARVEC, in a single pass
+ * over all potentials. This should be called after EP has converged.
+ * Cavity marginals are computed from the representation and the
+ * marginals MARGPI, MARGBETA, which are not modified.
+ * Details in 'FactorizedEPDriver::compLogMarginal' comments. Potentials
+ * for which the cavity is invalid (pi < PIMINTHRES/2) or the local
+ * computation fails are skipped, their number is returned in NSKIP.
+ * All potentials must be in group 'atypeUnivariate'. If DPARVEC is
+ * requested, potentials with parameters must support log Z derivatives
+ * (see 'EPScalarPotential::compMomentsDerivs').
+ *
+ * Input:
+ * - N:           Number of variables
+ * - M:           Number of factors
+ * - PM_POTIDS:   Potential manager [int32 array]
+ * - PM_NUMPOT:   " [int32 array]
+ * - PM_PARVEC:   " [double array]
+ * - PM_PARSHRD:  " [int32 array]
+ * - PM_ANNOBJ:   " [void* array]
+ * - RP_ROWIND:   Factorized EP representation [int32 array]
+ * - RP_COLIND:   " [int32 array]
+ * - RP_BVALS:    " [double array]
+ * - RP_PI:       " [double array]
+ * - RP_BETA:     " [double array]
+ * - MARGPI:      Variable marginals
+ * - MARGBETA:    "
+ * - PIMINTHRES:  See above. Positive
+ *
+ * Return:
+ * - LOGZ:        log Z_EP
+ * - NSKIP:       Number of skipped potentials [int32]
+ * - DPARVEC:     Gradient w.r.t. PM_PARVEC. Optional
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_fact_logmarglik.h"
+#include "src/eptools/FactorizedEPDriver.h"
+
+void eptwrap_fact_logmarglik(int ain,int aout,int n,int m,
+			     W_IARRAY(pm_potids),W_IARRAY(pm_numpot),
+			     W_DARRAY(pm_parvec),W_IARRAY(pm_parshrd),
+			     W_ARRAY(pm_annobj,void*),W_IARRAY(rp_rowind),
+			     W_IARRAY(rp_colind),W_DARRAY(rp_bvals),
+			     W_DARRAY(rp_pi),W_DARRAY(rp_beta),
+			     W_DARRAY(margpi),W_DARRAY(margbeta),
+			     double piminthres,double* logz,int* nskip,
+			     W_DARRAY(dparvec),W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_fact_logmarglik","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=15)
+      W_RETERROR(2,"Need 15 input arguments");
+    if (aout<2 || aout>3)
+      W_RETERROR(2,"Wrong number of return arguments");
+    if (n<1) W_RETERROR(1,"N wrong");
+    if (m<1) W_RETERROR(1,"M wrong");
+    /* Potential manager */
+    Handle<PotentialManager> potMan;
+    createPotentialManager(W_ARR(pm_potids),W_ARR(pm_numpot),W_ARR(pm_parvec),
+			   W_ARR(pm_parshrd),W_ARR(pm_annobj),potMan,
+			   W_ERRARGS);
+    if (potMan->size()!=m)
+      W_RETERROR(1,"PM_*: Potential manager has wrong size");
+    /* Representation of B */
+    Handle<FactorizedEPRepresentation> epRepr;
+    createFactEPRepres(n,m,W_ARR(rp_rowind),W_ARR(rp_colind),W_ARR(rp_bvals),
+		       W_ARR(rp_pi),W_ARR(rp_beta),epRepr,W_ERRARGS);
+    /* Variable marginals */
+    ArrayHandle<double> margpiA,margbetaA;
+    W_CHKSIZE(margpi,n,"MARGPI");
+    W_CHKSIZE(margbeta,n,"MARGBETA");
+    W_MASKARRAY(margpi);
+    W_MASKARRAY(margbeta);
+    if (piminthres<=0.0)
+      W_RETERROR(1,"PIMINTHRES must be positive");
+    /* Return arguments */
+    if (aout>2)
+      W_CHKSIZE(dparvec,npm_parvec,"DPARVEC");
+    else
+      dparvec=0;
+    /* Create EP driver */
+    Handle<FactorizedEPDriver> epDriver;
+    try {
+      epDriver.changeRep(new FactorizedEPDriver(potMan,epRepr,margbetaA,
+						margpiA,piminthres));
+    } catch (StandardException ex) {
+      W_RETERROR_ARGS(1,"Cannot create FactorizedEPDriver:\n%s",ex.msg());
+    } catch (...) {
+      W_RETERROR(1,"Cannot create FactorizedEPDriver: Unspecified exception");
+    }
+    *nskip=epDriver->compLogMarginal(*logz,dparvec);
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s", ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
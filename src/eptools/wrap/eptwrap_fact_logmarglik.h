@@ -0,0 +1,31 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_FACT_LOGMARGLIK
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_FACT_LOGMARGLIK_H
+#define EPTWRAP_FACT_LOGMARGLIK_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_fact_logmarglik(int ain,int aout,int n,int m,
+			       W_IARRAY(pm_potids),W_IARRAY(pm_numpot),
+			       W_DARRAY(pm_parvec),W_IARRAY(pm_parshrd),
+			       W_ARRAY(pm_annobj,void*),W_IARRAY(rp_rowind),
+			       W_IARRAY(rp_colind),W_DARRAY(rp_bvals),
+			       W_DARRAY(rp_pi),W_DARRAY(rp_beta),
+			       W_DARRAY(margpi),W_DARRAY(margbeta),
+			       double piminthres,double* logz,int* nskip,
+			       W_DARRAY(dparvec),W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
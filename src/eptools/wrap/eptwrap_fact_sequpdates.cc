@@ -56,6 +56,23 @@
  * variables (I/O, content is overwritten).
  * SD_NUPD, SD_NREC return statistics about this datastructure (number of
  * update calls and block recomputations).
+ * If ROWTHREADS>1, each update on a potential j with |V_j| >= ROWTHRES is
+ * done by ROWTHREADS threads of the eptools thread pool (which is
+ * configured to use ROWTHREADS threads unless it already does, see
+ * EPTWRAP_THREADPOOL_CONFIG), each on a part of V_j (intra-row
+ * parallelism, see 'FactorizedEPDriver'). Useful only for very long rows.
+ * The local EP updates are still done by the calling thread, so
+ * potentials need not be thread-safe.
+ * Results are the same as without threads, up to rounding. To pass these
+ * arguments without selective damping, use empty SD_XXX arrays.
+ * If UC_ENTRIES is given (non-empty), results of local EP updates are
+ * cached there (see 'LocalUpdateCache'): an update on j whose cavity
+ * (h, rho) differs from the one stored for j by less than UC_RELTOL
+ * (relative; h relative to sqrt(rho)) reuses the stored results. For
+ * UC_RELTOL==0 (default), cavities must be equal. UC_ENTRIES (size 4*M)
+ * and UC_COUNTS (size 2*M; hits, then misses for each j) are I/O, the
+ * caller keeps them between calls. Zero UC_ENTRIES is an empty cache.
+ * The cache must be cleared by the caller if PM_PARVEC changes.
  *
  * Input:
  * - N:           Number of variables
@@ -80,6 +97,11 @@
  * - SD_TOPVAL:   " [double array; I/O]
  * - SD_SUBIND    " [int32 array]
  * - SD_SUBEXCL   ". Def.: false
+ * - ROWTHREADS:  Number of threads per update. Def.: 1
+ * - ROWTHRES:    Threshold on |V_j| for using them. Def.: 32768
+ * - UC_ENTRIES:  Local update cache. Optional [double array; I/O]
+ * - UC_COUNTS:   " [int32 array; I/O]
+ * - UC_RELTOL:   ". Def.: 0
  *
  * Return:
  * - RSTAT:       Return stati for each update. Optional [int32]
@@ -96,6 +118,8 @@
 #include "src/eptools/wrap/eptwrap_fact_sequpdates.h"
 #include "src/eptools/FactorizedEPDriver.h"
 #include "src/eptools/FactEPMaximumPiValues.h"
+#include "src/eptools/LocalUpdateCache.h"
+#include "src/eptools/ThreadPool.h"
 
 void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
 			     W_IARRAY(pm_potids),W_IARRAY(pm_numpot),
@@ -107,13 +131,17 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
 			     double dampfact,W_IARRAY(sd_numvalid),
 			     W_IARRAY(sd_topind),W_DARRAY(sd_topval),
 			     W_IARRAY(sd_subind),int sd_subexcl,
+			     int rowthreads,int rowthres,W_DARRAY(uc_entries),
+			     W_IARRAY(uc_counts),double uc_reltol,
 			     W_IARRAY(rstat),W_DARRAY(delta),
 			     W_DARRAY(sd_dampfact),int* sd_nupd,int* sd_nrec,
 			     W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_fact_sequpdates","wrap");
+
   try {
     /* Read arguments */
-    if (ain<16 || ain>22)
+    if (ain<16 || ain>27)
       W_RETERROR(2,"Wrong number of input arguments");
     if (aout>5)
       W_RETERROR(2,"Too many return arguments");
@@ -153,7 +181,7 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
     if (ain>16) {
       if (dampfact<0.0 || dampfact>=1.0)
 	W_RETERROR(1,"DAMPFACT: Out of range");
-      if (ain>17) {
+      if (ain>17 && nsd_numvalid>0) {
 	// Selective damping
 	//printMsgStdout("Point 4");
 	if (ain<20)
@@ -167,8 +195,8 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
 	W_CHKSIZE(sd_topval,nsd_topind,"SD_TOPVAL");
 	W_MASKARRAY(sd_topval);
 	//printMsgStdout("Point 5");
-	if (ain>20) {
-	  if (nsd_subind==0 || nsd_subind>m)
+	if (ain>20 && nsd_subind>0) {
+	  if (nsd_subind>m)
 	    W_RETERROR(1,"SD_SUBIND: Wrong size");
 	  W_MASKARRAY(sd_subind);
 	  if (ain==21)
@@ -177,6 +205,34 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
       }
     } else
       dampfact=0.0;
+    if (ain>22) {
+      if (rowthreads<1 || rowthreads>FactorizedEPDriver::maxRowThreads)
+	W_RETERROR(1,"ROWTHREADS: Out of range");
+      if (ain>23) {
+	if (rowthres<1)
+	  W_RETERROR(1,"ROWTHRES must be positive");
+      } else
+	rowthres=FactorizedEPDriver::defRowParThres;
+    } else
+      rowthreads=1;
+    Handle<LocalUpdateCache> updCache;
+    ArrayHandle<double> uc_entriesA;
+    ArrayHandle<int> uc_countsA;
+    if (ain>24 && nuc_entries>0) {
+      if (ain<26)
+	W_RETERROR(1,"Need UC_ENTRIES and UC_COUNTS");
+      W_CHKSIZE(uc_entries,4*m,"UC_ENTRIES");
+      W_CHKSIZE(uc_counts,2*m,"UC_COUNTS");
+      if (ain>26) {
+	if (uc_reltol<0.0)
+	  W_RETERROR(1,"UC_RELTOL must be nonnegative");
+      } else
+	uc_reltol=0.0;
+      W_MASKARRAY(uc_entries);
+      W_MASKARRAY(uc_counts);
+      updCache.changeRep(new LocalUpdateCache(m,2,uc_reltol,uc_entriesA,
+					      uc_countsA));
+    }
     /* Return arguments: Default values and check sizes */
     if (aout<5) {
       sd_nrec=0;
@@ -208,6 +264,7 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
     //printMsgStdout("Point 6");
     if (sd_k>0) {
       try {
+	MemTagScope mtag(EPMemoryTags::tagSelDamp);
 	//sprintf(W_ERRSTR,"MEX: n=%d,K=%d,numvalid=%d,topind=%d,topval=%d",n,
 	//	sd_k,sd_numvalidA.size(),sd_topindA.size(),sd_topvalA.size());
 	//printMsgStdout(W_ERRSTR);
@@ -227,6 +284,13 @@ void eptwrap_fact_sequpdates(int ain,int aout,int n,int m,W_IARRAY(updjind),
     try {
       epDriver.changeRep(new FactorizedEPDriver(potMan,epRepr,margbetaA,
 						margpiA,piminthres,epMaxPi));
+      if (rowthreads>1) {
+	epDriver->setRowParallel(rowthreads,rowthres);
+	if (ThreadPool::numThreads()!=rowthreads)
+	  ThreadPool::configure(rowthreads);
+      }
+      if (!(updCache==0))
+	epDriver->setUpdateCache(updCache);
     } catch (StandardException ex) {
       W_RETERROR_ARGS(1,"Cannot create FactorizedEPDriver:\n%s",ex.msg());
     } catch (...) {
@@ -24,7 +24,9 @@ extern "C" {
 			       double piminthres,double dampfact,
 			       W_IARRAY(sd_numvalid),W_IARRAY(sd_topind),
 			       W_DARRAY(sd_topval),W_IARRAY(sd_subind),
-			       int sd_subexcl,W_IARRAY(rstat),W_DARRAY(delta),
+			       int sd_subexcl,int rowthreads,int rowthres,
+			       W_DARRAY(uc_entries),W_IARRAY(uc_counts),
+			       double uc_reltol,W_IARRAY(rstat),W_DARRAY(delta),
 			       W_DARRAY(sd_dampfact),int* sd_nupd,int* sd_nrec,
 			       W_ERRORARGS);
 
@@ -17,6 +17,33 @@
  * ATTENTION: SD_SUBIND, SD_SUBEXCL are for SD w.r.t. pi only, the a|c
  * mechanism runs over all precision potentials.
  * The return values SD_Nxxx are sums over all SD mechanisms.
+ * Empty SD_xxx, SDA_xxx, SDC_xxx, SD_SUBIND arguments are treated as not
+ * given.
+ *
+ * Parallel updates: If NTHREADS>0, the updates in UPDJIND are done by
+ * 'ParallelFactEPDriver::parallelUpdates' with NTHREADS threads, instead
+ * of sequentially. Updates on disjoint variables are done concurrently,
+ * also updates sharing a precision variable tau_k if k is dense (shared
+ * by more than DENSEFRAC times the number of precision potentials in
+ * UPDJIND). For the latter, changes to a_k, c_k are merged at the end of
+ * each batch, applying selective damping for a|c there (see
+ * 'ParallelFactEPDriver'). Results do not depend on NTHREADS, but are
+ * different from sequential updates.
+ * The workers run on the eptools thread pool, which is configured to use
+ * NTHREADS threads (see EPTWRAP_THREADPOOL_CONFIG), unless it already
+ * does. If NTHREADS>1, all potentials must be thread-safe (see
+ * 'EPScalarPotential::isThreadSafe'), otherwise an error is returned.
+ * If THRCPUS is given (size NTHREADS), thread t is pinned to CPU
+ * THRCPUS[t], updates are assigned to threads by row blocks, and the
+ * representation, marginals and selective damping arrays are placed on
+ * the NUMA nodes of these CPUs (row blocks on the node of their thread,
+ * arrays indexed by variables interleaved; see 'NumaServices'). Pages are
+ * migrated, pages already in place are not moved again. Empty THRCPUS is
+ * treated as not given.
+ * Intra-row parallelism: For sequential updates (NTHREADS==0), if
+ * ROWTHREADS>1, each update on a potential j with |V_j| >= ROWTHRES is
+ * done by ROWTHREADS threads of the thread pool (see
+ * EPTWRAP_FACT_SEQUPDATES).
  *
  * Input:
  * - N:            Number of variables x_i
@@ -54,6 +81,12 @@
  * - SDC_TOPVAL:   " [double array; I/O]
  * - SD_SUBIND:    " [int32 array]
  * - SD_SUBEXCL:   ". Def.: false
+ * - NTHREADS:     Number of threads for parallel updates. Def.: 0
+ *                 (sequential updates)
+ * - DENSEFRAC:    See above. In (0,1]. Def.: 0.5
+ * - THRCPUS:      See above. Optional [int32 array]
+ * - ROWTHREADS:   See above. Def.: 1
+ * - ROWTHRES:     See above. Def.: 32768
  *
  * Return:
  * - RSTAT:        Return stati for each update. Optional [int32]
@@ -69,6 +102,8 @@
 #include "src/eptools/wrap/eptools_helper.h"
 #include "src/eptools/wrap/eptwrap_fact_sequpdates_bvprec.h"
 #include "src/eptools/FactorizedEPDriver.h"
+#include "src/eptools/ParallelFactEPDriver.h"
+#include "src/eptools/ThreadPool.h"
 #include "src/eptools/FactEPMaximumPiValues.h"
 #include "src/eptools/FactEPMaximumAValues.h"
 #include "src/eptools/FactEPMaximumCValues.h"
@@ -91,13 +126,18 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
 				    W_IARRAY(sda_topind),W_DARRAY(sda_topval),
 				    W_IARRAY(sdc_numvalid),W_IARRAY(sdc_topind),
 				    W_DARRAY(sdc_topval),W_IARRAY(sd_subind),
-				    int sd_subexcl,W_IARRAY(rstat),
+				    int sd_subexcl,int nthreads,
+				    double densefrac,W_IARRAY(thrcpus),
+				    int rowthreads,int rowthres,
+				    W_IARRAY(rstat),
 				    W_DARRAY(delta),W_DARRAY(sd_dampfact),
 				    int* sd_nupd,int* sd_nrec,W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_fact_sequpdates_bvprec","wrap");
+
   try {
     /* Read arguments */
-    if (ain<23 || ain>35)
+    if (ain<23 || ain>40)
       W_RETERROR(2,"Wrong number of input arguments");
     if (aout>5)
       W_RETERROR(2,"Too many return arguments");
@@ -150,7 +190,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     if (ain>23) {
       if (dampfact<0.0 || dampfact>=1.0)
 	W_RETERROR(1,"DAMPFACT: Out of range");
-      if (ain>24) {
+      if (ain>24 && nsd_numvalid>0) {
 	// Selective damping
 	//printMsgStdout("Point 4");
 	if (ain<27)
@@ -163,7 +203,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
 	W_MASKARRAY(sd_topind);
 	W_CHKSIZE(sd_topval,nsd_topind,"SD_TOPVAL");
 	W_MASKARRAY(sd_topval);
-	if (ain>27) {
+	if (ain>27 && nsda_numvalid>0) {
 	  if (ain<30)
 	    W_RETERROR(1,"Need all SDA_xxx");
 	  W_CHKSIZE(sda_numvalid,numk,"SDA_NUMVALID");
@@ -174,7 +214,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
 	  W_CHKSIZE(sda_topval,nsda_topind,"SDA_TOPVAL");
 	  W_MASKARRAY(sda_topind);
 	  W_MASKARRAY(sda_topval);
-	  if (ain>30) {
+	  if (ain>30 && nsdc_numvalid>0) {
 	    if (ain<33)
 	      W_RETERROR(1,"Need all SDC_xxx");
 	    W_CHKSIZE(sdc_numvalid,numk,"SDC_NUMVALID");
@@ -185,18 +225,49 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
 	    W_CHKSIZE(sdc_topval,nsdc_topind,"SDC_TOPVAL");
 	    W_MASKARRAY(sdc_topind);
 	    W_MASKARRAY(sdc_topval);
-	    if (ain>33) {
-	      if (nsd_subind==0 || nsd_subind>m)
+	    if (ain>33 && nsd_subind>0) {
+	      if (nsd_subind>m)
 		W_RETERROR(1,"SD_SUBIND: Wrong size");
 	      W_MASKARRAY(sd_subind);
 	      if (ain==34)
 		sd_subexcl=0;
+	    } else {
+	      sd_subind=0; nsd_subind=0;
 	    }
 	  }
 	}
       }
     } else
       dampfact=0.0;
+    if (ain>35) {
+      if (nthreads<0 || nthreads>ParallelFactEPDriver::maxThreads)
+	W_RETERROR(1,"NTHREADS: Out of range");
+      if (ain>36) {
+	if (densefrac<=0.0 || densefrac>1.0)
+	  W_RETERROR(1,"DENSEFRAC: Out of range");
+      } else
+	densefrac=0.5;
+      if (ain>37 && nthrcpus>0) {
+	if (nthreads==0)
+	  W_RETERROR(1,"THRCPUS: Requires NTHREADS>0");
+	W_CHKSIZE(thrcpus,nthreads,"THRCPUS");
+      } else {
+	thrcpus=0; nthrcpus=0;
+      }
+    } else
+      nthreads=0;
+    if (ain>38) {
+      if (rowthreads<1 || rowthreads>FactorizedEPDriver::maxRowThreads)
+	W_RETERROR(1,"ROWTHREADS: Out of range");
+      if (rowthreads>1 && nthreads>0)
+	W_RETERROR(1,"ROWTHREADS: Requires NTHREADS==0");
+      if (ain>39) {
+	if (rowthres<1)
+	  W_RETERROR(1,"ROWTHRES must be positive");
+      } else
+	rowthres=FactorizedEPDriver::defRowParThres;
+    } else
+      rowthreads=1;
     /* Return arguments: Default values and check sizes */
     if (aout<5) {
       sd_nrec=0;
@@ -230,6 +301,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     //printMsgStdout("Point 6");
     if (sd_k>0) {
       try {
+	MemTagScope mtag(EPMemoryTags::tagSelDamp);
 	//sprintf(errMsg,"MEX: n=%d,K=%d,numvalid=%d,topind=%d,topval=%d",numN,
 	//      sd_k,sd_numvalid.size(),sd_topind.size(),sd_topval.size());
 	//printMsgStdout(errMsg);
@@ -245,6 +317,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     }
     if (sda_k>0) {
       try {
+	MemTagScope mtag(EPMemoryTags::tagSelDamp);
 	epMaxA.changeRep(new FactEPMaximumAValues(epRepr,sda_k,sda_numvalidA,
 						  sda_topindA,sda_topvalA));
       } catch (StandardException ex) {
@@ -255,6 +328,7 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     }
     if (sdc_k>0) {
       try {
+	MemTagScope mtag(EPMemoryTags::tagSelDamp);
 	epMaxC.changeRep(new FactEPMaximumCValues(epRepr,sdc_k,sdc_numvalidA,
 						  sdc_topindA,sdc_topvalA));
       } catch (StandardException ex) {
@@ -265,12 +339,49 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     }
     /* Create EP driver */
     Handle<FactorizedEPDriver> epDriver;
+    Handle<ParallelFactEPDriver> parDriver;
     //printMsgStdout("Point 7");
     try {
-      epDriver.changeRep(new FactorizedEPDriver(potMan,epRepr,margbetaA,
-						margpiA,margaA,margcA,
-						piminthres,aminthres,cminthres,
-						epMaxPi,epMaxA,epMaxC));
+      if (nthreads==0) {
+	epDriver.changeRep(new FactorizedEPDriver(potMan,epRepr,margbetaA,
+						  margpiA,margaA,margcA,
+						  piminthres,aminthres,
+						  cminthres,epMaxPi,epMaxA,
+						  epMaxC));
+	if (rowthreads>1) {
+	  epDriver->setRowParallel(rowthreads,rowthres);
+	  if (ThreadPool::numThreads()!=rowthreads)
+	    ThreadPool::configure(rowthreads);
+	}
+      } else {
+	// Each thread needs its own potential manager
+	if (nthreads>1 && !potMan->isThreadSafe())
+	  W_RETERROR(1,"NTHREADS>1: Potentials are not thread-safe (see 'EPScalarPotential::isThreadSafe')");
+	ArrayHandle<Handle<PotentialManager> > thrPots(nthreads);
+	thrPots[0]=potMan;
+	for (int t=1; t<nthreads; t++)
+	  createPotentialManager(W_ARR(pm_potids),W_ARR(pm_numpot),
+				 W_ARR(pm_parvec),W_ARR(pm_parshrd),
+				 W_ARR(pm_annobj),thrPots[t],W_ERRARGS);
+	parDriver.changeRep(new ParallelFactEPDriver(potMan,epRepr,margbetaA,
+						     margpiA,margaA,margcA,
+						     piminthres,aminthres,
+						     cminthres,thrPots,
+						     densefrac,epMaxPi,epMaxA,
+						     epMaxC));
+	if (nthrcpus>0) {
+	  ArrayHandle<int> thrcpusA;
+	  W_MASKARRAY(thrcpus);
+	  parDriver->setAffinity(thrcpusA);
+	  parDriver->numaPlace(); // Placement is optional
+	}
+	// Workers run on the thread pool. Without THRCPUS, pinning set by
+	// EPTWRAP_THREADPOOL_CONFIG is kept if the size matches
+	if (nthrcpus>0)
+	  ThreadPool::configure(nthreads,thrcpus);
+	else if (ThreadPool::numThreads()!=nthreads)
+	  ThreadPool::configure(nthreads);
+      }
     } catch (StandardException ex) {
       W_RETERROR_ARGS(1,"Cannot create FactorizedEPDriver:\n%s",ex.msg());
     } catch (...) {
@@ -278,18 +389,28 @@ void eptwrap_fact_sequpdates_bvprec(int ain,int aout,int n,int m,
     }
 
     /* Main loop over updates */
-    for (int i=0; i<nupdjind; i++) {
-      int j=updjind[i];
-      //sprintf(errstr,"i=%d, j=%d",i,j);
-      //printMsgStdout(errstr);
-      int irstat=epDriver->sequentialUpdate(j,dampfact,(delta!=0)?(delta+i):0,
-					    (sd_dampfact!=0)?(sd_dampfact+i):0);
-      if (rstat!=0) rstat[i]=irstat;
-      if (irstat!=FactorizedEPDriver::updSuccess && delta!=0)
-	delta[i]=0.0;
-      if (irstat!=FactorizedEPDriver::updSuccess && sd_dampfact!=0)
-	sd_dampfact[i]=1.0;
-    }
+    if (nthreads>0) {
+      ArrayHandle<int> rstatA;
+      int* irstat=rstat;
+      if (irstat==0) {
+	rstatA.changeRep(nupdjind); irstat=rstatA.p();
+      }
+      parDriver->parallelUpdates(nupdjind,updjind,dampfact,irstat,delta,
+				 sd_dampfact);
+    } else
+      for (int i=0; i<nupdjind; i++) {
+	int j=updjind[i];
+	//sprintf(errstr,"i=%d, j=%d",i,j);
+	//printMsgStdout(errstr);
+	int irstat=epDriver->sequentialUpdate(j,dampfact,
+					      (delta!=0)?(delta+i):0,
+					      (sd_dampfact!=0)?(sd_dampfact+i):0);
+	if (rstat!=0) rstat[i]=irstat;
+	if (irstat!=FactorizedEPDriver::updSuccess && delta!=0)
+	  delta[i]=0.0;
+	if (irstat!=FactorizedEPDriver::updSuccess && sd_dampfact!=0)
+	  sd_dampfact[i]=1.0;
+      }
     //printMsgStdout("Point 9");
     if (sd_nupd!=0) {
       int nupd=0,nrec=0,tu,tr;
@@ -34,7 +34,10 @@ extern "C" {
 				      W_IARRAY(sdc_numvalid),
 				      W_IARRAY(sdc_topind),
 				      W_DARRAY(sdc_topval),W_IARRAY(sd_subind),
-				      int sd_subexcl,W_IARRAY(rstat),
+				      int sd_subexcl,int nthreads,
+				      double densefrac,W_IARRAY(thrcpus),
+				      int rowthreads,int rowthres,
+				      W_IARRAY(rstat),
 				      W_DARRAY(delta),W_DARRAY(sd_dampfact),
 				      int* sd_nupd,int* sd_nrec,W_ERRORARGS);
 
@@ -0,0 +1,132 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_FACT_TESTMONITOR
+ *
+ * EP with factorized Gaussian backbone. Keeps test set predictions in
+ * sync with the variable marginals MARGPI, MARGBETA during training,
+ * updating them incrementally. Details in 'FactEPTestMonitor' comments.
+ * The test set is given by the coupling factor B_p (column index
+ * TP_COLIND, nonzeros TP_BVALS, as in the factorized EP representation)
+ * and the test potentials TP_*. If TARGETS (values -1, +1) is not empty,
+ * accuracy is monitored (binary classification).
+ * The state ST_* is kept by the caller between calls. If TOL is
+ * negative, it is recomputed from scratch (this has to be done in the
+ * first call). Otherwise, only variables whose marginals changed by more
+ * than TOL (relative change in mean or stddev.) are propagated, via the
+ * column structure of B_p.
+ *
+ * Input:
+ * - N:            Number of variables
+ * - P:            Number of test points
+ * - TP_POTIDS:    Test potential manager [int32 array]
+ * - TP_NUMPOT:    " [int32 array]
+ * - TP_PARVEC:    " [double array]
+ * - TP_PARSHRD:   " [int32 array]
+ * - TP_ANNOBJ:    " [void* array]
+ * - TP_COLIND:    Column index of B_p [int32 array]
+ * - TP_BVALS:     Nonzeros of B_p [double array]
+ * - TARGETS:      Test targets (size P), or empty
+ * - MARGPI:       Variable marginals
+ * - MARGBETA:     "
+ * - ST_MARGMEANS: State (I/O): Marginal means (snapshot) [N]
+ * - ST_MARGVARS:  " Marginal variances (snapshot) [N]
+ * - ST_PREDMEANS: " Predictive means h_q [P]
+ * - ST_PREDVARS:  " Predictive variances rho_q [P]
+ * - ST_PREDLOGZ:  " Predictive log Z [P]
+ * - ST_STATS:     " Number correct, sum of ST_PREDLOGZ [2]
+ * - TOL:          See above
+ *
+ * Return:
+ * - NVARS:        Number of variables propagated. Optional
+ * - NROWS:        Number of test points recomputed. Optional
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_fact_testmonitor.h"
+#include "src/eptools/FactEPTestMonitor.h"
+
+void eptwrap_fact_testmonitor(int ain,int aout,int n,int p,
+			      W_IARRAY(tp_potids),W_IARRAY(tp_numpot),
+			      W_DARRAY(tp_parvec),W_IARRAY(tp_parshrd),
+			      W_ARRAY(tp_annobj,void*),W_IARRAY(tp_colind),
+			      W_DARRAY(tp_bvals),W_DARRAY(targets),
+			      W_DARRAY(margpi),W_DARRAY(margbeta),
+			      W_DARRAY(st_margmeans),W_DARRAY(st_margvars),
+			      W_DARRAY(st_predmeans),W_DARRAY(st_predvars),
+			      W_DARRAY(st_predlogz),W_DARRAY(st_stats),
+			      double tol,int* nvars,int* nrows,W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_fact_testmonitor","wrap");
+
+  try {
+    int nv,nr;
+
+    /* Read arguments */
+    if (ain!=19)
+      W_RETERROR(2,"Need 19 input arguments");
+    if (aout<0 || aout>2)
+      W_RETERROR(2,"Wrong number of return arguments");
+    if (n<1) W_RETERROR(1,"N wrong");
+    if (p<1) W_RETERROR(1,"P wrong");
+    /* Test potential manager */
+    Handle<PotentialManager> potMan;
+    createPotentialManager(W_ARR(tp_potids),W_ARR(tp_numpot),W_ARR(tp_parvec),
+			   W_ARR(tp_parshrd),W_ARR(tp_annobj),potMan,
+			   W_ERRARGS);
+    if (potMan->size()!=p)
+      W_RETERROR(1,"TP_*: Potential manager has wrong size");
+    if (potMan->numArgumentGroup(EPScalarPotential::atypeUnivariate)!=p)
+      W_RETERROR(1,"All test potentials must be in group 'atypeUnivariate'");
+    /* Arrays */
+    ArrayHandle<int> tp_colindA;
+    ArrayHandle<double> tp_bvalsA,targetsA,st_margmeansA,st_margvarsA,
+      st_predmeansA,st_predvarsA,st_predlogzA,st_statsA;
+    W_MASKARRAY(tp_colind);
+    W_MASKARRAY(tp_bvals);
+    if (ntargets>0) {
+      W_CHKSIZE(targets,p,"TARGETS");
+      W_MASKARRAY(targets);
+    }
+    W_CHKSIZE(margpi,n,"MARGPI");
+    W_CHKSIZE(margbeta,n,"MARGBETA");
+    W_CHKSIZE(st_margmeans,n,"ST_MARGMEANS");
+    W_CHKSIZE(st_margvars,n,"ST_MARGVARS");
+    W_CHKSIZE(st_predmeans,p,"ST_PREDMEANS");
+    W_CHKSIZE(st_predvars,p,"ST_PREDVARS");
+    W_CHKSIZE(st_predlogz,p,"ST_PREDLOGZ");
+    W_CHKSIZE(st_stats,2,"ST_STATS");
+    W_MASKARRAY(st_margmeans);
+    W_MASKARRAY(st_margvars);
+    W_MASKARRAY(st_predmeans);
+    W_MASKARRAY(st_predvars);
+    W_MASKARRAY(st_predlogz);
+    W_MASKARRAY(st_stats);
+    /* Create monitor */
+    Handle<FactEPTestMonitor> monitor;
+    try {
+      monitor.changeRep(new FactEPTestMonitor(n,p,tp_colindA,tp_bvalsA,
+					      potMan,targetsA,st_margmeansA,
+					      st_margvarsA,st_predmeansA,
+					      st_predvarsA,st_predlogzA,
+					      st_statsA));
+    } catch (StandardException ex) {
+      W_RETERROR_ARGS(1,"Cannot create FactEPTestMonitor:\n%s",ex.msg());
+    } catch (...) {
+      W_RETERROR(1,"Cannot create FactEPTestMonitor: Unspecified exception");
+    }
+    if (tol<0.0) {
+      monitor->reset(margbeta,margpi);
+      nv=n; nr=p;
+    } else
+      nv=monitor->update(margbeta,margpi,tol,&nr);
+    if (aout>0) *nvars=nv;
+    if (aout>1) *nrows=nr;
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s", ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
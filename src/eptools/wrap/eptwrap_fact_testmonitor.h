@@ -0,0 +1,32 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_FACT_TESTMONITOR
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_FACT_TESTMONITOR_H
+#define EPTWRAP_FACT_TESTMONITOR_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_fact_testmonitor(int ain,int aout,int n,int p,
+				W_IARRAY(tp_potids),W_IARRAY(tp_numpot),
+				W_DARRAY(tp_parvec),W_IARRAY(tp_parshrd),
+				W_ARRAY(tp_annobj,void*),W_IARRAY(tp_colind),
+				W_DARRAY(tp_bvals),W_DARRAY(targets),
+				W_DARRAY(margpi),W_DARRAY(margbeta),
+				W_DARRAY(st_margmeans),W_DARRAY(st_margvars),
+				W_DARRAY(st_predmeans),W_DARRAY(st_predvars),
+				W_DARRAY(st_predlogz),W_DARRAY(st_stats),
+				double tol,int* nvars,int* nrows,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,8 @@
 
 void eptwrap_getpotagroup(int ain,int aout,int pid,int* agid,W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_getpotagroup","wrap");
+
   try {
     /* Read arguments */
     if (ain!=1)
@@ -20,6 +20,8 @@
 
 void eptwrap_getpotid(int ain,int aout,char* name,int* pid,W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_getpotid","wrap");
+
   try {
     /* Read arguments */
     if (ain!=1)
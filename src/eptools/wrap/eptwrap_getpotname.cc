@@ -22,6 +22,8 @@ const char* eptwrap_getpotname_emptyStr = "";
 
 void eptwrap_getpotname(int ain,int aout,int pid,char** name,W_ERRORARGS)
 {
+  TraceScope trace("eptwrap_getpotname","wrap");
+
   try {
     /* Read arguments */
     if (ain!=1)
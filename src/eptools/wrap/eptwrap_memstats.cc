@@ -0,0 +1,81 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_MEMSTATS
+ *
+ * Allocation statistics per tag, see 'TrackingMemManager' and
+ * 'EPMemoryTags'. Only available if the code has been compiled with
+ * USE_OWN_MEMMAN (ACTIVE==1), otherwise the call has no effect and
+ * statistics are zero. Depending on MODE:
+ * - 0: Write statistics to STATS
+ * - 1: Reset statistics
+ * - 2: Enable collection of statistics (default)
+ * - 3: Disable collection of statistics
+ * STATS has size NTAGS*6 (NTAGS: number of tags in 'EPMemoryTags'). Row
+ * k (entries 6*k,...,6*k+5) is for tag k: number of allocations,
+ * deallocations, bytes allocated currently, high-water mark of bytes
+ * allocated, total bytes allocated, allocations per second. Apart from
+ * current bytes, these refer to the time since the last reset.
+ *
+ * Input:
+ * - MODE:   See above
+ * - STATS:  Statistics ret. here (MODE 0) [double array]
+ *
+ * Return:
+ * - ACTIVE: 1 if statistics are available, 0 otherwise
+ * - NTAGS:  Number of tags
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_memstats.h"
+
+void eptwrap_memstats(int ain,int aout,int mode,W_DARRAY(stats),int* active,
+		      int* ntags,W_ERRORARGS)
+{
+  int k;
+  double etime;
+  TrackingMemManager::TagStats tstats;
+  TraceScope trace("eptwrap_memstats","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=2)
+      W_RETERROR(2,"Need 2 input arguments");
+    if (aout!=2)
+      W_RETERROR(2,"Need 2 return arguments");
+    switch (mode) {
+    case 0:
+      W_CHKSIZE(stats,6*EPMemoryTags::numTags,"STATS");
+      etime=TrackingMemManager::elapsedTime();
+      for (k=0; k<EPMemoryTags::numTags; k++,stats+=6) {
+	TrackingMemManager::getStats(k,tstats);
+	stats[0]=(double) tstats.numAlloc;
+	stats[1]=(double) tstats.numFree;
+	stats[2]=(double) tstats.bytesCur;
+	stats[3]=(double) tstats.bytesPeak;
+	stats[4]=(double) tstats.bytesTotal;
+	stats[5]=(etime>0.0)?((double) tstats.numAlloc)/etime:0.0;
+      }
+      break;
+    case 1:
+      TrackingMemManager::resetStats();
+      break;
+    case 2:
+      TrackingMemManager::setEnabled(true);
+      break;
+    case 3:
+      TrackingMemManager::setEnabled(false);
+      break;
+    default:
+      W_RETERROR(2,"MODE: Invalid value");
+    }
+    *active=TrackingMemManager::isActive()?1:0;
+    *ntags=EPMemoryTags::numTags;
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_MEMSTATS
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_MEMSTATS_H
+#define EPTWRAP_MEMSTATS_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_memstats(int ain,int aout,int mode,W_DARRAY(stats),
+			int* active,int* ntags,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
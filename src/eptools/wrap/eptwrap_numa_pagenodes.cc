@@ -0,0 +1,48 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PAGENODES
+ *
+ * Determines the NUMA node of each memory page covered by array ARR (any
+ * type, NBYTES bytes), see 'NumaServices::pageNodes'. PNODES must have
+ * size >= NPAGES, the number of pages (NBYTES divided by page size, plus
+ * 1 is always enough). The first NPAGES entries are written. Entries for
+ * pages not yet placed are negative. If this is not supported, NPAGES is
+ * -1.
+ *
+ * Input:
+ * - ARR:    Array [char array]
+ * - PNODES: Page nodes ret. here [int32 array]
+ *
+ * Return:
+ * - NPAGES: Number of pages, or -1
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_numa_pagenodes.h"
+#include "src/eptools/NumaServices.h"
+
+void eptwrap_numa_pagenodes(int ain,int aout,W_ARRAY(arr,char),
+			    W_IARRAY(pnodes),int* npages,W_ERRORARGS)
+{
+  int np;
+  TraceScope trace("eptwrap_numa_pagenodes","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=2)
+      W_RETERROR(2,"Need 2 input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    np=NumaServices::numPages(arr,narr);
+    if (npnodes<np)
+      W_RETERROR_ARGS(2,"PNODES: Need size >= %d",np);
+    *npages=NumaServices::pageNodes(arr,narr,pnodes)?np:-1;
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PAGENODES
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_NUMA_PAGENODES_H
+#define EPTWRAP_NUMA_PAGENODES_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_numa_pagenodes(int ain,int aout,W_ARRAY(arr,char),
+			      W_IARRAY(pnodes),int* npages,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
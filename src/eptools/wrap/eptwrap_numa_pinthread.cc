@@ -0,0 +1,45 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PINTHREAD
+ *
+ * Pins the calling thread to CPU CPU (if CPU>=0). Also returns the NUMA
+ * node of CPU and the number of NUMA nodes (CPU<0: only NNODES).
+ *
+ * Input:
+ * - CPU:    CPU number
+ *
+ * Return:
+ * - SUCC:   Has thread been pinned?
+ * - NODE:   NUMA node of CPU (-1 if not available). Optional
+ * - NNODES: Number of NUMA nodes (0 if not available). Optional
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_numa_pinthread.h"
+#include "src/eptools/NumaServices.h"
+
+void eptwrap_numa_pinthread(int ain,int aout,int cpu,int* succ,int* node,
+			    int* nnodes,W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_numa_pinthread","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=1)
+      W_RETERROR(2,"Need 1 input argument");
+    if (aout<1 || aout>3)
+      W_RETERROR(2,"Wrong number of return arguments");
+    *succ=(cpu>=0 && NumaServices::pinCurrentThread(cpu));
+    if (aout>1)
+      *node=NumaServices::nodeOfCpu(cpu);
+    if (aout>2)
+      *nnodes=NumaServices::numNodes();
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PINTHREAD
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_NUMA_PINTHREAD_H
+#define EPTWRAP_NUMA_PINTHREAD_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_numa_pinthread(int ain,int aout,int cpu,int* succ,int* node,
+			      int* nnodes,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PLACE
+ *
+ * Places the memory of array ARR (any type, NBYTES bytes) on NUMA nodes,
+ * see 'NumaServices'. If BLKOFF is not given, pages are interleaved over
+ * the nodes NODES. Otherwise, ARR is split into blocks at byte offsets
+ * BLKOFF (size numel(NODES)+1, BLKOFF(1)==0, BLKOFF(end)==NBYTES), and
+ * block b goes to node NODES(b).
+ * Pages already touched are migrated. Nothing is done (SUCC==0) if
+ * NUMA placement is not supported.
+ *
+ * Input:
+ * - ARR:    Array to be placed [char array]
+ * - NODES:  NUMA nodes [int32 array]
+ * - BLKOFF: Block offsets (bytes) [int32 array]. Optional
+ *
+ * Return:
+ * - SUCC:   Success?
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_numa_place.h"
+#include "src/eptools/NumaServices.h"
+#include <vector>
+
+void eptwrap_numa_place(int ain,int aout,W_ARRAY(arr,char),W_IARRAY(nodes),
+			W_IARRAY(blkoff),int* succ,W_ERRORARGS)
+{
+  int b;
+  TraceScope trace("eptwrap_numa_place","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain<2 || ain>3)
+      W_RETERROR(2,"Wrong number of input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    if (nnodes<1)
+      W_RETERROR(2,"NODES must not be empty");
+    if (ain<3 || nblkoff==0)
+      *succ=NumaServices::placeInterleaved(arr,narr,nodes,nnodes);
+    else {
+      if (nblkoff!=nnodes+1 || blkoff[0]!=0 || blkoff[nnodes]!=narr)
+	W_RETERROR(2,"BLKOFF: Wrong size or wrong end points");
+      std::vector<size_t> boff(nblkoff);
+      for (b=0; b<nblkoff; b++) {
+	if (b>0 && blkoff[b]<blkoff[b-1])
+	  W_RETERROR(2,"BLKOFF must be nondecreasing");
+	boff[b]=blkoff[b];
+      }
+      *succ=NumaServices::placeBlocks(arr,&boff[0],nodes,nnodes);
+    }
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
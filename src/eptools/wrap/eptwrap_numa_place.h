@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_NUMA_PLACE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_NUMA_PLACE_H
+#define EPTWRAP_NUMA_PLACE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_numa_place(int ain,int aout,W_ARRAY(arr,char),W_IARRAY(nodes),
+			  W_IARRAY(blkoff),int* succ,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -49,6 +49,7 @@ void eptwrap_potmanager_isvalid(int ain,int aout,W_IARRAY(potids),
   ArrayHandle<int> potidsA,numpotA,parshrdA,tauindA;
   ArrayHandle<double> parvecA;
   ArrayHandle<void*> annobjA;
+  TraceScope trace("eptwrap_potmanager_isvalid","wrap");
 
   try {
     /* Read arguments */
@@ -0,0 +1,102 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_QUAD_ACCSCHED
+ *
+ * Controls the accuracy schedule attached to quadrature services ANNOBJ
+ * (void* to 'QuadratureServices', see 'QuadAccuracySchedule'). All
+ * quadrature potentials sharing ANNOBJ use the schedule. Depending on
+ * MODE:
+ * - 0: Attach new schedule with ACCMIN, ACCMAX, ACCFACT (replaces one
+ *      attached before). The first sweep uses ACCMAX
+ * - 1: Start new sweep, the accuracy is determined from DELTA, the
+ *      convergence criterion of the previous sweep
+ * - 2: Write statistics to STATS: for each sweep, accuracy, number of
+ *      quadrature calls, number of integrand evaluations. STATS must have
+ *      size >= 3*NSWEEPS (use MODE 3 with empty STATS to obtain NSWEEPS)
+ * - 3: Only return NSWEEPS
+ * - 4: Detach and delete schedule
+ * Modes 0 and 1 pass the accuracy to ANNOBJ, so that potentials can be
+ * updated concurrently afterwards.
+ *
+ * Input:
+ * - MODE:    See above
+ * - ANNOBJ:  Quadrature services
+ * - ACCMIN:  Minimum accuracy (MODE 0)
+ * - ACCMAX:  Maximum accuracy (MODE 0)
+ * - ACCFACT: Factor (MODE 0)
+ * - DELTA:   Convergence criterion of previous sweep (MODE 1)
+ *
+ * Return:
+ * - STATS:   Statistics (MODE 2)
+ * - NSWEEPS: Number of sweeps recorded (0 if no schedule is attached)
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_quad_accsched.h"
+#include "src/eptools/potentials/quad/QuadAccuracySchedule.h"
+
+void eptwrap_quad_accsched(int ain,int aout,int mode,void* annobj,
+			   double accmin,double accmax,double accfact,
+			   double delta,W_DARRAY(stats),int* nsweeps,
+			   W_ERRORARGS)
+{
+  int i,nq,nn;
+  QuadratureServices* qserv;
+  QuadAccuracySchedule* sched;
+
+  try {
+    /* Read arguments */
+    if (ain!=8)
+      W_RETERROR(2,"Need 8 input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    if (annobj==0)
+      W_RETERROR(1,"ANNOBJ is NULL");
+    qserv=(QuadratureServices*) annobj;
+    sched=qserv->getAccuracySchedule();
+    switch (mode) {
+    case 0:
+      if (accmin<=0.0 || accmax<accmin || accfact<=0.0)
+	W_RETERROR(2,"ACCMIN, ACCMAX, ACCFACT: Invalid values");
+      qserv->setAccuracySchedule(0);
+      delete sched;
+      sched=new QuadAccuracySchedule(accmin,accmax,accfact);
+      qserv->setAccuracySchedule(sched);
+      sched->apply(*qserv);
+      break;
+    case 1:
+      if (sched==0)
+	W_RETERROR(2,"No schedule attached to ANNOBJ");
+      sched->startSweep(delta);
+      sched->apply(*qserv);
+      break;
+    case 2:
+      if (sched==0)
+	W_RETERROR(2,"No schedule attached to ANNOBJ");
+      if (nstats<3*sched->numSweeps())
+	W_RETERROR(1,"STATS: Too small");
+      for (i=0; i<sched->numSweeps(); i++) {
+	sched->getSweepStats(i,stats[3*i],nq,nn);
+	stats[3*i+1]=(double) nq; stats[3*i+2]=(double) nn;
+      }
+      break;
+    case 3:
+      break;
+    case 4:
+      qserv->setAccuracySchedule(0);
+      delete sched;
+      sched=0;
+      break;
+    default:
+      W_RETERROR(2,"MODE: Invalid value");
+    }
+    *nsweeps=(sched==0)?0:sched->numSweeps();
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
@@ -0,0 +1,26 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_QUAD_ACCSCHED
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_QUAD_ACCSCHED_H
+#define EPTWRAP_QUAD_ACCSCHED_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_quad_accsched(int ain,int aout,int mode,void* annobj,
+			     double accmin,double accmax,double accfact,
+			     double delta,W_DARRAY(stats),int* nsweeps,
+			     W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_QUAD_FIXEDNODE
+ *
+ * Configures fixed-node Gauss-Hermite quadrature on quadrature services
+ * ANNOBJ (void* to 'QuadratureServices', see
+ * 'QuadratureServices::setFixedNodeQuad'). All quadrature potentials
+ * sharing ANNOBJ use it in batched updates (EPTWRAP_EPUPDATE_PARALLEL):
+ * moments are computed with a rule of order ORDER, checked against a
+ * rule of order CHECKORDER with tolerance TOL, lanes failing the check
+ * fall back to adaptive quadrature (see 'EPPotQuadLaplaceApprox').
+ * ORDER==0 switches fixed-node quadrature off.
+ * NOTE: ORDER=30, CHECKORDER=20, TOL=1e-5 accepts most lanes for
+ * log-concave potentials.
+ *
+ * Input:
+ * - ANNOBJ:     Quadrature services
+ * - ORDER:      Order of rule (0: Switch off)
+ * - CHECKORDER: Order of check rule (different from ORDER)
+ * - TOL:        Tolerance for check (positive)
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_quad_fixednode.h"
+#include "src/eptools/potentials/quad/QuadratureServices.h"
+
+void eptwrap_quad_fixednode(int ain,int aout,void* annobj,int order,
+			    int checkorder,double tol,W_ERRORARGS)
+{
+  QuadratureServices* qserv;
+  TraceScope trace("eptwrap_quad_fixednode","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain!=4)
+      W_RETERROR(2,"Need 4 input arguments");
+    if (aout!=0)
+      W_RETERROR(2,"No return arguments");
+    if (annobj==0)
+      W_RETERROR(1,"ANNOBJ is NULL");
+    qserv=(QuadratureServices*) annobj;
+    if (order!=0) {
+      if (order<1 || order>GaussHermiteRule::maxOrder || checkorder<1 ||
+	  checkorder>GaussHermiteRule::maxOrder)
+	W_RETERROR_ARGS(1,"ORDER, CHECKORDER: Must be in 1:%d",
+			GaussHermiteRule::maxOrder);
+      if (checkorder==order)
+	W_RETERROR(1,"CHECKORDER must be different from ORDER");
+      if (tol<=0.0)
+	W_RETERROR(1,"TOL must be positive");
+      qserv->setFixedNodeQuad(Handle<GaussHermiteRule>(new GaussHermiteRule(order)),
+			      Handle<GaussHermiteRule>(new GaussHermiteRule(checkorder)),
+			      tol);
+    } else
+      qserv->setFixedNodeQuad(Handle<GaussHermiteRule>(),
+			      Handle<GaussHermiteRule>(),tol);
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
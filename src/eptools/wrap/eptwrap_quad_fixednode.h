@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_QUAD_FIXEDNODE
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_QUAD_FIXEDNODE_H
+#define EPTWRAP_QUAD_FIXEDNODE_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_quad_fixednode(int ain,int aout,void* annobj,int order,
+			      int checkorder,double tol,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
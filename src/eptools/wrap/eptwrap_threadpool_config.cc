@@ -0,0 +1,53 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_THREADPOOL_CONFIG
+ *
+ * Configures the eptools thread pool (see 'ThreadPool'), which runs
+ * parallel loops of EPTWRAP_EPUPDATE_PARALLEL,
+ * EPTWRAP_FACT_COMPMARGINALS, EPTWRAP_FACT_COMPMAXPI, and others. If
+ * NTHREADS>0, the pool uses NTHREADS threads (1: serial). If THRCPUS is
+ * given (size NTHREADS), thread t is pinned to CPU THRCPUS[t]. Empty
+ * THRCPUS is treated as not given. For NTHREADS==0, nothing is changed.
+ *
+ * Input:
+ * - NTHREADS: Number of threads (0: No change)
+ * - THRCPUS:  CPU for each thread. Optional [int32 array]
+ *
+ * Return:
+ * - NUMTHR:   Number of threads of the pool
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_threadpool_config.h"
+#include "src/eptools/ThreadPool.h"
+
+void eptwrap_threadpool_config(int ain,int aout,int nthreads,
+			       W_IARRAY(thrcpus),int* numthr,W_ERRORARGS)
+{
+  TraceScope trace("eptwrap_threadpool_config","wrap");
+
+  try {
+    /* Read arguments */
+    if (ain<1 || ain>2)
+      W_RETERROR(2,"Wrong number of input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    if (nthreads<0 || nthreads>ThreadPool::maxThreads)
+      W_RETERROR_ARGS(1,"NTHREADS: Must be in 0:%d",ThreadPool::maxThreads);
+    if (ain<2 || nthrcpus==0)
+      thrcpus=0;
+    if (nthreads>0) {
+      if (thrcpus!=0)
+	W_CHKSIZE(thrcpus,nthreads,"THRCPUS");
+      ThreadPool::configure(nthreads,thrcpus);
+    }
+    *numthr=ThreadPool::numThreads();
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_THREADPOOL_CONFIG
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_THREADPOOL_CONFIG_H
+#define EPTWRAP_THREADPOOL_CONFIG_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_threadpool_config(int ain,int aout,int nthreads,
+				 W_IARRAY(thrcpus),int* numthr,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
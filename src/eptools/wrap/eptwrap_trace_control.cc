@@ -0,0 +1,65 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_TRACE_CONTROL
+ *
+ * Controls timeline tracing, see 'TraceServices'. Depending on MODE:
+ * - 0: Disable tracing (events are kept)
+ * - 1: Enable tracing, sampling period PERIOD (every PERIOD-th fine-
+ *      grained event is recorded, per thread), ring buffer size BUFSIZE
+ *      (events per thread). Events recorded so far are removed
+ * - 2: Write events to file FNAME (Chrome trace-event JSON)
+ * - 3: Remove all events
+ *
+ * Input:
+ * - MODE:    See above
+ * - PERIOD:  Sampling period (MODE 1)
+ * - BUFSIZE: Ring buffer size (MODE 1)
+ * - FNAME:   File name (MODE 2)
+ *
+ * Return:
+ * - RET:     Number of events written (MODE 2), otherwise 1 if tracing
+ *            is enabled, 0 if not
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_trace_control.h"
+
+void eptwrap_trace_control(int ain,int aout,int mode,int period,int bufsize,
+			   char* fname,int* ret,W_ERRORARGS)
+{
+  try {
+    /* Read arguments */
+    if (ain!=4)
+      W_RETERROR(2,"Need 4 input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    switch (mode) {
+    case 0:
+      TraceServices::disable();
+      break;
+    case 1:
+      if (period<1 || bufsize<1)
+	W_RETERROR(2,"PERIOD, BUFSIZE must be positive");
+      TraceServices::enable(period,bufsize);
+      break;
+    case 2:
+      if ((*ret=TraceServices::writeJSON(fname))<0)
+	W_RETERROR_ARGS(1,"Cannot open file %s",fname);
+      W_RETOK;
+      return;
+    case 3:
+      TraceServices::clear();
+      break;
+    default:
+      W_RETERROR(2,"MODE: Invalid value");
+    }
+    *ret=TraceServices::isEnabled()?1:0;
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
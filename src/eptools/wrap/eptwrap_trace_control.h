@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_TRACE_CONTROL
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_TRACE_CONTROL_H
+#define EPTWRAP_TRACE_CONTROL_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_trace_control(int ain,int aout,int mode,int period,int bufsize,
+			     char* fname,int* ret,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
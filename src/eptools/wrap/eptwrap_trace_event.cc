@@ -0,0 +1,46 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_TRACE_EVENT
+ *
+ * Timeline tracing (see 'TraceServices') of code outside of the wrapper
+ * functions. Returns the current time TNOW on the trace clock
+ * (microseconds). If the inputs are given and tracing is enabled, the
+ * interval from TS to TNOW is recorded as event NAME in category CAT
+ * (for the calling thread), with argument ARG (if >=0). Use TNOW of an
+ * earlier call as TS.
+ *
+ * Input:
+ * - NAME:    Event name. Optional
+ * - CAT:     Category
+ * - TS:      Begin time
+ * - ARG:     Argument (not shown if negative)
+ *
+ * Return:
+ * - TNOW:    Current time
+ * -------------------------------------------------------------------
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#include "src/main.h"
+#include "src/eptools/wrap/eptools_helper.h"
+#include "src/eptools/wrap/eptwrap_trace_event.h"
+
+void eptwrap_trace_event(int ain,int aout,char* name,char* cat,double ts,
+			 int arg,double* tnow,W_ERRORARGS)
+{
+  try {
+    /* Read arguments */
+    if (ain!=0 && ain!=4)
+      W_RETERROR(2,"Need 0 or 4 input arguments");
+    if (aout!=1)
+      W_RETERROR(2,"Need 1 return argument");
+    *tnow=TraceServices::now();
+    if (ain==4 && TraceServices::isEnabled())
+      TraceServices::record(TraceServices::intern(name),
+			    TraceServices::intern(cat),ts,*tnow-ts,arg);
+    W_RETOK;
+  } catch (StandardException ex) {
+    W_RETERROR_ARGS(1,"Caught LHOTSE exception: %s",ex.msg());
+  } catch (...) {
+    W_RETERROR(1,"Caught unspecified exception");
+  }
+}
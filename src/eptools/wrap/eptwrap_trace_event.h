@@ -0,0 +1,24 @@
+/* -------------------------------------------------------------------
+ * EPTWRAP_TRACE_EVENT
+ * -------------------------------------------------------------------
+ * Declaration wrapper function
+ * Author: Matthias Seeger
+ * ------------------------------------------------------------------- */
+
+#ifndef EPTWRAP_TRACE_EVENT_H
+#define EPTWRAP_TRACE_EVENT_H
+
+#include "src/eptools/wrap/eptools_helper_macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  void eptwrap_trace_event(int ain,int aout,char* name,char* cat,double ts,
+			   int arg,double* tnow,W_ERRORARGS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
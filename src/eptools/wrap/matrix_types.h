@@ -13,7 +13,13 @@
  * Matrix is n-by-m, stored column-major (Fortran convention) in 'buff'.
  * Column i starts at 'buff[i*stride]', where stride>=m. 'strcode':
  * - &UPLO(strcode): "L" or "U" (lower or upper triangular)
+ * - PACKED(strcode): 'P' (packed storage) or 0 (full storage)
  * - &DIAG(strcode): "N" or "U" (normal or unit diagonal)
+ *
+ * Packed storage (LAPACK 'L' convention, only for lower triangular, n-by-n):
+ * The n*(n+1)/2 elements of the lower triangle are stored column by
+ * column, the diagonal element of column i at 'buff[PACKEDL_DIAG(n,i)]',
+ * followed by the n-i-1 elements below it. 'stride' is not used.
  */
 typedef struct {
   double* buff;
@@ -22,6 +28,16 @@ typedef struct {
   char strcode[4];
 } fst_matrix;
 
+/*
+ * Same as 'fst_matrix', but for single precision matrix
+ */
+typedef struct {
+  float* buff;
+  int m,n;
+  int stride;
+  char strcode[4];
+} fst_smatrix;
+
 typedef struct {
   double* buff;
   int n;
@@ -33,8 +49,16 @@ typedef struct {
  */
 #define UPLO(arr) (arr)[0]
 
+#define PACKED(arr) (arr)[1]
+
 #define DIAG(arr) (arr)[2]
 
+/*
+ * Offset of diagonal element of column i in packed lower triangular
+ * storage
+ */
+#define PACKEDL_DIAG(n,i) ((i)*(n)-((i)*((i)-1))/2)
+
 /*
  * The BLAS/LAPACK function xxx is called as xxx_ in Linux, but as
  * xxx in Windows. Uncomment the corresponding definition here.